@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Multi-channel ADC scan bookkeeping, kept free of hardware so the native
+ * tests can feed it. The hardware side (DMA on ESP32-S3, conversion-complete
+ * interrupts on Teensy—see src/analog_input.cpp) produces *interleaved* frames:
+ * one conversion per configured channel, in list order, at a fixed frame rate.
+ * This class de-interleaves them into per-channel blocks that sensor classes
+ * can chew on, and stamps every frame from one clock, micros():
+ *
+ *   - the interrupt backend stamps each frame as it starts (ingest);
+ *   - the DMA backend stamps the last frame of each batch when it drains it and
+ *     back-dates the rest by period_us (ingest_ending). Rounding in period_us,
+ *     the ADC clock's own error, and frames DMA dropped therefore never build
+ *     up past one batch.
+ *
+ * Stamps never run backwards, and "A0 at 1234 µs" and "A3 at 1234 µs" really
+ * were sampled in the same scan.
+ */
+
+static const uint8_t kAdcMaxChannels = 8;
+static const uint16_t kAdcBlockFrames = 16;  // frames per block handed to sensors (4 ms at 4 kHz)
+static const uint8_t kAdcBlockSlots = 8;     // blocks buffered per channel before overrun
+
+/**
+ * One channel's slice of a scan block, copied out of the ring so the producer
+ * can reuse the slot while the sensor is still chewing on it.
+ */
+struct AdcBlock {
+  uint16_t samples[kAdcBlockFrames];
+  uint32_t stamps[kAdcBlockFrames];  // µs per sample, shared by every channel
+  uint16_t count;
+};
+
+class AdcScanner {
+ public:
+  // `pins` are opaque to this class (Arduino pin numbers on the board).
+  // Returns false if the list is empty or longer than kAdcMaxChannels.
+  bool configure(const uint8_t* pins, uint8_t count, uint32_t frame_rate_hz);
+
+  uint8_t channel_count() const { return count_; }
+  uint8_t pin(uint8_t channel) const { return pins_[channel]; }
+  // -1 when the pin is not in the scan list.
+  int channel_of(uint8_t pin) const;
+  uint32_t period_us() const { return period_us_; }
+
+  // Producer side (DMA-complete / ADC ISR context). `interleaved` holds
+  // `frames` × channel_count() conversions; `first_frame_us` stamps frame 0.
+  // Frames beyond kAdcBlockFrames per call are split across blocks.
+  void ingest(const uint16_t* interleaved, uint16_t frames, uint32_t first_frame_us);
+  // Same, for a batch whose *last* frame was sampled at `last_frame_us`; the
+  // earlier frames are back-dated by period_us(). If that would reach back
+  // past the previous batch (frames arrived faster than the nominal rate, or
+  // the previous anchor was late), the batch is spread evenly over the gap
+  // instead, so time keeps moving forward.
+  void ingest_ending(const uint16_t* interleaved, uint16_t frames, uint32_t last_frame_us);
+
+  // Consumer side. Copies the next unread full block for `channel`; false when
+  // caught up. The oldest block a lagging reader may still take sits right
+  // behind the slot being filled, so when the producer is an ISR the copy must
+  // run with interrupts masked (analog_read_block() does that).
+  bool read_block(uint8_t channel, AdcBlock* out);
+  // Newest conversion for `channel`, full block or not; false before any data.
+  bool latest(uint8_t channel, uint16_t* value, uint32_t* stamp_us) const;
+
+  // Blocks a channel's reader lost because the producer lapped it.
+  uint32_t overruns(uint8_t channel) const { return overruns_[channel]; }
+
+ private:
+  struct Slot {
+    uint16_t samples[kAdcMaxChannels][kAdcBlockFrames];
+    uint32_t stamps[kAdcBlockFrames];
+  };
+
+  void store(const uint16_t* frame, uint32_t stamp);
+
+  uint8_t pins_[kAdcMaxChannels] = {0};
+  uint8_t count_ = 0;
+  uint32_t period_us_ = 0;
+
+  Slot slots_[kAdcBlockSlots];
+  volatile uint32_t written_ = 0;  // completed blocks (monotonic)
+  uint16_t fill_ = 0;              // frames in the block being filled
+  volatile uint16_t last_[kAdcMaxChannels] = {0};
+  volatile uint32_t last_us_ = 0;
+  volatile bool have_data_ = false;
+
+  uint32_t read_[kAdcMaxChannels] = {0};
+  uint32_t overruns_[kAdcMaxChannels] = {0};
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Knobs for one baseline channel. Rates are per-sample blend factors, the same
+ * units as the old hand-written `0.999f * baseline + 0.001f * raw` followers.
+ */
+struct BaselineConfig {
+  float rate = 0.001f;        // how fast the baseline follows a quiet signal
+  float fall_rate = 0.0f;     // >0: faster rate when the input drops below the baseline (room got darker)
+  bool gate_below = true;     // false: drops below the baseline are never "activity" (only rises are touches)
+  float gate_sigmas = 3.0f;   // excursions past this many σ count as activity and barely move the baseline
+  float min_weight = 0.05f;   // floor on the gate so a permanent room change is absorbed eventually
+  float min_sigma = 1e-4f;    // keeps a dead-quiet channel from gating on rounding noise
+  uint16_t warmup = 32;       // samples averaged flat before the gate engages
+};
+
+/**
+ * Shared drift + noise-floor follower. Every sensor used to roll its own
+ * constant-rate low-pass; this one keeps a running mean *and* variance in O(1)
+ * per sample and lets the measured noise set how eagerly it adapts:
+ *
+ *   - a sample within a few σ of the mean is "room" → follow it at `rate`;
+ *   - a sample far outside is "player" → follow it at `rate * min_weight`.
+ *
+ * So a noisy room widens the gate and the baseline keeps up with bigger
+ * wiggles, while a quiet room locks tight and a touch stands out sooner. The
+ * σ it learns is exposed so GestureEngine thresholds can be set in noise units.
+ */
+class BaselineTracker {
+ public:
+  explicit BaselineTracker(const BaselineConfig& c = BaselineConfig());
+
+  // Start from a known level (e.g. an average taken in begin()) instead of 0.
+  void seed(float x);
+
+  // Folds in one raw sample and returns its deviation from the baseline as it
+  // stood *before* this sample, so a fast touch is measured against clean air.
+  float update(float x);
+
+  float mean() const { return mean_; }
+  float variance() const { return var_; }
+  float sigma() const;
+  // |x - mean| in units of σ; handy for narrating "that was a 5σ touch".
+  float z(float x) const;
+
+ private:
+  BaselineConfig c_;
+  float mean_ = 0.0f;
+  float var_ = 0.0f;
+  uint16_t count_ = 0;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sensor_sample.h"
+
+/**
+ * Always-on flight recorder: the last few minutes of what the engine saw and
+ * what the board did about it, kept in spare RAM so a misfire in a show can be
+ * replayed afterwards even if nobody was logging.
+ *
+ * Storage is a ring of fixed 256-byte blocks. Each block opens with a keyframe
+ * (sequence number, absolute time, absolute value). Inside a block, every
+ * record is a delta from the previous sample, so a block decodes on its own
+ * and overwriting the oldest block never breaks the next one. Appending is O(1):
+ * encode at most kMaxRecordBytes into scratch, start a fresh block if it does
+ * not fit, copy.
+ *
+ * Records (all time deltas are zigzag varints of signed µs):
+ *
+ *   0x01 dt dq        sample; dq is a zigzag varint in value units (1/16384)
+ *   0x80..0xFE        sample, same dt as the previous sample, dq = tag - 0xBF
+ *                     (-63..+63): a quiet 1 kHz stream costs one byte/sample
+ *   0x10 + g, dt, value, note   emitted gesture (g = Gesture enum; note 0xFF = none)
+ *   0x20 dt status d1 d2        MIDI message as it left for the wire
+ *
+ * Block header (little endian): u32 seq, u32 base_us, i16 base_q, u16 used.
+ * `used` counts header + records; bytes past it are junk.
+ */
+
+static const size_t kFlightBlockBytes = 256;
+static const size_t kFlightHeaderBytes = 12;
+static const float kFlightValueScale = 16384.0f;  // value units per 1.0
+
+enum class FlightRecordType : uint8_t { Sample, Gesture, Midi };
+
+struct FlightRecord {
+  FlightRecordType type = FlightRecordType::Sample;
+  uint32_t us = 0;
+  float value = 0.0f;    // Sample
+  uint8_t gesture = 0;   // Gesture: the Gesture enum value
+  uint8_t amount = 0;    // Gesture: the value the telemetry line carried
+  int16_t note = -1;     // Gesture: -1 when the event had no note
+  uint8_t midi[3] = {0, 0, 0};  // Midi: status, data1, data2
+};
+
+class FlightRecorder {
+ public:
+  static const size_t kMaxRecordBytes = 12;
+
+  // `storage` is carved into whole blocks; a tail smaller than a block is unused.
+  // Fewer than two blocks disables recording.
+  FlightRecorder(uint8_t* storage, size_t bytes);
+
+  void sample(const SensorSample& s);
+  void gesture(uint32_t us, uint8_t gesture, uint8_t amount, int note);
+  void midi(uint32_t us, uint8_t status, uint8_t d1, uint8_t d2);
+
+  uint32_t block_count() const { return blocks_; }
+  // Sequence numbers of the oldest surviving and the block being written; 0 = nothing yet.
+  uint32_t oldest_seq() const;
+  uint32_t newest_seq() const { return seq_; }
+  // Copy block `seq` (header + records) into `out` (kFlightBlockBytes).
+  // Returns its length, or 0 when that block was overwritten or never written.
+  size_t copy_block(uint32_t seq, uint8_t* out) const;
+  // Time from the oldest surviving keyframe to the latest record.
+  uint32_t span_us() const;
+  uint32_t records() const { return records_; }
+
+ private:
+  uint8_t* storage_;
+  uint32_t blocks_;
+  uint32_t seq_ = 0;   // block being written
+  uint8_t* block_ = nullptr;
+  size_t used_ = 0;
+  uint32_t last_us_ = 0;
+  int16_t last_q_ = 0;  // running value, carried across blocks into each keyframe
+  uint32_t last_dt_ = 0;
+  bool have_dt_ = false;  // a sample has set last_dt_ in this block
+  uint32_t records_ = 0;
+
+  void append(const uint8_t* rec, size_t n);
+  void open_block(uint32_t us);
+  uint8_t* slot(uint32_t seq) const { return storage_ + ((seq - 1) % blocks_) * kFlightBlockBytes; }
+};
+
+/**
+ * Decodes one block: the other half of the format above. The native tests use
+ * it to replay a recording through GestureEngine; tools/flight_dump.py is the
+ * same loop in Python.
+ */
+class FlightBlockReader {
+ public:
+  // False when `n` is shorter than a header or the header's `used` is nonsense.
+  bool open(const uint8_t* block, size_t n);
+  uint32_t seq() const { return seq_; }
+  // Next record in order; false at the end of the block or on a malformed record.
+  bool next(FlightRecord* out);
+
+ private:
+  const uint8_t* data_ = nullptr;
+  size_t used_ = 0;
+  size_t pos_ = 0;
+  uint32_t seq_ = 0;
+  uint32_t last_us_ = 0;
+  int32_t last_q_ = 0;
+  uint32_t last_dt_ = 0;
+  bool have_dt_ = false;
+};
+
+// Standard base64 (with padding). `out` needs 4 * ((n + 2) / 3) + 1 bytes; returns the length.
+size_t flight_base64(const uint8_t* in, size_t n, char* out);
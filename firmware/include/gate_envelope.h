@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Event-driven envelope for on/off inputs (PIR gate, MaKey touch). A pin-change
+ * interrupt drops timestamped edges into an EdgeRing; when someone asks for a
+ * sample, GateEnvelope replays the edges and evaluates the envelope in closed
+ * form:
+ *
+ *   env(t) = level + (env(t0) - level) * exp(-(t - t0) / tau)
+ *
+ * which is exactly what an EMA would converge to if it ran infinitely fast.
+ * So the answer does not depend on how often loop() happens to call read(),
+ * and edges keep their microsecond timestamps instead of the poll period.
+ */
+
+struct GateEdge {
+  uint32_t stamp_us;
+  bool level;
+};
+
+/** Single-producer (ISR) / single-consumer (loop) ring of edges. */
+class EdgeRing {
+ public:
+  static const uint8_t kCapacity = 32;  // power of two
+
+  // ISR side. A full ring drops the edge and counts it.
+  void push(uint32_t stamp_us, bool level);
+  // Loop side. Oldest edge first; false when empty.
+  bool pop(GateEdge* out);
+  // True once after any drop: the consumer should re-sync to the live pin.
+  bool take_overflow();
+  uint32_t dropped() const { return dropped_; }
+
+ private:
+  GateEdge edges_[kCapacity];
+  volatile uint8_t head_ = 0;  // written by the ISR
+  volatile uint8_t tail_ = 0;  // written by the loop
+  volatile bool overflow_ = false;
+  volatile uint32_t dropped_ = 0;
+};
+
+class GateEnvelope {
+ public:
+  // Rising toward 1 uses attack_tau_us, falling toward 0 uses release_tau_us.
+  // Edges closer than holdoff_us to the last accepted edge are chatter: the
+  // envelope keeps its level until the holdoff ends, then takes whatever the
+  // pin settled on.
+  GateEnvelope(float attack_tau_us, float release_tau_us, uint32_t holdoff_us = 0);
+
+  void reset(bool level, uint32_t now_us);
+  // Edges must arrive in time order (as they do out of an EdgeRing).
+  void edge(bool level, uint32_t stamp_us);
+  // Envelope at `now_us`; also advances the internal clock there.
+  float value_at(uint32_t now_us);
+
+  bool level() const { return level_; }
+  uint32_t last_edge_us() const { return last_edge_us_; }
+
+ private:
+  float attack_tau_us_;
+  float release_tau_us_;
+  uint32_t holdoff_us_;
+
+  float value_ = 0.0f;
+  uint32_t t_us_ = 0;
+  bool level_ = false;
+  uint32_t last_edge_us_ = 0;
+  bool pending_ = false;  // a level change waiting out the holdoff
+  bool pending_level_ = false;
+
+  void advance(uint32_t to_us);
+  void decay(uint32_t to_us);
+};
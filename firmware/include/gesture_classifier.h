@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "gesture_engine.h"
+#include "sensor_sample.h"
+
+/**
+ * Optional learned backend next to the hand-written rules. Same input (the
+ * SensorSample stream), same output shape (GestureResult), but the decision is
+ * a small int8 decision tree trained on captures from real players by
+ * tools/train_gesture_tree.py and compiled in as include/gesture_tree_model.h.
+ *
+ * Cost is fixed by construction: features come from a fixed window of
+ * kTreeWindow samples (one pass over it per sample), and the tree walk stops
+ * after at most kTreeMaxDepth comparisons. No heap, no floats in the tree.
+ *
+ * Everything is integer after the input is quantized, so the Python trainer
+ * can mirror the feature math bit-for-bit.
+ */
+
+static const uint8_t kTreeWindow = 32;    // samples per window (~32 ms at 1 kHz)
+static const uint8_t kTreeMaxDepth = 8;   // worst-case comparisons per sample
+static const uint8_t kTreeFlipDeadband = 4;  // quantized steps a delta must reach to count as a direction
+
+enum TreeFeature : uint8_t {
+  kFeatValue,   // newest sample, 0..127
+  kFeatMean,    // window mean
+  kFeatMin,
+  kFeatMax,
+  kFeatRange,   // max - min: wobble depth
+  kFeatSlope,   // newest minus the sample kTreeWindow/4 back, -128..127
+  kFeatFlips,   // direction changes in the window: wobble count
+  kFeatSpanMs,  // time covered by the window, ms (clamped 127): rate context
+  kTreeFeatureCount
+};
+
+/**
+ * One node of the exported tree. Internal nodes go to `left` when
+ * feature <= threshold, else `right`. Leaves have feature = -1, `left` = the
+ * Gesture they vote for, `right` = confidence scaled 0..255.
+ */
+struct GestureTreeNode {
+  int8_t feature;
+  int8_t threshold;
+  uint8_t left;
+  uint8_t right;
+};
+
+class GestureClassifier {
+ public:
+  // Uses the compiled-in model (include/gesture_tree_model.h).
+  GestureClassifier();
+  // Any other tree, e.g. from a test.
+  GestureClassifier(const GestureTreeNode* nodes, uint8_t count);
+
+  // Per sample. Event semantics match GestureEngine::process: one-shot gestures
+  // are reported once when the tree's label switches to them, Bow repeats
+  // while held, everything else is Idle. Features stay default; the engine owns those.
+  GestureResult process(const SensorSample& s);
+
+  // The window label behind the last process() call, before event shaping.
+  Gesture label() const { return label_; }
+  const int8_t* features() const { return features_; }
+
+  // Model sanity check: every path ends in a leaf within kTreeMaxDepth, child
+  // indices point forward (no cycles), feature indices are in range.
+  static bool validate(const GestureTreeNode* nodes, uint8_t count);
+  bool valid() const { return validate(nodes_, count_); }
+
+ private:
+  const GestureTreeNode* nodes_;
+  uint8_t count_;
+
+  int8_t window_[kTreeWindow] = {0};
+  uint32_t stamps_[kTreeWindow] = {0};
+  uint8_t head_ = 0;  // next write slot
+  uint8_t filled_ = 0;
+  int8_t features_[kTreeFeatureCount] = {0};
+  Gesture label_ = Gesture::Idle;
+
+  void push(const SensorSample& s);
+  void extract();
+  Gesture classify(float* confidence) const;
+};
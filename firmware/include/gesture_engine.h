@@ -5,17 +5,27 @@
 #include <algorithm>
 #include <cmath>
 
-struct SensorSample {
-  float value;
-  uint32_t micros;
-};
+#include "sensor_sample.h"
 
+/**
+ * Tunable gesture thresholds. Treat this like a calibration worksheet: these
+ * numbers start as defaults and should be tweaked with students while watching
+ * the debugger. The hysteresis (`on_thresh` / `off_thresh`) keeps the contact
+ * state stable; the time windows set how fast is "scrape" versus a fresh pluck.
+ */
 struct GestureParams {
   float on_thresh = 0.55f;        // crossing above => "contact"
   float off_thresh = 0.40f;       // falling below => "release"
   uint32_t min_retrigger_us = 60000;  // 60ms guard against double plucks
   uint32_t scrape_window_us = 40000;  // <40ms between mini-onsets => scrape grain
 
+  // Noise-relative contact thresholds. 0 keeps the absolute on/off values above;
+  // >0 re-expresses them as multiples of the sensor's measured noise σ (fed in via
+  // GestureEngine::set_noise_floor), so a humid or flickery room raises the bar
+  // on its own. Keep off_sigmas below on_sigmas to preserve the hysteresis.
+  float on_sigmas = 0.0f;
+  float off_sigmas = 0.0f;
+
   // Extended gestures (all narratable in class; edit + reflash or push via Serial)
   float harmonic_peak_min = 0.35f;    // light touch floor; tweak while listening for chime partials
   float harmonic_peak_max = 0.65f;    // light touch ceiling
@@ -31,32 +41,103 @@ struct GestureParams {
   uint32_t tremolo_grace_us = 8000;        // ignore micro-wobbles right at onset; gives players a breath
   uint8_t wobble_goal = 4;            // how many flips before we declare tremolo/vibrato
   float vibrato_depth_min = 0.15f;    // deeper swings ⇒ vibrato; shallow ⇒ tremolo
+
+  // Pluck dynamics. The first sample over on_thresh is always near on_thresh,
+  // so it says little about how hard the string was struck. With a look-ahead
+  // the engine holds the Pluck back this long after the (interpolated) onset,
+  // watching the attack climb, then reports it with the measured slope and
+  // peak. This is added latency, on purpose: 0 reports on the crossing sample
+  // as before; 2–5 ms catches most piezo and optical attacks.
+  uint32_t attack_lookahead_us = 0;
+  float attack_slope_full = 100.0f;   // attack slope (units/s) that counts as a full-strength strike
 };
 
 enum class Gesture { Idle, Pluck, Bow, Scrape, Harmonic, Muted, Tremolo, Vibrato };
 
+/**
+ * The measurements the rules above are made of, exposed instead of thrown
+ * away. Contact-scoped fields describe the current contact (or the one that
+ * just ended, on the release sample) and reset at the next onset.
+ */
+struct GestureFeatures {
+  float value = 0.0f;           // the sample just fed in
+  float velocity = 0.0f;        // d(value)/dt in units per second
+  bool contact = false;
+  uint32_t contact_us = 0;      // how long the contact has lasted
+  float peak = 0.0f;            // highest value this contact
+  float wobble_depth = 0.0f;    // max - min this contact
+  float wobble_center = 0.0f;   // (max + min) / 2: where the wobble swings around
+  uint8_t wobble_count = 0;     // direction flips inside tremolo_max_period_us
+  float wobble_rate_hz = 0.0f;  // full wobble cycles per second, smoothed
+
+  // Attack, measured once per contact (see attack_lookahead_us).
+  uint32_t onset_us = 0;        // when the signal crossed on_thresh, interpolated between samples
+  float attack_slope = 0.0f;    // steepest sample-to-sample rise during the attack, units per second
+  float strike = 0.0f;          // 0..1 blend of peak and slope; what MIDI velocity is made of
+};
+
+/**
+ * One update's verdict. `confidence` (0..1) says how far inside its rule the
+ * call landed: 1 = nowhere near a boundary, ~0.5 = it could have gone the
+ * other way. It describes the gesture in `gesture`, Idle included.
+ */
+struct GestureResult {
+  Gesture gesture = Gesture::Idle;
+  float confidence = 1.0f;
+  GestureFeatures features;
+};
+
+/**
+ * Converts a stream of SensorSamples into semantic gestures. The design goal
+ * is to keep the rules audible and debuggable. There is no hidden machine
+ * learning here—just explicit timing and hysteresis—so a class can reason about
+ * why a particular motion produced "bow" versus "pluck".
+ */
 class GestureEngine {
  public:
   explicit GestureEngine(const GestureParams& p);
-  Gesture update(const SensorSample& s);
+  // Full verdict: gesture, confidence, and the features behind it.
+  GestureResult process(const SensorSample& s);
+  // Just the label, for callers that only branch on the gesture.
+  Gesture update(const SensorSample& s) { return process(s).gesture; }
+
+  // Noise σ in the same normalized units as SensorSample::value (see
+  // Sensor::noise_floor). Only consulted when on_sigmas/off_sigmas are set.
+  void set_noise_floor(float sigma) { noise_sigma_ = sigma; }
+  float noise_floor() const { return noise_sigma_; }
+  // The thresholds actually in force after noise scaling; telemetry shows these
+  // so the class can watch the bar move when the lights change.
+  float effective_on_thresh() const;
+  float effective_off_thresh() const;
 
  private:
+  void measure_attack(GestureFeatures* f, float on_thresh) const;
   enum class ContactState { Released, Attacking, Sustaining };
+  struct RuleState;  // the shared verdict's view of these fields (gesture_engine.cpp)
 
   GestureParams p_;
+  float noise_sigma_ = 0.0f;
   bool contact_ = false;
-  uint32_t last_onset_us_ = 0;
-  uint32_t contact_start_us_ = 0;
+  // Ages, not timestamps, so nothing aliases when micros() wraps (see process()).
+  uint32_t onset_age_us_ = 0;    // since the last accepted onset: the retrigger/scrape guard
+  uint32_t contact_age_us_ = 0;  // since this contact began
+  uint32_t onset_us_ = 0;     // interpolated crossing time
+  float attack_slope_ = 0.0f;  // steepest rise from the crossing through the look-ahead
+  bool pluck_pending_ = false;  // onset seen, still inside the look-ahead
+  float pluck_timing_confidence_ = 1.0f;
   float peak_value_ = 0.0f;
   float last_value_ = 0.0f;
+  uint32_t last_sample_us_ = 0;
+  bool have_sample_ = false;
+  float velocity_ = 0.0f;
+  float wobble_rate_hz_ = 0.0f;
   float wobble_min_ = 1.0f;
   float wobble_max_ = 0.0f;
   uint8_t wobble_count_ = 0;
-  uint32_t last_wobble_us_ = 0;
+  uint32_t wobble_age_us_ = 0;  // since the last direction flip
   bool last_direction_up_ = true;
   bool harmonic_called_ = false;
   bool modulation_called_ = false;
   bool mute_candidate_ = false;
   ContactState contact_state_ = ContactState::Released;
 };
-
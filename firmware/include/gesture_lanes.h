@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "gesture_engine.h"
+
+/**
+ * GestureEngine, packed for arrays. One engine is ~150 bytes: floats and
+ * uint32_t timestamps for everything, plus its own copy of GestureParams.
+ * That is fine for one string and wasteful for a 64-pad capacitive sheet or
+ * an optical curtain, where every lane uses the same thresholds and the
+ * per-sample walk over all lanes falls out of the ESP32-S3's cache.
+ *
+ * GestureLanes runs the same rules over lanes that keep only what the rules
+ * need, squeezed to 24 bytes each:
+ *
+ *   - values as 16-bit fractions of full scale (0..65535 ↔ 0..1)
+ *   - one absolute timestamp per lane; every other time is an age in 16 µs
+ *     ticks, saturating at ~1 s, so every window must be shorter than that
+ *     (add_params refuses a block that is not)
+ *   - the state machine's flags, the wobble count, and the pluck timing
+ *     confidence bit-packed into one word
+ *   - thresholds and windows in shared parameter blocks, referenced by index
+ *
+ * What the packing costs, against GestureEngine on the same samples:
+ *   - features come back quantized (values to 1/65535, wobble rate to 1/2 Hz,
+ *     attack slope to 1/255 of attack_slope_full and saturating there)
+ *   - contact_us saturates at kLaneMaxAgeUs, and the wobble count at 15
+ *   - onset_us is the first sample over the threshold, not interpolated
+ *     between samples, so a look-ahead pluck can land one sample later
+ *   - a repeated timestamp reads velocity 0 instead of keeping the last one
+ *   - the first contact after reset is always a pluck (GestureEngine's
+ *     retrigger guard counts from micros() == 0, so it can call a scrape)
+ * The gesture calls themselves match (test/test_gesture_lanes checks this).
+ *
+ * The caller owns the lane storage so it can live wherever the board has
+ * room (a static array, DMAMEM, PSRAM).
+ */
+static const uint32_t kLaneTickUs = 16;
+static const uint32_t kLaneMaxAgeUs = 0xFFFFu * kLaneTickUs;
+
+struct PackedLane {
+  uint32_t last_us;      // the lane's one absolute time: its last sample
+  uint16_t last_q;       // last value, 1/65535ths
+  uint16_t peak_q;       // highest value this contact
+  uint16_t wobble_min_q;
+  uint16_t wobble_max_q;
+  uint16_t contact_age;  // ticks since contact started
+  uint16_t onset_age;    // ticks since the last accepted onset (retrigger/scrape guard)
+  uint16_t wobble_age;   // ticks since the last direction flip
+  uint16_t flags;        // see gesture_lanes.cpp: contact, state, wobble count, ...
+  uint8_t slope;         // steepest attack, 1/255ths of attack_slope_full
+  uint8_t rate;          // wobble rate, half Hz (up to 127.5)
+  uint8_t noise;         // noise σ, 1/2048ths of full scale
+  uint8_t block;         // which parameter block this lane uses
+};
+static_assert(sizeof(PackedLane) <= 24, "PackedLane grew past its 24-byte budget");
+
+/**
+ * One shared parameter block: the GestureParams it came from (the shared
+ * verdict in gesture_rules.h reads those, with wobble_goal capped at 15, the
+ * most the packed count can hold), plus what the per-sample state updates
+ * compare against, converted once into the units the lanes store.
+ */
+struct LaneParams {
+  GestureParams p;
+  uint16_t on_q, off_q;
+  uint16_t tremolo_delta_q;
+  uint16_t tremolo_period_ticks, grace_ticks;
+};
+
+class GestureLanes {
+ public:
+  static const uint8_t kMaxBlocks = 4;
+
+  static const int kBlocksFull = -1;   // add_params: all kMaxBlocks taken
+  static const int kWindowTooLong = -2;  // add_params: a window the ages cannot count up to
+
+  // Every lane starts on block 0, built from `p`. If `p` does not fit (see
+  // add_params) there are no lanes at all: valid() is false and every call is
+  // a no-op, rather than lanes quietly disagreeing with GestureEngine.
+  GestureLanes(PackedLane* lanes, uint16_t count, const GestureParams& p);
+  bool valid() const { return block_count_ > 0; }
+
+  // Another parameter block (say, the bass pads want a lower threshold).
+  // Returns its index, kBlocksFull, or kWindowTooLong when any time window
+  // reaches kLaneMaxAgeUs: a saturated age would never get past it, so the
+  // lane would never fire (or never stop guarding) where GestureEngine does.
+  int add_params(const GestureParams& p);
+  // Whether every window in `p` fits under kLaneMaxAgeUs.
+  static bool fits(const GestureParams& p);
+  // Move a lane to a block; the lane starts over, released.
+  void assign(uint16_t lane, uint8_t block);
+  void reset(uint16_t lane);
+
+  // Same contract as GestureEngine::process, per lane.
+  GestureResult process(uint16_t lane, const SensorSample& s);
+  Gesture update(uint16_t lane, const SensorSample& s) { return process(lane, s).gesture; }
+
+  void set_noise_floor(uint16_t lane, float sigma);
+  float noise_floor(uint16_t lane) const;
+  float effective_on_thresh(uint16_t lane) const;
+  float effective_off_thresh(uint16_t lane) const;
+
+  uint16_t lane_count() const { return count_; }
+  uint8_t block_count() const { return block_count_; }
+
+ private:
+  PackedLane* lanes_;
+  uint16_t count_;
+  LaneParams blocks_[kMaxBlocks];
+  uint8_t block_count_ = 0;
+
+  void thresholds(const PackedLane& l, uint16_t* on_q, uint16_t* off_q) const;
+  struct LaneRuleState;  // the shared verdict's view of a lane (gesture_lanes.cpp)
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Asynchronous I²C, one transaction in flight per bus. A driver fills in a
+ * transaction, submits it, and comes back later to look at `status`; nothing
+ * here ever waits on the wire. The hardware backends (i2c_bus_hw.cpp) finish
+ * transactions from the peripheral interrupt; the native tests use a simulated
+ * bus that finishes them when the test advances its clock.
+ */
+enum class I2cStatus : uint8_t { Idle, Pending, Done, Nack, Error };
+
+struct I2cTransaction {
+  uint8_t address = 0;          // 7-bit
+  const uint8_t* tx = nullptr;  // written first (usually the register index)
+  uint8_t tx_len = 0;
+  uint8_t* rx = nullptr;        // then read after a repeated start, if rx_len > 0
+  uint8_t rx_len = 0;
+  volatile I2cStatus status = I2cStatus::Idle;
+};
+
+class I2cBus {
+ public:
+  // Starts `t` if the bus is free and returns true; returns false (and leaves
+  // `t` untouched) while another transaction is in flight. `t` and its buffers
+  // must stay alive until status leaves Pending.
+  virtual bool submit(I2cTransaction* t) = 0;
+  virtual bool busy() const = 0;
+  virtual ~I2cBus() {}
+};
+
+/** Digital outputs the ToF array needs for XSHUT sequencing. */
+class GpioOut {
+ public:
+  virtual void write(uint8_t pin, bool high) = 0;
+  virtual ~GpioOut() {}
+};
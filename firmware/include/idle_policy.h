@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "sensor_sample.h"
+
+/**
+ * Knobs for adaptive acquisition. A gallery install spends most of its night
+ * with nobody touching the string; these decide when the board may doze and
+ * how often it still looks while dozing.
+ */
+struct IdleParams {
+  uint32_t idle_after_us = 2000000;    // quiet this long before dozing
+  float quiet_fraction = 0.5f;         // "quiet" = below off_thresh × this (the margin)
+  uint32_t idle_period_us = 10000;     // one look every 10 ms while dozing, at most
+  uint32_t min_idle_period_us = 1000;  // late wakes never shrink the period below this
+  float rise_margin = 0.5f;            // doze at most this share of the sensor's quiet→on rise
+  uint8_t restore_after_wakes = 4;     // on-time wakes in a row before a shrunk period doubles back
+};
+
+/** Power-side counters; `{"power":"stats"}` prints them. */
+struct IdleStats {
+  float duty = 1.0f;            // fraction of time awake since boot
+  float dozing = 0.0f;          // fraction of time spent in the dozing state (awake or not)
+  uint32_t wakes = 0;           // dozing → full rate transitions
+  uint32_t late_wakes = 0;      // wakes that found the signal already past on_thresh
+  uint32_t last_wake_latency_us = 0;   // how long the activity could have gone unseen
+  uint32_t worst_wake_latency_us = 0;
+  uint32_t idle_period_us = 0;  // current dozing period (shrinks after late wakes)
+  bool can_doze = false;        // false for sensors that can jump to on_thresh in one sample
+};
+
+/**
+ * Decides, sample by sample, whether loop() may sleep before the next read.
+ *
+ * Full rate: no sleeping at all. After `idle_after_us` below the quiet level
+ * the policy starts dozing: one sample per idle period, sleeping in between.
+ * The first sample above the quiet level wakes it, and the very next read is
+ * back at full rate.
+ *
+ * Onset latency only survives a doze if the wake lands before the onset, so
+ * the policy dozes only on sensors whose output is low-passed (Sensor::
+ * rise_tau_us). Even a full-scale step through a one-pole filter with time
+ * constant tau needs tau·ln((1 - quiet) / (1 - on)) to climb from the quiet
+ * level to on_thresh, and the idle period is held to `rise_margin` of that, so
+ * some sample always lands in between and wakes the board first. Sensors that
+ * can jump in one sample (piezo, pads, pins) never doze.
+ *
+ * A wake that finds the signal already past on_thresh was late anyway (the
+ * sensor overstated its tau); the policy halves its idle period, and doubles
+ * it back after `restore_after_wakes` on-time wakes in a row.
+ */
+class IdlePolicy {
+ public:
+  explicit IdlePolicy(const IdleParams& p = IdleParams());
+
+  void set_enabled(bool on);
+  bool enabled() const { return enabled_; }
+  // The sensor's output time constant (Sensor::rise_tau_us); 0 never dozes.
+  void set_rise_tau_us(float tau_us) { rise_tau_us_ = tau_us; }
+
+  // Every acquired sample, with the thresholds the engine is using right now.
+  void observe(const SensorSample& s, float on_thresh, float off_thresh);
+  // How long loop() may sleep before the next read; 0 at full rate.
+  uint32_t sleep_budget_us(uint32_t now_us) const;
+  // Bookkeeping for duty cycle: loop() reports what it actually slept.
+  void note_slept(uint32_t us) { slept_us_ += us; }
+
+  bool dozing() const { return dozing_; }
+  IdleStats stats() const;
+
+ private:
+  // Longest idle period that still wakes before on_thresh; 0 = never doze.
+  uint32_t rise_cap_us(float on_thresh, float quiet) const;
+  uint32_t period_us() const { return idle_period_us_ < rise_cap_us_ ? idle_period_us_ : rise_cap_us_; }
+
+  IdleParams p_;
+  bool enabled_ = true;
+  bool dozing_ = false;
+  bool started_ = false;
+  float rise_tau_us_ = 0.0f;
+  uint32_t rise_cap_us_ = 0;
+  uint32_t idle_period_us_;
+  uint8_t on_time_wakes_ = 0;  // in a row, since the last late wake
+  uint32_t last_us_ = 0;
+  uint32_t quiet_since_us_ = 0;
+  uint32_t doze_since_us_ = 0;
+  uint64_t dozed_us_ = 0;  // completed dozing spans
+  uint64_t slept_us_ = 0;
+  uint32_t wakes_ = 0;
+  uint32_t late_wakes_ = 0;
+  uint32_t last_wake_latency_us_ = 0;
+  uint32_t worst_wake_latency_us_ = 0;
+  uint64_t elapsed_us_ = 0;  // total observed time, 64-bit so a week-long show cannot wrap it
+};
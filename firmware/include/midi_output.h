@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Raw channel-voice destination. The firmware wraps the 47effects MIDI
+ * instance; native tests record into an array so the message stream can be
+ * asserted byte-for-byte. Channels are 1-16, matching the MIDI library.
+ */
+class MidiSink {
+ public:
+  virtual void note_on(uint8_t note, uint8_t velocity, uint8_t channel) = 0;
+  virtual void note_off(uint8_t note, uint8_t velocity, uint8_t channel) = 0;
+  virtual void control_change(uint8_t number, uint8_t value, uint8_t channel) = 0;
+  virtual void pitch_bend(int16_t bend, uint8_t channel) = 0;  // -8192..8191, 0 = center
+  virtual void channel_pressure(uint8_t pressure, uint8_t channel) = 0;
+  virtual ~MidiSink() {}
+};
+
+/**
+ * Global: the v0.2 behavior. Every note and controller lives on one channel, so
+ * bowing one string bends every sounding note.
+ * Mpe: MIDI Polyphonic Expression lower zone. Channel 1 is the manager and each
+ * sounding note borrows its own member channel, so pitch bend, pressure, and
+ * timbre (CC74) only touch the note they belong to.
+ */
+enum class MidiMode : uint8_t { Global, Mpe };
+
+/**
+ * Routes note + expression intents to channels. The mapping layer talks in
+ * "this note, this much pressure" and the router decides which channel carries
+ * it. Expression is change-only: repeating a value already on the wire costs
+ * nothing, which keeps the USB link quiet while a bow hovers.
+ *
+ * Expression dimensions use the MPE names. In Global mode they fall back to the
+ * classic lanes: pressure → CC1 (mod wheel), timbre → CC11 (expression),
+ * bend → channel pitch bend.
+ */
+class MidiVoiceRouter {
+ public:
+  static const uint8_t kGlobalChannel = 1;
+  static const uint8_t kMpeManagerChannel = 1;
+  static const uint8_t kMaxMemberChannels = 15;  // channels 2..16
+
+  explicit MidiVoiceRouter(MidiSink& sink, uint8_t member_channels = kMaxMemberChannels);
+
+  // Releases anything sounding, then announces the new layout. Entering MPE
+  // sends the MPE Configuration Message (RPN 6) so the synth opens its zone;
+  // leaving MPE sends the same RPN with zero members to close it.
+  void set_mode(MidiMode mode);
+  MidiMode mode() const { return mode_; }
+  uint8_t member_channels() const { return member_count_; }
+
+  void note_on(uint8_t note, uint8_t velocity);
+  void note_off(uint8_t note);
+  void all_notes_off();
+
+  // Per-note expression. `note` < 0 (or a note that is not sounding) targets
+  // the whole zone: the manager channel in MPE, the global channel otherwise.
+  void set_pressure(int note, uint8_t value);
+  void set_timbre(int note, uint8_t value);
+  void set_bend(int note, int16_t bend);
+  // Any other controller on the note's channel. Not change-tracked: the
+  // caller decides when a value is worth sending (RouteMatrix does). A
+  // controller that is also a pressure/timbre lane updates that lane's cache.
+  void set_cc(int note, uint8_t number, uint8_t value);
+
+  // 0 when the note is not sounding.
+  uint8_t channel_for(uint8_t note) const;
+
+ private:
+  static const uint8_t kChannels = 16;
+  static const int16_t kUnknown = -32768;  // forces the next value onto the wire
+
+  struct Voice {
+    int16_t note = -1;  // -1 == channel free
+    uint32_t stamp = 0;  // allocation/release order for least-recently-used reuse
+  };
+
+  // Last value sent per channel, so expression only goes out when it changes.
+  struct ChannelState {
+    int16_t bend = kUnknown;
+    int16_t pressure = kUnknown;
+    int16_t timbre = kUnknown;
+  };
+
+  MidiSink& sink_;
+  MidiMode mode_ = MidiMode::Global;
+  uint8_t member_count_;
+  uint32_t clock_ = 0;
+  Voice voices_[kMaxMemberChannels];
+  ChannelState state_[kChannels];
+
+  uint8_t allocate_channel();
+  uint8_t expression_channel(int note) const;
+  void send_pressure(uint8_t channel, uint8_t value);
+  void send_timbre(uint8_t channel, uint8_t value);
+  void send_bend(uint8_t channel, int16_t bend);
+  void send_mpe_configuration(uint8_t members);
+  void reset_channel_state();
+};
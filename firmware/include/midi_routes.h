@@ -0,0 +1,184 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "gesture_engine.h"
+#include "midi_output.h"
+
+/**
+ * Gesture → MIDI as data instead of a switch statement. Every venue wants a
+ * different mapping (this synth wants bow on CC74, that one wants pressure;
+ * the dancer's rig wants plucks an octave down), and nobody wants to reflash
+ * on site. So the mapping is a small table of routes, each one saying:
+ *
+ *   when <trigger> happens, take <input>, bend it through <curve>, send it to <dest>
+ *
+ *   {"route":{"on":"bow","in":"value","to":"cc","cc":74,"curve":"exp","k":2}}
+ *
+ * Several routes may share a trigger (vibrato drives bend *and* the vibrato
+ * knobs), and the same input may feed several destinations.
+ *
+ * The curve is a 128-entry lookup table built when the route is loaded, so
+ * the per-frame cost is: quantize the engine's features to 0..127 once
+ * (route_frame), then for each route an index, a table read, and a compare.
+ * No floats, no pow(), nothing that scales with curve complexity.
+ *
+ * Tables are double-buffered. Route lines fill a staging table while the
+ * active one keeps playing; {"routes":"commit"} swaps them between frames, so
+ * a half-typed mapping never reaches the synth.
+ */
+
+// What fires a route. The first seven match Gesture so a frame's gesture is
+// its own trigger; the last three are frame states rather than gestures.
+enum class RouteTrigger : uint8_t {
+  Pluck = 1,
+  Bow,
+  Scrape,
+  Harmonic,
+  Muted,
+  Tremolo,
+  Vibrato,
+  Release,  // contact just ended with a note sounding (the note-off itself is built in)
+  Contact,  // every frame while touching, whatever the gesture
+  Always,   // every frame
+};
+
+// The engine's features, each quantized to a 0..127 curve index.
+enum class RouteInput : uint8_t {
+  Value,       // the sample, 0..1
+  Strike,      // pluck strength, 0..1 (what velocity used to be made of)
+  Depth,       // wobble depth, 0..1
+  Rate,        // wobble rate, 0..16 Hz
+  Wobble,      // value - wobble center, ±0.5; 64 = centered
+  Confidence,  // how sure the classifier was, 0..1
+  Full,        // always 127: for fixed amounts ("velocity 50") via a const curve
+};
+static const uint8_t kRouteInputCount = 7;
+
+enum class RouteDest : uint8_t {
+  Note,      // new sustaining note (releases the old one); curve = velocity, param = transpose
+  Grain,     // note on + off at once, nothing sustains; curve = velocity, param = transpose
+  Release,   // note off for the sustaining note
+  Pressure,  // MidiVoiceRouter::set_pressure (CC1 globally, channel pressure in MPE)
+  Timbre,    // MidiVoiceRouter::set_timbre (CC11 globally, CC74 in MPE)
+  Bend,      // MidiVoiceRouter::set_bend; curve outputs -8192..8191
+  Cc,        // any controller on the note's channel; param = CC number
+};
+
+enum class CurveShape : uint8_t {
+  Linear,  // lo → hi in a straight line
+  Exp,     // x^k: slow start, fast finish (k > 1)
+  Log,     // 1 - (1-x)^k: fast start, gentle finish
+  Const,   // hi for every input
+  Points,  // straight lines through up to kMaxCurvePoints (in, out) pairs
+};
+static const uint8_t kMaxCurvePoints = 8;
+
+// A route as it is typed and listed. Output units follow the destination:
+// 0..127 for velocity and controllers, -8192..8191 for bend.
+struct RouteSpec {
+  RouteTrigger trigger = RouteTrigger::Bow;
+  RouteInput input = RouteInput::Value;
+  RouteDest dest = RouteDest::Pressure;
+  int16_t param = 0;  // transpose for Note/Grain, controller number for Cc
+  CurveShape shape = CurveShape::Linear;
+  float k = 2.0f;     // Exp/Log steepness
+  int16_t lo = 0;
+  int16_t hi = 127;
+  uint8_t point_count = 0;
+  uint8_t point_in[kMaxCurvePoints] = {};
+  int16_t point_out[kMaxCurvePoints] = {};
+};
+
+struct MidiRoute {
+  RouteSpec spec;
+  // Output per input step, in destination units. 14-bit wide so bend keeps
+  // its range; 7-bit destinations just never go above 127.
+  int16_t curve[128];
+};
+
+// One frame as the routes see it: the float → 0..127 step happens here, once.
+struct RouteFrame {
+  Gesture gesture = Gesture::Idle;
+  bool contact = false;
+  uint8_t in[kRouteInputCount] = {};
+};
+RouteFrame route_frame(const GestureResult& r);
+
+// Where new pitches come from (main.cpp's round-robin note set).
+class NoteSupply {
+ public:
+  virtual uint8_t next_note() = 0;
+  virtual ~NoteSupply() {}
+};
+
+// What a frame's routes did, for the telemetry line.
+struct RouteOutcome {
+  int note = -1;           // note started by a Note/Grain route this frame
+  uint8_t velocity = 0;
+  int released = -1;       // note released this frame (route or contact end)
+};
+
+class RouteMatrix {
+ public:
+  static const uint8_t kMaxRoutes = 24;
+
+  // Starts with the default table live (see load_defaults).
+  RouteMatrix();
+
+  // The mapping the firmware shipped with before routes existed: pluck →
+  // note (velocity from strike), scrape → grain at 50, harmonic → note +12 at
+  // 96, mute → release, bow → pressure, tremolo → timbre, vibrato → bend and
+  // CC76/77. Staged and committed in one go.
+  void load_defaults();
+
+  // Staging side. add() builds the route's curve (the only float work) and
+  // returns false when the staging table is full.
+  bool add(const RouteSpec& spec);
+  void discard() { tables_[1 - active_].count = 0; }
+  uint8_t staged() const { return tables_[1 - active_].count; }
+  // Make the staged table live; staging starts empty again.
+  void commit();
+
+  uint8_t count() const { return tables_[active_].count; }
+  const MidiRoute& route(uint8_t i) const { return tables_[active_].routes[i]; }
+
+  // Run every route whose trigger this frame meets. Integer-only.
+  RouteOutcome dispatch(const RouteFrame& f, MidiVoiceRouter& midi, NoteSupply& notes);
+
+  int current_note() const { return current_note_; }
+  // Note off for whatever sustains (note set swapped, say). -1 when silent.
+  int release(MidiVoiceRouter& midi);
+  // The router already dropped every voice (mode switch): just forget it.
+  int forget();
+
+ private:
+  struct Table {
+    MidiRoute routes[kMaxRoutes];
+    uint8_t count = 0;
+  };
+
+  Table tables_[2];
+  uint8_t active_ = 0;
+  int current_note_ = -1;
+  int16_t last_[kMaxRoutes];  // last value each continuous route sent, for change-only output
+
+  void start_note(int note);
+  void reset_last();
+};
+
+// Fill `lut` for `spec` (exposed so tests can check shapes directly).
+void build_route_curve(const RouteSpec& spec, int16_t lut[128]);
+
+// {"route":{...}} → spec. False when the line has no "route" key. With the
+// key but a bad field, returns true and sets *error to what was wrong.
+bool parse_route_spec(const char* line, RouteSpec* out, const char** error);
+// One route back as the JSON it would be loaded from (no trailing newline).
+// Returns the length written; `out` needs kRouteJsonMax bytes.
+static const uint16_t kRouteJsonMax = 256;
+uint16_t format_route_spec(const RouteSpec& spec, char* out);
+
+const char* route_trigger_name(RouteTrigger t);
+const char* route_input_name(RouteInput in);
+const char* route_dest_name(RouteDest d);
+const char* curve_shape_name(CurveShape s);
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "midi_output.h"
+
+/**
+ * Two outputs, two queues. MIDI and the JSON telemetry used to share one CDC
+ * byte stream, so a NoteOn could sit behind half a line of text. Now both
+ * sides only enqueue, and TransportPump decides what reaches the wire:
+ *
+ *   1. every queued MIDI message, oldest first,
+ *   2. then as many telemetry bytes as the serial port can take without
+ *      blocking, and only if step 1 left nothing behind.
+ *
+ * The port can take part of a line. On a shared link the next pump then
+ * finishes that line before step 1, so MIDI only ever lands between lines.
+ *
+ * With -D MIDI_USB the MIDI port is the native USB-MIDI endpoint and CDC only
+ * carries text; without it both ports share CDC, and the same rule keeps text
+ * from ever taking the space a note needed.
+ */
+
+/** One channel-voice message as it goes on the wire. */
+struct MidiMessage {
+  uint8_t status;  // type in the high nibble, channel - 1 in the low nibble
+  uint8_t data1;
+  uint8_t data2;
+
+  uint8_t type() const { return status & 0xF0; }
+  uint8_t channel() const { return static_cast<uint8_t>((status & 0x0F) + 1); }
+  int16_t bend() const { return static_cast<int16_t>(((data2 << 7) | data1) - 8192); }
+};
+
+static const uint8_t kMidiNoteOff = 0x80;
+static const uint8_t kMidiNoteOn = 0x90;
+static const uint8_t kMidiControlChange = 0xB0;
+static const uint8_t kMidiChannelPressure = 0xD0;
+static const uint8_t kMidiPitchBend = 0xE0;
+
+/**
+ * Bounded FIFO of MIDI messages. Full → the new message is dropped and
+ * counted, except a note-off: losing one leaves a note hanging, so it evicts
+ * the newest controller/bend/pressure message (the next one supersedes it
+ * anyway), or failing that the newest NoteOn, and takes its place.
+ */
+class MidiQueue {
+ public:
+  static const uint8_t kCapacity = 128;  // power of two; holds a full 15-member MPE setup (95 messages)
+
+  bool push(const MidiMessage& m);
+  const MidiMessage* front() const { return empty() ? nullptr : &slots_[tail_ % kCapacity]; }
+  void pop() { if (!empty()) ++tail_; }
+  bool empty() const { return head_ == tail_; }
+  uint8_t size() const { return static_cast<uint8_t>(head_ - tail_); }
+  uint32_t dropped() const { return dropped_; }
+
+ private:
+  MidiMessage slots_[kCapacity];
+  uint8_t head_ = 0;  // free-running; wraps at 256, a multiple of kCapacity
+  uint8_t tail_ = 0;
+  uint32_t dropped_ = 0;
+
+  bool evict_for_note_off();
+};
+
+/** MidiSink that encodes into a MidiQueue instead of talking to hardware. */
+class MidiQueueSink : public MidiSink {
+ public:
+  explicit MidiQueueSink(MidiQueue& q) : q_(q) {}
+  void note_on(uint8_t note, uint8_t velocity, uint8_t channel) override;
+  void note_off(uint8_t note, uint8_t velocity, uint8_t channel) override;
+  void control_change(uint8_t number, uint8_t value, uint8_t channel) override;
+  void pitch_bend(int16_t bend, uint8_t channel) override;
+  void channel_pressure(uint8_t pressure, uint8_t channel) override;
+
+ private:
+  MidiQueue& q_;
+  void put(uint8_t type, uint8_t channel, uint8_t d1, uint8_t d2);
+};
+
+/**
+ * Bounded byte ring for newline-terminated telemetry. Lines are atomic: bytes
+ * only become drainable once their '\n' arrives, and a line that does not fit
+ * is dropped whole (and counted) instead of going out torn.
+ */
+class LineQueue {
+ public:
+  static const size_t kCapacity = 2048;  // power of two
+
+  // Byte-at-a-time, so an Arduino Print adapter can sit on top.
+  void put(char c);
+  // Longest run of committed bytes that is contiguous in memory.
+  size_t peek(const char** data) const;
+  void consume(size_t n);
+  size_t pending() const { return committed_ - tail_; }
+  uint32_t dropped_lines() const { return dropped_lines_; }
+
+ private:
+  char buf_[kCapacity];
+  size_t head_ = 0;       // next byte of the line being written
+  size_t committed_ = 0;  // end of the last complete line
+  size_t tail_ = 0;       // next byte to drain
+  bool dropping_ = false;  // current line overflowed; discard until '\n'
+  uint32_t dropped_lines_ = 0;
+};
+
+/** Where MIDI finally goes: the 47effects instance, usbMIDI, TinyUSB MIDI, a test. */
+class MidiPort {
+ public:
+  // False when the port cannot take it right now; the message stays queued.
+  virtual bool send(const MidiMessage& m) = 0;
+  // Push anything the port batches (usbMIDI packs messages into USB packets).
+  virtual void flush() {}
+  // True when MIDI bytes go down the same byte stream as the TextPort, so a
+  // message must never land between the bytes of a line.
+  virtual bool shares_text_port() const { return false; }
+  virtual ~MidiPort() {}
+};
+
+/** Where telemetry goes: CDC Serial, or a test. Must never block. */
+class TextPort {
+ public:
+  virtual size_t writable() = 0;
+  virtual size_t write(const char* data, size_t n) = 0;
+  virtual ~TextPort() {}
+};
+
+class TransportPump {
+ public:
+  TransportPump(MidiQueue& midi, MidiPort& midi_port, LineQueue& text, TextPort& text_port)
+      : midi_(midi), midi_port_(midi_port), text_(text), text_port_(text_port) {}
+
+  // Call often (top and bottom of loop()). Never blocks.
+  void pump();
+
+ private:
+  bool write_text(bool to_line_end);
+
+  MidiQueue& midi_;
+  MidiPort& midi_port_;
+  LineQueue& text_;
+  TextPort& text_port_;
+  bool mid_line_ = false;  // the port has taken part of a line but not its '\n'
+};
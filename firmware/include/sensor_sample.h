@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * A single sensor reading with the two pieces of data the gesture engine needs.
+ * `value` is normalized 0..1; `micros` is the acquisition timestamp.
+ */
+struct SensorSample {
+  float value;
+  uint32_t micros;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "sensor_sample.h"
+
+/**
+ * Filters that think in time, not in calls. The old smoothers were written as
+ * `env = 0.9f * env + 0.1f * x`, which is a time constant only at one loop
+ * rate: double the rate and the envelope gets twice as fast. Here every
+ * coefficient comes from a time constant and the measured gap between
+ * samples, so raising the acquisition rate leaves the feel alone.
+ */
+
+/**
+ * First-order low-pass: y += (x - y) * (1 - exp(-dt / tau)). The step size
+ * comes from the timestamps, so a late sample moves the output further and a
+ * burst of early ones moves it less, landing where a continuous RC would.
+ *
+ * Converting an old per-call coefficient: `keep * y + (1 - keep) * x` at loop
+ * period T is tau = -T / ln(keep). At 1 kHz, 0.9 → 9.5 ms, 0.88 → 7.8 ms,
+ * 0.85 → 6.2 ms.
+ */
+class OnePole {
+ public:
+  explicit OnePole(float tau_us) : tau_us_(tau_us) {}
+
+  float update(float x, uint32_t now_us);
+  // Jump straight to `x` (e.g. after a sensor re-seed).
+  void reset(float x, uint32_t now_us);
+  float value() const { return y_; }
+  float tau_us() const { return tau_us_; }
+
+ private:
+  float tau_us_;
+  float y_ = 0.0f;
+  uint32_t last_us_ = 0;
+  bool started_ = false;
+};
+
+/**
+ * Mean: the time-weighted average of the signal over each output period
+ * (sample-and-hold integral / period). It is a boxcar anti-alias filter whose
+ * first null sits at the output rate, and because it weights by time, an
+ * uneven acquisition rate does not tilt the average.
+ * Peak: the largest sample in the period, stamped when it arrived. For
+ * percussive envelopes (piezo) where averaging would shave off the hit.
+ */
+enum class DecimateMode : uint8_t { Mean, Peak };
+
+/**
+ * Multi-rate stage between acquisition and classification. Sensors can
+ * sample as fast as they like; the Decimator hands on one sample per output
+ * period, so GestureEngine runs at a fixed rate no matter how fast loop()
+ * spins. A finished period is reported when the first sample past its end
+ * arrives, so the added latency is at most one period plus one acquisition.
+ *
+ * Mean outputs are stamped at the end of their period (a steady grid); Peak
+ * outputs keep the peak's own timestamp so onset timing survives.
+ * period_us = 0 passes every sample straight through.
+ */
+class Decimator {
+ public:
+  explicit Decimator(uint32_t period_us = 0, DecimateMode mode = DecimateMode::Mean)
+      : period_us_(period_us), mode_(mode) {}
+
+  // Takes effect from the next period.
+  void set_mode(DecimateMode mode) { mode_ = mode; }
+  DecimateMode mode() const { return mode_; }
+  uint32_t period_us() const { return period_us_; }
+
+  // Feed one acquired sample. True when a finished period is ready in *out.
+  bool push(const SensorSample& in, SensorSample* out);
+
+ private:
+  uint32_t period_us_;
+  DecimateMode mode_;
+  bool started_ = false;
+  uint32_t bin_start_us_ = 0;
+  float area_ = 0.0f;  // ∫ held value dt over the current period, value·µs
+  float held_ = 0.0f;  // last sample's value; holds until the next one
+  uint32_t held_us_ = 0;
+  float peak_ = 0.0f;
+  uint32_t peak_us_ = 0;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * Lock-free single-producer / single-consumer ring, for handing data from one
+ * core to the other. The ISR rings elsewhere (EdgeRing, the ADC scan blocks)
+ * get away with `volatile` because producer and consumer share one core and
+ * see memory in the same order. Two cores do not: without a release/acquire
+ * pair, the consumer could see the new head before the slot it guards. So
+ * the indices here are std::atomic. Each one has exactly one writer, so no
+ * compare-and-swap and no lock is needed.
+ *
+ * A full ring drops the new item and counts it. The producer is the sampling
+ * core, and it must never wait on the consumer.
+ */
+template <typename T, uint32_t N>
+class SpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+ public:
+  static const uint32_t kCapacity = N;
+
+  // Producer side only.
+  bool push(const T& item) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail >= N) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    slots_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);  // publishes the slot
+    uint32_t depth = head + 1 - tail;
+    if (depth > high_water_.load(std::memory_order_relaxed)) {
+      high_water_.store(depth, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  // Consumer side only. Oldest first; false when empty.
+  bool pop(T* out) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t head = head_.load(std::memory_order_acquire);
+    if (head == tail) return false;
+    *out = slots_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);  // hands the slot back
+    return true;
+  }
+
+  // Either side; a snapshot that may be one item stale by the time you read it.
+  uint32_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+  uint32_t high_water() const { return high_water_.load(std::memory_order_relaxed); }
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  T slots_[N];
+  std::atomic<uint32_t> head_{0};  // free-running; written by the producer only
+  std::atomic<uint32_t> tail_{0};  // free-running; written by the consumer only
+  std::atomic<uint32_t> high_water_{0};
+  std::atomic<uint32_t> dropped_{0};
+};
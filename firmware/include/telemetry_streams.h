@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Telemetry by subscription. The projector wants gesture lines and maybe an
+ * envelope at 30 Hz; the logging rig wants every raw sample and the engine's
+ * internals. Each host says what it wants:
+ *
+ *   {"sub":{"gestures":true,"raw":500,"env":30,"engine":false}}
+ *
+ * true = every line, a number = at most that many lines per second (0 or
+ * false = off), and streams not named keep their setting. {"sub":"none"}
+ * turns everything off, and any other {"sub":...} just reports the current
+ * set. Gesture lines are on at boot so existing visualizers keep working.
+ *
+ * The firmware asks due() before it formats anything, so a stream nobody
+ * subscribed to costs one bit test and no printing.
+ */
+enum class TelemetryStream : uint8_t {
+  Gestures,  // {"gesture":...} lines; the cap applies to bow/tremolo/vibrato, never to one-shots
+  Raw,       // {"raw":[micros,value]} per classified sample
+  Envelope,  // {"env":[micros,value,on,off,noise,contact]}
+  Latency,   // {"latency":{...}} pipeline lag + queue health
+  Engine,    // {"features":{...}} the engine's measurements per sample
+};
+static const uint8_t kStreamCount = 5;
+
+class TelemetryStreams {
+ public:
+  TelemetryStreams();
+
+  bool subscribed(TelemetryStream s) const { return (mask_ >> static_cast<uint8_t>(s)) & 1u; }
+  // Subscribed, and at least 1/max_hz since this stream last went out (marks
+  // it sent). Unsubscribed streams return before touching anything else.
+  bool due(TelemetryStream s, uint32_t now_us) {
+    if (!subscribed(s)) return false;
+    return take(static_cast<uint8_t>(s), now_us);
+  }
+
+  // max_hz = 0: every line.
+  void subscribe(TelemetryStream s, uint16_t max_hz);
+  void unsubscribe(TelemetryStream s);
+  uint16_t max_hz(TelemetryStream s) const { return max_hz_[static_cast<uint8_t>(s)]; }
+
+  // Apply a {"sub":...} line. False when the line has no "sub" key.
+  bool apply_command(const char* line);
+  static const char* name(TelemetryStream s);
+
+ private:
+  uint8_t mask_ = 0;
+  uint16_t max_hz_[kStreamCount];
+  uint32_t period_us_[kStreamCount];
+  uint32_t last_us_[kStreamCount];
+  bool sent_once_[kStreamCount];
+
+  bool take(uint8_t i, uint32_t now_us);
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "i2c_bus.h"
+
+/** One range measurement, stamped when the sensor said it was ready. */
+struct TofReading {
+  uint16_t mm = 0;
+  uint32_t stamp_us = 0;
+};
+
+/**
+ * VL53L0X in continuous back-to-back ranging, driven as a non-blocking state
+ * machine. Call step() from loop() as often as you like: it issues at most one
+ * I²C transaction, or harvests the one that finished, and returns. Bring-up,
+ * reference calibration, and every range read go through the same path, so
+ * loop() never stalls on the bus—even during boot.
+ *
+ * Scope: this is the register sequence from ST's API (data init, reference
+ * calibration, continuous start) minus the per-part default tuning table and
+ * SPAD map load. Parts range usefully on their power-on defaults; if a unit
+ * reads short, the tuning writes drop straight into kBringUp as more W8 ops.
+ */
+class Vl53l0x {
+ public:
+  static const uint8_t kDefaultAddress = 0x29;
+  static const uint32_t kPollIntervalUs = 2000;      // status polls when no GPIO1 interrupt is wired
+  static const uint32_t kTransactionTimeoutUs = 10000;
+  static const uint32_t kReadyTimeoutUs = 200000;    // calibration / first range must land by then
+
+  enum class State : uint8_t { Off, BringUp, Ranging, Failed };
+
+  explicit Vl53l0x(I2cBus& bus);
+
+  // Restarts bring-up. `new_address` != kDefaultAddress moves the part there
+  // right after it answers (needs XSHUT sequencing when several share a bus).
+  void begin(uint32_t now_us, uint8_t new_address = kDefaultAddress);
+  void step(uint32_t now_us);
+
+  // Hook for the GPIO1 data-ready interrupt. With it wired, the driver skips
+  // status polling and the stamp is the interrupt time, not the poll time.
+  void notify_data_ready(uint32_t stamp_us);
+  void use_data_ready_pin(bool enabled) { use_ready_pin_ = enabled; }
+
+  // Newest reading since the last take(); false when nothing new.
+  bool take(TofReading* out);
+
+  State state() const { return state_; }
+  uint8_t address() const { return address_; }
+  uint32_t readings() const { return readings_; }
+
+ private:
+  enum class OpKind : uint8_t { W8, W16, Or8, And8, SaveStop, RestoreStop, WaitReady, Expect, DelayUs, SetAddress };
+  struct Op {
+    OpKind kind;
+    uint8_t reg;
+    uint16_t value;
+  };
+  enum class Loop : uint8_t { Wait, Status, Range, Clear };
+
+  static const Op kBringUp[];
+  static const uint8_t kBringUpLen;
+
+  I2cBus& bus_;
+  I2cTransaction txn_;
+  uint8_t tx_[3] = {0};
+  uint8_t rx_[2] = {0};
+  bool in_flight_ = false;
+  uint32_t txn_start_us_ = 0;
+
+  State state_ = State::Off;
+  uint8_t address_ = kDefaultAddress;
+  uint8_t target_address_ = kDefaultAddress;
+  uint8_t op_ = 0;
+  uint8_t phase_ = 0;
+  uint32_t op_start_us_ = 0;
+  uint32_t last_poll_us_ = 0;
+  uint8_t stop_variable_ = 0;
+  uint8_t scratch_ = 0;  // read-modify-write value between the read and the write
+
+  Loop loop_ = Loop::Wait;
+  bool use_ready_pin_ = false;
+  volatile bool ready_flag_ = false;
+  volatile uint32_t ready_stamp_us_ = 0;
+  uint32_t pending_stamp_us_ = 0;
+
+  TofReading latest_;
+  bool fresh_ = false;
+  uint32_t readings_ = 0;
+
+  void run_bring_up(uint32_t now_us);
+  void finish_bring_up_op(uint32_t now_us);
+  void run_ranging(uint32_t now_us);
+  void finish_ranging(uint32_t now_us);
+  void next_op(uint32_t now_us);
+  void fail();
+
+  bool write8(uint8_t reg, uint8_t value, uint32_t now_us);
+  bool write16(uint8_t reg, uint16_t value, uint32_t now_us);
+  bool read(uint8_t reg, uint8_t len, uint32_t now_us);
+  bool issue(uint8_t tx_len, uint8_t rx_len, uint32_t now_us);
+};
+
+/**
+ * Several VL53L0X on one bus. They all wake up at 0x29, so we hold every XSHUT
+ * low, then release them one at a time and move each to its own address before
+ * waking the next. After that they range concurrently, taking turns on the bus.
+ */
+class TofArray {
+ public:
+  static const uint8_t kMaxSensors = 4;
+  static const uint32_t kResetHoldUs = 1000;  // XSHUT low time before the first release
+
+  TofArray(I2cBus& bus, GpioOut& gpio);
+
+  // Register a sensor by its XSHUT pin and the address it should end up at.
+  bool add(uint8_t xshut_pin, uint8_t address);
+  void begin(uint32_t now_us);
+  void step(uint32_t now_us);
+
+  uint8_t count() const { return count_; }
+  Vl53l0x& sensor(uint8_t i) { return sensors_[i]; }
+
+ private:
+  GpioOut& gpio_;
+  Vl53l0x sensors_[kMaxSensors];
+  uint8_t xshut_[kMaxSensors] = {0};
+  uint8_t addresses_[kMaxSensors] = {0};
+  uint8_t count_ = 0;
+  uint8_t powered_ = 0;  // sensors released from reset so far
+  uint32_t reset_us_ = 0;
+  uint8_t turn_ = 0;     // round-robin start so no sensor hogs the bus
+};
@@ -0,0 +1,86 @@
+#include "adc_scan.h"
+
+bool AdcScanner::configure(const uint8_t* pins, uint8_t count, uint32_t frame_rate_hz) {
+  if (count == 0 || count > kAdcMaxChannels || frame_rate_hz == 0) return false;
+  for (uint8_t i = 0; i < count; ++i) pins_[i] = pins[i];
+  count_ = count;
+  period_us_ = 1000000UL / frame_rate_hz;
+  written_ = 0;
+  fill_ = 0;
+  have_data_ = false;
+  for (uint8_t i = 0; i < kAdcMaxChannels; ++i) {
+    read_[i] = 0;
+    overruns_[i] = 0;
+  }
+  return true;
+}
+
+int AdcScanner::channel_of(uint8_t pin) const {
+  for (uint8_t i = 0; i < count_; ++i) {
+    if (pins_[i] == pin) return i;
+  }
+  return -1;
+}
+
+void AdcScanner::store(const uint16_t* frame, uint32_t stamp) {
+  Slot& slot = slots_[written_ % kAdcBlockSlots];
+  for (uint8_t ch = 0; ch < count_; ++ch) {
+    slot.samples[ch][fill_] = frame[ch];
+    last_[ch] = frame[ch];
+  }
+  slot.stamps[fill_] = stamp;
+  last_us_ = stamp;
+  have_data_ = true;
+  if (++fill_ == kAdcBlockFrames) {
+    fill_ = 0;
+    ++written_;  // publish only after the whole block is in place
+  }
+}
+
+void AdcScanner::ingest(const uint16_t* interleaved, uint16_t frames, uint32_t first_frame_us) {
+  for (uint16_t f = 0; f < frames; ++f) store(interleaved + f * count_, first_frame_us + f * period_us_);
+}
+
+void AdcScanner::ingest_ending(const uint16_t* interleaved, uint16_t frames, uint32_t last_frame_us) {
+  if (frames == 0) return;
+  uint32_t back = (frames - 1u) * period_us_;
+  // Signed so the check holds across the 71-minute micros() wrap.
+  int32_t room = have_data_ ? static_cast<int32_t>(last_frame_us - last_us_) : INT32_MAX;
+  if (room > 0 && static_cast<uint32_t>(room) > back) {
+    ingest(interleaved, frames, last_frame_us - back);
+    return;
+  }
+  uint32_t prev = last_us_;
+  uint32_t span = room > 0 ? static_cast<uint32_t>(room) : 0;
+  for (uint16_t f = 0; f < frames; ++f) {
+    store(interleaved + f * count_, prev + static_cast<uint32_t>(static_cast<uint64_t>(span) * (f + 1u) / frames));
+  }
+}
+
+bool AdcScanner::read_block(uint8_t channel, AdcBlock* out) {
+  if (channel >= count_ || out == nullptr) return false;
+  uint32_t written = written_;
+  uint32_t& r = read_[channel];
+  if (r == written) return false;
+  // The slot being filled is written % kAdcBlockSlots, so a reader may lag by
+  // at most kAdcBlockSlots - 1 blocks. Further behind: skip to the oldest
+  // intact block and count what was lost.
+  if (written - r > kAdcBlockSlots - 1u) {
+    uint32_t oldest = written - (kAdcBlockSlots - 1u);
+    overruns_[channel] += oldest - r;
+    r = oldest;
+  }
+  const Slot& slot = slots_[r % kAdcBlockSlots];
+  for (uint16_t i = 0; i < kAdcBlockFrames; ++i) out->samples[i] = slot.samples[channel][i];
+  out->count = kAdcBlockFrames;
+  for (uint16_t i = 0; i < kAdcBlockFrames; ++i) out->stamps[i] = slot.stamps[i];
+  ++r;
+  return true;
+}
+
+bool AdcScanner::latest(uint8_t channel, uint16_t* value, uint32_t* stamp_us) const {
+  if (channel >= count_ || !have_data_) return false;
+  if (value) *value = last_[channel];
+  if (stamp_us) *stamp_us = last_us_;
+  return true;
+}
@@ -0,0 +1,206 @@
+#include "analog_input.h"
+
+#if defined(ADC_SCAN)
+
+#ifndef ADC_SCAN_RATE_HZ
+#define ADC_SCAN_RATE_HZ 4000  // frames per second; every pin in the list once per frame
+#endif
+
+#if defined(TEENSYDUINO)
+#include <ADC.h>
+#include <IntervalTimer.h>
+#elif defined(ARDUINO_ARCH_ESP32)
+#include "driver/adc.h"
+#else
+#error "ADC_SCAN needs a Teensy 4.x or an ESP32-S3"
+#endif
+
+namespace {
+// The analog sensing pins. A1 (capacitive) stays out on purpose: that path
+// flips the pin between OUTPUT and INPUT_PULLUP every read, which a background
+// scan would fight.
+const uint8_t kScanPins[] = {A0, A2, A3, A4};
+const uint8_t kScanCount = sizeof(kScanPins);
+static_assert(kScanCount <= kAdcMaxChannels, "scan list longer than AdcScanner supports");
+
+AdcScanner g_scanner;
+bool g_scanning = false;
+}  // namespace
+
+#if defined(TEENSYDUINO)
+// ---- Teensy 4.x: timer-paced, interrupt-chained scan ------------------------
+// A timer kicks off each frame; every conversion-complete interrupt stores its
+// result and starts the next pin, so the CPU never waits on the ADC. (The
+// i.MX RT can also chain conversions through ADC_ETC + DMA; the interrupt chain
+// is a handful of cycles per conversion and keeps the pin list editable here.)
+namespace {
+ADC g_adc;
+IntervalTimer g_frame_timer;
+uint16_t g_frame[kAdcMaxChannels];
+volatile uint8_t g_next = 0;
+volatile uint32_t g_frame_us = 0;
+volatile bool g_busy = false;
+volatile uint32_t g_late_frames = 0;  // frame tick arrived mid-scan: rate set too high
+
+void conversion_done() {
+  g_frame[g_next] = static_cast<uint16_t>(g_adc.adc0->readSingle());
+  if (++g_next < kScanCount) {
+    g_adc.adc0->startSingleRead(kScanPins[g_next]);
+    return;
+  }
+  g_busy = false;
+  g_scanner.ingest(g_frame, 1, g_frame_us);
+}
+
+void frame_start() {
+  if (g_busy) {
+    ++g_late_frames;
+    return;
+  }
+  g_busy = true;
+  g_next = 0;
+  g_frame_us = micros();  // one stamp per frame: every channel shares it
+  g_adc.adc0->startSingleRead(kScanPins[0]);
+}
+}  // namespace
+
+void analog_scan_begin() {
+  if (!g_scanner.configure(kScanPins, kScanCount, ADC_SCAN_RATE_HZ)) return;
+  g_adc.adc0->setResolution(10);
+  g_adc.adc0->setAveraging(1);
+  g_adc.adc0->setConversionSpeed(ADC_CONVERSION_SPEED::HIGH_SPEED);
+  g_adc.adc0->setSamplingSpeed(ADC_SAMPLING_SPEED::HIGH_SPEED);
+  g_adc.adc0->enableInterrupts(conversion_done);
+  g_scanning = g_frame_timer.begin(frame_start, g_scanner.period_us());
+}
+
+void analog_scan_poll() {}
+
+#else
+// ---- ESP32-S3: continuous DMA ----------------------------------------------
+// The ADC digital controller walks the pattern table at a fixed conversion
+// rate and DMA drops results into a ring we drain without waiting.
+namespace {
+uint8_t g_dma_buf[256 * SOC_ADC_DIGI_RESULT_BYTES];
+uint8_t g_adc_channel[kAdcMaxChannels];
+// Whole frames assembled from one read, interleaved; a frame split across two
+// reads finishes in the second.
+uint16_t g_batch[sizeof(g_dma_buf) / SOC_ADC_DIGI_RESULT_BYTES + kAdcMaxChannels];
+uint8_t g_next = 0;
+}  // namespace
+
+void analog_scan_begin() {
+  if (!g_scanner.configure(kScanPins, kScanCount, ADC_SCAN_RATE_HZ)) return;
+  adc_digi_pattern_config_t pattern[kAdcMaxChannels] = {};
+  uint16_t mask = 0;
+  for (uint8_t i = 0; i < kScanCount; ++i) {
+    int ch = digitalPinToAnalogChannel(kScanPins[i]);
+    if (ch < 0 || ch >= SOC_ADC_CHANNEL_NUM(0)) return;  // ADC2 pins cannot join the DMA scan
+    g_adc_channel[i] = static_cast<uint8_t>(ch);
+    mask |= 1u << ch;
+    pattern[i].atten = ADC_ATTEN_DB_11;
+    pattern[i].channel = static_cast<uint8_t>(ch);
+    pattern[i].unit = 0;  // ADC1
+    pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  }
+
+  adc_digi_init_config_t init = {};
+  init.max_store_buf_size = sizeof(g_dma_buf) * 4;
+  init.conv_num_each_intr = sizeof(g_dma_buf);
+  init.adc1_chan_mask = mask;
+  if (adc_digi_initialize(&init) != ESP_OK) return;
+
+  adc_digi_configuration_t cfg = {};
+  cfg.conv_limit_en = false;
+  cfg.pattern_num = kScanCount;
+  cfg.adc_pattern = pattern;
+  cfg.sample_freq_hz = ADC_SCAN_RATE_HZ * kScanCount;  // conversions per second, all channels
+  cfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  cfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+  if (adc_digi_controller_configure(&cfg) != ESP_OK) return;
+  g_scanning = adc_digi_start() == ESP_OK;
+}
+
+void analog_scan_poll() {
+  if (!g_scanning) return;
+  uint32_t got = 0;
+  // Timeout 0: take whatever DMA has finished and leave immediately. An
+  // overflowed driver ring still hands back data (ESP_ERR_INVALID_STATE); the
+  // frames it lost are absorbed by re-anchoring below.
+  for (;;) {
+    esp_err_t err = adc_digi_read_bytes(g_dma_buf, sizeof(g_dma_buf), &got, 0);
+    if ((err != ESP_OK && err != ESP_ERR_INVALID_STATE) || got == 0) break;
+    uint16_t frames = 0;
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= got; i += SOC_ADC_DIGI_RESULT_BYTES) {
+      const adc_digi_output_data_t* p = reinterpret_cast<const adc_digi_output_data_t*>(&g_dma_buf[i]);
+      uint8_t ch = p->type2.channel;
+      // Re-sync on the first channel if a result was dropped mid-frame.
+      if (ch != g_adc_channel[g_next]) {
+        if (ch != g_adc_channel[0]) continue;
+        g_next = 0;
+      }
+      g_batch[frames * kScanCount + g_next] = static_cast<uint16_t>(p->type2.data >> 2);  // 12-bit → 10-bit
+      if (++g_next == kScanCount) {
+        g_next = 0;
+        ++frames;
+      }
+    }
+    // DMA carries no timestamps. Stamp the newest frame now and back-date the
+    // rest, so neither the whole-µs period nor the ADC clock's error can drift.
+    g_scanner.ingest_ending(g_batch, frames, micros());
+    // A frame cut off by the end of this read carries over to the next.
+    for (uint8_t c = 0; c < g_next; ++c) g_batch[c] = g_batch[frames * kScanCount + c];
+  }
+}
+#endif
+
+uint16_t analog_input(uint8_t pin, uint32_t* stamp_us) {
+  if (g_scanning) {
+    int ch = g_scanner.channel_of(pin);
+    uint16_t v = 0;
+    if (ch >= 0) {
+      noInterrupts();  // Teensy updates from an ISR; keep the read coherent
+      bool ok = g_scanner.latest(static_cast<uint8_t>(ch), &v, stamp_us);
+      interrupts();
+      if (ok) return v;
+    }
+  }
+  if (stamp_us) *stamp_us = micros();
+#if defined(ARDUINO_ARCH_ESP32)
+  return static_cast<uint16_t>(analogRead(pin) >> 2);
+#else
+  return static_cast<uint16_t>(analogRead(pin));
+#endif
+}
+
+AdcScanner* analog_scanner() { return g_scanning ? &g_scanner : nullptr; }
+
+bool analog_read_block(uint8_t pin, AdcBlock* out) {
+  if (!g_scanning) return false;
+  int ch = g_scanner.channel_of(pin);
+  if (ch < 0) return false;
+  noInterrupts();  // ~100 bytes; the ISR must not lap this slot mid-copy
+  bool ok = g_scanner.read_block(static_cast<uint8_t>(ch), out);
+  interrupts();
+  return ok;
+}
+
+#else  // !ADC_SCAN
+
+void analog_scan_begin() {}
+void analog_scan_poll() {}
+
+uint16_t analog_input(uint8_t pin, uint32_t* stamp_us) {
+  if (stamp_us) *stamp_us = micros();
+#if defined(ARDUINO_ARCH_ESP32)
+  return static_cast<uint16_t>(analogRead(pin) >> 2);  // default 12-bit → 10-bit
+#else
+  return static_cast<uint16_t>(analogRead(pin));
+#endif
+}
+
+AdcScanner* analog_scanner() { return nullptr; }
+
+bool analog_read_block(uint8_t, AdcBlock*) { return false; }
+
+#endif  // ADC_SCAN
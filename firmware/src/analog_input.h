@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "adc_scan.h"
+
+// ---- Analog acquisition front door -----------------------------------------
+// Sensors ask for analog values through here instead of calling analogRead()
+// directly. Built with -D ADC_SCAN, the board samples every pin in the scan
+// list continuously at ADC_SCAN_RATE_HZ (DMA on ESP32-S3, conversion-complete
+// interrupts on Teensy) and these calls just return what already landed.
+// Without the flag they fall back to a plain blocking analogRead().
+
+// Starts the background scan (no-op without ADC_SCAN). Call before sensors begin().
+void analog_scan_begin();
+
+// Drains finished DMA buffers into the scanner. Cheap and non-blocking; call
+// once per loop(). Teensy fills the scanner from interrupts, so it is a no-op there.
+void analog_scan_poll();
+
+// Newest 10-bit (0..1023) reading for `pin` on every MCU, so the sensors'
+// `/ 1023.0f` normalization holds whether or not the pin is being scanned.
+// `stamp_us`, when given, gets the time it was sampled: the scan's clock for a
+// scanned pin, micros() for a blocking read.
+uint16_t analog_input(uint8_t pin, uint32_t* stamp_us = nullptr);
+
+// Per-channel sample blocks for sensors that want every conversion (piezo
+// transients). nullptr when scanning is off.
+AdcScanner* analog_scanner();
+
+// Copies the next full block for `pin` out of the scan ring with the scan
+// interrupt held off, so the Teensy ISR cannot overwrite it mid-copy. False
+// when scanning is off, the pin is not scanned, or the reader is caught up.
+bool analog_read_block(uint8_t pin, AdcBlock* out);
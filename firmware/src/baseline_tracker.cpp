@@ -0,0 +1,51 @@
+#include "baseline_tracker.h"
+
+#include <cmath>
+
+BaselineTracker::BaselineTracker(const BaselineConfig& c) : c_(c) {}
+
+void BaselineTracker::seed(float x) {
+  mean_ = x;
+  var_ = 0.0f;
+  count_ = 1;  // keep warming up so the variance is learned from real samples
+}
+
+float BaselineTracker::update(float x) {
+  float d = x - mean_;
+  float d_var = d;  // deviation fed to the variance; clipped while gated
+  float a;
+  if (count_ < c_.warmup) {
+    // Warm-up: plain running average (a = 1/n) so the first seconds after boot
+    // do not crawl toward the room at the slow steady-state rate.
+    ++count_;
+    a = 1.0f / count_;
+    if (a < c_.rate) a = c_.rate;
+  } else {
+    bool below = d < 0.0f;
+    float w = 1.0f;
+    if (!below || c_.gate_below) {
+      // Soft gate: ~1 inside gate_sigmas, falls off as (σ/d)^4 outside. Smooth,
+      // so the baseline never jumps when a touch grazes the gate edge.
+      float gate = sigma() * c_.gate_sigmas;
+      float zn = std::fabs(d) / gate;
+      float zn2 = zn * zn;
+      w = 1.0f / (1.0f + zn2 * zn2);
+      if (w < c_.min_weight) w = c_.min_weight;
+      // Huber-style clip: a held touch may nudge σ, but cannot balloon it and
+      // talk the gate into swallowing the very touch it is measuring.
+      if (zn > 1.0f) d_var = d > 0.0f ? gate : -gate;
+    }
+    a = ((below && c_.fall_rate > 0.0f) ? c_.fall_rate : c_.rate) * w;
+  }
+  mean_ += a * d;
+  // Exponentially weighted variance (West 1979); exact running variance while a = 1/n.
+  var_ = (1.0f - a) * (var_ + a * d_var * d_var);
+  return d;
+}
+
+float BaselineTracker::sigma() const {
+  float s = std::sqrt(var_);
+  return s < c_.min_sigma ? c_.min_sigma : s;
+}
+
+float BaselineTracker::z(float x) const { return std::fabs(x - mean_) / sigma(); }
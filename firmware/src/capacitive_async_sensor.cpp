@@ -0,0 +1,212 @@
+#include "sensor.h"
+
+#ifdef SENSOR_CAPACITIVE_ASYNC
+
+// Non-blocking, many-pad capacitive sensing. The single-pad path in
+// capacitive_sensor.cpp parks the CPU in delayMicroseconds() for every read;
+// here the hardware measures in the background and read() only collects the
+// last finished frame. All pads are measured in the same frame, so adding pads
+// does not lower the per-pad rate.
+//
+//   Teensy 4.x : no touch peripheral, so we time the RC rise ourselves. A
+//                periodic timer alternates "discharge" and "charge" half-frames;
+//                a RISING pin interrupt per pad stamps the cycle counter when the
+//                pad crosses the input threshold. Same wiring as the single-pad
+//                path (pad + internal pullup, performer grounded).
+//   ESP32-S3   : the touch peripheral's FSM scans every enabled channel on its
+//                own timer and raises "scan done" after each sweep; we count
+//                sweeps there and read the raw counts once per sweep.
+
+#if defined(TEENSYDUINO)
+#include <IntervalTimer.h>
+#elif defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_IDF_TARGET_ESP32S3)
+#include "driver/touch_pad.h"
+#else
+#error "SENSOR_CAPACITIVE_ASYNC needs a Teensy 4.x (timer + pin capture) or an ESP32-S3 (touch FSM)"
+#endif
+
+namespace {
+
+#if defined(TEENSYDUINO)
+const uint8_t kPadPins[] = {2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 14};  // 13 is the LED
+const uint8_t kPadCount = sizeof(kPadPins);
+const uint32_t kHalfFrameUs = 200;  // discharge + charge = 400 µs → 2.5 kHz per pad, every pad at once
+const float kSensitivity = 4000.0f;  // extra CPU cycles of rise time that read as a full touch
+
+IntervalTimer g_frame_timer;
+volatile uint32_t g_charge_start[kPadCount];
+volatile uint32_t g_rise_cycles[kPadCount];
+volatile bool g_armed[kPadCount];
+volatile uint32_t g_result[kPadCount];
+volatile uint32_t g_result_us = 0;
+volatile uint32_t g_frames = 0;
+volatile bool g_charging = false;
+
+template <uint8_t I>
+void pad_rise_isr() {
+  if (!g_armed[I]) return;  // ignore edges outside the charge window
+  g_rise_cycles[I] = ARM_DWT_CYCCNT - g_charge_start[I];
+  g_armed[I] = false;
+}
+
+typedef void (*PadIsr)();
+const PadIsr kPadIsrs[] = {pad_rise_isr<0>, pad_rise_isr<1>, pad_rise_isr<2>, pad_rise_isr<3>,
+                           pad_rise_isr<4>, pad_rise_isr<5>, pad_rise_isr<6>, pad_rise_isr<7>,
+                           pad_rise_isr<8>, pad_rise_isr<9>, pad_rise_isr<10>, pad_rise_isr<11>};
+static_assert(kPadCount <= sizeof(kPadIsrs) / sizeof(kPadIsrs[0]), "add a pad_rise_isr<> per extra pad");
+
+// Runs every half-frame from the timer interrupt; never waits on anything.
+void frame_tick() {
+  if (g_charging) {
+    // Charge window closed. A pad that never crossed is pinned at the window
+    // length (a very heavy touch, or a pad shorted to something big).
+    const uint32_t window = kHalfFrameUs * (F_CPU_ACTUAL / 1000000);
+    for (uint8_t i = 0; i < kPadCount; ++i) {
+      g_result[i] = g_armed[i] ? window : g_rise_cycles[i];
+      g_armed[i] = false;
+      pinMode(kPadPins[i], OUTPUT);  // drain for the next half-frame
+      digitalWrite(kPadPins[i], LOW);
+    }
+    g_result_us = micros();
+    ++g_frames;
+    g_charging = false;
+  } else {
+    for (uint8_t i = 0; i < kPadCount; ++i) {
+      g_armed[i] = true;
+      g_charge_start[i] = ARM_DWT_CYCCNT;  // per pad, so pinMode() skew is not measured
+      pinMode(kPadPins[i], INPUT_PULLUP);
+    }
+    g_charging = true;
+  }
+}
+
+void scan_begin() {
+  for (uint8_t i = 0; i < kPadCount; ++i) {
+    pinMode(kPadPins[i], OUTPUT);
+    digitalWrite(kPadPins[i], LOW);
+    attachInterrupt(digitalPinToInterrupt(kPadPins[i]), kPadIsrs[i], RISING);
+  }
+  g_frame_timer.begin(frame_tick, kHalfFrameUs);
+}
+
+// Copies the latest finished frame. Returns false if nothing new landed since
+// the caller's last frame number.
+bool scan_collect(uint32_t* raw, uint32_t* stamp_us, uint32_t* frame) {
+  noInterrupts();
+  bool fresh = g_frames != *frame;
+  if (fresh) {
+    for (uint8_t i = 0; i < kPadCount; ++i) raw[i] = g_result[i];
+    *stamp_us = g_result_us;
+    *frame = g_frames;
+  }
+  interrupts();
+  return fresh;
+}
+
+#else  // ESP32-S3
+const touch_pad_t kPads[] = {TOUCH_PAD_NUM1, TOUCH_PAD_NUM2,  TOUCH_PAD_NUM3,  TOUCH_PAD_NUM4,
+                             TOUCH_PAD_NUM5, TOUCH_PAD_NUM6,  TOUCH_PAD_NUM7,  TOUCH_PAD_NUM8,
+                             TOUCH_PAD_NUM9, TOUCH_PAD_NUM10, TOUCH_PAD_NUM11, TOUCH_PAD_NUM12};  // GPIO1..12
+const uint8_t kPadCount = sizeof(kPads) / sizeof(kPads[0]);
+// The FSM measures pads back-to-back. Fewer charge/discharge cycles per
+// measurement = faster sweep but noisier counts; 12 pads × ~60 µs stays above
+// 1 kHz per pad. The interval is in RTC slow-clock ticks (~150 kHz) between sweeps.
+const uint16_t kChargeDischargeTimes = 120;
+const uint16_t kSweepIntervalTicks = 0;
+const float kSensitivity = 2000.0f;  // raw-count rise that reads as a full touch
+
+volatile uint32_t g_result_us = 0;
+volatile uint32_t g_frames = 0;  // finished sweeps; 0 until the first one, so boot never seeds from junk
+
+void IRAM_ATTR scan_done_isr(void*) {
+  if (touch_pad_read_intr_status_mask() & TOUCH_PAD_INTR_MASK_SCAN_DONE) {
+    g_result_us = micros();
+    ++g_frames;
+  }
+}
+
+void scan_begin() {
+  touch_pad_init();
+  for (uint8_t i = 0; i < kPadCount; ++i) touch_pad_config(kPads[i]);
+  touch_pad_set_charge_discharge_times(kChargeDischargeTimes);
+  touch_pad_set_measurement_interval(kSweepIntervalTicks);
+  touch_pad_set_fsm_mode(TOUCH_FSM_MODE_TIMER);
+  touch_pad_isr_register(scan_done_isr, nullptr, TOUCH_PAD_INTR_MASK_SCAN_DONE);
+  touch_pad_intr_enable(TOUCH_PAD_INTR_MASK_SCAN_DONE);
+  touch_pad_fsm_start();
+}
+
+// The peripheral keeps the latest count per channel; reading it never waits.
+// Only a finished sweep is a new frame, so each pad's baseline moves once per
+// measurement however fast loop() spins. Returns false until one lands.
+bool scan_collect(uint32_t* raw, uint32_t* stamp_us, uint32_t* frame) {
+  uint32_t frames = g_frames;
+  if (frames == *frame) return false;
+  for (uint8_t i = 0; i < kPadCount; ++i) touch_pad_read_raw_data(kPads[i], &raw[i]);
+  *stamp_us = g_result_us;
+  *frame = frames;
+  return true;
+}
+
+#endif
+
+}  // namespace
+
+class CapacitiveAsyncSensor : public Sensor {
+ public:
+  void begin() override {
+    // Frames arrive at kilohertz rates, so the drift follower runs slower per
+    // frame than the 1 kHz single-pad path to keep the same ~1 s feel.
+    BaselineConfig c;
+    c.rate = 0.0004f;
+    c.gate_below = false;
+    for (uint8_t i = 0; i < kPadCount; ++i) baselines_[i] = BaselineTracker(c);
+    scan_begin();
+  }
+
+  SensorSample read() override {
+    uint32_t raw[kPadCount];
+    uint32_t stamp_us = 0;
+    if (!scan_collect(raw, &stamp_us, &frame_)) return pads_[loudest_];
+
+    if (!seeded_) {
+      // First frame is the untouched reference; seeding here keeps boot from
+      // looking like twelve simultaneous plucks.
+      for (uint8_t i = 0; i < kPadCount; ++i) baselines_[i].seed(raw[i]);
+      seeded_ = true;
+    }
+    float loudest_value = -1.0f;
+    for (uint8_t i = 0; i < kPadCount; ++i) {
+      float delta = baselines_[i].update(raw[i]);
+      float normalized = constrain(delta / kSensitivity, 0.0f, 1.0f);
+      pads_[i] = {normalized, stamp_us};
+      if (normalized > loudest_value) {
+        loudest_value = normalized;
+        loudest_ = i;
+      }
+    }
+    // The single-lane engine hears whichever pad is touched hardest; per-pad
+    // consumers read channel_sample().
+    return pads_[loudest_];
+  }
+
+  float noise_floor() const override { return baselines_[loudest_].sigma() / kSensitivity; }
+  uint8_t channel_count() const override { return kPadCount; }
+  SensorSample channel_sample(uint8_t channel) const override {
+    return channel < kPadCount ? pads_[channel] : SensorSample{0.0f, 0};
+  }
+
+ private:
+  BaselineTracker baselines_[kPadCount];
+  SensorSample pads_[kPadCount] = {};
+  uint8_t loudest_ = 0;
+  uint32_t frame_ = 0;
+  bool seeded_ = false;
+};
+
+Sensor& get_capacitive_async_sensor() {
+  static CapacitiveAsyncSensor sensor_impl;
+  return sensor_impl;
+}
+
+#endif  // SENSOR_CAPACITIVE_ASYNC
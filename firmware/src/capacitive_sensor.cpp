@@ -13,9 +13,11 @@ class CapacitiveSensorCalibrated : public Sensor {
       sum += measure_raw();
       delay(2);
     }
-    baseline_ = sum / 16.0f;
+    baseline_.seed(sum / 16.0f);
   }
 
+  float noise_floor() const override { return baseline_.sigma() / sensitivity_scale_; }
+
   SensorSample read() override {
     uint32_t now = micros();
     // Guard: if a previous read happened too recently, reuse the last sample.
@@ -24,9 +26,9 @@ class CapacitiveSensorCalibrated : public Sensor {
 
     uint16_t raw = measure_raw();
     // Slow baseline drift follower; this resists humidity swings but keeps
-    // quick touches visible. The rate is intentionally tiny for classroom calm.
-    baseline_ = 0.999f * baseline_ + 0.001f * raw;
-    float delta = raw - baseline_;
+    // quick touches visible. The tracker gates on measured noise, so a held
+    // touch barely leaks into the baseline while the room still gets followed.
+    float delta = baseline_.update(raw);
     float normalized = constrain(delta / sensitivity_scale_, 0.0f, 1.0f);
     last_sample_ = {normalized, now};
     return last_sample_;
@@ -39,10 +41,19 @@ class CapacitiveSensorCalibrated : public Sensor {
   const uint16_t guard_us_ = 1000;    // 1ms guard between reads to avoid ghosting
   const float sensitivity_scale_ = 400.0f;  // tweak alongside on/off thresholds
 
-  float baseline_ = 0.0f;
+  // rate 0.001 matches the old 0.999/0.001 follower; drops below the baseline
+  // are never touches on this pad, so only rises are gated.
+  BaselineTracker baseline_{make_baseline_config()};
   uint32_t last_read_us_ = 0;
   SensorSample last_sample_{0.0f, 0};
 
+  static BaselineConfig make_baseline_config() {
+    BaselineConfig c;
+    c.rate = 0.001f;
+    c.gate_below = false;
+    return c;
+  }
+
   uint16_t measure_raw() {
     // Drain any residual charge. This assumes the performer is grounded via a
     // wrist strap or shared foil so the pad always has a reference.
@@ -1,5 +1,6 @@
 #include <math.h>
 
+#include "analog_input.h"
 #include "sensor.h"
 
 #ifdef SENSOR_ELECTRET
@@ -14,35 +15,47 @@ class ElectretMicSensor : public Sensor {
       seed = 0.75f * seed + 0.25f * sample_raw();
       delay(2);
     }
-    bias_ = seed;
+    bias_.seed(seed);
   }
 
+  float noise_floor() const override { return bias_.sigma() * gain_; }
+  float rise_tau_us() const override { return env_.tau_us(); }
+
   SensorSample read() override {
     uint32_t now = micros();
     // Expected signal range: biased mic envelope on A4, sampled 0..1023. You want
     // mid-rail idle (around 0.5 normalized) so the swing has room both ways.
     float x = sample_raw();
-    // AC coupling: follow bias slowly, measure swing fast.
-    bias_ = 0.9994f * bias_ + 0.0006f * x;  // tweak live if the room hums
-    float swing = fabs(x - bias_) * gain_;
+    // AC coupling: follow bias slowly, measure swing fast. Loud swings sit
+    // outside the noise gate both ways, so a sustained note cannot drag the bias.
+    float swing = fabs(bias_.update(x)) * gain_;
     // Normalization behavior: clamp the rectified swing into 0..1, then smooth to a
     // performance-friendly envelope.
-    env_ = 0.88f * env_ + 0.12f * constrain(swing, 0.0f, 1.0f);
+    float env = env_.update(constrain(swing, 0.0f, 1.0f), now);
     // Small floor clamp to avoid whisper-noise. Bump lower if you need pianissimo.
-    if (env_ < 0.01f) env_ = 0.0f;
+    if (env < 0.01f) {
+      env = 0.0f;
+      env_.reset(0.0f, now);
+    }
     // Common failure modes: missing bias resistor (floating pin noise),
     // long unshielded leads (50/60 Hz hum), or gain too high (perma-clipped 1.0).
-    return {env_, now};
+    return {env, now};
   }
 
  private:
   static const uint8_t kMicPin = A4;  // analog envelope input; keep wiring short
   const float gain_ = 3.5f;           // adjust alongside bias speed during calibration
 
-  float bias_ = 0.5f;
-  float env_ = 0.0f;
+  BaselineTracker bias_{make_bias_config()};
+  OnePole env_{7800.0f};  // 7.8 ms: the old 0.88/0.12 blend at a 1 kHz loop
+
+  static BaselineConfig make_bias_config() {
+    BaselineConfig c;
+    c.rate = 0.0006f;  // tweak live if the room hums
+    return c;
+  }
 
-  float sample_raw() { return constrain(analogRead(kMicPin) / 1023.0f, 0.0f, 1.0f); }
+  float sample_raw() { return constrain(analog_input(kMicPin) / 1023.0f, 0.0f, 1.0f); }
 };
 
 Sensor& get_electret_sensor() {
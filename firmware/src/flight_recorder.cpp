@@ -0,0 +1,241 @@
+#include "flight_recorder.h"
+
+#include <string.h>
+
+namespace {
+const uint8_t kTagSample = 0x01;
+const uint8_t kTagGesture = 0x10;  // + Gesture value (0..7)
+const uint8_t kTagMidi = 0x20;
+const uint8_t kTagSameDt = 0xBF;   // 0xBF + dq, dq in -63..+63 → 0x80..0xFE
+
+void put_u32(uint8_t* p, uint32_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+  p[2] = static_cast<uint8_t>(v >> 16);
+  p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+void put_u16(uint8_t* p, uint16_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+uint32_t get_u32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint16_t get_u16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+// Signed → unsigned so small negatives stay small: 0, -1, 1, -2 → 0, 1, 2, 3.
+size_t put_zigzag(uint8_t* p, int32_t v) {
+  uint32_t z = (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+  size_t n = 0;
+  while (z >= 0x80) {
+    p[n++] = static_cast<uint8_t>(z | 0x80);
+    z >>= 7;
+  }
+  p[n++] = static_cast<uint8_t>(z);
+  return n;
+}
+
+bool get_zigzag(const uint8_t* p, size_t end, size_t* pos, int32_t* v) {
+  uint32_t z = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    if (*pos >= end) return false;
+    uint8_t b = p[(*pos)++];
+    z |= static_cast<uint32_t>(b & 0x7F) << shift;
+    if ((b & 0x80) == 0) {
+      *v = static_cast<int32_t>((z >> 1) ^ (~(z & 1) + 1));
+      return true;
+    }
+  }
+  return false;
+}
+
+int16_t quantize(float v) {
+  if (!(v == v)) return 0;  // NaN
+  float q = v * kFlightValueScale;
+  if (q >= 32767.0f) return 32767;
+  if (q <= -32768.0f) return -32768;
+  return static_cast<int16_t>(q < 0.0f ? q - 0.5f : q + 0.5f);
+}
+}  // namespace
+
+FlightRecorder::FlightRecorder(uint8_t* storage, size_t bytes)
+    : storage_(storage), blocks_(static_cast<uint32_t>(bytes / kFlightBlockBytes)) {
+  if (blocks_ < 2) blocks_ = 0;
+  // Teensy DMAMEM is not zeroed at boot: mark every slot empty ourselves.
+  for (uint32_t i = 0; i < blocks_; ++i) put_u32(storage_ + i * kFlightBlockBytes, 0);
+}
+
+void FlightRecorder::open_block(uint32_t us) {
+  ++seq_;
+  block_ = slot(seq_);
+  put_u32(block_, seq_);
+  put_u32(block_ + 4, us);
+  put_u16(block_ + 8, static_cast<uint16_t>(last_q_));
+  used_ = kFlightHeaderBytes;
+  put_u16(block_ + 10, static_cast<uint16_t>(used_));
+  last_us_ = us;
+  have_dt_ = false;
+}
+
+void FlightRecorder::append(const uint8_t* rec, size_t n) {
+  memcpy(block_ + used_, rec, n);
+  used_ += n;
+  put_u16(block_ + 10, static_cast<uint16_t>(used_));
+  ++records_;
+}
+
+void FlightRecorder::sample(const SensorSample& s) {
+  if (blocks_ == 0) return;
+  int16_t q = quantize(s.value);
+  uint8_t rec[kMaxRecordBytes];
+  size_t n = 0;
+  for (uint8_t attempt = 0; attempt < 2; ++attempt) {
+    if (block_ == nullptr) open_block(s.micros);
+    uint32_t dt = s.micros - last_us_;
+    int32_t dq = static_cast<int32_t>(q) - last_q_;
+    n = 0;
+    if (have_dt_ && dt == last_dt_ && dq >= -63 && dq <= 63) {
+      rec[n++] = static_cast<uint8_t>(kTagSameDt + dq);
+    } else {
+      rec[n++] = kTagSample;
+      n += put_zigzag(rec + n, static_cast<int32_t>(dt));
+      n += put_zigzag(rec + n, dq);
+    }
+    if (used_ + n <= kFlightBlockBytes) break;
+    block_ = nullptr;  // full: the next attempt keyframes a fresh block
+  }
+  // A same-dt record needs the dt set by an earlier record in this block.
+  if (rec[0] == kTagSample) {
+    last_dt_ = s.micros - last_us_;
+    have_dt_ = true;
+  }
+  append(rec, n);
+  last_us_ = s.micros;
+  last_q_ = q;
+}
+
+void FlightRecorder::gesture(uint32_t us, uint8_t gesture, uint8_t amount, int note) {
+  if (blocks_ == 0) return;
+  if (block_ == nullptr || used_ + kMaxRecordBytes > kFlightBlockBytes) open_block(us);
+  uint8_t rec[kMaxRecordBytes];
+  size_t n = 0;
+  rec[n++] = static_cast<uint8_t>(kTagGesture + (gesture & 0x0F));
+  n += put_zigzag(rec + n, static_cast<int32_t>(us - last_us_));
+  rec[n++] = amount;
+  rec[n++] = (note >= 0 && note <= 127) ? static_cast<uint8_t>(note) : 0xFF;
+  append(rec, n);
+}
+
+void FlightRecorder::midi(uint32_t us, uint8_t status, uint8_t d1, uint8_t d2) {
+  if (blocks_ == 0) return;
+  if (block_ == nullptr || used_ + kMaxRecordBytes > kFlightBlockBytes) open_block(us);
+  uint8_t rec[kMaxRecordBytes];
+  size_t n = 0;
+  rec[n++] = kTagMidi;
+  n += put_zigzag(rec + n, static_cast<int32_t>(us - last_us_));
+  rec[n++] = status;
+  rec[n++] = d1;
+  rec[n++] = d2;
+  append(rec, n);
+}
+
+uint32_t FlightRecorder::oldest_seq() const {
+  if (seq_ == 0) return 0;
+  return seq_ > blocks_ ? seq_ - blocks_ + 1 : 1;
+}
+
+size_t FlightRecorder::copy_block(uint32_t seq, uint8_t* out) const {
+  if (seq == 0 || seq > seq_ || seq < oldest_seq()) return 0;
+  const uint8_t* b = slot(seq);
+  if (get_u32(b) != seq) return 0;
+  size_t used = get_u16(b + 10);
+  if (used < kFlightHeaderBytes || used > kFlightBlockBytes) return 0;
+  memcpy(out, b, used);
+  return used;
+}
+
+uint32_t FlightRecorder::span_us() const {
+  uint32_t oldest = oldest_seq();
+  if (oldest == 0) return 0;
+  return last_us_ - get_u32(slot(oldest) + 4);
+}
+
+bool FlightBlockReader::open(const uint8_t* block, size_t n) {
+  if (n < kFlightHeaderBytes) return false;
+  size_t used = get_u16(block + 10);
+  if (used < kFlightHeaderBytes || used > n || used > kFlightBlockBytes) return false;
+  data_ = block;
+  used_ = used;
+  pos_ = kFlightHeaderBytes;
+  seq_ = get_u32(block);
+  last_us_ = get_u32(block + 4);
+  last_q_ = static_cast<int16_t>(get_u16(block + 8));
+  have_dt_ = false;
+  return true;
+}
+
+bool FlightBlockReader::next(FlightRecord* out) {
+  if (data_ == nullptr || pos_ >= used_) return false;
+  uint8_t tag = data_[pos_++];
+  int32_t dt = 0;
+  if (tag >= 0x80 && tag != 0xFF) {
+    if (!have_dt_) return false;
+    last_us_ += last_dt_;
+    last_q_ += static_cast<int32_t>(tag) - kTagSameDt;
+    out->type = FlightRecordType::Sample;
+    out->us = last_us_;
+    out->value = static_cast<float>(last_q_) / kFlightValueScale;
+    return true;
+  }
+  if (tag == kTagSample) {
+    int32_t dq = 0;
+    if (!get_zigzag(data_, used_, &pos_, &dt) || !get_zigzag(data_, used_, &pos_, &dq)) return false;
+    last_dt_ = static_cast<uint32_t>(dt);
+    have_dt_ = true;
+    last_us_ += last_dt_;
+    last_q_ += dq;
+    out->type = FlightRecordType::Sample;
+    out->us = last_us_;
+    out->value = static_cast<float>(last_q_) / kFlightValueScale;
+    return true;
+  }
+  if ((tag & 0xF0) == kTagGesture) {
+    if (!get_zigzag(data_, used_, &pos_, &dt) || pos_ + 2 > used_) return false;
+    out->type = FlightRecordType::Gesture;
+    out->us = last_us_ + static_cast<uint32_t>(dt);
+    out->gesture = tag & 0x0F;
+    out->amount = data_[pos_++];
+    uint8_t note = data_[pos_++];
+    out->note = note == 0xFF ? -1 : note;
+    return true;
+  }
+  if (tag == kTagMidi) {
+    if (!get_zigzag(data_, used_, &pos_, &dt) || pos_ + 3 > used_) return false;
+    out->type = FlightRecordType::Midi;
+    out->us = last_us_ + static_cast<uint32_t>(dt);
+    memcpy(out->midi, data_ + pos_, 3);
+    pos_ += 3;
+    return true;
+  }
+  return false;  // unknown tag: stop rather than guess
+}
+
+size_t flight_base64(const uint8_t* in, size_t n, char* out) {
+  static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  size_t o = 0;
+  for (size_t i = 0; i < n; i += 3) {
+    uint32_t chunk = static_cast<uint32_t>(in[i]) << 16;
+    if (i + 1 < n) chunk |= static_cast<uint32_t>(in[i + 1]) << 8;
+    if (i + 2 < n) chunk |= in[i + 2];
+    out[o++] = kAlphabet[(chunk >> 18) & 0x3F];
+    out[o++] = kAlphabet[(chunk >> 12) & 0x3F];
+    out[o++] = i + 1 < n ? kAlphabet[(chunk >> 6) & 0x3F] : '=';
+    out[o++] = i + 2 < n ? kAlphabet[chunk & 0x3F] : '=';
+  }
+  out[o] = '\0';
+  return o;
+}
@@ -0,0 +1,84 @@
+#include "gate_envelope.h"
+
+#include <math.h>
+
+void EdgeRing::push(uint32_t stamp_us, bool level) {
+  uint8_t head = head_;
+  uint8_t next = (head + 1) & (kCapacity - 1);
+  if (next == tail_) {
+    overflow_ = true;
+    ++dropped_;
+    return;
+  }
+  edges_[head].stamp_us = stamp_us;
+  edges_[head].level = level;
+  head_ = next;  // publish after the slot is written
+}
+
+bool EdgeRing::pop(GateEdge* out) {
+  uint8_t tail = tail_;
+  if (tail == head_) return false;
+  *out = edges_[tail];
+  tail_ = (tail + 1) & (kCapacity - 1);
+  return true;
+}
+
+bool EdgeRing::take_overflow() {
+  if (!overflow_) return false;
+  overflow_ = false;
+  return true;
+}
+
+GateEnvelope::GateEnvelope(float attack_tau_us, float release_tau_us, uint32_t holdoff_us)
+    : attack_tau_us_(attack_tau_us), release_tau_us_(release_tau_us), holdoff_us_(holdoff_us) {}
+
+void GateEnvelope::reset(bool level, uint32_t now_us) {
+  value_ = level ? 1.0f : 0.0f;
+  level_ = level;
+  t_us_ = now_us;
+  last_edge_us_ = now_us;
+  pending_ = false;
+}
+
+void GateEnvelope::edge(bool level, uint32_t stamp_us) {
+  advance(stamp_us);
+  if (holdoff_us_ > 0 && stamp_us - last_edge_us_ < holdoff_us_) {
+    // Chatter. Remember where the pin is heading; advance() applies it when
+    // the holdoff expires.
+    pending_ = level != level_;
+    pending_level_ = level;
+    return;
+  }
+  pending_ = false;
+  if (level == level_) return;
+  level_ = level;
+  last_edge_us_ = stamp_us;
+}
+
+float GateEnvelope::value_at(uint32_t now_us) {
+  advance(now_us);
+  return value_;
+}
+
+void GateEnvelope::advance(uint32_t to_us) {
+  if (pending_) {
+    uint32_t release_us = last_edge_us_ + holdoff_us_;
+    // Signed difference keeps this right across the micros() wrap.
+    if (static_cast<int32_t>(to_us - release_us) >= 0) {
+      decay(release_us);
+      pending_ = false;
+      level_ = pending_level_;
+      last_edge_us_ = release_us;
+    }
+  }
+  decay(to_us);
+}
+
+void GateEnvelope::decay(uint32_t to_us) {
+  int32_t dt = static_cast<int32_t>(to_us - t_us_);
+  if (dt <= 0) return;  // out-of-order or repeated stamps: nothing elapsed
+  t_us_ = to_us;
+  float target = level_ ? 1.0f : 0.0f;
+  float tau = target > value_ ? attack_tau_us_ : release_tau_us_;
+  value_ = target + (value_ - target) * expf(-static_cast<float>(dt) / tau);
+}
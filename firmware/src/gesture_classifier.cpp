@@ -0,0 +1,129 @@
+#include "gesture_classifier.h"
+
+#include <math.h>
+
+#include "gesture_tree_model.h"
+
+static_assert(kGestureTreeModelDepth <= kTreeMaxDepth, "regenerate the model with --max-depth <= kTreeMaxDepth");
+static_assert(sizeof(kGestureTreeModel) / sizeof(kGestureTreeModel[0]) <= 255, "tree too large for uint8_t node indices");
+
+namespace {
+int clamp_i8(int x) { return x < -128 ? -128 : (x > 127 ? 127 : x); }
+
+// 0..1 → 0..127, round half up. tools/train_gesture_tree.py quantizes the same way.
+int8_t quantize(float v) {
+  if (!(v > 0.0f)) return 0;  // also catches NaN
+  if (v >= 1.0f) return 127;
+  return static_cast<int8_t>(floorf(v * 127.0f + 0.5f));
+}
+}  // namespace
+
+GestureClassifier::GestureClassifier()
+    : nodes_(kGestureTreeModel),
+      count_(static_cast<uint8_t>(sizeof(kGestureTreeModel) / sizeof(kGestureTreeModel[0]))) {}
+
+GestureClassifier::GestureClassifier(const GestureTreeNode* nodes, uint8_t count) : nodes_(nodes), count_(count) {}
+
+GestureResult GestureClassifier::process(const SensorSample& s) {
+  push(s);
+  extract();
+  float confidence = 0.0f;
+  Gesture prev = label_;
+  label_ = classify(&confidence);
+
+  GestureResult r;
+  r.confidence = confidence;
+  if (label_ == Gesture::Bow) {
+    r.gesture = Gesture::Bow;
+  } else if (label_ != prev && label_ != Gesture::Idle) {
+    r.gesture = label_;
+  } else {
+    r.gesture = Gesture::Idle;
+  }
+  return r;
+}
+
+void GestureClassifier::push(const SensorSample& s) {
+  window_[head_] = quantize(s.value);
+  stamps_[head_] = s.micros;
+  head_ = static_cast<uint8_t>((head_ + 1) % kTreeWindow);
+  if (filled_ < kTreeWindow) ++filled_;
+}
+
+// One pass over the window, oldest to newest. Integer-only on purpose.
+void GestureClassifier::extract() {
+  const uint8_t n = filled_;
+  const uint8_t oldest = static_cast<uint8_t>((head_ + kTreeWindow - n) % kTreeWindow);
+  int sum = 0;
+  int lo = 127;
+  int hi = 0;
+  int flips = 0;
+  int last_sign = 0;
+  int prev = window_[oldest];
+  for (uint8_t i = 0; i < n; ++i) {
+    int q = window_[(oldest + i) % kTreeWindow];
+    sum += q;
+    if (q < lo) lo = q;
+    if (q > hi) hi = q;
+    if (i > 0) {
+      int d = q - prev;
+      if (d >= kTreeFlipDeadband || d <= -kTreeFlipDeadband) {
+        int sign = d > 0 ? 1 : -1;
+        if (last_sign != 0 && sign != last_sign) ++flips;
+        last_sign = sign;
+      }
+    }
+    prev = q;
+  }
+  const uint8_t newest = static_cast<uint8_t>((head_ + kTreeWindow - 1) % kTreeWindow);
+  const uint8_t back = n > kTreeWindow / 4 ? kTreeWindow / 4 : static_cast<uint8_t>(n - 1);
+  const uint8_t then = static_cast<uint8_t>((head_ + kTreeWindow - 1 - back) % kTreeWindow);
+  uint32_t span_ms = (stamps_[newest] - stamps_[oldest]) / 1000;
+
+  features_[kFeatValue] = window_[newest];
+  features_[kFeatMean] = static_cast<int8_t>(sum / n);
+  features_[kFeatMin] = static_cast<int8_t>(lo);
+  features_[kFeatMax] = static_cast<int8_t>(hi);
+  features_[kFeatRange] = static_cast<int8_t>(hi - lo);
+  features_[kFeatSlope] = static_cast<int8_t>(clamp_i8(window_[newest] - window_[then]));
+  features_[kFeatFlips] = static_cast<int8_t>(clamp_i8(flips));
+  features_[kFeatSpanMs] = static_cast<int8_t>(span_ms > 127 ? 127 : span_ms);
+}
+
+Gesture GestureClassifier::classify(float* confidence) const {
+  uint8_t i = 0;
+  // Bounded walk: at most kTreeMaxDepth decisions, then we must be on a leaf.
+  for (uint8_t depth = 0; depth <= kTreeMaxDepth && i < count_; ++depth) {
+    const GestureTreeNode& node = nodes_[i];
+    if (node.feature < 0) {
+      *confidence = node.right / 255.0f;
+      return static_cast<Gesture>(node.left);
+    }
+    i = features_[node.feature] <= node.threshold ? node.left : node.right;
+  }
+  *confidence = 0.0f;  // malformed model: say nothing rather than guess
+  return Gesture::Idle;
+}
+
+bool GestureClassifier::validate(const GestureTreeNode* nodes, uint8_t count) {
+  if (count == 0) return false;
+  // Children always point forward, so depth(child) = depth(parent) + 1 can be
+  // filled in one pass in index order.
+  uint8_t depth[255] = {0};
+  bool reached[255] = {false};
+  reached[0] = true;
+  for (uint8_t i = 0; i < count; ++i) {
+    if (!reached[i]) continue;
+    const GestureTreeNode& n = nodes[i];
+    if (n.feature < 0) {
+      if (n.left > static_cast<uint8_t>(Gesture::Vibrato)) return false;
+      continue;
+    }
+    if (n.feature >= kTreeFeatureCount) return false;
+    if (depth[i] >= kTreeMaxDepth) return false;
+    if (n.left <= i || n.right <= i || n.left >= count || n.right >= count) return false;
+    reached[n.left] = reached[n.right] = true;
+    depth[n.left] = depth[n.right] = static_cast<uint8_t>(depth[i] + 1);
+  }
+  return true;
+}
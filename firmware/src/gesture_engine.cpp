@@ -3,20 +3,113 @@
 #include <algorithm>
 #include <cmath>
 
+#include "gesture_rules.h"
+
+using gesture_rules::clamp_thresh;
+using gesture_rules::Latch;
+using gesture_rules::ramp;
+
+namespace {
+// An age in µs, one sample step older, stopping at ~71 minutes instead of
+// wrapping back to "just now".
+uint32_t age(uint32_t a, uint32_t dt) { return a > UINT32_MAX - dt ? UINT32_MAX : a + dt; }
+}  // namespace
+
+// gesture_rules::decide's view of this engine: plain fields, full precision.
+struct GestureEngine::RuleState {
+  GestureEngine& e;
+
+  uint32_t onset_age_us() const { return e.onset_age_us_; }
+  void restart_onset_age() { e.onset_age_us_ = 0; }
+  float keep_timing(float c) { return e.pluck_timing_confidence_ = c; }
+  float timing() const { return e.pluck_timing_confidence_; }
+  bool latched(Latch l) const { return *latch_field(l); }
+  void latch(Latch l, bool on) { *latch_field(l) = on; }
+  void release() { e.contact_state_ = ContactState::Released; }
+
+  bool* latch_field(Latch l) const {
+    switch (l) {
+      case gesture_rules::kPluckPending: return &e.pluck_pending_;
+      case gesture_rules::kHarmonicCalled: return &e.harmonic_called_;
+      case gesture_rules::kModulationCalled: return &e.modulation_called_;
+      default: return &e.mute_candidate_;
+    }
+  }
+};
+
 GestureEngine::GestureEngine(const GestureParams& p) : p_(p) {}
 
-Gesture GestureEngine::update(const SensorSample& s) {
+// A 0..1 strike that weighs how high the attack got against how fast it got
+// there. Both come from sample timestamps, not from how many samples landed
+// in the window, so a slower loop sees the same attack.
+void GestureEngine::measure_attack(GestureFeatures* f, float on_thresh) const {
+  f->onset_us = onset_us_;
+  f->attack_slope = attack_slope_;
+  f->strike = 0.5f * ramp(peak_value_, on_thresh, 1.0f) + 0.5f * ramp(attack_slope_, 0.0f, p_.attack_slope_full);
+}
+
+float GestureEngine::effective_on_thresh() const {
+  if (p_.on_sigmas > 0.0f && noise_sigma_ > 0.0f) return clamp_thresh(p_.on_sigmas * noise_sigma_);
+  return p_.on_thresh;
+}
+
+float GestureEngine::effective_off_thresh() const {
+  float off = p_.off_thresh;
+  if (p_.off_sigmas > 0.0f && noise_sigma_ > 0.0f) off = clamp_thresh(p_.off_sigmas * noise_sigma_);
+  return std::min(off, effective_on_thresh());  // never let release sit above contact
+}
+
+GestureResult GestureEngine::process(const SensorSample& s) {
+  const float on_thresh = effective_on_thresh();
+  const float off_thresh = effective_off_thresh();
   bool prev = contact_;
-  if (!contact_ && s.value >= p_.on_thresh) contact_ = true;
-  if (contact_ && s.value <= p_.off_thresh) contact_ = false;
+
+  // A dropout (NaN, ±inf) says nothing about the string, so it repeats the
+  // last value. Anything else is clamped to the normalized 0..1 range the
+  // thresholds live in, which keeps every feature below finite.
+  const float value = std::isfinite(s.value) ? std::min(std::max(s.value, 0.0f), 1.0f) : last_value_;
+
+  // Velocity from the previous sample; a repeated timestamp keeps the last
+  // estimate instead of dividing by zero.
+  uint32_t sample_dt = s.micros - last_sample_us_;
+  const uint32_t last_sample_us = last_sample_us_;
+  const bool have_prev = have_sample_;
+  if (!have_sample_) {
+    velocity_ = 0.0f;
+  } else if (sample_dt > 0) {
+    velocity_ = (value - last_value_) * 1e6f / static_cast<float>(sample_dt);
+  }
+  have_sample_ = true;
+  last_sample_us_ = s.micros;
+  // The windows below measure ages, not differences of micros() stamps: a
+  // stamp difference wraps every ~71 minutes and would make an hour-old
+  // onset look recent again. (The first sample counts from micros() == 0.)
+  onset_age_us_ = age(onset_age_us_, sample_dt);
+  contact_age_us_ = age(contact_age_us_, sample_dt);
+  wobble_age_us_ = age(wobble_age_us_, sample_dt);
+
+  if (!contact_ && value >= on_thresh) contact_ = true;
+  if (contact_ && value <= off_thresh) contact_ = false;
 
   if (contact_ && !prev) {
-    contact_start_us_ = s.micros;
-    peak_value_ = s.value;
-    wobble_min_ = s.value;
-    wobble_max_ = s.value;
+    contact_age_us_ = 0;
+    // Where between the last sample and this one did the signal actually
+    // cross? Linear interpolation; the first sample ever has no "before".
+    onset_us_ = s.micros;
+    if (have_prev && last_value_ < on_thresh && value > last_value_) {
+      float frac = (on_thresh - last_value_) / (value - last_value_);
+      // float rounding can land a long gap's crossing past this sample
+      onset_us_ = last_sample_us + std::min(static_cast<uint32_t>(frac * static_cast<float>(sample_dt)), sample_dt);
+    }
+    // The crossing segment's slope; the look-ahead keeps the steepest one.
+    attack_slope_ = have_prev ? std::max(velocity_, 0.0f) : p_.attack_slope_full;
+    pluck_pending_ = false;
+    peak_value_ = value;
+    wobble_min_ = value;
+    wobble_max_ = value;
     wobble_count_ = 0;
-    last_wobble_us_ = s.micros;
+    wobble_rate_hz_ = 0.0f;
+    wobble_age_us_ = 0;
     last_direction_up_ = true;
     harmonic_called_ = false;
     modulation_called_ = false;
@@ -24,66 +117,53 @@ Gesture GestureEngine::update(const SensorSample& s) {
     contact_state_ = ContactState::Attacking;
   }
   if (contact_) {
-    peak_value_ = std::max(peak_value_, s.value);
-    wobble_min_ = std::min(wobble_min_, s.value);
-    wobble_max_ = std::max(wobble_max_, s.value);
-    if (contact_state_ == ContactState::Attacking &&
-        (s.micros - contact_start_us_) > p_.tremolo_grace_us) {
+    peak_value_ = std::max(peak_value_, value);
+    if (pluck_pending_) attack_slope_ = std::max(attack_slope_, velocity_);
+    wobble_min_ = std::min(wobble_min_, value);
+    wobble_max_ = std::max(wobble_max_, value);
+    if (contact_state_ == ContactState::Attacking && contact_age_us_ > p_.tremolo_grace_us) {
       contact_state_ = ContactState::Sustaining;
     }
   }
 
-  float delta = s.value - last_value_;
+  float delta = value - last_value_;
   bool rising = delta >= 0.0f;
   if (std::fabs(delta) >= p_.tremolo_min_delta && contact_state_ == ContactState::Sustaining) {
     if (rising != last_direction_up_) {
-      uint32_t wobble_dt = s.micros - last_wobble_us_;
+      uint32_t wobble_dt = wobble_age_us_;
       if (wobble_dt <= p_.tremolo_max_period_us) {
         ++wobble_count_;
+        // A flip is half a cycle. Light smoothing so one ragged flip does not
+        // yank a synth's LFO rate around.
+        float inst_hz = wobble_dt > 0 ? 1e6f / (2.0f * static_cast<float>(wobble_dt)) : wobble_rate_hz_;
+        wobble_rate_hz_ = wobble_rate_hz_ > 0.0f ? 0.7f * wobble_rate_hz_ + 0.3f * inst_hz : inst_hz;
       } else {
         wobble_count_ = 1;
       }
-      last_wobble_us_ = s.micros;
+      wobble_age_us_ = 0;
       last_direction_up_ = rising;
     }
   }
-  last_value_ = s.value;
+  last_value_ = value;
 
-  Gesture g = Gesture::Idle;
-  if (contact_ && !prev) {
-    uint32_t dt = s.micros - last_onset_us_;
-    if (dt < p_.scrape_window_us) {
-      g = Gesture::Scrape;
-      last_onset_us_ = s.micros;
-    } else if (dt < p_.min_retrigger_us) {
-      g = Gesture::Idle;
-    } else {
-      g = Gesture::Pluck;
-      last_onset_us_ = s.micros;
-    }
-  } else if (contact_) {
-    bool in_harmonic_band = peak_value_ >= p_.harmonic_peak_min && peak_value_ <= p_.harmonic_peak_max;
-    float wobble_depth = wobble_max_ - wobble_min_;
-    if (!harmonic_called_ && in_harmonic_band && wobble_depth <= p_.harmonic_variation_eps &&
-        (s.micros - contact_start_us_) > p_.harmonic_hold_us) {
-      harmonic_called_ = true;
-      g = Gesture::Harmonic;
-    } else if (!modulation_called_ && wobble_count_ >= p_.wobble_goal) {
-      modulation_called_ = true;
-      g = (wobble_depth >= p_.vibrato_depth_min) ? Gesture::Vibrato : Gesture::Tremolo;
-    } else {
-      g = Gesture::Bow;
-    }
-    if (peak_value_ <= p_.mute_peak_thresh && s.value <= p_.mute_release_thresh) {
-      mute_candidate_ = true;
-    }
-  } else if (prev && !contact_) {
-    contact_state_ = ContactState::Released;
-    uint32_t hold = s.micros - contact_start_us_;
-    if (hold <= p_.mute_window_us || mute_candidate_) {
-      g = Gesture::Muted;
-    }
-  }
-  return g;
-}
+  GestureResult r;
+  GestureFeatures& f = r.features;
+  f.value = value;
+  f.velocity = velocity_;
+  f.contact = contact_;
+  f.contact_us = (contact_ || prev) ? contact_age_us_ : 0;
+  f.peak = peak_value_;
+  f.wobble_depth = wobble_max_ - wobble_min_;
+  f.wobble_center = 0.5f * (wobble_max_ + wobble_min_);
+  f.wobble_count = wobble_count_;
+  f.wobble_rate_hz = wobble_rate_hz_;
+  measure_attack(&f, on_thresh);
 
+  // The verdict itself is shared with GestureLanes (see gesture_rules.h).
+  RuleState st{*this};
+  gesture_rules::Verdict v =
+      gesture_rules::decide(st, p_, f, prev, on_thresh, off_thresh, s.micros - onset_us_);
+  r.gesture = v.gesture;
+  r.confidence = v.confidence;
+  return r;
+}
@@ -0,0 +1,288 @@
+#include "gesture_lanes.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "gesture_rules.h"
+
+using gesture_rules::clamp_thresh;
+using gesture_rules::Latch;
+using gesture_rules::ramp;
+
+namespace {
+// PackedLane::flags, low bit first.
+const uint16_t kContact = 1u << 0;
+const uint16_t kHaveSample = 1u << 1;
+const uint16_t kPluckPending = 1u << 2;
+const uint16_t kDirectionUp = 1u << 3;
+const uint16_t kHarmonicCalled = 1u << 4;
+const uint16_t kModulationCalled = 1u << 5;
+const uint16_t kMuteCandidate = 1u << 6;
+const uint16_t kStateShift = 7;   // 2 bits: Released, Attacking, Sustaining
+const uint16_t kWobbleShift = 9;  // 4 bits: wobble count, saturating at 15
+const uint16_t kTimingShift = 13;  // 3 bits: pluck timing confidence, 0.5 + n/14
+const uint16_t kStateMask = 3u << kStateShift;
+const uint16_t kWobbleMask = 15u << kWobbleShift;
+const uint16_t kTimingMask = 7u << kTimingShift;
+const uint8_t kWobbleMax = 15;
+
+enum : uint16_t { kReleased = 0, kAttacking = 1, kSustaining = 2 };
+
+const float kQScale = 65535.0f;
+const float kNoiseScale = 2048.0f;
+const float kRateScale = 2.0f;
+const uint32_t kTickMask = 0xFFFFFFFFu / kLaneTickUs;  // micros() / 16 wraps here
+
+uint16_t to_q(float x) {
+  if (!(x > 0.0f)) return 0;  // NaN lands on 0
+  if (x >= 1.0f) return 0xFFFF;
+  return static_cast<uint16_t>(x * kQScale + 0.5f);
+}
+float from_q(uint16_t q) { return static_cast<float>(q) / kQScale; }
+
+// add_params() has already refused anything past kLaneMaxAgeUs.
+uint16_t to_ticks(uint32_t us) { return static_cast<uint16_t>(us / kLaneTickUs); }
+
+uint16_t age(uint16_t a, uint32_t dticks) { return static_cast<uint16_t>(std::min<uint32_t>(a + dticks, 0xFFFF)); }
+
+uint8_t slope_q(float v, float full) {
+  if (!(v > 0.0f)) return 0;
+  if (!(full > 0.0f) || v >= full) return 255;
+  return static_cast<uint8_t>(v / full * 255.0f + 0.5f);
+}
+}  // namespace
+
+GestureLanes::GestureLanes(PackedLane* lanes, uint16_t count, const GestureParams& p)
+    : lanes_(lanes), count_(lanes ? count : 0) {
+  if (add_params(p) < 0) count_ = 0;
+  for (uint16_t i = 0; i < count_; ++i) {
+    lanes_[i].block = 0;
+    lanes_[i].noise = 0;
+    reset(i);
+  }
+}
+
+bool GestureLanes::fits(const GestureParams& p) {
+  const uint32_t windows[] = {p.min_retrigger_us, p.scrape_window_us,      p.harmonic_hold_us,
+                              p.mute_window_us,   p.tremolo_max_period_us, p.tremolo_grace_us,
+                              p.attack_lookahead_us};
+  for (uint32_t w : windows) {
+    if (w >= kLaneMaxAgeUs) return false;
+  }
+  return true;
+}
+
+int GestureLanes::add_params(const GestureParams& p) {
+  if (block_count_ >= kMaxBlocks) return kBlocksFull;
+  if (!fits(p)) return kWindowTooLong;
+  LaneParams& b = blocks_[block_count_];
+  b.p = p;
+  b.p.wobble_goal = std::min<uint8_t>(p.wobble_goal, kWobbleMax);  // the most the packed count can hold
+  b.on_q = to_q(p.on_thresh);
+  b.off_q = to_q(p.off_thresh);
+  b.tremolo_delta_q = to_q(p.tremolo_min_delta);
+  b.tremolo_period_ticks = to_ticks(p.tremolo_max_period_us);
+  b.grace_ticks = to_ticks(p.tremolo_grace_us);
+  return block_count_++;
+}
+
+void GestureLanes::assign(uint16_t lane, uint8_t block) {
+  if (lane >= count_ || block >= block_count_) return;
+  lanes_[lane].block = block;
+  reset(lane);
+}
+
+void GestureLanes::reset(uint16_t lane) {
+  if (lane >= count_) return;
+  PackedLane& l = lanes_[lane];
+  l.last_us = 0;
+  l.last_q = 0;
+  l.peak_q = 0;
+  l.wobble_min_q = 0xFFFF;
+  l.wobble_max_q = 0;
+  l.contact_age = 0xFFFF;
+  l.onset_age = 0xFFFF;  // long ago: the first contact is a pluck, never a scrape
+  l.wobble_age = 0xFFFF;
+  l.flags = kDirectionUp;
+  l.slope = 0;
+  l.rate = 0;
+}
+
+void GestureLanes::set_noise_floor(uint16_t lane, float sigma) {
+  if (lane >= count_) return;
+  float n = sigma * kNoiseScale + 0.5f;
+  lanes_[lane].noise = !(n > 0.0f) ? 0 : n >= 255.0f ? 255 : static_cast<uint8_t>(n);
+}
+
+float GestureLanes::noise_floor(uint16_t lane) const {
+  return lane < count_ ? static_cast<float>(lanes_[lane].noise) / kNoiseScale : 0.0f;
+}
+
+void GestureLanes::thresholds(const PackedLane& l, uint16_t* on_q, uint16_t* off_q) const {
+  const LaneParams& b = blocks_[l.block];
+  *on_q = b.on_q;
+  *off_q = b.off_q;
+  if (l.noise == 0) return;  // the common case: no float work at all
+  const float sigma = static_cast<float>(l.noise) / kNoiseScale;
+  if (b.p.on_sigmas > 0.0f) {
+    *on_q = to_q(clamp_thresh(b.p.on_sigmas * sigma));
+  }
+  if (b.p.off_sigmas > 0.0f) {
+    *off_q = to_q(clamp_thresh(b.p.off_sigmas * sigma));
+  }
+  *off_q = std::min(*off_q, *on_q);
+}
+
+float GestureLanes::effective_on_thresh(uint16_t lane) const {
+  if (lane >= count_) return 0.0f;
+  uint16_t on_q, off_q;
+  thresholds(lanes_[lane], &on_q, &off_q);
+  return from_q(on_q);
+}
+
+float GestureLanes::effective_off_thresh(uint16_t lane) const {
+  if (lane >= count_) return 0.0f;
+  uint16_t on_q, off_q;
+  thresholds(lanes_[lane], &on_q, &off_q);
+  return from_q(off_q);
+}
+
+// gesture_rules::decide's view of one lane: ages in ticks, latches and the
+// pluck timing confidence (3 bits) packed into the flags word.
+struct GestureLanes::LaneRuleState {
+  PackedLane& l;
+  uint16_t& flags;
+  uint16_t& state;
+
+  uint32_t onset_age_us() const { return static_cast<uint32_t>(l.onset_age) * kLaneTickUs; }
+  void restart_onset_age() { l.onset_age = 0; }
+  float keep_timing(float c) {
+    uint16_t n = std::min<uint16_t>(static_cast<uint16_t>((c - 0.5f) * 14.0f + 0.5f), 7);
+    flags = static_cast<uint16_t>((flags & ~kTimingMask) | (n << kTimingShift));
+    return timing();
+  }
+  float timing() const { return 0.5f + static_cast<float>((flags & kTimingMask) >> kTimingShift) / 14.0f; }
+  bool latched(Latch b) const { return flags & bit(b); }
+  void latch(Latch b, bool on) { flags = static_cast<uint16_t>(on ? (flags | bit(b)) : (flags & ~bit(b))); }
+  void release() { state = kReleased; }
+
+  static uint16_t bit(Latch b) {
+    switch (b) {
+      case gesture_rules::kPluckPending: return kPluckPending;
+      case gesture_rules::kHarmonicCalled: return kHarmonicCalled;
+      case gesture_rules::kModulationCalled: return kModulationCalled;
+      default: return kMuteCandidate;
+    }
+  }
+};
+
+/**
+ * GestureEngine::process, step for step, on packed state. The comments there
+ * explain the rules; the ones here only explain the packing.
+ */
+GestureResult GestureLanes::process(uint16_t lane, const SensorSample& s) {
+  GestureResult r;
+  if (lane >= count_) return r;
+  PackedLane& l = lanes_[lane];
+  const LaneParams& b = blocks_[l.block];
+  const GestureParams& p = b.p;
+  uint16_t on_q, off_q;
+  thresholds(l, &on_q, &off_q);
+  // A dropout repeats the last value and the rest is clamped, as in GestureEngine.
+  const bool finite = std::isfinite(s.value);
+  const uint16_t q = finite ? to_q(s.value) : l.last_q;
+  const float value = finite ? std::min(std::max(s.value, 0.0f), 1.0f) : from_q(l.last_q);
+  uint16_t flags = l.flags;
+  const bool prev = flags & kContact;
+  const bool have_prev = flags & kHaveSample;
+
+  // Ages step by whole ticks of the absolute clock (not by dt / 16), so the
+  // rounding never accumulates however many samples go by.
+  const uint32_t sample_dt = s.micros - l.last_us;
+  const uint32_t dticks = have_prev ? ((s.micros / kLaneTickUs - l.last_us / kLaneTickUs) & kTickMask) : 0;
+  l.contact_age = age(l.contact_age, dticks);
+  l.onset_age = age(l.onset_age, dticks);
+  l.wobble_age = age(l.wobble_age, dticks);
+  float velocity = 0.0f;
+  if (have_prev && sample_dt > 0) {
+    velocity = static_cast<float>(static_cast<int32_t>(q) - l.last_q) / kQScale * 1e6f / static_cast<float>(sample_dt);
+  }
+  flags |= kHaveSample;
+  l.last_us = s.micros;
+
+  bool contact = prev;
+  if (!contact && q >= on_q) contact = true;
+  if (contact && q <= off_q) contact = false;
+  uint16_t state = (flags & kStateMask) >> kStateShift;
+  uint8_t wobbles = static_cast<uint8_t>((flags & kWobbleMask) >> kWobbleShift);
+
+  if (contact && !prev) {
+    l.contact_age = 0;
+    l.slope = have_prev ? slope_q(velocity, p.attack_slope_full) : 255;
+    l.peak_q = q;
+    l.wobble_min_q = q;
+    l.wobble_max_q = q;
+    l.wobble_age = 0;
+    l.rate = 0;
+    wobbles = 0;
+    flags &= static_cast<uint16_t>(~(kPluckPending | kHarmonicCalled | kModulationCalled | kMuteCandidate));
+    flags |= kDirectionUp;
+    state = kAttacking;
+  }
+  if (contact) {
+    l.peak_q = std::max(l.peak_q, q);
+    if (flags & kPluckPending) l.slope = std::max(l.slope, slope_q(velocity, p.attack_slope_full));
+    l.wobble_min_q = std::min(l.wobble_min_q, q);
+    l.wobble_max_q = std::max(l.wobble_max_q, q);
+    if (state == kAttacking && l.contact_age > b.grace_ticks) state = kSustaining;
+  }
+
+  const int32_t delta = static_cast<int32_t>(q) - l.last_q;
+  const bool rising = delta >= 0;
+  if (static_cast<uint32_t>(delta < 0 ? -delta : delta) >= b.tremolo_delta_q && state == kSustaining) {
+    if (rising != static_cast<bool>(flags & kDirectionUp)) {
+      if (l.wobble_age <= b.tremolo_period_ticks) {
+        if (wobbles < kWobbleMax) ++wobbles;
+        float old_hz = static_cast<float>(l.rate) / kRateScale;
+        float inst_hz = l.wobble_age > 0 ? 1e6f / (2.0f * static_cast<float>(l.wobble_age * kLaneTickUs)) : old_hz;
+        float hz = old_hz > 0.0f ? 0.7f * old_hz + 0.3f * inst_hz : inst_hz;
+        float rq = hz * kRateScale + 0.5f;
+        l.rate = rq >= 255.0f ? 255 : static_cast<uint8_t>(rq);
+      } else {
+        wobbles = 1;
+      }
+      l.wobble_age = 0;
+      flags = rising ? (flags | kDirectionUp) : (flags & static_cast<uint16_t>(~kDirectionUp));
+    }
+  }
+  l.last_q = q;
+
+  const float on_thresh = from_q(on_q);
+  const float off_thresh = from_q(off_q);
+  const float peak = from_q(l.peak_q);
+  const uint32_t contact_us = static_cast<uint32_t>(l.contact_age) * kLaneTickUs;
+  GestureFeatures& f = r.features;
+  f.value = value;
+  f.velocity = velocity;
+  f.contact = contact;
+  f.contact_us = (contact || prev) ? contact_us : 0;
+  f.peak = peak;
+  f.wobble_depth = from_q(l.wobble_max_q) - from_q(l.wobble_min_q);  // -1 before the first contact, as in GestureEngine
+  f.wobble_center = 0.5f * (from_q(l.wobble_max_q) + from_q(l.wobble_min_q));
+  f.wobble_count = wobbles;
+  f.wobble_rate_hz = static_cast<float>(l.rate) / kRateScale;
+  f.onset_us = s.micros - contact_us;
+  f.attack_slope = static_cast<float>(l.slope) / 255.0f * p.attack_slope_full;
+  f.strike = 0.5f * ramp(peak, on_thresh, 1.0f) + 0.5f * static_cast<float>(l.slope) / 255.0f;
+
+  LaneRuleState st{l, flags, state};
+  gesture_rules::Verdict v = gesture_rules::decide(st, p, f, prev, on_thresh, off_thresh, contact_us);
+
+  flags = static_cast<uint16_t>(contact ? (flags | kContact) : (flags & ~kContact));
+  flags = static_cast<uint16_t>((flags & ~(kStateMask | kWobbleMask)) | (state << kStateShift) |
+                                (static_cast<uint16_t>(wobbles) << kWobbleShift));
+  l.flags = flags;
+  r.gesture = v.gesture;
+  r.confidence = v.confidence;
+  return r;
+}
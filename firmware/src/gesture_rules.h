@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "gesture_engine.h"
+
+// ---- Gesture rules shared by GestureEngine and GestureLanes ------------------
+// The two engines keep their state differently (floats and µs ages vs 16-bit
+// fractions and 16 µs ticks), but the verdict must be the same call with the
+// same confidence. It lives here once, as a template over each engine's state,
+// so a rule change cannot land in one engine and miss the other.
+namespace gesture_rules {
+
+// Noise-scaled thresholds stay inside the normalized range so a silent room
+// cannot talk the engine into triggering on rounding noise (or never at all).
+const float kMinNoiseThresh = 0.02f;
+const float kMaxNoiseThresh = 0.98f;
+
+inline float clamp_thresh(float x) { return std::min(std::max(x, kMinNoiseThresh), kMaxNoiseThresh); }
+
+// 0 at `lo`, 1 at `hi`, clamped: "how far past the boundary did we land".
+inline float ramp(float x, float lo, float hi) {
+  if (hi <= lo) return x >= hi ? 1.0f : 0.0f;
+  return std::min(std::max((x - lo) / (hi - lo), 0.0f), 1.0f);
+}
+
+// Confidence for a two-way call decided at `boundary`: 0.5 right on the line,
+// 1.0 once the margin reaches `full_margin`.
+inline float split_confidence(float x, float boundary, float full_margin) {
+  return 0.5f + 0.5f * ramp(std::fabs(x - boundary), 0.0f, full_margin);
+}
+
+// The per-contact latches the verdict reads and sets.
+enum Latch : uint8_t { kPluckPending, kHarmonicCalled, kModulationCalled, kMuteCandidate };
+
+struct Verdict {
+  Gesture gesture = Gesture::Idle;
+  float confidence = 1.0f;
+};
+
+/**
+ * One sample's verdict, after the caller has updated contact, peak, wobble,
+ * and ages and filled in `f`. `prev` is the contact state before this sample;
+ * `since_onset_us` is how long ago the onset the look-ahead counts from was.
+ *
+ * `State` is the engine's storage seen through:
+ *   uint32_t onset_age_us() const;   since the last accepted onset
+ *   void restart_onset_age();
+ *   float keep_timing(float c);      store the pluck timing confidence; returns
+ *                                    what was stored (lanes quantize it)
+ *   float timing() const;
+ *   bool latched(Latch) const;  void latch(Latch, bool);
+ *   void release();                  contact state machine → Released
+ */
+template <typename State>
+Verdict decide(State& st, const GestureParams& p, const GestureFeatures& f, bool prev, float on_thresh,
+               float off_thresh, uint32_t since_onset_us) {
+  Verdict v;
+  const bool contact = f.contact;
+  // Released and nothing happening: sure it is Idle unless the signal is
+  // creeping up on the contact threshold.
+  v.confidence = contact ? 1.0f : 1.0f - 0.5f * ramp(f.value, off_thresh, on_thresh);
+  const float attack_margin = std::max(on_thresh - off_thresh, 0.05f);
+
+  if (contact && !prev) {
+    const uint32_t dt = st.onset_age_us();
+    if (dt < p.scrape_window_us) {
+      v.gesture = Gesture::Scrape;
+      st.restart_onset_age();
+      v.confidence = split_confidence(static_cast<float>(dt), static_cast<float>(p.scrape_window_us),
+                                      0.5f * p.scrape_window_us);
+    } else if (dt < p.min_retrigger_us) {
+      v.gesture = Gesture::Idle;  // swallowed by the retrigger guard
+      v.confidence = split_confidence(static_cast<float>(dt), static_cast<float>(p.min_retrigger_us),
+                                      0.5f * (p.min_retrigger_us - p.scrape_window_us));
+    } else {
+      st.restart_onset_age();
+      // Clear of the retrigger guard, and how decisively it crossed the bar.
+      float timing = st.keep_timing(split_confidence(static_cast<float>(dt), static_cast<float>(p.min_retrigger_us),
+                                                     static_cast<float>(p.min_retrigger_us)));
+      if (p.attack_lookahead_us == 0) {
+        v.gesture = Gesture::Pluck;
+        v.confidence = std::min(timing, split_confidence(f.value, on_thresh, attack_margin));
+      } else {
+        st.latch(kPluckPending, true);  // report once the attack has had time to show itself
+      }
+    }
+  } else if (st.latched(kPluckPending) && contact) {
+    // Inside the look-ahead: keep quiet until it ends. A contact that ends
+    // first is judged on its release sample below.
+    if (since_onset_us >= p.attack_lookahead_us) {
+      st.latch(kPluckPending, false);
+      v.gesture = Gesture::Pluck;
+      v.confidence = std::min(st.timing(), split_confidence(f.peak, on_thresh, attack_margin));
+    }
+  } else if (contact) {
+    bool in_harmonic_band = f.peak >= p.harmonic_peak_min && f.peak <= p.harmonic_peak_max;
+    if (!st.latched(kHarmonicCalled) && in_harmonic_band && f.wobble_depth <= p.harmonic_variation_eps &&
+        f.contact_us > p.harmonic_hold_us) {
+      st.latch(kHarmonicCalled, true);
+      v.gesture = Gesture::Harmonic;
+      // The weaker of two margins: how still it held, how centered in the light band.
+      float half_band = 0.5f * (p.harmonic_peak_max - p.harmonic_peak_min);
+      float mid = p.harmonic_peak_min + half_band;
+      float centered = half_band > 0.0f ? 1.0f - 0.5f * ramp(std::fabs(f.peak - mid), 0.0f, half_band) : 1.0f;
+      float still = split_confidence(f.wobble_depth, p.harmonic_variation_eps, p.harmonic_variation_eps);
+      v.confidence = std::min(centered, still);
+    } else if (!st.latched(kModulationCalled) && f.wobble_count >= p.wobble_goal) {
+      st.latch(kModulationCalled, true);
+      v.gesture = (f.wobble_depth >= p.vibrato_depth_min) ? Gesture::Vibrato : Gesture::Tremolo;
+      v.confidence = split_confidence(f.wobble_depth, p.vibrato_depth_min, 0.5f * p.vibrato_depth_min);
+    } else {
+      v.gesture = Gesture::Bow;
+      // A bow firms up as the contact lasts past the window where it could
+      // still turn out to be a mute.
+      v.confidence = 0.5f + 0.5f * ramp(static_cast<float>(f.contact_us), 0.0f, static_cast<float>(p.mute_window_us));
+    }
+    if (f.peak <= p.mute_peak_thresh && f.value <= p.mute_release_thresh) st.latch(kMuteCandidate, true);
+  } else if (prev) {
+    st.release();
+    const uint32_t hold = f.contact_us;
+    if (hold <= p.mute_window_us || st.latched(kMuteCandidate)) {
+      // A dampening tap, including one over before the look-ahead ended:
+      // the mute rule comes first, so a pending Pluck never sounds it.
+      v.gesture = Gesture::Muted;
+      v.confidence = st.latched(kMuteCandidate)
+                         ? 1.0f
+                         : split_confidence(static_cast<float>(hold), static_cast<float>(p.mute_window_us),
+                                            0.5f * p.mute_window_us);
+    } else if (st.latched(kPluckPending)) {
+      // Too long for a mute but shorter than the look-ahead (a look-ahead
+      // set past mute_window_us): still strikes its note, which the next
+      // sample's Idle releases.
+      v.gesture = Gesture::Pluck;
+      v.confidence = std::min(st.timing(), split_confidence(f.peak, on_thresh, attack_margin));
+    }
+    st.latch(kPluckPending, false);
+  }
+  return v;
+}
+
+}  // namespace gesture_rules
@@ -0,0 +1,179 @@
+#include "i2c_bus_hw.h"
+
+#if defined(TOF_I2C)
+
+#include <Wire.h>
+
+#if defined(TEENSYDUINO)
+// ---- Teensy 4.x: interrupt-driven LPI2C1 -----------------------------------
+namespace {
+// LPI2C master flags and commands (i.MX RT1060 reference manual, LPI2C chapter).
+const uint32_t kMsrTdf = 1u << 0;   // TX FIFO at/below watermark
+const uint32_t kMsrRdf = 1u << 1;   // RX FIFO above watermark
+const uint32_t kMsrSdf = 1u << 9;   // STOP went out
+const uint32_t kMsrNdf = 1u << 10;  // NACK
+const uint32_t kMsrAlf = 1u << 11;  // arbitration lost
+const uint32_t kMsrFef = 1u << 12;  // FIFO error
+const uint32_t kMsrErrors = kMsrNdf | kMsrAlf | kMsrFef;
+const uint32_t kMcrRtf = 1u << 8;   // reset TX FIFO
+const uint32_t kMcrRrf = 1u << 9;   // reset RX FIFO
+const uint32_t kMrdrRxEmpty = 1u << 14;
+const uint32_t kCmdTransmit = 0u << 8;
+const uint32_t kCmdReceive = 1u << 8;  // DATA + 1 bytes
+const uint32_t kCmdStop = 2u << 8;
+const uint32_t kCmdStart = 4u << 8;    // START + address byte
+const uint8_t kTxFifoWords = 4;
+const uint8_t kMaxTx = 8;
+
+class Lpi2cBus : public I2cBus {
+ public:
+  bool submit(I2cTransaction* t) override {
+    if (current_) return false;
+    if (t->tx_len > kMaxTx) {
+      t->status = I2cStatus::Error;
+      return true;
+    }
+    // Precompute the whole transfer as FIFO commands; the ISR just copies them.
+    uint8_t n = 0;
+    cmds_[n++] = kCmdStart | (t->address << 1);
+    for (uint8_t i = 0; i < t->tx_len; ++i) cmds_[n++] = kCmdTransmit | t->tx[i];
+    if (t->rx_len > 0) {
+      cmds_[n++] = kCmdStart | (t->address << 1) | 1;  // repeated start, read
+      cmds_[n++] = kCmdReceive | (t->rx_len - 1);
+    }
+    cmds_[n++] = kCmdStop;
+    cmd_count_ = n;
+    next_cmd_ = 0;
+    rx_got_ = 0;
+    error_ = I2cStatus::Done;
+    t->status = I2cStatus::Pending;
+    current_ = t;
+    IMXRT_LPI2C1.MSR = kMsrSdf | kMsrErrors;
+    // TDF is already set (FIFO empty), so this fires the ISR right away.
+    IMXRT_LPI2C1.MIER = kMsrTdf | kMsrRdf | kMsrSdf | kMsrErrors;
+    return true;
+  }
+
+  bool busy() const override { return current_ != nullptr; }
+
+  void isr() {
+    I2cTransaction* t = current_;
+    uint32_t msr = IMXRT_LPI2C1.MSR;
+    if (!t) {
+      IMXRT_LPI2C1.MIER = 0;
+      return;
+    }
+    if (msr & kMsrErrors) {
+      // Flush what is queued and end the transfer; status reports the cause.
+      error_ = (msr & kMsrNdf) ? I2cStatus::Nack : I2cStatus::Error;
+      IMXRT_LPI2C1.MCR |= kMcrRtf | kMcrRrf;
+      IMXRT_LPI2C1.MSR = kMsrErrors;
+      IMXRT_LPI2C1.MTDR = kCmdStop;
+      next_cmd_ = cmd_count_;
+    }
+    while (rx_got_ < t->rx_len) {
+      uint32_t d = IMXRT_LPI2C1.MRDR;
+      if (d & kMrdrRxEmpty) break;
+      t->rx[rx_got_++] = static_cast<uint8_t>(d);
+    }
+    while (next_cmd_ < cmd_count_ && (IMXRT_LPI2C1.MFSR & 0x7) < kTxFifoWords) {
+      IMXRT_LPI2C1.MTDR = cmds_[next_cmd_++];
+    }
+    if (next_cmd_ >= cmd_count_) IMXRT_LPI2C1.MIER &= ~kMsrTdf;
+    if (msr & kMsrSdf) {
+      IMXRT_LPI2C1.MSR = kMsrSdf;
+      IMXRT_LPI2C1.MIER = 0;
+      current_ = nullptr;
+      if (error_ == I2cStatus::Done && rx_got_ < t->rx_len) error_ = I2cStatus::Error;
+      t->status = error_;
+    }
+  }
+
+ private:
+  I2cTransaction* volatile current_ = nullptr;
+  uint16_t cmds_[kMaxTx + 4];
+  uint8_t cmd_count_ = 0;
+  volatile uint8_t next_cmd_ = 0;
+  volatile uint8_t rx_got_ = 0;
+  volatile I2cStatus error_ = I2cStatus::Done;
+};
+
+Lpi2cBus g_bus;
+
+void lpi2c1_isr() { g_bus.isr(); }
+}  // namespace
+
+bool hardware_i2c_begin(uint32_t clock_hz) {
+  // Let Wire do pin muxing and clock/timing setup, then take the port over.
+  Wire.begin();
+  Wire.setClock(clock_hz);
+  IMXRT_LPI2C1.MIER = 0;
+  IMXRT_LPI2C1.MFCR = 1;  // TXWATER = 1 word, RXWATER = 0 (any byte raises RDF)
+  attachInterruptVector(IRQ_LPI2C1, lpi2c1_isr);
+  NVIC_ENABLE_IRQ(IRQ_LPI2C1);
+  return true;
+}
+
+I2cBus& hardware_i2c_bus() { return g_bus; }
+
+#elif defined(ARDUINO_ARCH_ESP32)
+// ---- ESP32-S3: transfer worker on core 0 ------------------------------------
+namespace {
+class WorkerBus : public I2cBus {
+ public:
+  bool begin() {
+    queue_ = xQueueCreate(1, sizeof(I2cTransaction*));
+    if (!queue_) return false;
+    return xTaskCreatePinnedToCore(task, "i2c_bus", 3072, this, 5, nullptr, 0) == pdPASS;
+  }
+
+  bool submit(I2cTransaction* t) override {
+    if (busy_) return false;
+    busy_ = true;
+    t->status = I2cStatus::Pending;
+    xQueueSend(queue_, &t, 0);  // depth 1 and we were idle: never full
+    return true;
+  }
+
+  bool busy() const override { return busy_; }
+
+ private:
+  QueueHandle_t queue_ = nullptr;
+  volatile bool busy_ = false;
+
+  static void task(void* arg) {
+    WorkerBus* self = static_cast<WorkerBus*>(arg);
+    I2cTransaction* t = nullptr;
+    for (;;) {
+      if (xQueueReceive(self->queue_, &t, portMAX_DELAY) != pdTRUE) continue;
+      Wire.beginTransmission(t->address);
+      Wire.write(t->tx, t->tx_len);
+      uint8_t err = Wire.endTransmission(t->rx_len == 0);  // keep the bus for a repeated start
+      if (err == 0 && t->rx_len > 0) {
+        uint8_t got = Wire.requestFrom(t->address, t->rx_len);
+        if (got != t->rx_len) err = 4;
+        for (uint8_t i = 0; i < got; ++i) t->rx[i] = static_cast<uint8_t>(Wire.read());
+      }
+      self->busy_ = false;
+      t->status = err == 0 ? I2cStatus::Done : (err == 2 || err == 3) ? I2cStatus::Nack : I2cStatus::Error;
+    }
+  }
+};
+
+WorkerBus g_bus;
+}  // namespace
+
+bool hardware_i2c_begin(uint32_t clock_hz) {
+  if (!Wire.begin()) return false;
+  Wire.setClock(clock_hz);
+  Wire.setTimeOut(5);  // ms; a wedged bus fails the transaction instead of the task
+  return g_bus.begin();
+}
+
+I2cBus& hardware_i2c_bus() { return g_bus; }
+
+#else
+#error "TOF_I2C needs a Teensy 4.x (LPI2C interrupts) or an ESP32-S3 (I2C worker task)"
+#endif
+
+#endif  // TOF_I2C
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "i2c_bus.h"
+
+// ---- Board I²C as an asynchronous bus ----------------------------------------
+// The one hardware I²C port (SDA/SCL 18/19 on Teensy 4.0, the default Wire pins
+// on ESP32-S3) behind the I2cBus interface. submit() returns at once; the
+// transaction finishes in the background:
+//
+//   Teensy 4.x : LPI2C1 is driven from its own interrupt. The ISR feeds the
+//                command FIFO, drains received bytes, and marks the transaction
+//                done on STOP (or NACK).
+//   ESP32-S3   : a small worker task on core 0 runs the transfer through the
+//                IDF driver, which sleeps on the I²C interrupt, so loop() on
+//                core 1 never waits.
+//
+// Nothing else may use Wire once this owns the port.
+
+// Sets the pins and clock up (e.g. 400000 for fast mode). Call once from a
+// sensor's begin().
+bool hardware_i2c_begin(uint32_t clock_hz);
+I2cBus& hardware_i2c_bus();
+
+// digitalWrite() behind GpioOut, for XSHUT lines.
+class ArduinoGpio : public GpioOut {
+ public:
+  void write(uint8_t pin, bool high) override { digitalWrite(pin, high ? HIGH : LOW); }
+};
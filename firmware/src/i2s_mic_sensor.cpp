@@ -15,6 +15,8 @@ class I2SMicSensor : public Sensor {
     }
   }
 
+  float rise_tau_us() const override { return env_.tau_us(); }
+
   SensorSample read() override {
     uint32_t now = micros();
     if (!ready_) return {0.0f, now};
@@ -34,10 +36,10 @@ class I2SMicSensor : public Sensor {
     float normalized = constrain((avg / 32768.0f) * gain_, 0.0f, 1.0f);
     // Normalization behavior: absolute-value average -> 0..1 energy envelope with a short
     // smoothing filter so percussive taps still show up as peaks.
-    env_ = 0.9f * env_ + 0.1f * normalized;
+    float env = env_.update(normalized, now);
     // Common failure modes: I2S.begin() never locks (ready_ false => silence),
     // word-select swapped (garbled noise), or sample_rate_ mismatch (aliasy hiss).
-    return {env_, now};
+    return {env, now};
   }
 
  private:
@@ -47,7 +49,7 @@ class I2SMicSensor : public Sensor {
   const float gain_ = 2.5f;
 
   bool ready_ = false;
-  float env_ = 0.0f;
+  OnePole env_{9500.0f};  // 9.5 ms: the old 0.9/0.1 blend at a 1 kHz loop
 };
 
 Sensor& get_i2s_mic_sensor() {
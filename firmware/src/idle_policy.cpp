@@ -0,0 +1,90 @@
+#include "idle_policy.h"
+
+#include <math.h>
+
+IdlePolicy::IdlePolicy(const IdleParams& p) : p_(p), idle_period_us_(p.idle_period_us) {}
+
+void IdlePolicy::set_enabled(bool on) {
+  enabled_ = on;
+  if (!on && dozing_) {
+    dozed_us_ += last_us_ - doze_since_us_;
+    dozing_ = false;
+  }
+  quiet_since_us_ = last_us_;  // start the quiet clock fresh either way
+}
+
+void IdlePolicy::observe(const SensorSample& s, float on_thresh, float off_thresh) {
+  if (!started_) {
+    started_ = true;
+    last_us_ = quiet_since_us_ = s.micros;
+  }
+  uint32_t gap = s.micros - last_us_;
+  elapsed_us_ += gap;
+  last_us_ = s.micros;
+
+  float quiet_level = off_thresh * p_.quiet_fraction;
+  bool quiet = s.value < quiet_level;
+  if (!quiet) {
+    quiet_since_us_ = s.micros;
+    if (dozing_) {
+      // Wake: the activity started somewhere in the last gap.
+      dozing_ = false;
+      dozed_us_ += s.micros - doze_since_us_;
+      ++wakes_;
+      last_wake_latency_us_ = gap;
+      if (gap > worst_wake_latency_us_) worst_wake_latency_us_ = gap;
+      if (s.value >= on_thresh) {
+        // Already past contact: this onset was seen at the idle rate, so the
+        // sensor rises faster than it claims. Look twice as often from now on.
+        ++late_wakes_;
+        on_time_wakes_ = 0;
+        idle_period_us_ = period_us() / 2;
+        if (idle_period_us_ < p_.min_idle_period_us) idle_period_us_ = p_.min_idle_period_us;
+      } else if (idle_period_us_ < p_.idle_period_us && ++on_time_wakes_ >= p_.restore_after_wakes) {
+        // A run of wakes that all beat the onset: that late one was a fluke.
+        on_time_wakes_ = 0;
+        idle_period_us_ = idle_period_us_ > p_.idle_period_us / 2 ? p_.idle_period_us : idle_period_us_ * 2;
+      }
+    }
+    return;
+  }
+  // Thresholds can move (noise-relative ones do), so re-derive the cap here.
+  rise_cap_us_ = rise_cap_us(on_thresh, quiet_level);
+  if (enabled_ && !dozing_ && rise_cap_us_ > 0 && s.micros - quiet_since_us_ >= p_.idle_after_us) {
+    dozing_ = true;
+    doze_since_us_ = s.micros;
+  }
+}
+
+uint32_t IdlePolicy::sleep_budget_us(uint32_t now_us) const {
+  if (!dozing_) return 0;
+  uint32_t period = period_us();
+  uint32_t since = now_us - last_us_;
+  return since >= period ? 0 : period - since;
+}
+
+uint32_t IdlePolicy::rise_cap_us(float on_thresh, float quiet) const {
+  if (rise_tau_us_ <= 0.0f || quiet >= on_thresh) return 0;
+  if (on_thresh >= 1.0f) return p_.idle_period_us;  // a 0..1 output never gets there
+  // Worst case is a full-scale step the instant after a dozing sample.
+  float rise = rise_tau_us_ * logf((1.0f - quiet) / (1.0f - on_thresh));
+  float cap = rise * p_.rise_margin;
+  return cap >= static_cast<float>(p_.idle_period_us) ? p_.idle_period_us : static_cast<uint32_t>(cap);
+}
+
+IdleStats IdlePolicy::stats() const {
+  IdleStats st;
+  uint64_t dozed = dozed_us_ + (dozing_ ? last_us_ - doze_since_us_ : 0);
+  if (elapsed_us_ > 0) {
+    uint64_t slept = slept_us_ < elapsed_us_ ? slept_us_ : elapsed_us_;
+    st.duty = 1.0f - static_cast<float>(slept) / static_cast<float>(elapsed_us_);
+    st.dozing = static_cast<float>(dozed) / static_cast<float>(elapsed_us_);
+  }
+  st.wakes = wakes_;
+  st.late_wakes = late_wakes_;
+  st.last_wake_latency_us = last_wake_latency_us_;
+  st.worst_wake_latency_us = worst_wake_latency_us_;
+  st.idle_period_us = period_us();
+  st.can_doze = rise_cap_us_ > 0;
+  return st;
+}
@@ -17,9 +17,95 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "analog_input.h"
+#include "flight_recorder.h"
+#if defined(GESTURE_TREE)
+#include "gesture_classifier.h"
+#endif
+#include "gesture_engine.h"
+#include "idle_policy.h"
+#include "midi_output.h"
+#include "midi_routes.h"
+#include "midi_transport.h"
 #include "sensor.h"
+#include "telemetry_streams.h"
+#if defined(DUAL_CORE)
+#if !defined(ARDUINO_ARCH_ESP32)
+#error "DUAL_CORE needs a dual-core part (ESP32-S3)"
+#endif
+#if defined(ADAPTIVE_SAMPLING)
+#error "DUAL_CORE runs the sense task on a fixed tick; it does not combine with ADAPTIVE_SAMPLING"
+#endif
+#include <esp_timer.h>
 
-// ---- MIDI setup --------------------------------------------------------------
+#include <atomic>
+
+#include "spsc_queue.h"
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(IDLE_LIGHT_SLEEP)
+#include <esp_sleep.h>
+#endif
+
+// ---- Flight recorder ---------------------------------------------------------
+// Always on: every sample the engine classifies, every gesture line, and every
+// MIDI message that reaches the wire, delta-encoded into a RAM ring
+// (flight_recorder.h). {"rec":"dump"} streams it out without pausing anything;
+// tools/flight_dump.py turns the dump back into a capture CSV.
+#ifndef FLIGHT_RECORDER_KB
+#if defined(TEENSYDUINO)
+#define FLIGHT_RECORDER_KB 256  // the otherwise idle OCRAM half: minutes of playing
+#else
+#define FLIGHT_RECORDER_KB 64
+#endif
+#endif
+static const size_t kFlightStorageBytes = FLIGHT_RECORDER_KB > 0 ? FLIGHT_RECORDER_KB * 1024UL : 1;
+#if defined(TEENSYDUINO)
+DMAMEM uint8_t g_flight_storage[kFlightStorageBytes];
+#else
+uint8_t g_flight_storage[kFlightStorageBytes];
+#endif
+FlightRecorder g_flight(g_flight_storage, sizeof(g_flight_storage));  // < 2 blocks: records nothing
+
+// ---- MIDI + telemetry transports ---------------------------------------------
+// MIDI and the JSON lines each get their own bounded queue (midi_transport.h);
+// TransportPump drains MIDI first so a NoteOn never waits behind text.
+#if defined(MIDI_USB)
+// -D MIDI_USB: notes go out the class-compliant USB-MIDI endpoint, so DAWs see
+// a MIDI device with no bridge app, and CDC `Serial` carries only telemetry and
+// commands. Teensy needs the Serial+MIDI USB type (-D USB_MIDI_SERIAL); the
+// ESP32-S3 needs TinyUSB (-D ARDUINO_USB_MODE=0). The *_usbmidi envs set both.
+#if defined(ARDUINO_ARCH_ESP32)
+#include <USB.h>
+#include <USBMIDI.h>
+USBMIDI g_usb_midi;
+#endif
+
+class UsbMidiPort : public MidiPort {
+ public:
+  bool send(const MidiMessage& m) override {
+#if defined(TEENSYDUINO)
+    usbMIDI.send(m.type(), m.data1, m.data2, m.channel(), 0);
+#else
+    switch (m.type()) {
+      case kMidiNoteOn: g_usb_midi.noteOn(m.data1, m.data2, m.channel()); break;
+      case kMidiNoteOff: g_usb_midi.noteOff(m.data1, m.data2, m.channel()); break;
+      case kMidiControlChange: g_usb_midi.controlChange(m.data1, m.data2, m.channel()); break;
+      case kMidiPitchBend: g_usb_midi.pitchBend(m.bend(), m.channel()); break;
+      case kMidiChannelPressure: g_usb_midi.channelPressure(m.data1, m.channel()); break;
+      default: break;
+    }
+#endif
+    return true;
+  }
+#if defined(TEENSYDUINO)
+  // usbMIDI packs messages into USB packets; send them now rather than at the
+  // next frame so the pluck lands within this loop.
+  void flush() override { usbMIDI.send_now(); }
+#endif
+};
+UsbMidiPort g_midi_port;
+#else
 #if defined(TEENSYDUINO)
 // Teensy exposes `Serial` as a USB CDC endpoint (usb_serial_class), not a
 // HardwareSerial port. The default MIDI macro assumes a UART, so we override the
@@ -29,158 +115,96 @@ MIDI_CREATE_INSTANCE(usb_serial_class, Serial, MIDI);
 #else
 MIDI_CREATE_DEFAULT_INSTANCE();
 #endif
-static const uint8_t kChannel = 1;  // 1-16
 
-// ---- Gesture Engine ----------------------------------------------------------
-// INTENT: Detect three coarse gestures using only a thresholded stream. Keep
-// all constants named and easy to calibrate.
 /**
- * Tunable gesture thresholds. Treat this like a calibration worksheet: these
- * numbers start as defaults and should be tweaked with students while watching
- * the debugger. The hysteresis (`on_thresh` / `off_thresh`) keeps the contact
- * state stable; the time windows set how fast is "scrape" versus a fresh pluck.
+ * Bridges queued messages to the 47effects MIDI instance. Everything above this
+ * line talks in notes and expression; only this adapter knows the library API.
+ * MIDI shares `Serial` with the JSON lines here, so it declines (and the pump
+ * holds the text back) when the port has no room for a whole message.
  */
-struct GestureParams {
-  float on_thresh = 0.55f;        // crossing above => "contact"
-  float off_thresh = 0.40f;       // falling below => "release"
-  uint32_t min_retrigger_us = 60000;  // 60ms guard against double plucks
-  uint32_t scrape_window_us = 40000;  // <40ms between mini-onsets => scrape grain
-
-  // Extended gestures (all narratable in class; edit + reflash or push via Serial)
-  float harmonic_peak_min = 0.35f;    // light touch floor; tweak while listening for chime partials
-  float harmonic_peak_max = 0.65f;    // light touch ceiling
-  uint32_t harmonic_hold_us = 70000;  // hold a light touch this long → call it harmonic
-  float harmonic_variation_eps = 0.05f;  // how still the envelope must be to count as a harmonic touch
-
-  float mute_peak_thresh = 0.25f;     // low-amplitude contacts that end early => muted articulation
-  uint32_t mute_window_us = 50000;    // release within this window → treat as mute instead of pluck-off
-  float mute_release_thresh = 0.15f;  // if the release falls below this before rising again, call it a mute
-
-  float tremolo_min_delta = 0.06f;    // minimum swing to count as one wobble
-  uint32_t tremolo_max_period_us = 30000;  // how fast the sign flips must be (<33 Hz)
-  uint32_t tremolo_grace_us = 8000;        // ignore micro-wobbles right at onset; gives players a breath
-  uint8_t wobble_goal = 4;            // how many flips before we declare tremolo/vibrato
-  float vibrato_depth_min = 0.15f;    // deeper swings ⇒ vibrato; shallow ⇒ tremolo
+class MidiLibraryPort : public MidiPort {
+ public:
+  bool send(const MidiMessage& m) override {
+    if (Serial.availableForWrite() < 3) return false;
+    switch (m.type()) {
+      case kMidiNoteOn: MIDI.sendNoteOn(m.data1, m.data2, m.channel()); break;
+      case kMidiNoteOff: MIDI.sendNoteOff(m.data1, m.data2, m.channel()); break;
+      case kMidiControlChange: MIDI.sendControlChange(m.data1, m.data2, m.channel()); break;
+      case kMidiPitchBend: MIDI.sendPitchBend(m.bend(), m.channel()); break;
+      case kMidiChannelPressure: MIDI.sendAfterTouch(m.data1, m.channel()); break;
+      default: break;
+    }
+    return true;
+  }
+  bool shares_text_port() const override { return true; }
 };
+MidiLibraryPort g_midi_port;
+#endif
 
-enum class Gesture { Idle, Pluck, Bow, Scrape, Harmonic, Muted, Tremolo, Vibrato };
+/** Records each message into the flight recorder once the real port takes it. */
+class RecordingMidiPort : public MidiPort {
+ public:
+  explicit RecordingMidiPort(MidiPort& inner) : inner_(inner) {}
+  bool send(const MidiMessage& m) override {
+    if (!inner_.send(m)) return false;
+    g_flight.midi(micros(), m.status, m.data1, m.data2);
+    return true;
+  }
+  void flush() override { inner_.flush(); }
+  bool shares_text_port() const override { return inner_.shares_text_port(); }
+
+ private:
+  MidiPort& inner_;
+};
+RecordingMidiPort g_recorded_midi_port(g_midi_port);
+
+/** CDC `Serial` as a TextPort: writes only what fits, never blocks. */
+class SerialTextPort : public TextPort {
+ public:
+  size_t writable() override {
+    int room = Serial.availableForWrite();
+    return room > 0 ? static_cast<size_t>(room) : 0;
+  }
+  size_t write(const char* data, size_t n) override {
+    return Serial.write(reinterpret_cast<const uint8_t*>(data), n);
+  }
+};
 
 /**
- * Converts a stream of SensorSamples into semantic gestures. The design goal
- * is to keep the rules audible and debuggable. There is no hidden machine
- * learning here—just explicit timing and hysteresis—so a class can reason about
- * why a particular motion produced "bow" versus "pluck".
+ * Every JSON line goes through this Print, so the familiar print()/println()
+ * calls below only fill the telemetry queue; the pump decides when they hit
+ * the wire.
  */
-class GestureEngine {
+class TelemetryPrint : public Print {
  public:
-  GestureEngine(const GestureParams& p) : p_(p) {}
-  Gesture update(const SensorSample& s) {
-    // Hysteresis for contact state
-    bool prev = contact_;
-    if (!contact_ && s.value >= p_.on_thresh) contact_ = true;
-    if (contact_ && s.value <= p_.off_thresh) contact_ = false;
-
-    // Update per-contact tracking for extended gestures
-    if (contact_ && !prev) {
-      contact_start_us_ = s.micros;
-      peak_value_ = s.value;
-      wobble_min_ = s.value;
-      wobble_max_ = s.value;
-      wobble_count_ = 0;
-      last_wobble_us_ = s.micros;
-      last_direction_up_ = true;
-      harmonic_called_ = false;
-      modulation_called_ = false;
-      mute_candidate_ = false;
-      contact_state_ = ContactState::Attacking;
-    }
-    if (contact_) {
-      peak_value_ = max(peak_value_, s.value);
-      wobble_min_ = min(wobble_min_, s.value);
-      wobble_max_ = max(wobble_max_, s.value);
-      if (contact_state_ == ContactState::Attacking &&
-          (s.micros - contact_start_us_) > p_.tremolo_grace_us) {
-        contact_state_ = ContactState::Sustaining;
-      }
-    }
-
-    // Tremolo/vibrato wobble detection: count sign changes when the swing is loud enough.
-    float delta = s.value - last_value_;
-    bool rising = delta >= 0.0f;
-    if (fabs(delta) >= p_.tremolo_min_delta && contact_state_ == ContactState::Sustaining) {
-      if (rising != last_direction_up_) {
-        uint32_t wobble_dt = s.micros - last_wobble_us_;
-        if (wobble_dt <= p_.tremolo_max_period_us) {
-          ++wobble_count_;
-        } else {
-          wobble_count_ = 1;  // reset if too slow; still count current flip
-        }
-        last_wobble_us_ = s.micros;
-        last_direction_up_ = rising;
-      }
-    }
-    last_value_ = s.value;
-
-    // Onset detection
-    Gesture g = Gesture::Idle;
-    if (contact_ && !prev) {
-      uint32_t dt = s.micros - last_onset_us_;
-      if (dt < p_.min_retrigger_us) {
-        g = Gesture::Idle;  // debounce double strike
-      } else {
-        g = (dt < p_.scrape_window_us) ? Gesture::Scrape : Gesture::Pluck;
-        last_onset_us_ = s.micros;
-      }
-    } else if (contact_) {
-      // Harmonics: require a light touch that stays stable. This prevents loud plucks
-      // from being mis-labeled when the player lingers.
-      bool in_harmonic_band = peak_value_ >= p_.harmonic_peak_min && peak_value_ <= p_.harmonic_peak_max;
-      float wobble_depth = wobble_max_ - wobble_min_;
-      if (!harmonic_called_ && in_harmonic_band && wobble_depth <= p_.harmonic_variation_eps &&
-          (s.micros - contact_start_us_) > p_.harmonic_hold_us) {
-        harmonic_called_ = true;
-        g = Gesture::Harmonic;
-      } else if (!modulation_called_ && wobble_count_ >= p_.wobble_goal) {
-        modulation_called_ = true;  // only announce once per contact so the serial log stays readable
-        g = (wobble_depth >= p_.vibrato_depth_min) ? Gesture::Vibrato : Gesture::Tremolo;
-      } else {
-        // Sustained contact → treat as bow (continuous control)
-        g = Gesture::Bow;
-      }
-      // Track whether the player is drifting toward a mute: low peak and falling envelope.
-      if (peak_value_ <= p_.mute_peak_thresh && s.value <= p_.mute_release_thresh) {
-        mute_candidate_ = true;
-      }
-    } else if (prev && !contact_) {
-      contact_state_ = ContactState::Released;
-      uint32_t hold = s.micros - contact_start_us_;
-      // Quick-touch deadening => mute gesture; otherwise idle falls through to release handling in loop().
-      if (hold <= p_.mute_window_us || mute_candidate_) {
-        g = Gesture::Muted;
-      }
-    }
-    return g;
+  explicit TelemetryPrint(LineQueue& q) : q_(q) {}
+  size_t write(uint8_t c) override {
+    q_.put(static_cast<char>(c));
+    return 1;
   }
 
  private:
-    enum class ContactState { Released, Attacking, Sustaining };
-    GestureParams p_;
-    bool contact_ = false;
-    uint32_t last_onset_us_ = 0;
-    uint32_t contact_start_us_ = 0;
-    float peak_value_ = 0.0f;
-    float last_value_ = 0.0f;
-    float wobble_min_ = 1.0f;
-    float wobble_max_ = 0.0f;
-    uint8_t wobble_count_ = 0;
-    uint32_t last_wobble_us_ = 0;
-    bool last_direction_up_ = true;
-    bool harmonic_called_ = false;
-    bool modulation_called_ = false;
-    bool mute_candidate_ = false;
-    ContactState contact_state_ = ContactState::Released;
+  LineQueue& q_;
 };
 
+MidiQueue g_midi_queue;
+LineQueue g_text_queue;
+SerialTextPort g_text_port;
+TelemetryPrint g_telemetry(g_text_queue);
+TransportPump g_transport(g_midi_queue, g_recorded_midi_port, g_text_queue, g_text_port);
+
+MidiQueueSink g_midi_sink(g_midi_queue);
+// Global mode keeps the classic single-channel lanes (CC1 bow, CC11 tremolo,
+// channel pitch bend). MPE gives every sounding note its own member channel;
+// flip it live with {"mpe":true} or boot into it with -D MIDI_MPE_DEFAULT.
+MidiVoiceRouter g_midi(g_midi_sink);
+
+// ---- Gesture Engine ----------------------------------------------------------
+// INTENT: Detect coarse gestures using only a thresholded stream. The rules live
+// in gesture_engine.cpp (shared with the native Unity tests) so what the class
+// reads aloud is exactly what the board runs; GestureParams in
+// gesture_engine.h is the calibration worksheet.
+
 // ---- Mapping -----------------------------------------------------------------
 // Map gestures to MIDI: notes from a small pentatonic set, CC1 for bow energy.
 static const uint8_t kMaxNoteSlots = 12;
@@ -216,12 +240,101 @@ uint8_t next_note() {
   return n;
 }
 
-// Track the sustaining note globally so both the gesture mapper and the serial
-// hot-swapper can see it. Declaring it before the anonymous namespace keeps the
-// linker happy (Teensy's GCC was grumbling when the namespace tried to `extern`
-// something defined later in the file) and makes the flow of control easier to
-// narrate while screen-sharing.
-int current_note = -1;  // -1 == no sustaining note; >=0 stores the active MIDI pitch.
+// The gesture → MIDI mapping, as a table the venue can rewrite over serial
+// (midi_routes.h). It also tracks the sustaining note, so both the mapper and
+// the serial hot-swapper can see it. Declaring it before the anonymous
+// namespace keeps the linker happy (Teensy's GCC was grumbling when the
+// namespace tried to `extern` something defined later in the file).
+RouteMatrix g_routes;
+
+class ScaleNotes : public NoteSupply {
+ public:
+  uint8_t next_note() override { return ::next_note(); }
+} g_scale_notes;
+
+// Which telemetry streams the host asked for, and how fast (telemetry_streams.h).
+// Gesture lines are on at boot; {"sub":{...}} picks the rest. {"raw":true}
+// still works as shorthand for {"sub":{"raw":true}}, so tools/serial_logger.py
+// captures for tools/train_gesture_tree.py need nothing new.
+TelemetryStreams g_streams;
+
+// Latency stream bookkeeping: worst cases since the last {"latency":...} line.
+struct LatencyStats {
+  uint32_t pluck_lag_us = 0;        // last pluck: onset → its MIDI queued
+  uint32_t worst_pluck_lag_us = 0;
+  uint32_t worst_frame_lag_us = 0;  // sample stamp → rendered (decimation + hand-off)
+} g_latency;
+
+// ---- Adaptive sampling -------------------------------------------------------
+// Battery installs: after a couple of quiet seconds, read once per idle period
+// and sleep in between; the first sample above the quiet level brings back full
+// rate. -D ADAPTIVE_SAMPLING boots with it on; {"adaptive":true|false} flips it
+// live and {"power":"stats"} reports duty cycle and wake latency.
+IdlePolicy g_idle;
+
+#if defined(GESTURE_TREE)
+// ---- Learned backend (A/B) ---------------------------------------------------
+// -D GESTURE_TREE compiles in the int8 decision tree from gesture_tree_model.h.
+// Both backends see every sample; {"engine":"tree"} hands MIDI to the tree,
+// {"engine":"rules"} hands it back. Whichever is not driving prints its
+// one-shot calls as {"ab":...} lines so the class can compare them live.
+GestureClassifier g_tree;
+bool g_use_tree = false;
+bool g_tree_ok = false;           // validate() passed at boot
+uint32_t g_tree_worst_cycles = 0;  // slowest classifier call seen so far
+
+// CPU cycles on both targets (Teensy: DWT counter, ESP32: CCOUNT).
+uint32_t cycle_stamp() {
+#if defined(TEENSYDUINO)
+  return ARM_DWT_CYCCNT;
+#elif defined(ARDUINO_ARCH_ESP32)
+  return ESP.getCycleCount();
+#else
+  return micros();  // other boards: microseconds, still good for a worst case
+#endif
+}
+#endif
+
+// ---- Sense → render hand-off ------------------------------------------------
+// One finished classification: what sense_step() produces and render_frame()
+// turns into MIDI + JSON. In the single-core build it never leaves loop(); in
+// the dual-core build it is what crosses from one core to the other.
+struct SenseFrame {
+  SensorSample s;   // the decimated sample the engine saw
+  GestureResult r;  // the rules engine's verdict
+  float on_thresh;  // thresholds and noise in force for this sample (env stream)
+  float off_thresh;
+  float noise;
+#if defined(GESTURE_TREE)
+  bool tree_ran;
+  Gesture tree_gesture;
+  float tree_confidence;
+  uint32_t tree_cycles;
+#endif
+};
+
+#if defined(DUAL_CORE)
+// ---- Dual-core pipeline (ESP32-S3, -D DUAL_CORE) -----------------------------
+// Core 1 runs a high-priority sense task on a fixed timer tick: acquire,
+// decimate, classify, push a SenseFrame. Core 0 runs the I/O task: pop frames,
+// map them to MIDI + telemetry, pump the transports, parse commands. Frames
+// cross in a lock-free SPSC ring (spsc_queue.h), so a USB host that stops
+// reading can back up the I/O core but never the sampling period.
+#ifndef SENSE_PERIOD_US
+#define SENSE_PERIOD_US 250  // 4 kHz acquisition, decimated to GESTURE_RATE_HZ
+#endif
+static const int kSenseCore = 1;  // APP CPU: no Wi-Fi/USB stack tasks live here
+static const int kIoCore = 0;
+
+SpscQueue<SenseFrame, 64> g_frames;
+TaskHandle_t g_sense_task = nullptr;
+TaskHandle_t g_io_task = nullptr;
+esp_timer_handle_t g_sense_timer = nullptr;
+// Written by the sense core only, read by {"pipeline":"stats"} on the I/O core.
+std::atomic<uint32_t> g_sense_ticks{0};
+std::atomic<uint32_t> g_sense_missed{0};     // ticks that arrived while a step was still running
+std::atomic<uint32_t> g_sense_worst_us{0};   // slowest sense step so far
+#endif
 
 // ---- Serial preset browser ---------------------------------------------------
 namespace {
@@ -233,19 +346,148 @@ namespace {
    * Emit a projector-friendly JSON telemetry line. The visualizers depend on
    * the shape `{ "gesture": "pluck", "value": 90, "note": 64 }` so we
    * centralize the formatting and make sure every pathway uses the same voice.
+   * When the engine's verdict is at hand we append its confidence, plus rate
+   * (Hz) and depth for the wobble gestures and onset time + lag for plucks;
+   * older visualizers ignore extra keys. `"us"` is the board clock when the
+   * line was written, which is what lets a host put several boards' lines in
+   * one timeline (see {"ping":N} below).
    */
-  void emit_gesture_event(const char* name, uint8_t value, int note) {
-    Serial.print('{');
-    Serial.print("\"gesture\":\"");
-    Serial.print(name);
-    Serial.print("\"");
-    Serial.print(",\"value\":");
-    Serial.print(value);
+  void emit_gesture_event(const char* name, uint8_t value, int note, const GestureResult* r = nullptr) {
+    uint32_t now = micros();
+    g_flight.gesture(now, static_cast<uint8_t>(r ? r->gesture : Gesture::Idle), value, note);
+    if (!g_streams.subscribed(TelemetryStream::Gestures)) return;
+    g_telemetry.print('{');
+    g_telemetry.print("\"gesture\":\"");
+    g_telemetry.print(name);
+    g_telemetry.print("\"");
+    g_telemetry.print(",\"value\":");
+    g_telemetry.print(value);
     if (note >= 0) {
-      Serial.print(",\"note\":");
-      Serial.print(note);
+      g_telemetry.print(",\"note\":");
+      g_telemetry.print(note);
+    }
+    g_telemetry.print(",\"us\":");
+    g_telemetry.print(now);
+    if (r) {
+      g_telemetry.print(",\"conf\":");
+      g_telemetry.print(r->confidence, 2);
+      if (r->gesture == Gesture::Pluck) {
+        // When the string was actually struck, and how far behind it this line is.
+        g_telemetry.print(",\"onset_us\":");
+        g_telemetry.print(r->features.onset_us);
+        g_telemetry.print(",\"lag_us\":");
+        g_telemetry.print(now - r->features.onset_us);
+      }
+      if (r->gesture == Gesture::Tremolo || r->gesture == Gesture::Vibrato) {
+        g_telemetry.print(",\"rate\":");
+        g_telemetry.print(r->features.wobble_rate_hz, 1);
+        g_telemetry.print(",\"depth\":");
+        g_telemetry.print(r->features.wobble_depth, 2);
+      }
+    }
+    g_telemetry.println('}');
+  }
+
+  const char* gesture_name(Gesture g) {
+    switch (g) {
+      case Gesture::Pluck: return "pluck";
+      case Gesture::Bow: return "bow";
+      case Gesture::Scrape: return "scrape";
+      case Gesture::Harmonic: return "harmonic";
+      case Gesture::Muted: return "mute";
+      case Gesture::Tremolo: return "tremolo";
+      case Gesture::Vibrato: return "vibrato";
+      case Gesture::Idle: default: return "idle";
+    }
+  }
+
+  void emit_raw_sample(const SensorSample& s) {
+    g_telemetry.print("{\"raw\":[");
+    g_telemetry.print(s.micros);
+    g_telemetry.print(',');
+    g_telemetry.print(s.value, 4);
+    g_telemetry.println("]}");
+  }
+
+  // {"env":[micros,value,on,off,noise,contact]}: the trace a projector plots.
+  void emit_envelope(const SenseFrame& fr) {
+    g_telemetry.print("{\"env\":[");
+    g_telemetry.print(fr.s.micros);
+    g_telemetry.print(',');
+    g_telemetry.print(fr.s.value, 4);
+    g_telemetry.print(',');
+    g_telemetry.print(fr.on_thresh, 4);
+    g_telemetry.print(',');
+    g_telemetry.print(fr.off_thresh, 4);
+    g_telemetry.print(',');
+    g_telemetry.print(fr.noise, 4);
+    g_telemetry.print(',');
+    g_telemetry.print(fr.r.features.contact ? 1 : 0);
+    g_telemetry.println("]}");
+  }
+
+  // {"features":{...}}: everything GestureEngine measured for this sample.
+  void emit_features(const GestureResult& r) {
+    const GestureFeatures& f = r.features;
+    g_telemetry.print("{\"features\":{\"gesture\":\"");
+    g_telemetry.print(gesture_name(r.gesture));
+    g_telemetry.print("\",\"conf\":");
+    g_telemetry.print(r.confidence, 2);
+    g_telemetry.print(",\"contact_us\":");
+    g_telemetry.print(f.contact ? f.contact_us : 0);
+    g_telemetry.print(",\"velocity\":");
+    g_telemetry.print(f.velocity, 2);
+    g_telemetry.print(",\"peak\":");
+    g_telemetry.print(f.peak, 4);
+    g_telemetry.print(",\"depth\":");
+    g_telemetry.print(f.wobble_depth, 4);
+    g_telemetry.print(",\"center\":");
+    g_telemetry.print(f.wobble_center, 4);
+    g_telemetry.print(",\"flips\":");
+    g_telemetry.print(f.wobble_count);
+    g_telemetry.print(",\"rate\":");
+    g_telemetry.print(f.wobble_rate_hz, 1);
+    g_telemetry.print(",\"strike\":");
+    g_telemetry.print(f.strike, 3);
+    g_telemetry.println("}}");
+  }
+
+  // {"latency":{...}}: worst cases since the previous line, then reset.
+  void emit_latency() {
+    g_telemetry.print("{\"latency\":{\"pluck_lag_us\":");
+    g_telemetry.print(g_latency.pluck_lag_us);
+    g_telemetry.print(",\"worst_pluck_lag_us\":");
+    g_telemetry.print(g_latency.worst_pluck_lag_us);
+    g_telemetry.print(",\"worst_frame_lag_us\":");
+    g_telemetry.print(g_latency.worst_frame_lag_us);
+    g_telemetry.print(",\"midi_queue\":");
+    g_telemetry.print(g_midi_queue.size());
+    g_telemetry.print(",\"midi_dropped\":");
+    g_telemetry.print(g_midi_queue.dropped());
+    g_telemetry.print(",\"text_queue\":");
+    g_telemetry.print(g_text_queue.pending());
+    g_telemetry.print(",\"text_dropped\":");
+    g_telemetry.print(g_text_queue.dropped_lines());
+    g_telemetry.println("}}");
+    g_latency.worst_pluck_lag_us = 0;
+    g_latency.worst_frame_lag_us = 0;
+  }
+
+  // Current subscriptions: {"sub":{"gestures":0,"raw":500}}; 0 = every line.
+  void acknowledge_subscriptions() {
+    g_telemetry.print("{\"sub\":{");
+    bool first = true;
+    for (uint8_t i = 0; i < kStreamCount; ++i) {
+      TelemetryStream st = static_cast<TelemetryStream>(i);
+      if (!g_streams.subscribed(st)) continue;
+      if (!first) g_telemetry.print(',');
+      first = false;
+      g_telemetry.print('"');
+      g_telemetry.print(TelemetryStreams::name(st));
+      g_telemetry.print("\":");
+      g_telemetry.print(g_streams.max_hz(st));
     }
-    Serial.println('}');
+    g_telemetry.println("}}");
   }
 
   /**
@@ -288,37 +530,360 @@ namespace {
    * play. The response is still machine-readable for any classroom tooling.
    */
   void acknowledge_noteset(const NoteSet& set) {
-    Serial.print('{');
-    Serial.print("\"noteset\":\"loaded\",\"count\":");
-    Serial.print(set.size);
-    Serial.print(",\"notes\":[");
+    g_telemetry.print('{');
+    g_telemetry.print("\"noteset\":\"loaded\",\"count\":");
+    g_telemetry.print(set.size);
+    g_telemetry.print(",\"notes\":[");
     for (uint8_t i = 0; i < set.size; ++i) {
-      Serial.print(set.notes[i]);
-      if (i + 1 < set.size) Serial.print(',');
+      g_telemetry.print(set.notes[i]);
+      if (i + 1 < set.size) g_telemetry.print(',');
+    }
+    g_telemetry.println("]}");
+  }
+
+  /**
+   * Look for `"<key>":true` / `"<key>":false` (1/0 also accepted), e.g. the
+   * `"mpe"` and `"raw"` toggles. Returns false when the key is absent so the
+   * caller can fall through to other commands.
+   */
+  bool parse_bool_toggle(const char* line, const char* quoted_key, bool* enable) {
+    const char* key = strstr(line, quoted_key);
+    if (!key) return false;
+    const char* colon = strchr(key, ':');
+    if (!colon) return false;
+    const char* v = colon + 1;
+    while (*v == ' ' || *v == '\t') ++v;
+    if (strncmp(v, "true", 4) == 0 || *v == '1') {
+      *enable = true;
+      return true;
+    }
+    if (strncmp(v, "false", 5) == 0 || *v == '0') {
+      *enable = false;
+      return true;
+    }
+    return false;
+  }
+
+  void acknowledge_route(const char* error) {
+    g_telemetry.print("{\"route\":{");
+    if (error) {
+      g_telemetry.print("\"error\":\"");
+      // Error strings quote field names; escape them for the JSON line.
+      for (const char* c = error; *c; ++c) {
+        if (*c == '"') g_telemetry.print('\\');
+        g_telemetry.print(*c);
+      }
+      g_telemetry.print('"');
+    } else {
+      g_telemetry.print("\"staged\":");
+      g_telemetry.print(g_routes.staged());
+    }
+    g_telemetry.println("}}");
+  }
+
+  void acknowledge_routes() {
+    g_telemetry.print("{\"routes\":{\"active\":");
+    g_telemetry.print(g_routes.count());
+    g_telemetry.print(",\"staged\":");
+    g_telemetry.print(g_routes.staged());
+    g_telemetry.print(",\"max\":");
+    g_telemetry.print(RouteMatrix::kMaxRoutes);
+    g_telemetry.println("}}");
+  }
+
+  // The live table as the lines that would load it, so a venue's mapping can
+  // be captured with serial_logger.py and replayed next time.
+  void list_routes() {
+    char text[kRouteJsonMax];
+    for (uint8_t i = 0; i < g_routes.count(); ++i) {
+      format_route_spec(g_routes.route(i).spec, text);
+      g_telemetry.println(text);
+    }
+  }
+
+  void acknowledge_midi_mode() {
+    g_telemetry.print("{\"midi\":\"");
+    g_telemetry.print(g_midi.mode() == MidiMode::Mpe ? "mpe" : "global");
+    g_telemetry.print("\",\"members\":");
+    g_telemetry.print(g_midi.mode() == MidiMode::Mpe ? g_midi.member_channels() : 0);
+    g_telemetry.println('}');
+  }
+
+#if defined(GESTURE_TREE)
+  /**
+   * `{"engine":"tree"}` / `{"engine":"rules"}`. Returns false when the key is
+   * absent or the value is neither, so a typo is ignored rather than guessed.
+   */
+  bool parse_engine_choice(const char* line, bool* use_tree) {
+    const char* key = strstr(line, "\"engine\"");
+    if (!key) return false;
+    const char* colon = strchr(key, ':');
+    if (!colon) return false;
+    if (strstr(colon, "\"tree\"")) {
+      *use_tree = true;
+      return true;
+    }
+    if (strstr(colon, "\"rules\"")) {
+      *use_tree = false;
+      return true;
+    }
+    return false;
+  }
+
+  void acknowledge_engine() {
+    g_telemetry.print("{\"engine\":\"");
+    g_telemetry.print(g_use_tree ? "tree" : "rules");
+    g_telemetry.print("\",\"tree_ok\":");
+    g_telemetry.print(g_tree_ok ? "true" : "false");
+    g_telemetry.print(",\"worst_cycles\":");
+    g_telemetry.print(g_tree_worst_cycles);
+    g_telemetry.println('}');
+  }
+#endif
+
+  void report_power() {
+    IdleStats st = g_idle.stats();
+    g_telemetry.print("{\"power\":{\"adaptive\":");
+    g_telemetry.print(g_idle.enabled() ? "true" : "false");
+    g_telemetry.print(",\"can_doze\":");
+    g_telemetry.print(st.can_doze ? "true" : "false");
+    g_telemetry.print(",\"dozing\":");
+    g_telemetry.print(g_idle.dozing() ? "true" : "false");
+    g_telemetry.print(",\"duty\":");
+    g_telemetry.print(st.duty, 4);
+    g_telemetry.print(",\"dozing_frac\":");
+    g_telemetry.print(st.dozing, 4);
+    g_telemetry.print(",\"wakes\":");
+    g_telemetry.print(st.wakes);
+    g_telemetry.print(",\"late_wakes\":");
+    g_telemetry.print(st.late_wakes);
+    g_telemetry.print(",\"wake_latency_us\":");
+    g_telemetry.print(st.last_wake_latency_us);
+    g_telemetry.print(",\"worst_wake_latency_us\":");
+    g_telemetry.print(st.worst_wake_latency_us);
+    g_telemetry.print(",\"idle_period_us\":");
+    g_telemetry.print(st.idle_period_us);
+    g_telemetry.println("}}");
+  }
+
+#if defined(DUAL_CORE)
+  void report_pipeline() {
+    g_telemetry.print("{\"pipeline\":{\"sense_core\":");
+    g_telemetry.print(kSenseCore);
+    g_telemetry.print(",\"io_core\":");
+    g_telemetry.print(kIoCore);
+    g_telemetry.print(",\"period_us\":");
+    g_telemetry.print(SENSE_PERIOD_US);
+    g_telemetry.print(",\"ticks\":");
+    g_telemetry.print(g_sense_ticks.load(std::memory_order_relaxed));
+    g_telemetry.print(",\"missed_ticks\":");
+    g_telemetry.print(g_sense_missed.load(std::memory_order_relaxed));
+    g_telemetry.print(",\"worst_step_us\":");
+    g_telemetry.print(g_sense_worst_us.load(std::memory_order_relaxed));
+    g_telemetry.print(",\"depth\":");
+    g_telemetry.print(g_frames.size());
+    g_telemetry.print(",\"high_water\":");
+    g_telemetry.print(g_frames.high_water());
+    g_telemetry.print(",\"capacity\":");
+    g_telemetry.print(g_frames.kCapacity);
+    g_telemetry.print(",\"dropped\":");
+    g_telemetry.print(g_frames.dropped());
+    g_telemetry.print(",\"midi_dropped\":");
+    g_telemetry.print(g_midi_queue.dropped());
+    g_telemetry.print(",\"text_dropped\":");
+    g_telemetry.print(g_text_queue.dropped_lines());
+    g_telemetry.println("}}");
+  }
+#endif
+
+  // {"rec":"dump"} walks the ring oldest block first, one block per call.
+  struct FlightDump {
+    bool active = false;
+    uint32_t next = 0;  // next block to send
+    uint32_t last = 0;  // newest block when the dump began (it may still grow)
+    uint32_t sent = 0;
+    uint32_t skipped = 0;  // overwritten by new playing before we got to it
+  } g_dump;
+
+  void report_flight() {
+    g_telemetry.print("{\"rec\":{\"blocks\":");
+    g_telemetry.print(g_flight.block_count());
+    g_telemetry.print(",\"block_bytes\":");
+    g_telemetry.print(kFlightBlockBytes);
+    g_telemetry.print(",\"oldest\":");
+    g_telemetry.print(g_flight.oldest_seq());
+    g_telemetry.print(",\"newest\":");
+    g_telemetry.print(g_flight.newest_seq());
+    g_telemetry.print(",\"span_us\":");
+    g_telemetry.print(g_flight.span_us());
+    g_telemetry.print(",\"records\":");
+    g_telemetry.print(g_flight.records());
+    g_telemetry.print(",\"dumping\":");
+    g_telemetry.print(g_dump.active ? "true" : "false");
+    g_telemetry.println("}}");
+  }
+
+  void start_flight_dump() {
+    report_flight();  // header: tells the decoder what to expect
+    g_dump.active = g_flight.newest_seq() != 0;
+    g_dump.next = g_flight.oldest_seq();
+    g_dump.last = g_flight.newest_seq();
+    g_dump.sent = 0;
+    g_dump.skipped = 0;
+    if (!g_dump.active) g_telemetry.println("{\"rec_done\":{\"sent\":0,\"skipped\":0}}");
+  }
+
+  /**
+   * Send the next block of a dump as {"rec":[seq,"<base64>"]}. One block per
+   * call, and only while the telemetry queue is nearly empty, so a dump never
+   * crowds out gesture lines and the recorder keeps recording the whole time.
+   */
+  void service_flight_dump() {
+    if (!g_dump.active || g_text_queue.pending() > LineQueue::kCapacity / 4) return;
+    if (g_dump.next > g_dump.last) {
+      g_dump.active = false;
+      g_telemetry.print("{\"rec_done\":{\"sent\":");
+      g_telemetry.print(g_dump.sent);
+      g_telemetry.print(",\"skipped\":");
+      g_telemetry.print(g_dump.skipped);
+      g_telemetry.println("}}");
+      return;
     }
-    Serial.println("]}");
+    static uint8_t block[kFlightBlockBytes];
+    static char text[4 * ((kFlightBlockBytes + 2) / 3) + 1];
+    size_t n = g_flight.copy_block(g_dump.next, block);
+    if (n == 0) {
+      ++g_dump.skipped;
+    } else {
+      flight_base64(block, n, text);
+      g_telemetry.print("{\"rec\":[");
+      g_telemetry.print(g_dump.next);
+      g_telemetry.print(",\"");
+      g_telemetry.print(text);
+      g_telemetry.println("\"]}");
+      ++g_dump.sent;
+    }
+    ++g_dump.next;
   }
 
   /**
    * Process a single newline-delimited command from the Serial terminal. This
-   * is intentionally tiny: either load a new note set, print help, or ignore.
+   * is intentionally tiny: load a new note set, flip the MIDI mode, print help,
+   * or ignore.
    */
   void handle_serial_line(const char* line) {
     if (!line) return;
+    // {"ping":N} → {"pong":[N,micros]}: one clock-sync exchange for a host
+    // that merges several boards (software/native, stringfield-aggregate).
+    // First in line, so the stamp sits as close to the request's arrival as
+    // the loop allows; the host keeps the exchanges with the shortest round
+    // trip and throws the rest away.
+    const char* ping = strstr(line, "\"ping\"");
+    if (ping) {
+      uint32_t now = micros();
+      const char* colon = strchr(ping, ':');
+      unsigned long seq = colon ? strtoul(colon + 1, nullptr, 10) : 0;
+      g_telemetry.print("{\"pong\":[");
+      g_telemetry.print(static_cast<uint32_t>(seq));
+      g_telemetry.print(',');
+      g_telemetry.print(now);
+      g_telemetry.println("]}");
+      return;
+    }
     // Minimal punk-rock JSON parser: expects {"notes":[..]}
     NoteSet candidate = g_notes;
     if (parse_note_set_json(line, &candidate)) {
-      if (current_note >= 0) {
-        MIDI.sendNoteOff(current_note, 0, kChannel);
-        emit_gesture_event("release", 0, current_note);
-        current_note = -1;
-      }
+      int released = g_routes.release(g_midi);
+      if (released >= 0) emit_gesture_event("release", 0, released);
       g_notes = candidate;
       acknowledge_noteset(g_notes);
       return;
     }
+    bool mpe = false;
+    if (parse_bool_toggle(line, "\"mpe\"", &mpe)) {
+      // Switching modes releases every voice, so forget the sustaining note too.
+      int released = g_routes.forget();
+      if (released >= 0) emit_gesture_event("release", 0, released);
+      g_midi.set_mode(mpe ? MidiMode::Mpe : MidiMode::Global);
+      acknowledge_midi_mode();
+      return;
+    }
+    if (g_streams.apply_command(line)) {
+      acknowledge_subscriptions();
+      return;
+    }
+    RouteSpec spec;
+    const char* route_error = nullptr;
+    if (parse_route_spec(line, &spec, &route_error)) {
+      if (!route_error && !g_routes.add(spec)) route_error = "staging table full";
+      acknowledge_route(route_error);
+      return;
+    }
+    const char* routes = strstr(line, "\"routes\"");
+    if (routes) {
+      // The live table only changes here, between frames: render_frame runs
+      // on this same thread (loop(), or the I/O task on dual-core builds).
+      if (strstr(routes, "\"commit\"")) {
+        g_routes.commit();
+      } else if (strstr(routes, "\"discard\"")) {
+        g_routes.discard();
+      } else if (strstr(routes, "\"default\"")) {
+        g_routes.load_defaults();
+      } else if (strstr(routes, "\"list\"")) {
+        list_routes();
+      }
+      acknowledge_routes();
+      return;
+    }
+    bool raw = false;
+    if (parse_bool_toggle(line, "\"raw\"", &raw)) {
+      if (raw) {
+        g_streams.subscribe(TelemetryStream::Raw, 0);
+      } else {
+        g_streams.unsubscribe(TelemetryStream::Raw);
+      }
+      g_telemetry.print("{\"raw\":");
+      g_telemetry.print(raw ? "true" : "false");
+      g_telemetry.println('}');
+      return;
+    }
+#if defined(DUAL_CORE)
+    if (strstr(line, "\"pipeline\"")) {
+      report_pipeline();
+      return;
+    }
+#else
+    bool adaptive = false;
+    if (parse_bool_toggle(line, "\"adaptive\"", &adaptive)) {
+      g_idle.set_enabled(adaptive);
+      report_power();
+      return;
+    }
+#endif
+    const char* rec = strstr(line, "\"rec\"");
+    if (rec) {
+      if (strstr(rec, "\"dump\"")) {
+        start_flight_dump();
+      } else {
+        report_flight();
+      }
+      return;
+    }
+    if (strstr(line, "\"power\"")) {
+      report_power();
+      return;
+    }
+#if defined(GESTURE_TREE)
+    bool use_tree = false;
+    if (parse_engine_choice(line, &use_tree)) {
+      // A model that failed validation never gets the MIDI lane.
+      g_use_tree = use_tree && g_tree_ok;
+      acknowledge_engine();
+      return;
+    }
+#endif
     if (strstr(line, "help")) {
-      Serial.println("{\"help\":\"Send {\\\"notes\\\":[60,62,...]} to audition scales; this box will echo what it loads.\"}");
+      g_telemetry.println("{\"help\":\"Send {\\\"notes\\\":[60,62,...]} to audition scales; this box will echo what it loads. {\\\"mpe\\\":true} switches to per-note MPE channels. {\\\"sub\\\":{\\\"raw\\\":500,\\\"env\\\":30}} picks telemetry streams (gestures, raw, env, latency, engine) and max rates; {\\\"raw\\\":true} streams samples for training; {\\\"adaptive\\\":true} dozes while idle and {\\\"power\\\":\\\"stats\\\"} reports it; dual-core builds answer {\\\"pipeline\\\":\\\"stats\\\"}; {\\\"rec\\\":\\\"dump\\\"} streams the flight recorder; {\\\"ping\\\":N} answers {\\\"pong\\\":[N,micros]} for multi-board clock sync; {\\\"route\\\":{\\\"on\\\":\\\"bow\\\",\\\"to\\\":\\\"cc\\\",\\\"cc\\\":74}} stages a gesture-to-MIDI route and {\\\"routes\\\":\\\"commit\\\"} makes the staged table live (\\\"list\\\", \\\"default\\\", \\\"discard\\\"); with -D GESTURE_TREE, {\\\"engine\\\":\\\"tree\\\"} or \\\"rules\\\" picks the classifier.\"}");
     }
   }
 
@@ -345,116 +910,303 @@ namespace {
 }
 
 // ---- Globals -----------------------------------------------------------------
-GestureParams g_params;            // Live copy so calibration tools can tweak at runtime.
+// How long a pluck waits after its onset to measure the attack (see
+// GestureParams::attack_lookahead_us). This is the latency we trade for
+// velocity that tracks how hard the string was struck; 0 restores the old
+// report-on-crossing behavior.
+#ifndef ATTACK_LOOKAHEAD_US
+#define ATTACK_LOOKAHEAD_US 3000
+#endif
+
+GestureParams firmware_params() {
+  GestureParams p;
+  p.attack_lookahead_us = ATTACK_LOOKAHEAD_US;
+  return p;
+}
+
+GestureParams g_params = firmware_params();  // Live copy so calibration tools can tweak at runtime.
 GestureEngine g_engine(g_params);  // Gesture interpreter built from the live parameters.
 Sensor* g_sensor = nullptr;        // Assigned in setup() based on the compile-time flag.
 
-// ---- Setup / Loop ------------------------------------------------------------
+// Acquisition runs as fast as loop() spins; classification runs at this fixed
+// rate on decimated, anti-aliased samples (Decimator in signal_filters.h), so
+// a faster sensor path does not mean more GestureEngine calls. 0 classifies
+// every read, the pre-decimation behavior.
+#ifndef GESTURE_RATE_HZ
+#define GESTURE_RATE_HZ 1000
+#endif
+Decimator g_decimator(GESTURE_RATE_HZ > 0 ? 1000000UL / GESTURE_RATE_HZ : 0);
+
 /**
- * Arduino entry point. We boot MIDI, select the concrete sensor, and emit a
- * JSON hello so any connected classroom tooling knows the firmware is ready.
+ * Sleep out whatever the idle policy grants, then log what we actually slept.
+ * Teensy: WFI until the budget is spent; SysTick wakes it every millisecond and
+ * any USB or pin interrupt sooner, so a serial command or a PIR edge is never
+ * kept waiting. ESP32-S3: delay() parks the task and the idle task waits for
+ * an interrupt; -D IDLE_LIGHT_SLEEP uses timer light sleep instead (more
+ * savings, but the USB link naps too, so only for installs on a wall wart
+ * with no laptop attached).
  */
-void setup() {
-  MIDI.begin(MIDI_CHANNEL_OMNI);
-  g_sensor = make_sensor();
-  if (g_sensor != nullptr) {
-    g_sensor->begin();
+void nap_if_idle() {
+  uint32_t budget = g_idle.sleep_budget_us(micros());
+  if (budget == 0) return;
+  uint32_t start = micros();
+#if defined(TEENSYDUINO)
+  while (micros() - start < budget && Serial.available() == 0) {
+    asm volatile("wfi");
   }
-  Serial.begin(SERIAL_BAUD);
-  delay(500);
-  Serial.println("{\"firmware\":\"StringField\",\"version\":\"0.2-dev\",\"serial\":\"ready\"}");
-  Serial.println("{\"hint\":\"Send {\\\"notes\\\":[60,62,...]} + newline to hot-swap the scale. Type 'help' for this reminder.\"}");
+#elif defined(ARDUINO_ARCH_ESP32) && defined(IDLE_LIGHT_SLEEP)
+  esp_sleep_enable_timer_wakeup(budget);
+  esp_light_sleep_start();
+#else
+  if (budget >= 1000) {
+    delay(budget / 1000);
+  } else {
+    delayMicroseconds(budget);
+  }
+#endif
+  g_idle.note_slept(micros() - start);
 }
 
 /**
- * Main loop: poll serial (so commands stay snappy), read a sensor sample, let
- * the gesture engine classify it, and drive the MIDI + telemetry outputs. The
- * structure mirrors the teaching narrative: sense → classify → map → narrate.
+ * Sense: one acquisition, and a verdict when the decimator finishes a period.
+ * Everything here is sensor and classifier work; nothing touches Serial or
+ * MIDI, so in the dual-core build it can run on its own core.
  */
-void loop() {
-  pump_serial_commands();
-  if (g_sensor == nullptr) return;
-  SensorSample s = g_sensor->read();
-  Gesture g = g_engine.update(s);
-
-  switch (g) {
-    case Gesture::Pluck: {
-      // Narration cue: "pluck → NoteOn velocity burst" — say it while showing the debugger.
-      // Guard: don't stack overlapping notes
-      if (current_note >= 0) {
-        MIDI.sendNoteOff(current_note, 0, kChannel);
-      }
-      current_note = next_note();
-      uint8_t vel = (uint8_t)constrain(s.value * 127, 1, 127);
-      MIDI.sendNoteOn(current_note, vel, kChannel);
-      emit_gesture_event("pluck", vel, current_note);
-      break;
-    }
-    case Gesture::Scrape: {
-      // Narration cue: "scrape → micro-note grains at ~50 velocity".
-      // Rapid small notes; velocity lower to read as grain
-      uint8_t note = next_note();
-      MIDI.sendNoteOn(note, 50, kChannel);
-      MIDI.sendNoteOff(note, 0, kChannel);
-      emit_gesture_event("scrape", 50, note);
-      break;
+bool sense_step(SenseFrame* fr) {
+  analog_scan_poll();
+  if (g_sensor == nullptr) return false;
+  SensorSample acquired = g_sensor->read();
+#if !defined(DUAL_CORE)
+  g_idle.observe(acquired, g_engine.effective_on_thresh(), g_engine.effective_off_thresh());
+#endif
+  if (!g_decimator.push(acquired, &fr->s)) return false;
+  // Hand the sensor's live noise estimate to the engine; it only matters when
+  // on_sigmas/off_sigmas are set, and costs one float copy otherwise.
+  g_engine.set_noise_floor(g_sensor->noise_floor());
+  // One call, one verdict: the label, how sure the engine is, and the features
+  // it measured. The mapping reads those instead of re-deriving from s.value.
+  fr->r = g_engine.process(fr->s);
+  fr->on_thresh = g_engine.effective_on_thresh();
+  fr->off_thresh = g_engine.effective_off_thresh();
+  fr->noise = g_sensor->noise_floor();
+#if defined(GESTURE_TREE)
+  fr->tree_ran = g_tree_ok;
+  if (g_tree_ok) {
+    uint32_t t0 = cycle_stamp();
+    GestureResult t = g_tree.process(fr->s);
+    fr->tree_cycles = cycle_stamp() - t0;
+    fr->tree_gesture = t.gesture;
+    fr->tree_confidence = t.confidence;
+  }
+#endif
+  return true;
+}
+
+/**
+ * Map → narrate: turn one verdict into MIDI and JSON. The structure mirrors the
+ * teaching narrative: sense → classify → map → narrate.
+ */
+void render_frame(const SenseFrame& fr) {
+  GestureResult r = fr.r;
+  const GestureFeatures& f = r.features;
+  g_flight.sample(fr.s);
+  uint32_t frame_lag = micros() - fr.s.micros;
+  if (frame_lag > g_latency.worst_frame_lag_us) g_latency.worst_frame_lag_us = frame_lag;
+  // Every stream asks before it formats: nobody subscribed, nothing printed.
+  if (g_streams.due(TelemetryStream::Raw, fr.s.micros)) emit_raw_sample(fr.s);
+  if (g_streams.due(TelemetryStream::Envelope, fr.s.micros)) emit_envelope(fr);
+  if (g_streams.due(TelemetryStream::Engine, fr.s.micros)) emit_features(fr.r);
+  if (g_streams.due(TelemetryStream::Latency, fr.s.micros)) emit_latency();
+
+#if defined(GESTURE_TREE)
+  if (fr.tree_ran) {
+    if (fr.tree_cycles > g_tree_worst_cycles) g_tree_worst_cycles = fr.tree_cycles;
+    // The shadow backend's one-shots (Bow repeats every sample, so skip it).
+    Gesture shadow = g_use_tree ? r.gesture : fr.tree_gesture;
+    float shadow_conf = g_use_tree ? r.confidence : fr.tree_confidence;
+    if (shadow != Gesture::Idle && shadow != Gesture::Bow) {
+      g_telemetry.print("{\"ab\":\"");
+      g_telemetry.print(g_use_tree ? "rules" : "tree");
+      g_telemetry.print("\",\"gesture\":\"");
+      g_telemetry.print(gesture_name(shadow));
+      g_telemetry.print("\",\"conf\":");
+      g_telemetry.print(shadow_conf, 2);
+      g_telemetry.println('}');
     }
-    case Gesture::Harmonic: {
-      // Narration cue: "harmonic → glassy octave above"; we bias the pitch up so
-      // students *hear* the light touch difference.
-      if (current_note >= 0) {
-        MIDI.sendNoteOff(current_note, 0, kChannel);
-      }
-      uint8_t base = next_note();
-      uint8_t harmonic_note = (uint8_t)constrain(base + 12, 0, 127);
-      current_note = harmonic_note;
-      uint8_t vel = 96;
-      MIDI.sendNoteOn(harmonic_note, vel, kChannel);
-      emit_gesture_event("harmonic", vel, harmonic_note);
-      break;
+    if (g_use_tree) {
+      // The tree decides what happens; the engine's features still shape it.
+      r.gesture = fr.tree_gesture;
+      r.confidence = fr.tree_confidence;
     }
-    case Gesture::Muted: {
-      // Narration cue: "mute → note-off + short whisper". Great for damping riffs in class.
-      if (current_note >= 0) {
-        MIDI.sendNoteOff(current_note, 0, kChannel);
-        emit_gesture_event("mute", 0, current_note);
-        current_note = -1;
+  }
+#endif
+
+  // Map: the route table decides what MIDI this frame makes. The float →
+  // 0..127 step happens once in route_frame(); the routes themselves are table
+  // reads (see midi_routes.h for the defaults and {"route":...} to change them).
+  RouteFrame rf = route_frame(r);
+  RouteOutcome played = g_routes.dispatch(rf, g_midi, g_scale_notes);
+  const int current_note = g_routes.current_note();
+
+  // Narrate: what the player did, with whatever notes the routes played.
+  switch (r.gesture) {
+    case Gesture::Pluck:
+      if (played.note >= 0) {
+        g_latency.pluck_lag_us = micros() - f.onset_us;
+        if (g_latency.pluck_lag_us > g_latency.worst_pluck_lag_us) g_latency.worst_pluck_lag_us = g_latency.pluck_lag_us;
       }
+      // fall through
+    case Gesture::Scrape:
+    case Gesture::Harmonic:
+      if (played.note >= 0) emit_gesture_event(gesture_name(r.gesture), played.velocity, played.note, &r);
       break;
-    }
-    case Gesture::Tremolo: {
-      // Quick amplitude wobbles: map to Expression so synths get a trembling loudness lane.
-      uint8_t cc = (uint8_t)constrain(s.value * 127, 0, 127);
-      MIDI.sendControlChange(11, cc, kChannel);
-      emit_gesture_event("tremolo", cc, current_note);
+    case Gesture::Muted:
+      if (played.released >= 0) emit_gesture_event("mute", 0, played.released, &r);
       break;
-    }
+    case Gesture::Tremolo:
     case Gesture::Vibrato: {
-      // Deeper wobble: swing pitch bend around center. Teensy MIDI uses +/-8192 range.
-      int bend = (int)((s.value - 0.5f) * 2.0f * 8191);  // center on 0
-      MIDI.sendPitchBend(bend, kChannel);
-      emit_gesture_event("vibrato", (uint8_t)constrain(s.value * 127, 0, 127), current_note);
+      // Continuous lines obey the gestures stream's rate cap; one-shots never do.
+      uint8_t amount = rf.in[static_cast<uint8_t>(r.gesture == Gesture::Tremolo ? RouteInput::Value : RouteInput::Depth)];
+      if (g_streams.due(TelemetryStream::Gestures, fr.s.micros)) emit_gesture_event(gesture_name(r.gesture), amount, current_note, &r);
       break;
     }
     case Gesture::Bow: {
-      // Narration cue: "bow → CC1 envelope stream"; invite students to map it to filters.
-      // Continuous control (mod wheel)
-      uint8_t cc = (uint8_t)constrain(s.value * 127, 0, 127);
-      MIDI.sendControlChange(1, cc, kChannel);
-      if (abs((int)cc - (int)last_bow_cc) > 2) {
-        emit_gesture_event("bow", cc, current_note);
+      uint8_t cc = rf.in[static_cast<uint8_t>(RouteInput::Value)];
+      if (abs((int)cc - (int)last_bow_cc) > 2 && g_streams.due(TelemetryStream::Gestures, fr.s.micros)) {
+        emit_gesture_event("bow", cc, current_note, &r);
         last_bow_cc = cc;
       }
       break;
     }
     case Gesture::Idle: default:
-      // If contact ended, release sustained note
-      if (current_note >= 0 && s.value < g_params.off_thresh) {
-        MIDI.sendNoteOff(current_note, 0, kChannel);
-        emit_gesture_event("release", 0, current_note);
-        current_note = -1;
-      }
+      // Contact ended: the matrix already sent the note-off.
+      if (played.released >= 0) emit_gesture_event("release", 0, played.released, &r);
       break;
   }
+}
+
+#if defined(DUAL_CORE)
+// esp_timer callback (esp_timer task): wake the sense task for one step.
+void on_sense_tick(void*) { xTaskNotifyGive(g_sense_task); }
+
+/**
+ * Core 1. Sleeps until the next tick, runs one sense step, and hands any verdict
+ * over without ever waiting: a full ring drops the frame and counts it. The
+ * period comes from the hardware timer, not from how long the step took or
+ * what the I/O core is doing.
+ */
+void sense_task(void*) {
+  for (;;) {
+    uint32_t due = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    g_sense_ticks.store(g_sense_ticks.load(std::memory_order_relaxed) + due, std::memory_order_relaxed);
+    if (due > 1) {
+      g_sense_missed.store(g_sense_missed.load(std::memory_order_relaxed) + due - 1, std::memory_order_relaxed);
+    }
+    uint32_t t0 = micros();
+    SenseFrame fr;
+    if (sense_step(&fr) && g_frames.push(fr)) {
+      xTaskNotifyGive(g_io_task);  // wake-up hint only; the data went through the ring
+    }
+    uint32_t spent = micros() - t0;
+    if (spent > g_sense_worst_us.load(std::memory_order_relaxed)) {
+      g_sense_worst_us.store(spent, std::memory_order_relaxed);
+    }
+  }
+}
+
+/**
+ * Core 0. Everything that talks to the host: render frames into MIDI + JSON,
+ * pump both transports, parse commands. Waits for the sense task's hint, or
+ * 1 ms at most so serial commands stay snappy when nothing is being played.
+ */
+void io_task(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1));
+    pump_serial_commands();
+    service_flight_dump();
+    SenseFrame fr;
+    while (g_frames.pop(&fr)) {
+      render_frame(fr);
+      g_transport.pump();  // each frame's notes go out before the next frame
+    }
+    g_transport.pump();
+  }
+}
+
+void pipeline_begin() {
+  xTaskCreatePinnedToCore(io_task, "io", 8192, nullptr, 5, &g_io_task, kIoCore);
+  xTaskCreatePinnedToCore(sense_task, "sense", 8192, nullptr, configMAX_PRIORITIES - 2, &g_sense_task, kSenseCore);
+  esp_timer_create_args_t args = {};
+  args.callback = on_sense_tick;
+  args.name = "sense_tick";
+  esp_timer_create(&args, &g_sense_timer);
+  esp_timer_start_periodic(g_sense_timer, SENSE_PERIOD_US);
+}
+#endif
+
+// ---- Setup / Loop ------------------------------------------------------------
+/**
+ * Arduino entry point. We boot MIDI, select the concrete sensor, and emit a
+ * JSON hello so any connected classroom tooling knows the firmware is ready.
+ */
+void setup() {
+#if !defined(MIDI_USB)
+  MIDI.begin(MIDI_CHANNEL_OMNI);
+#elif defined(ARDUINO_ARCH_ESP32)
+  g_usb_midi.begin();
+  USB.begin();
+#endif
+#if defined(MIDI_MPE_DEFAULT)
+  g_midi.set_mode(MidiMode::Mpe);
+#endif
+  analog_scan_begin();  // no-op unless built with -D ADC_SCAN
+  g_sensor = make_sensor();
+  if (g_sensor != nullptr) {
+    g_sensor->begin();
+    g_decimator.set_mode(g_sensor->decimate_mode());
+    g_idle.set_rise_tau_us(g_sensor->rise_tau_us());
+  }
+#if !defined(ADAPTIVE_SAMPLING)
+  g_idle.set_enabled(false);
+#endif
+  Serial.begin(SERIAL_BAUD);
+  delay(500);
+  g_telemetry.println("{\"firmware\":\"StringField\",\"version\":\"0.2-dev\",\"serial\":\"ready\"}");
+#if defined(GESTURE_TREE)
+  g_tree_ok = g_tree.valid();
+  acknowledge_engine();
+#endif
+  g_telemetry.println("{\"hint\":\"Send {\\\"notes\\\":[60,62,...]} + newline to hot-swap the scale. Type 'help' for this reminder.\"}");
+#if defined(DUAL_CORE)
+  pipeline_begin();
+#endif
+}
+
+/**
+ * Main loop: poll serial (so commands stay snappy), sense, and when a verdict
+ * is ready drive the MIDI + telemetry outputs from it.
+ */
+void loop() {
+#if defined(DUAL_CORE)
+  // The sense and I/O tasks own both cores; the Arduino loop task bows out.
+  vTaskDelete(nullptr);
+#else
   pump_serial_commands();
+  service_flight_dump();
+  g_transport.pump();
+#if defined(MIDI_USB) && defined(TEENSYDUINO)
+  while (usbMIDI.read()) {
+  }  // nothing to do with incoming MIDI yet; just keep the host's buffer moving
+#endif
+  SenseFrame fr;
+  if (!sense_step(&fr)) {
+    g_transport.pump();  // nothing to classify yet; keep the wire moving
+    nap_if_idle();
+    return;
+  }
+  render_frame(fr);
+  g_transport.pump();  // this sample's notes go out before the next read
+  pump_serial_commands();
+  nap_if_idle();  // no-op at full rate
+#endif
 }
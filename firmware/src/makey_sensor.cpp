@@ -1,38 +1,45 @@
+#include "gate_envelope.h"
 #include "sensor.h"
 
 #ifdef SENSOR_MAKEY
 
+namespace {
+const uint8_t kMakeyPin = 2;  // MaKey output wired here (internal pullup enabled)
+EdgeRing g_edges;
+
+// Pin-change ISR: a timestamp and the new level, nothing else.
+void makey_edge_isr() { g_edges.push(micros(), digitalRead(kMakeyPin) == LOW); }  // MaKey shorts to ground
+}  // namespace
+
 class MakeySensorGuarded : public Sensor {
  public:
-  void begin() override { pinMode(kMakeyPin, INPUT_PULLUP); }
+  void begin() override {
+    pinMode(kMakeyPin, INPUT_PULLUP);
+    env_.reset(digitalRead(kMakeyPin) == LOW, micros());
+    attachInterrupt(digitalPinToInterrupt(kMakeyPin), makey_edge_isr, CHANGE);
+  }
 
   SensorSample read() override {
     uint32_t now = micros();
-    if (now - last_read_us_ < guard_us_) return last_sample_;
-    last_read_us_ = now;
 
     // Expected signal range: digital gate with pullup enabled, so HIGH ~= 1 (open)
-    // and LOW ~= 0 (touch shorts to ground).
-    bool touch = digitalRead(kMakeyPin) == LOW;  // MaKey shorts to ground
-    // Debounce using a tiny integrator so hand jitter does not look like a bow.
-    debounce_state_ = 0.9f * debounce_state_ + 0.1f * (touch ? 1.0f : 0.0f);
-    // Normalization: convert the debounced gate into a 0..1 envelope the rest of
-    // the gesture engine can treat like any other sensor.
-    float normalized = debounce_state_;
+    // and LOW ~= 0 (touch shorts to ground). Touches arrive as edges with the
+    // microsecond they happened, not the poll that noticed them.
+    GateEdge e;
+    while (g_edges.pop(&e)) env_.edge(e.level, e.stamp_us);
+    if (g_edges.take_overflow()) env_.edge(digitalRead(kMakeyPin) == LOW, now);
+
+    // Debounce: edges within 2 ms of the last one are hand jitter, and the ~19 ms
+    // envelope (what the old 0.9/0.1 integrator gave at a 2 ms poll) keeps a
+    // brush from looking like a bow. Computed only here, on demand.
+    // Normalization: the envelope is already 0..1 for the gesture engine.
     // Common failure modes: no shared ground (always HIGH), too-long leads acting
     // like antennas (phantom touches), or ESD spikes that look like micro taps.
-
-    last_sample_ = {normalized, now};
-    return last_sample_;
+    return {env_.value_at(now), now};
   }
 
  private:
-  static const uint8_t kMakeyPin = 2;  // MaKey output wired here (internal pullup enabled)
-  const uint16_t guard_us_ = 2000;     // 2ms guard to avoid chatter
-
-  uint32_t last_read_us_ = 0;
-  float debounce_state_ = 0.0f;
-  SensorSample last_sample_{0.0f, 0};
+  GateEnvelope env_{19000.0f, 19000.0f, 2000};
 };
 
 Sensor& get_makey_sensor() {
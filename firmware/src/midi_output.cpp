@@ -0,0 +1,198 @@
+#include "midi_output.h"
+
+namespace {
+// MPE puts a new note on a neutral channel: centered bend, no pressure, and
+// timbre at its midpoint so CC74 can swing both ways.
+const int16_t kNeutralBend = 0;
+const uint8_t kNeutralPressure = 0;
+const uint8_t kNeutralTimbre = 64;
+
+const uint8_t kCcModWheel = 1;
+const uint8_t kCcExpression = 11;
+const uint8_t kCcTimbre = 74;
+const uint8_t kCcAllNotesOff = 123;
+
+// Member channels' pitch-bend range. MPE defaults members to ±48 semitones,
+// which would make the vibrato route's full-scale bend a wild swoop; ±2 is
+// what the same bend means on the Global channel.
+const uint8_t kMemberBendSemitones = 2;
+}  // namespace
+
+MidiVoiceRouter::MidiVoiceRouter(MidiSink& sink, uint8_t member_channels)
+    : sink_(sink), member_count_(member_channels) {
+  if (member_count_ == 0 || member_count_ > kMaxMemberChannels) member_count_ = kMaxMemberChannels;
+}
+
+void MidiVoiceRouter::set_mode(MidiMode mode) {
+  all_notes_off();
+  if (mode_ == MidiMode::Mpe && mode == MidiMode::Global) {
+    send_mpe_configuration(0);  // close the zone so the synth falls back to omni/poly
+  }
+  mode_ = mode;
+  reset_channel_state();
+  if (mode_ == MidiMode::Mpe) {
+    send_mpe_configuration(member_count_);
+  }
+}
+
+void MidiVoiceRouter::note_on(uint8_t note, uint8_t velocity) {
+  if (mode_ == MidiMode::Global) {
+    sink_.note_on(note, velocity, kGlobalChannel);
+    return;
+  }
+  // Retriggering a sounding pitch reuses its channel instead of stacking a
+  // second voice with the same note number.
+  uint8_t ch = channel_for(note);
+  if (ch != 0) {
+    sink_.note_off(note, 0, ch);
+  } else {
+    ch = allocate_channel();
+  }
+  Voice& v = voices_[ch - 2];
+  v.note = note;
+  v.stamp = ++clock_;
+  // Expression must be in place before the note starts or the attack inherits
+  // whatever the previous owner of this channel left behind.
+  send_bend(ch, kNeutralBend);
+  send_timbre(ch, kNeutralTimbre);
+  send_pressure(ch, kNeutralPressure);
+  sink_.note_on(note, velocity, ch);
+}
+
+void MidiVoiceRouter::note_off(uint8_t note) {
+  if (mode_ == MidiMode::Global) {
+    sink_.note_off(note, 0, kGlobalChannel);
+    return;
+  }
+  uint8_t ch = channel_for(note);
+  if (ch == 0) return;  // already released (e.g. stolen by a newer note)
+  sink_.note_off(note, 0, ch);
+  Voice& v = voices_[ch - 2];
+  v.note = -1;
+  v.stamp = ++clock_;  // released channels age from their release, not their attack
+}
+
+void MidiVoiceRouter::all_notes_off() {
+  if (mode_ == MidiMode::Global) {
+    sink_.control_change(kCcAllNotesOff, 0, kGlobalChannel);
+    return;
+  }
+  for (uint8_t i = 0; i < member_count_; ++i) {
+    if (voices_[i].note >= 0) note_off(static_cast<uint8_t>(voices_[i].note));
+  }
+}
+
+void MidiVoiceRouter::set_pressure(int note, uint8_t value) {
+  send_pressure(expression_channel(note), value);
+}
+
+void MidiVoiceRouter::set_timbre(int note, uint8_t value) {
+  send_timbre(expression_channel(note), value);
+}
+
+void MidiVoiceRouter::set_bend(int note, int16_t bend) {
+  send_bend(expression_channel(note), bend);
+}
+
+void MidiVoiceRouter::set_cc(int note, uint8_t number, uint8_t value) {
+  uint8_t ch = expression_channel(note);
+  // A route may aim at the controller a lane already uses. Its value is now
+  // what the synth holds, so the change-only cache has to know, or the next
+  // set_pressure/set_timbre repeating the old value would be skipped.
+  ChannelState& st = state_[ch - 1];
+  if (mode_ == MidiMode::Global && number == kCcModWheel) st.pressure = value;
+  if (number == (mode_ == MidiMode::Mpe ? kCcTimbre : kCcExpression)) st.timbre = value;
+  sink_.control_change(number, value, ch);
+}
+
+uint8_t MidiVoiceRouter::channel_for(uint8_t note) const {
+  if (mode_ == MidiMode::Global) return kGlobalChannel;
+  for (uint8_t i = 0; i < member_count_; ++i) {
+    if (voices_[i].note == note) return static_cast<uint8_t>(i + 2);
+  }
+  return 0;
+}
+
+/**
+ * Least-recently-used allocation: prefer the free channel that has been quiet
+ * longest (its release tail has had the most time to ring out). When every
+ * member is busy we steal the oldest voice, which is also the note the player
+ * is least likely to still be shaping.
+ */
+uint8_t MidiVoiceRouter::allocate_channel() {
+  int best_free = -1;
+  int oldest = 0;
+  for (uint8_t i = 0; i < member_count_; ++i) {
+    const Voice& v = voices_[i];
+    if (v.note < 0 && (best_free < 0 || v.stamp < voices_[best_free].stamp)) best_free = i;
+    if (v.stamp < voices_[oldest].stamp) oldest = i;
+  }
+  if (best_free >= 0) return static_cast<uint8_t>(best_free + 2);
+  note_off(static_cast<uint8_t>(voices_[oldest].note));
+  return static_cast<uint8_t>(oldest + 2);
+}
+
+uint8_t MidiVoiceRouter::expression_channel(int note) const {
+  if (mode_ == MidiMode::Global) return kGlobalChannel;
+  if (note >= 0 && note <= 127) {
+    uint8_t ch = channel_for(static_cast<uint8_t>(note));
+    if (ch != 0) return ch;
+  }
+  return kMpeManagerChannel;  // zone-wide: applies to every note in the zone
+}
+
+void MidiVoiceRouter::send_pressure(uint8_t channel, uint8_t value) {
+  ChannelState& st = state_[channel - 1];
+  if (st.pressure == value) return;
+  st.pressure = value;
+  if (mode_ == MidiMode::Mpe) {
+    sink_.channel_pressure(value, channel);
+  } else {
+    sink_.control_change(kCcModWheel, value, channel);
+  }
+}
+
+void MidiVoiceRouter::send_timbre(uint8_t channel, uint8_t value) {
+  ChannelState& st = state_[channel - 1];
+  if (st.timbre == value) return;
+  st.timbre = value;
+  sink_.control_change(mode_ == MidiMode::Mpe ? kCcTimbre : kCcExpression, value, channel);
+}
+
+void MidiVoiceRouter::send_bend(uint8_t channel, int16_t bend) {
+  if (bend < -8192) bend = -8192;
+  if (bend > 8191) bend = 8191;
+  ChannelState& st = state_[channel - 1];
+  if (st.bend == bend) return;
+  st.bend = bend;
+  sink_.pitch_bend(bend, channel);
+}
+
+/**
+ * MPE Configuration Message: RPN 6 on the manager channel, data entry MSB =
+ * number of member channels. The trailing RPN null keeps a stray data-entry
+ * CC from silently editing the zone later. Opening a zone resets its members
+ * to ±48 semitones of bend, so each member then gets RPN 0 (pitch-bend
+ * sensitivity) = kMemberBendSemitones, after the MCM so the reset cannot undo it.
+ */
+void MidiVoiceRouter::send_mpe_configuration(uint8_t members) {
+  sink_.control_change(101, 0, kMpeManagerChannel);
+  sink_.control_change(100, 6, kMpeManagerChannel);
+  sink_.control_change(6, members, kMpeManagerChannel);
+  sink_.control_change(101, 127, kMpeManagerChannel);
+  sink_.control_change(100, 127, kMpeManagerChannel);
+  for (uint8_t ch = 2; ch < 2 + members; ++ch) {
+    sink_.control_change(101, 0, ch);
+    sink_.control_change(100, 0, ch);
+    sink_.control_change(6, kMemberBendSemitones, ch);
+    sink_.control_change(38, 0, ch);  // and no cents
+    sink_.control_change(101, 127, ch);
+    sink_.control_change(100, 127, ch);
+  }
+}
+
+void MidiVoiceRouter::reset_channel_state() {
+  for (uint8_t i = 0; i < kChannels; ++i) state_[i] = ChannelState();
+  for (uint8_t i = 0; i < kMaxMemberChannels; ++i) voices_[i] = Voice();
+  clock_ = 0;
+}
@@ -0,0 +1,457 @@
+#include "midi_routes.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+// Names as typed and listed, in enum order. Triggers start at 1 (Pluck), so
+// slot 0 is Gesture::Idle, which never fires a route.
+const char* const kTriggerNames[] = {"idle",    "pluck",   "bow",     "scrape",  "harmonic", "mute",
+                                     "tremolo", "vibrato", "release", "contact", "always"};
+const char* const kInputNames[kRouteInputCount] = {"value", "strike", "depth", "rate", "wobble", "conf", "full"};
+const char* const kDestNames[] = {"note", "grain", "release", "pressure", "timbre", "bend", "cc"};
+const char* const kShapeNames[] = {"lin", "exp", "log", "const", "pts"};
+const uint8_t kTriggerCount = sizeof(kTriggerNames) / sizeof(kTriggerNames[0]);
+const uint8_t kDestCount = sizeof(kDestNames) / sizeof(kDestNames[0]);
+const uint8_t kShapeCount = sizeof(kShapeNames) / sizeof(kShapeNames[0]);
+
+const float kRateFullHz = 16.0f;  // the fastest wobble the engine counts (tremolo_max_period_us)
+
+// 0..1 → 0..127, truncating like the old `constrain(x * 127, 0, 127)`. NaN lands on 0.
+uint8_t q7(float x) {
+  if (!(x > 0.0f)) return 0;
+  if (x >= 1.0f) return 127;
+  return static_cast<uint8_t>(x * 127.0f);
+}
+
+void dest_range(RouteDest d, int16_t* lo, int16_t* hi) {
+  switch (d) {
+    case RouteDest::Bend: *lo = -8192; *hi = 8191; break;
+    case RouteDest::Note:
+    case RouteDest::Grain: *lo = 1; *hi = 127; break;  // velocity 0 would be a note-off
+    default: *lo = 0; *hi = 127; break;
+  }
+}
+
+int16_t clamp16(long v, int16_t lo, int16_t hi) { return static_cast<int16_t>(v < lo ? lo : v > hi ? hi : v); }
+
+// Index of `name` (quoted, at `at`) in `names`, or -1.
+int match_name(const char* at, const char* const* names, uint8_t count) {
+  if (*at != '"') return -1;
+  ++at;
+  for (uint8_t i = 0; i < count; ++i) {
+    size_t n = strlen(names[i]);
+    if (strncmp(at, names[i], n) == 0 && at[n] == '"') return i;
+  }
+  return -1;
+}
+
+// Value of "key" inside [body, end): points just past the colon and any
+// spaces, or null. Skips a quoted word that is only a value ("to":"cc" vs "cc":74).
+const char* field(const char* body, const char* end, const char* key) {
+  size_t n = strlen(key);
+  for (const char* at = strstr(body, key); at && at < end; at = strstr(at + 1, key)) {
+    const char* v = at + n;
+    while (*v == ' ' || *v == '\t') ++v;
+    if (*v != ':') continue;
+    ++v;
+    while (*v == ' ' || *v == '\t') ++v;
+    return v;
+  }
+  return nullptr;
+}
+
+bool read_int(const char* v, long* out) {
+  char* num_end = nullptr;
+  *out = strtol(v, &num_end, 10);
+  return num_end != v;
+}
+}  // namespace
+
+const char* route_trigger_name(RouteTrigger t) {
+  uint8_t i = static_cast<uint8_t>(t);
+  return i < kTriggerCount ? kTriggerNames[i] : "?";
+}
+const char* route_input_name(RouteInput in) {
+  uint8_t i = static_cast<uint8_t>(in);
+  return i < kRouteInputCount ? kInputNames[i] : "?";
+}
+const char* route_dest_name(RouteDest d) {
+  uint8_t i = static_cast<uint8_t>(d);
+  return i < kDestCount ? kDestNames[i] : "?";
+}
+const char* curve_shape_name(CurveShape s) {
+  uint8_t i = static_cast<uint8_t>(s);
+  return i < kShapeCount ? kShapeNames[i] : "?";
+}
+
+RouteFrame route_frame(const GestureResult& r) {
+  const GestureFeatures& f = r.features;
+  RouteFrame out;
+  out.gesture = r.gesture;
+  out.contact = f.contact;
+  out.in[static_cast<uint8_t>(RouteInput::Value)] = q7(f.value);
+  out.in[static_cast<uint8_t>(RouteInput::Strike)] = q7(f.strike);
+  out.in[static_cast<uint8_t>(RouteInput::Depth)] = q7(f.wobble_depth);
+  out.in[static_cast<uint8_t>(RouteInput::Rate)] = q7(f.wobble_rate_hz / kRateFullHz);
+  // ±0.5 around the center spans the whole index, with 64 exactly centered.
+  float w = 64.0f + (f.value - f.wobble_center) * 128.0f;
+  out.in[static_cast<uint8_t>(RouteInput::Wobble)] = !(w > 0.0f) ? 0 : w >= 127.0f ? 127 : static_cast<uint8_t>(w);
+  out.in[static_cast<uint8_t>(RouteInput::Confidence)] = q7(r.confidence);
+  out.in[static_cast<uint8_t>(RouteInput::Full)] = 127;
+  return out;
+}
+
+void build_route_curve(const RouteSpec& spec, int16_t lut[128]) {
+  int16_t min_out, max_out;
+  dest_range(spec.dest, &min_out, &max_out);
+  for (int i = 0; i < 128; ++i) {
+    float x = static_cast<float>(i) / 127.0f;
+    float out;
+    if (spec.shape == CurveShape::Points && spec.point_count > 0) {
+      const uint8_t n = spec.point_count;
+      if (i <= spec.point_in[0]) {
+        out = spec.point_out[0];
+      } else if (i >= spec.point_in[n - 1]) {
+        out = spec.point_out[n - 1];
+      } else {
+        uint8_t j = 1;
+        while (spec.point_in[j] < i) ++j;
+        float span = static_cast<float>(spec.point_in[j] - spec.point_in[j - 1]);
+        float t = static_cast<float>(i - spec.point_in[j - 1]) / span;
+        out = spec.point_out[j - 1] + t * static_cast<float>(spec.point_out[j] - spec.point_out[j - 1]);
+      }
+    } else {
+      float y = x;
+      if (spec.shape == CurveShape::Exp) y = powf(x, spec.k);
+      if (spec.shape == CurveShape::Log) y = 1.0f - powf(1.0f - x, spec.k);
+      if (spec.shape == CurveShape::Const) y = 1.0f;
+      out = spec.lo + y * static_cast<float>(spec.hi - spec.lo);
+    }
+    lut[i] = clamp16(lroundf(out), min_out, max_out);
+  }
+}
+
+RouteMatrix::RouteMatrix() {
+  reset_last();
+  load_defaults();
+}
+
+void RouteMatrix::load_defaults() {
+  discard();
+  RouteSpec s;
+  s.trigger = RouteTrigger::Pluck;  // velocity from the measured attack
+  s.input = RouteInput::Strike;
+  s.dest = RouteDest::Note;
+  s.lo = 1;
+  add(s);
+
+  s = RouteSpec();
+  s.trigger = RouteTrigger::Scrape;  // micro-note grains, soft enough to read as texture
+  s.input = RouteInput::Full;
+  s.dest = RouteDest::Grain;
+  s.shape = CurveShape::Const;
+  s.hi = 50;
+  add(s);
+
+  s = RouteSpec();
+  s.trigger = RouteTrigger::Harmonic;  // the glassy octave above
+  s.input = RouteInput::Full;
+  s.dest = RouteDest::Note;
+  s.param = 12;
+  s.shape = CurveShape::Const;
+  s.hi = 96;
+  add(s);
+
+  s = RouteSpec();
+  s.trigger = RouteTrigger::Muted;
+  s.input = RouteInput::Full;
+  s.dest = RouteDest::Release;
+  add(s);
+
+  s = RouteSpec();
+  s.trigger = RouteTrigger::Bow;  // mod wheel globally, per-note pressure in MPE
+  add(s);
+
+  s = RouteSpec();
+  s.trigger = RouteTrigger::Tremolo;  // CC11 globally, CC74 on the note in MPE
+  s.dest = RouteDest::Timbre;
+  add(s);
+
+  s = RouteSpec();
+  s.trigger = RouteTrigger::Vibrato;  // bend swings around the wobble's own center
+  s.input = RouteInput::Wobble;
+  s.dest = RouteDest::Bend;
+  s.shape = CurveShape::Points;
+  s.point_count = 3;
+  s.point_in[0] = 0;
+  s.point_out[0] = -8192;
+  s.point_in[1] = 64;
+  s.point_out[1] = 0;
+  s.point_in[2] = 127;
+  s.point_out[2] = 8191;
+  add(s);
+
+  s = RouteSpec();
+  s.trigger = RouteTrigger::Vibrato;  // rate and depth as synth knobs (GM2 CC76/77)
+  s.input = RouteInput::Rate;
+  s.dest = RouteDest::Cc;
+  s.param = 76;
+  add(s);
+  s.input = RouteInput::Depth;
+  s.param = 77;
+  add(s);
+
+  commit();
+}
+
+bool RouteMatrix::add(const RouteSpec& spec) {
+  Table& t = tables_[1 - active_];
+  if (t.count >= kMaxRoutes) return false;
+  MidiRoute& r = t.routes[t.count];
+  r.spec = spec;
+  build_route_curve(spec, r.curve);
+  ++t.count;
+  return true;
+}
+
+void RouteMatrix::commit() {
+  active_ = static_cast<uint8_t>(1 - active_);
+  tables_[1 - active_].count = 0;
+  reset_last();  // new routes, new change-only history
+}
+
+void RouteMatrix::reset_last() {
+  for (uint8_t i = 0; i < kMaxRoutes; ++i) last_[i] = -32768;
+}
+
+void RouteMatrix::start_note(int note) {
+  current_note_ = note;
+  reset_last();  // a new note (a fresh MPE channel) needs its expression resent
+}
+
+int RouteMatrix::release(MidiVoiceRouter& midi) {
+  int note = current_note_;
+  if (note >= 0) midi.note_off(static_cast<uint8_t>(note));
+  current_note_ = -1;
+  reset_last();
+  return note;
+}
+
+int RouteMatrix::forget() {
+  int note = current_note_;
+  current_note_ = -1;
+  reset_last();
+  return note;
+}
+
+RouteOutcome RouteMatrix::dispatch(const RouteFrame& f, MidiVoiceRouter& midi, NoteSupply& notes) {
+  RouteOutcome out;
+  const Table& t = tables_[active_];
+  const uint8_t gesture = static_cast<uint8_t>(f.gesture);  // Idle (0) matches no trigger
+  const bool releasing = f.gesture == Gesture::Idle && !f.contact && current_note_ >= 0;
+  for (uint8_t i = 0; i < t.count; ++i) {
+    const MidiRoute& r = t.routes[i];
+    const RouteTrigger trig = r.spec.trigger;
+    if (static_cast<uint8_t>(trig) != gesture && !(trig == RouteTrigger::Release && releasing) &&
+        !(trig == RouteTrigger::Contact && f.contact) && trig != RouteTrigger::Always) {
+      continue;
+    }
+    const int16_t v = r.curve[f.in[static_cast<uint8_t>(r.spec.input)]];
+    switch (r.spec.dest) {
+      case RouteDest::Note: {
+        if (current_note_ >= 0) midi.note_off(static_cast<uint8_t>(current_note_));  // don't stack notes
+        uint8_t note = static_cast<uint8_t>(clamp16(notes.next_note() + r.spec.param, 0, 127));
+        midi.note_on(note, static_cast<uint8_t>(v));
+        start_note(note);
+        out.note = note;
+        out.velocity = static_cast<uint8_t>(v);
+        break;
+      }
+      case RouteDest::Grain: {
+        uint8_t note = static_cast<uint8_t>(clamp16(notes.next_note() + r.spec.param, 0, 127));
+        midi.note_on(note, static_cast<uint8_t>(v));
+        midi.note_off(note);
+        out.note = note;
+        out.velocity = static_cast<uint8_t>(v);
+        break;
+      }
+      case RouteDest::Release:
+        if (current_note_ >= 0) out.released = release(midi);
+        break;
+      default:
+        if (last_[i] == v) break;  // change-only, per route
+        last_[i] = v;
+        if (r.spec.dest == RouteDest::Pressure) {
+          midi.set_pressure(current_note_, static_cast<uint8_t>(v));
+        } else if (r.spec.dest == RouteDest::Timbre) {
+          midi.set_timbre(current_note_, static_cast<uint8_t>(v));
+        } else if (r.spec.dest == RouteDest::Bend) {
+          midi.set_bend(current_note_, v);
+        } else {
+          midi.set_cc(current_note_, static_cast<uint8_t>(r.spec.param), static_cast<uint8_t>(v));
+        }
+        break;
+    }
+  }
+  // Contact ended: the note-off is not optional, whatever the table says, so
+  // a venue mapping can never leave a note hanging.
+  if (releasing && current_note_ >= 0) out.released = release(midi);
+  return out;
+}
+
+bool parse_route_spec(const char* line, RouteSpec* out, const char** error) {
+  const char* key = line ? strstr(line, "\"route\"") : nullptr;
+  if (!key) return false;
+  *error = nullptr;
+  const char* body = strchr(key, '{');
+  const char* end = body ? strchr(body, '}') : nullptr;
+  if (!body || !end) {
+    *error = "expected {\"route\":{...}}";
+    return true;
+  }
+  RouteSpec s;
+  const char* v = field(body, end, "\"on\"");
+  int i = v ? match_name(v, kTriggerNames, kTriggerCount) : -1;
+  if (i <= 0) {
+    *error = "\"on\": pluck, bow, scrape, harmonic, mute, tremolo, vibrato, release, contact or always";
+    return true;
+  }
+  s.trigger = static_cast<RouteTrigger>(i);
+  v = field(body, end, "\"to\"");
+  i = v ? match_name(v, kDestNames, kDestCount) : -1;
+  if (i < 0) {
+    *error = "\"to\": note, grain, release, pressure, timbre, bend or cc";
+    return true;
+  }
+  s.dest = static_cast<RouteDest>(i);
+  dest_range(s.dest, &s.lo, &s.hi);
+  const int16_t min_out = s.lo;
+  const int16_t max_out = s.hi;
+
+  if ((v = field(body, end, "\"in\""))) {
+    i = match_name(v, kInputNames, kRouteInputCount);
+    if (i < 0) {
+      *error = "\"in\": value, strike, depth, rate, wobble, conf or full";
+      return true;
+    }
+    s.input = static_cast<RouteInput>(i);
+  }
+  long n = 0;
+  if (s.dest == RouteDest::Cc) {
+    v = field(body, end, "\"cc\"");
+    if (!v || !read_int(v, &n) || n < 0 || n > 119) {  // 120+ are channel mode messages
+      *error = "\"cc\": 0..119";
+      return true;
+    }
+    s.param = static_cast<int16_t>(n);
+  }
+  if ((v = field(body, end, "\"tr\""))) {
+    if (!read_int(v, &n) || n < -48 || n > 48) {
+      *error = "\"tr\": -48..48 semitones";
+      return true;
+    }
+    if (s.dest == RouteDest::Note || s.dest == RouteDest::Grain) s.param = static_cast<int16_t>(n);
+  }
+  if ((v = field(body, end, "\"curve\""))) {
+    i = match_name(v, kShapeNames, kShapeCount);
+    if (i < 0) {
+      *error = "\"curve\": lin, exp, log, const or pts";
+      return true;
+    }
+    s.shape = static_cast<CurveShape>(i);
+  }
+  if ((v = field(body, end, "\"k\""))) {
+    char* num_end = nullptr;
+    float k = strtof(v, &num_end);
+    if (num_end == v || !(k > 0.0f) || k > 16.0f) {
+      *error = "\"k\": steepness above 0, up to 16";
+      return true;
+    }
+    s.k = k;
+  }
+  if ((v = field(body, end, "\"lo\""))) {
+    if (!read_int(v, &n) || n < min_out || n > max_out) {
+      *error = "\"lo\" outside the destination's range";
+      return true;
+    }
+    s.lo = static_cast<int16_t>(n);
+  }
+  if ((v = field(body, end, "\"hi\""))) {
+    if (!read_int(v, &n) || n < min_out || n > max_out) {
+      *error = "\"hi\" outside the destination's range";
+      return true;
+    }
+    s.hi = static_cast<int16_t>(n);
+  }
+  if ((v = field(body, end, "\"pts\""))) {
+    // Flat pairs: [in,out, in,out, ...], inputs rising through 0..127.
+    if (*v != '[') {
+      *error = "\"pts\": [in,out,in,out,...]";
+      return true;
+    }
+    ++v;
+    uint8_t count = 0;
+    long values[2 * kMaxCurvePoints];
+    while (true) {
+      while (*v == ' ' || *v == ',') ++v;
+      if (*v == ']') break;
+      if (count == 2 * kMaxCurvePoints || !read_int(v, &values[count])) {
+        *error = "\"pts\": up to 8 in,out pairs";
+        return true;
+      }
+      ++count;
+      while (*v == '-' || (*v >= '0' && *v <= '9') || *v == ' ') ++v;
+    }
+    if (count < 4 || count % 2 != 0) {
+      *error = "\"pts\": at least 2 in,out pairs";
+      return true;
+    }
+    for (uint8_t p = 0; p < count / 2; ++p) {
+      long in = values[2 * p];
+      long o = values[2 * p + 1];
+      if (in < 0 || in > 127 || (p > 0 && in <= s.point_in[p - 1]) || o < min_out || o > max_out) {
+        *error = "\"pts\": inputs rising in 0..127, outputs in the destination's range";
+        return true;
+      }
+      s.point_in[p] = static_cast<uint8_t>(in);
+      s.point_out[p] = static_cast<int16_t>(o);
+    }
+    s.point_count = static_cast<uint8_t>(count / 2);
+    s.shape = CurveShape::Points;
+  } else if (s.shape == CurveShape::Points) {
+    *error = "\"curve\":\"pts\" needs \"pts\":[in,out,...]";
+    return true;
+  }
+  *out = s;
+  return true;
+}
+
+uint16_t format_route_spec(const RouteSpec& s, char* out) {
+  int n = snprintf(out, kRouteJsonMax, "{\"route\":{\"on\":\"%s\",\"in\":\"%s\",\"to\":\"%s\"",
+                   route_trigger_name(s.trigger), route_input_name(s.input), route_dest_name(s.dest));
+  if (s.dest == RouteDest::Cc) {
+    n += snprintf(out + n, kRouteJsonMax - n, ",\"cc\":%d", s.param);
+  } else if ((s.dest == RouteDest::Note || s.dest == RouteDest::Grain) && s.param != 0) {
+    n += snprintf(out + n, kRouteJsonMax - n, ",\"tr\":%d", s.param);
+  }
+  n += snprintf(out + n, kRouteJsonMax - n, ",\"curve\":\"%s\"", curve_shape_name(s.shape));
+  if (s.shape == CurveShape::Points) {
+    n += snprintf(out + n, kRouteJsonMax - n, ",\"pts\":[");
+    for (uint8_t p = 0; p < s.point_count; ++p) {
+      n += snprintf(out + n, kRouteJsonMax - n, "%s%d,%d", p ? "," : "", s.point_in[p], s.point_out[p]);
+    }
+    n += snprintf(out + n, kRouteJsonMax - n, "]}}");
+    return static_cast<uint16_t>(n);
+  }
+  if (s.shape == CurveShape::Exp || s.shape == CurveShape::Log) {
+    // Hundredths by hand: not every board's printf does %f.
+    int k100 = static_cast<int>(lroundf(s.k * 100.0f));
+    n += snprintf(out + n, kRouteJsonMax - n, ",\"k\":%d.%02d", k100 / 100, k100 % 100);
+  }
+  if (s.shape != CurveShape::Const) n += snprintf(out + n, kRouteJsonMax - n, ",\"lo\":%d", s.lo);
+  n += snprintf(out + n, kRouteJsonMax - n, ",\"hi\":%d}}", s.hi);
+  return static_cast<uint16_t>(n);
+}
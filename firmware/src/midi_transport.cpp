@@ -0,0 +1,156 @@
+#include "midi_transport.h"
+
+#include <string.h>
+
+static_assert((MidiQueue::kCapacity & (MidiQueue::kCapacity - 1)) == 0, "MidiQueue capacity must be a power of two");
+static_assert(256 % MidiQueue::kCapacity == 0, "uint8_t indices must wrap on a slot boundary");
+static_assert((LineQueue::kCapacity & (LineQueue::kCapacity - 1)) == 0, "LineQueue capacity must be a power of two");
+
+namespace {
+bool is_note_off(const MidiMessage& m) {
+  return m.type() == kMidiNoteOff || (m.type() == kMidiNoteOn && m.data2 == 0);
+}
+}  // namespace
+
+bool MidiQueue::push(const MidiMessage& m) {
+  if (size() >= kCapacity && !(is_note_off(m) && evict_for_note_off())) {
+    ++dropped_;
+    return false;
+  }
+  slots_[head_ % kCapacity] = m;
+  ++head_;
+  return true;
+}
+
+// Removes the newest continuous message, else the newest NoteOn, closing the
+// gap; the victim is what gets counted as dropped. Only runs when full.
+bool MidiQueue::evict_for_note_off() {
+  uint8_t victim = head_;
+  for (uint8_t i = head_; i != tail_;) {
+    --i;
+    uint8_t type = slots_[i % kCapacity].type();
+    if (type != kMidiNoteOn && type != kMidiNoteOff) {
+      victim = i;
+      break;
+    }
+  }
+  if (victim == head_) {
+    for (uint8_t i = head_; i != tail_;) {
+      --i;
+      if (!is_note_off(slots_[i % kCapacity])) {
+        victim = i;
+        break;
+      }
+    }
+  }
+  if (victim == head_) return false;  // all note-offs: the new one is the one to lose
+  for (uint8_t i = victim; static_cast<uint8_t>(i + 1) != head_; ++i) {
+    slots_[i % kCapacity] = slots_[static_cast<uint8_t>(i + 1) % kCapacity];
+  }
+  --head_;
+  ++dropped_;
+  return true;
+}
+
+void MidiQueueSink::put(uint8_t type, uint8_t channel, uint8_t d1, uint8_t d2) {
+  MidiMessage m;
+  m.status = static_cast<uint8_t>(type | ((channel - 1) & 0x0F));
+  m.data1 = d1 & 0x7F;
+  m.data2 = d2 & 0x7F;
+  q_.push(m);
+}
+
+void MidiQueueSink::note_on(uint8_t note, uint8_t velocity, uint8_t channel) {
+  put(kMidiNoteOn, channel, note, velocity);
+}
+
+void MidiQueueSink::note_off(uint8_t note, uint8_t velocity, uint8_t channel) {
+  put(kMidiNoteOff, channel, note, velocity);
+}
+
+void MidiQueueSink::control_change(uint8_t number, uint8_t value, uint8_t channel) {
+  put(kMidiControlChange, channel, number, value);
+}
+
+void MidiQueueSink::pitch_bend(int16_t bend, uint8_t channel) {
+  int v = bend + 8192;
+  v = v < 0 ? 0 : (v > 16383 ? 16383 : v);
+  put(kMidiPitchBend, channel, static_cast<uint8_t>(v & 0x7F), static_cast<uint8_t>(v >> 7));
+}
+
+void MidiQueueSink::channel_pressure(uint8_t pressure, uint8_t channel) {
+  put(kMidiChannelPressure, channel, pressure, 0);
+}
+
+void LineQueue::put(char c) {
+  if (dropping_) {
+    if (c == '\n') {
+      dropping_ = false;
+      head_ = committed_;
+    }
+    return;
+  }
+  if (head_ - tail_ >= kCapacity) {
+    // No room for the rest of this line: forget what we have of it.
+    dropping_ = c != '\n';
+    head_ = committed_;
+    ++dropped_lines_;
+    return;
+  }
+  buf_[head_ % kCapacity] = c;
+  ++head_;
+  if (c == '\n') committed_ = head_;
+}
+
+size_t LineQueue::peek(const char** data) const {
+  size_t n = committed_ - tail_;
+  size_t start = tail_ % kCapacity;
+  if (start + n > kCapacity) n = kCapacity - start;
+  *data = buf_ + start;
+  return n;
+}
+
+void LineQueue::consume(size_t n) {
+  size_t avail = committed_ - tail_;
+  tail_ += n < avail ? n : avail;
+}
+
+void TransportPump::pump() {
+  // A line the port took part of goes out whole before any MIDI byte can.
+  if (mid_line_ && midi_port_.shares_text_port() && !write_text(true)) return;
+
+  while (const MidiMessage* m = midi_.front()) {
+    if (!midi_port_.send(*m)) break;
+    midi_.pop();
+  }
+  midi_port_.flush();
+  // A note still waiting means the wire is busy; text must not take its place.
+  if (!midi_.empty()) return;
+  write_text(false);
+}
+
+// As much committed text as the port takes, or only up to the end of the
+// current line. True when no line is left half-written.
+bool TransportPump::write_text(bool to_line_end) {
+  // Two peeks cover the ring's wrap point.
+  for (int pass = 0; pass < 2; ++pass) {
+    size_t room = text_port_.writable();
+    if (room == 0) break;
+    const char* data = nullptr;
+    size_t n = text_.peek(&data);
+    if (n == 0) break;
+    bool line_ends = false;
+    if (to_line_end) {
+      if (const char* nl = static_cast<const char*>(memchr(data, '\n', n))) {
+        n = static_cast<size_t>(nl - data) + 1;
+        line_ends = true;
+      }
+    }
+    if (n > room) n = room;
+    size_t wrote = text_port_.write(data, n);
+    text_.consume(wrote);
+    if (wrote > 0) mid_line_ = data[wrote - 1] != '\n';
+    if (wrote < n || (line_ends && !mid_line_)) break;
+  }
+  return !mid_line_;
+}
@@ -1,3 +1,4 @@
+#include "analog_input.h"
 #include "sensor.h"
 
 #ifdef SENSOR_OPTICAL
@@ -10,36 +11,49 @@ class OpticalSensor : public Sensor {
     pinMode(13, OUTPUT);   // onboard LED for heartbeat
   }
 
+  // Reported pre-smoothing, so it slightly overstates the envelope's noise:
+  // the safe direction for a threshold.
+  float noise_floor() const override { return ambient_floor_.sigma() * gain_; }
+  float rise_tau_us() const override { return env_.tau_us(); }
+
   SensorSample read() override {
     // Expected signal range: analog 0..1023 from a phototransistor divider.
     // If you see 0 or 1023 all the time, check wiring and whether the sensor is saturated.
-    int raw = analogRead(A0);  // 0..1023 on Teensy (will be 12-bit on some MCUs)
+    uint32_t now = micros();
+    int raw = analog_input(A0);  // 0..1023 on every MCU (scanned if built with ADC_SCAN)
     float x = constrain(raw / 1023.0f, 0.0f, 1.0f);
 
     // Ambient light baseline: follow slow changes in the room without chasing the hand.
-    if (x < ambient_floor_) {
-      ambient_floor_ = 0.95f * ambient_floor_ + 0.05f * x;  // drop quickly if the room gets darker
-    } else {
-      ambient_floor_ = 0.995f * ambient_floor_ + 0.005f * x;  // rise slowly so hands don't become "baseline"
-    }
+    // Drops quickly if the room gets darker, rises slowly (and only within the
+    // measured flicker) so hands don't become "baseline".
+    float delta = ambient_floor_.update(x);
 
     // Normalize: subtract the ambient floor, overdrive slightly for expressive motion.
-    float normalized = (x - ambient_floor_) * gain_;
+    float normalized = delta * gain_;
     normalized = constrain(normalized, 0.0f, 1.0f);
 
     // Low-pass smoothing to tame flicker without erasing intentional motion.
-    env_ = 0.9f * env_ + 0.1f * normalized;
+    // A time constant, not a per-loop blend: a faster loop keeps the same feel.
+    float env = env_.update(normalized, now);
 
     // Common failure modes: sunlight swamping the sensor, reflective surfaces
     // causing false positives, or the emitter LED wired backward (flatline).
     digitalWrite(13, (millis() >> 6) & 1);  // slow blink to show life
-    return {env_, micros()};
+    return {env, now};
   }
 
  private:
-  float ambient_floor_ = 0.0f;
-  float env_ = 0.0f;
+  BaselineTracker ambient_floor_{make_ambient_config()};
+  OnePole env_{9500.0f};     // 9.5 ms: the old 0.9/0.1 blend at a 1 kHz loop
   const float gain_ = 1.4f;  // bump for low-contrast rooms; adjust in class
+
+  static BaselineConfig make_ambient_config() {
+    BaselineConfig c;
+    c.rate = 0.005f;       // rise slowly
+    c.fall_rate = 0.05f;   // drop quickly
+    c.gate_below = false;  // a darker room is never a hand
+    return c;
+  }
 };
 
 Sensor& get_optical_sensor() {
@@ -1,5 +1,6 @@
 #include <math.h>
 
+#include "analog_input.h"
 #include "sensor.h"
 
 #ifdef SENSOR_PIEZO
@@ -9,23 +10,81 @@ class PiezoSensor : public Sensor {
   void begin() override {
     pinMode(A3, INPUT);
     pinMode(13, OUTPUT);  // re-use the onboard LED to show when peaks land
+    bias_.seed(0.5f);     // mid-rail estimate in normalized units
   }
 
+  float noise_floor() const override { return bias_.sigma() * kSwingGain; }
+  // Hits are short; averaging them down to the gesture rate would shave them off.
+  DecimateMode decimate_mode() const override { return DecimateMode::Peak; }
+
   SensorSample read() override {
-    static float bias = 0.5f;  // mid-rail estimate in normalized units
+    // With -D ADC_SCAN the piezo hears every conversion since the last read, not
+    // just whatever sat on the pin when loop() came around: a 1 ms click between
+    // two slow loops still lands as a peak, stamped when it happened.
+    AdcScanner* scan = analog_scanner();
+    if (scan && scan->channel_of(A3) >= 0) {
+      AdcBlock block;
+      bool fresh = false;
+      float peak = 0.0f;
+      uint32_t stamp = 0;
+      while (analog_read_block(A3, &block)) {
+        for (uint16_t i = 0; i < block.count; ++i) {
+          float env = swing_to_env(bias_.update(normalize(block.samples[i])));
+          uint32_t t = block.stamps[i];
+          if (!fresh || env > peak) {
+            peak = env;
+            stamp = t;
+          }
+          fresh = true;
+        }
+      }
+      if (fresh) return light_and_return(peak, stamp);
+      // Between blocks: peek at the newest conversion without feeding the bias
+      // twice (the block pass above will see it again). Stamped from the scan's
+      // clock like the blocks, not from micros().
+      uint32_t t = 0;
+      float env = swing_to_env(normalize(analog_input(A3, &t)) - bias_.mean());
+      return light_and_return(env, t);
+    }
+
     // Expected signal range: biased piezo swing around mid-rail, sampled as 0..1023.
     // If raw slams 0/1023, check your clamp diodes and that the piezo isn't floating.
-    int raw = analogRead(A3);
+    int raw = analog_input(A3);
     // Normalization behavior: scale ADC to 0..1, subtract a slow bias, then magnify
     // the swing into a 0..1 envelope that behaves like "hit energy."
-    float x = constrain(raw / 1023.0f, 0.0f, 1.0f);
-    bias = 0.999f * bias + 0.001f * x;  // slow bias tracker; tweak in calibration session
-    float swing = fabs(x - bias) * 2.2f;  // exaggerate small hits; clip later
-    float env = constrain(swing, 0.0f, 1.0f);
-    digitalWrite(13, env > 0.4f);  // punk-rock peak lamp
+    // Slow bias tracker; tweak in calibration session. Hits land far outside the
+    // noise gate, so a drum roll no longer drags the bias toward the rail.
+    float env = swing_to_env(bias_.update(normalize(raw)));
     // Common failure modes: cracked piezo disks (no response), mechanical mounting
     // that damps transients, or missing bias resistor so the ADC sees a floating pin.
-    return {env, micros()};
+    return light_and_return(env, micros());
+  }
+
+ private:
+  static constexpr float kSwingGain = 2.2f;  // exaggerate small hits; clip later
+
+  BaselineTracker bias_{make_bias_config()};
+  uint32_t last_stamp_ = 0;
+  bool have_stamp_ = false;
+
+  static float normalize(int raw) { return constrain(raw / 1023.0f, 0.0f, 1.0f); }
+  static float swing_to_env(float deviation) { return constrain(fabs(deviation) * kSwingGain, 0.0f, 1.0f); }
+
+  SensorSample light_and_return(float env, uint32_t stamp) {
+    digitalWrite(13, env > 0.4f);  // punk-rock peak lamp
+    // A block's peak can predate the newest conversion a between-blocks peek
+    // already reported; hold time still rather than let the engine see it
+    // run backwards.
+    if (have_stamp_ && static_cast<int32_t>(stamp - last_stamp_) < 0) stamp = last_stamp_;
+    last_stamp_ = stamp;
+    have_stamp_ = true;
+    return {env, stamp};
+  }
+
+  static BaselineConfig make_bias_config() {
+    BaselineConfig c;
+    c.rate = 0.001f;
+    return c;
   }
 };
 
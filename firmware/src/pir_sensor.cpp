@@ -1,49 +1,66 @@
+#include "gate_envelope.h"
 #include "sensor.h"
 
 #ifdef SENSOR_PIR
 
+namespace {
+const uint8_t kPirPin = 4;  // must be interrupt-capable (any digital pin on Teensy 4.x / ESP32-S3)
+EdgeRing g_edges;
+
+// Pin-change ISR: stamp the edge and leave. The envelope math happens later,
+// only when somebody asks for a sample.
+void pir_edge_isr() { g_edges.push(micros(), digitalRead(kPirPin) == HIGH); }
+}  // namespace
+
 class PirSensor : public Sensor {
  public:
   void begin() override {
     pinMode(kPirPin, INPUT);  // many PIR boards expose a digital gate; some are 3.3 V only
     warmup_start_ms_ = millis();
+    attachInterrupt(digitalPinToInterrupt(kPirPin), pir_edge_isr, CHANGE);
   }
 
   SensorSample read() override {
     uint32_t now_us = micros();
+    GateEdge e;
     if (!warmed_up()) {
-      // Most PIRs need 10–30 seconds to stabilize; keep the plot calm until then.
-      last_sample_ = {0.0f, now_us};
-      return last_sample_;
+      // Most PIRs need 10–30 seconds to stabilize; keep the plot calm until then
+      // and throw away the edges the settling comparator produces.
+      while (g_edges.pop(&e)) {
+      }
+      g_edges.take_overflow();
+      armed_ = false;
+      return {0.0f, now_us};
+    }
+    if (!armed_) {
+      env_.reset(digitalRead(kPirPin) == HIGH, now_us);
+      armed_ = true;
     }
 
-    // Expected signal range: digital HIGH/LOW gate from the PIR comparator.
-    bool raw_motion = digitalRead(kPirPin) == HIGH;
-    float x = raw_motion ? 1.0f : 0.0f;
-    // Normalization behavior: convert the binary gate into a smoothed 0..1 envelope so
-    // gestures feel like motion energy rather than a square wave.
-    // Exponential decay so a single person pass shows as a hill, not a square wave.
-    env_ = 0.92f * env_ + 0.08f * x;
-    // Guard window to avoid rapid re-triggers from onboard comparators that chatter.
-    if (now_us - last_read_us_ < guard_us_) return last_sample_;
-    last_read_us_ = now_us;
+    // Expected signal range: digital HIGH/LOW gate from the PIR comparator,
+    // arriving here as timestamped edges.
+    while (g_edges.pop(&e)) env_.edge(e.level, e.stamp_us);
+    // Edges were lost (ring full): trust the pin as it is now.
+    if (g_edges.take_overflow()) env_.edge(digitalRead(kPirPin) == HIGH, now_us);
 
+    // Normalization behavior: the binary gate becomes a smoothed 0..1 envelope so
+    // gestures feel like motion energy rather than a square wave. Quick rise,
+    // slow fall, so a single person pass shows as a hill. The 20 ms holdoff
+    // swallows comparator chatter at the edge itself instead of rate-limiting
+    // the output.
     // Common failure modes: powering a 3.3 V-only PIR from 5 V (stuck high),
     // heat vents/sunlight causing false triggers, or mounting aimed at the floor
     // so it never sees lateral motion.
-    last_sample_ = {env_, now_us};
-    return last_sample_;
+    return {env_.value_at(now_us), now_us};
   }
 
  private:
-  static const uint8_t kPirPin = 4;    // swap per build; keep on an interrupt-capable pin if you later move to ISRs
-  const uint32_t warmup_ms_ = 30000;   // adjust if your module stabilizes faster/slower
-  const uint32_t guard_us_ = 20000;    // 20 ms to smooth comparator chatter
+  const uint32_t warmup_ms_ = 30000;  // adjust if your module stabilizes faster/slower
 
   uint32_t warmup_start_ms_ = 0;
-  float env_ = 0.0f;
-  uint32_t last_read_us_ = 0;
-  SensorSample last_sample_{0.0f, 0};
+  bool armed_ = false;
+  // attack 50 ms, release 300 ms, 20 ms chatter holdoff
+  GateEnvelope env_{50000.0f, 300000.0f, 20000};
 
   bool warmed_up() const { return (millis() - warmup_start_ms_) > warmup_ms_; }
 };
@@ -2,21 +2,18 @@
 
 #include <Arduino.h>
 
+#include "baseline_tracker.h"
+#include "sensor_sample.h"
+#include "signal_filters.h"
+
 // ---- Compile-time selection of sensing path ---------------------------------
 // Define exactly one of these in platformio.ini build_flags, e.g. -D SENSOR_OPTICAL
 #if !defined(SENSOR_OPTICAL) && !defined(SENSOR_CAPACITIVE) && !defined(SENSOR_MAKEY) && !defined(SENSOR_TOF) && \
-    !defined(SENSOR_PIEZO) && !defined(SENSOR_PIR) && !defined(SENSOR_ELECTRET) && !defined(SENSOR_I2S_MIC)
+    !defined(SENSOR_PIEZO) && !defined(SENSOR_PIR) && !defined(SENSOR_ELECTRET) && !defined(SENSOR_I2S_MIC) && \
+    !defined(SENSOR_CAPACITIVE_ASYNC)
   #define SENSOR_OPTICAL 1  // default demo; explicitly include new options above
 #endif
 
-/**
- * A single sensor reading with the two pieces of data the gesture engine needs.
- */
-struct SensorSample {
-  float value;
-  uint32_t micros;
-};
-
 /**
  * Abstract sensing interface. The firmware intentionally hides the details of
  * which physical stack is active so students can swap implementations without
@@ -26,6 +23,26 @@ class Sensor {
  public:
   virtual void begin() = 0;
   virtual SensorSample read() = 0;
+  // Measured noise σ in normalized 0..1 units. Sensors with a BaselineTracker
+  // report it so GestureEngine can set thresholds in noise units; 0 = unknown.
+  virtual float noise_floor() const { return 0.0f; }
+  // How loop() should thin this sensor's samples down to the gesture rate
+  // (see Decimator). Smooth envelopes average; percussive ones keep peaks.
+  virtual DecimateMode decimate_mode() const { return DecimateMode::Mean; }
+  // Time constant (µs) of the low-pass on read()'s output. It bounds how fast
+  // the output can climb, which is what lets IdlePolicy doze without missing
+  // an onset. 0 = the output can jump in one sample (piezo, pads, pins, and
+  // anything Peak-decimated), and the board never dozes on it.
+  virtual float rise_tau_us() const { return 0.0f; }
+
+  // Multi-pad / multi-string stacks expose each channel; read() then reports
+  // the one the single-lane gesture engine should hear. channel_sample() only
+  // returns what was last acquired—it never starts a measurement.
+  virtual uint8_t channel_count() const { return 1; }
+  virtual SensorSample channel_sample(uint8_t channel) const {
+    (void)channel;
+    return {0.0f, 0};
+  }
   virtual ~Sensor() {}
 };
 
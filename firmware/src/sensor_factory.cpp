@@ -16,6 +16,8 @@ Sensor& get_pir_sensor();
 Sensor& get_electret_sensor();
 #elif defined(SENSOR_I2S_MIC)
 Sensor& get_i2s_mic_sensor();
+#elif defined(SENSOR_CAPACITIVE_ASYNC)
+Sensor& get_capacitive_async_sensor();
 #endif
 
 Sensor* make_sensor() {
@@ -35,6 +37,8 @@ Sensor* make_sensor() {
   return &get_electret_sensor();
 #elif defined(SENSOR_I2S_MIC)
   return &get_i2s_mic_sensor();
+#elif defined(SENSOR_CAPACITIVE_ASYNC)
+  return &get_capacitive_async_sensor();
 #else
   return nullptr;
 #endif
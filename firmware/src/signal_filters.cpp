@@ -0,0 +1,75 @@
+#include "signal_filters.h"
+
+#include <cmath>
+
+float OnePole::update(float x, uint32_t now_us) {
+  if (!started_) {
+    // Nothing to measure dt against yet; start the clock without moving.
+    started_ = true;
+    last_us_ = now_us;
+    return y_;
+  }
+  uint32_t dt = now_us - last_us_;
+  last_us_ = now_us;
+  if (tau_us_ <= 0.0f) {
+    y_ = x;
+  } else if (dt > 0) {
+    float a = 1.0f - std::exp(-static_cast<float>(dt) / tau_us_);
+    y_ += a * (x - y_);
+  }
+  return y_;
+}
+
+void OnePole::reset(float x, uint32_t now_us) {
+  y_ = x;
+  last_us_ = now_us;
+  started_ = true;
+}
+
+bool Decimator::push(const SensorSample& in, SensorSample* out) {
+  if (period_us_ == 0) {
+    *out = in;
+    return true;
+  }
+  if (!started_) {
+    started_ = true;
+    bin_start_us_ = in.micros;
+    area_ = 0.0f;
+    held_ = in.value;
+    held_us_ = in.micros;
+    peak_ = in.value;
+    peak_us_ = in.micros;
+    return false;
+  }
+
+  uint32_t into_bin = in.micros - bin_start_us_;
+  if (into_bin < period_us_) {
+    area_ += held_ * static_cast<float>(in.micros - held_us_);
+    held_ = in.value;
+    held_us_ = in.micros;
+    if (in.value > peak_) {
+      peak_ = in.value;
+      peak_us_ = in.micros;
+    }
+    return false;
+  }
+
+  // This sample is past the period's end: close it out.
+  uint32_t bin_end = bin_start_us_ + period_us_;
+  if (mode_ == DecimateMode::Mean) {
+    area_ += held_ * static_cast<float>(bin_end - held_us_);
+    *out = {area_ / static_cast<float>(period_us_), bin_end};
+  } else {
+    *out = {peak_, peak_us_};
+  }
+
+  // Start the period this sample falls in. After a stall, the periods in
+  // between are skipped rather than replayed as stale copies.
+  bin_start_us_ += (into_bin / period_us_) * period_us_;
+  area_ = held_ * static_cast<float>(in.micros - bin_start_us_);
+  held_ = in.value;
+  held_us_ = in.micros;
+  peak_ = in.value;
+  peak_us_ = in.micros;
+  return true;
+}
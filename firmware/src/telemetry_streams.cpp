@@ -0,0 +1,88 @@
+#include "telemetry_streams.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+// Command names, in TelemetryStream order.
+const char* const kNames[kStreamCount] = {"gestures", "raw", "env", "latency", "engine"};
+}  // namespace
+
+TelemetryStreams::TelemetryStreams() {
+  for (uint8_t i = 0; i < kStreamCount; ++i) {
+    max_hz_[i] = 0;
+    period_us_[i] = 0;
+    last_us_[i] = 0;
+    sent_once_[i] = false;
+  }
+  subscribe(TelemetryStream::Gestures, 0);  // what every host got before subscriptions existed
+}
+
+const char* TelemetryStreams::name(TelemetryStream s) { return kNames[static_cast<uint8_t>(s)]; }
+
+void TelemetryStreams::subscribe(TelemetryStream s, uint16_t max_hz) {
+  uint8_t i = static_cast<uint8_t>(s);
+  mask_ |= static_cast<uint8_t>(1u << i);
+  max_hz_[i] = max_hz;
+  period_us_[i] = max_hz ? 1000000UL / max_hz : 0;
+  sent_once_[i] = false;  // the first line after (re)subscribing goes out at once
+}
+
+void TelemetryStreams::unsubscribe(TelemetryStream s) {
+  uint8_t i = static_cast<uint8_t>(s);
+  mask_ &= static_cast<uint8_t>(~(1u << i));
+  max_hz_[i] = 0;
+}
+
+bool TelemetryStreams::take(uint8_t i, uint32_t now_us) {
+  if (period_us_[i] != 0 && sent_once_[i] && now_us - last_us_[i] < period_us_[i]) return false;
+  sent_once_[i] = true;
+  last_us_[i] = now_us;
+  return true;
+}
+
+bool TelemetryStreams::apply_command(const char* line) {
+  const char* key = line ? strstr(line, "\"sub\"") : nullptr;
+  if (!key) return false;
+  const char* colon = strchr(key, ':');
+  if (!colon) return true;
+  const char* body = colon + 1;
+  while (*body == ' ' || *body == '\t') ++body;
+  if (strncmp(body, "\"none\"", 6) == 0) {
+    for (uint8_t i = 0; i < kStreamCount; ++i) unsubscribe(static_cast<TelemetryStream>(i));
+    return true;
+  }
+  if (*body != '{') return true;  // {"sub":"?"} and friends: report only
+  const char* end = strchr(body, '}');
+  for (uint8_t i = 0; i < kStreamCount; ++i) {
+    // Look for "name": inside the braces; a name nobody sent keeps its setting.
+    char quoted[16];
+    size_t n = strlen(kNames[i]);
+    quoted[0] = '"';
+    memcpy(quoted + 1, kNames[i], n);
+    quoted[n + 1] = '"';
+    quoted[n + 2] = '\0';
+    const char* at = strstr(body, quoted);
+    if (!at || (end && at > end)) continue;
+    const char* v = strchr(at + n + 2, ':');
+    if (!v) continue;
+    ++v;
+    while (*v == ' ' || *v == '\t') ++v;
+    TelemetryStream s = static_cast<TelemetryStream>(i);
+    if (strncmp(v, "true", 4) == 0) {
+      subscribe(s, 0);
+    } else if (strncmp(v, "false", 5) == 0) {
+      unsubscribe(s);
+    } else {
+      char* num_end = nullptr;
+      long hz = strtol(v, &num_end, 10);
+      if (num_end == v || hz < 0) continue;  // not a number: ignore rather than guess
+      if (hz == 0) {
+        unsubscribe(s);
+      } else {
+        subscribe(s, static_cast<uint16_t>(hz > 65535 ? 65535 : hz));
+      }
+    }
+  }
+  return true;
+}
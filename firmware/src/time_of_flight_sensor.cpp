@@ -1,39 +1,157 @@
+#include "analog_input.h"
 #include "sensor.h"
 
 #ifdef SENSOR_TOF
 
+#if defined(TOF_I2C)
+#include "i2c_bus_hw.h"
+#include "vl53l0x.h"
+
+// ---- Real VL53L0X parts over I²C (-D TOF_I2C) -------------------------------
+// One or more sensors on SDA/SCL, each with its own XSHUT line so they can be
+// woken one at a time and moved to their own address. Ranging is continuous;
+// read() never touches the bus synchronously, it steps the driver state
+// machines and reports the newest millimetre reading mapped to 0..1.
+
+#ifndef TOF_XSHUT_PINS
+#define TOF_XSHUT_PINS 2  // comma-separated, one per sensor, e.g. -D TOF_XSHUT_PINS=2,3,4
+#endif
+#ifndef TOF_NEAR_MM
+#define TOF_NEAR_MM 40    // hand this close reads 1.0
+#endif
+#ifndef TOF_FAR_MM
+#define TOF_FAR_MM 400    // this far (or nothing in range) reads 0.0
+#endif
+
+namespace {
+const uint8_t kXshutPins[] = {TOF_XSHUT_PINS};
+const uint8_t kSensorCount = sizeof(kXshutPins);
+const uint8_t kFirstAddress = 0x30;
+static_assert(kSensorCount <= TofArray::kMaxSensors, "more XSHUT pins than TofArray supports");
+
+ArduinoGpio g_gpio;
+TofArray* g_array = nullptr;
+
+#ifdef TOF_READY_PINS
+// Optional GPIO1 lines (active low, "new sample ready"), same order as XSHUT.
+// With them wired the stamp is the interrupt time and no status polls go out.
+const uint8_t kReadyPins[] = {TOF_READY_PINS};
+static_assert(sizeof(kReadyPins) == kSensorCount, "TOF_READY_PINS needs one pin per sensor");
+
+template <uint8_t I>
+void ready_isr() {
+  if (g_array) g_array->sensor(I).notify_data_ready(micros());
+}
+
+typedef void (*ReadyIsr)();
+const ReadyIsr kReadyIsrs[] = {ready_isr<0>, ready_isr<1>, ready_isr<2>, ready_isr<3>};
+#endif
+}  // namespace
+
 class TimeOfFlightSensor : public Sensor {
  public:
   void begin() override {
-    // Pin/PWR notes: real ToF breakouts (VL53L0X, TMF8801, etc.) use I2C. Here we
-    // map the analog envelope from a helper board onto A2 to keep the demo
-    // solderable and readable in-class. Swap the pin when moving to a true I2C
-    // driver; keep the function shape identical so GestureEngine stays agnostic.
+    hardware_i2c_begin(400000);
+    static TofArray array(hardware_i2c_bus(), g_gpio);
+    for (uint8_t i = 0; i < kSensorCount; ++i) {
+      pinMode(kXshutPins[i], OUTPUT);
+      array.add(kXshutPins[i], kFirstAddress + i);
+#ifdef TOF_READY_PINS
+      pinMode(kReadyPins[i], INPUT_PULLUP);
+      array.sensor(i).use_data_ready_pin(true);
+      attachInterrupt(digitalPinToInterrupt(kReadyPins[i]), kReadyIsrs[i], FALLING);
+#endif
+    }
+    g_array = &array;
+    array.begin(micros());
+  }
+
+  SensorSample read() override {
+    // A few microseconds: harvest finished transfers, start the next ones.
+    g_array->step(micros());
+
+    for (uint8_t i = 0; i < kSensorCount; ++i) {
+      TofReading r;
+      if (!g_array->sensor(i).take(&r)) continue;
+      // Normalization behavior: nearer = bigger, so a hand diving in reads like
+      // a pluck. Readings arrive at ~33 Hz, so the smoothing is lighter than
+      // the analog path's per-loop filter.
+      float x = mm_to_unit(r.mm);
+      lanes_[i].value = 0.6f * lanes_[i].value + 0.4f * x;
+      if (lanes_[i].value < 0.02f) lanes_[i].value = 0.0f;
+      lanes_[i].micros = r.stamp_us;  // when the part said "ready", not when we looked
+    }
+
+    // The single-lane gesture engine hears whichever sensor sees the nearest hand.
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < kSensorCount; ++i) {
+      if (lanes_[i].value > lanes_[best].value) best = i;
+    }
+    // Common failure modes: a sensor stuck in Failed (XSHUT miswired, two parts
+    // sharing one XSHUT, missing pullups on SDA/SCL) simply never updates its lane.
+    return lanes_[best];
+  }
+
+  uint8_t channel_count() const override { return kSensorCount; }
+  SensorSample channel_sample(uint8_t channel) const override {
+    return channel < kSensorCount ? lanes_[channel] : SensorSample{0.0f, 0};
+  }
+
+ private:
+  SensorSample lanes_[kSensorCount] = {};
+
+  static float mm_to_unit(uint16_t mm) {
+    if (mm >= TOF_FAR_MM) return 0.0f;  // also covers 8190/8191 "nothing in range"
+    if (mm <= TOF_NEAR_MM) return 1.0f;
+    return (TOF_FAR_MM - mm) / float(TOF_FAR_MM - TOF_NEAR_MM);
+  }
+};
+
+#else  // analog helper board
+
+class TimeOfFlightSensor : public Sensor {
+ public:
+  void begin() override {
+    // Pin/PWR notes: real ToF breakouts (VL53L0X, TMF8801, etc.) use I2C—build
+    // with -D TOF_I2C for the real driver (vl53l0x.cpp). Here we map the analog
+    // envelope from a helper board onto A2 to keep the demo solderable and
+    // readable in-class. Both paths share the function shape so GestureEngine
+    // stays agnostic.
     pinMode(A2, INPUT);
   }
 
+  float rise_tau_us() const override { return y_.tau_us(); }
+
   SensorSample read() override {
-    // Expected signal range: analog envelope 0..1023 from an external ToF helper
-    // (or later: millimeters via I2C). If you see rails at 0/1023, check wiring
-    // and whether the sensor is saturating in sunlight.
-    int raw = analogRead(A2);  // e.g., 0..1023. Replace with mm reading / 4096.0 for I2C parts.
+    // Expected signal range: analog envelope 0..1023 from an external ToF helper.
+    // If you see rails at 0/1023, check wiring and whether the sensor is
+    // saturating in sunlight.
+    uint32_t now = micros();
+    int raw = analog_input(A2);
     // Calibrate like a lab notebook: expose the bias and smoothing knobs. Students
     // can anchor a “hand at 15 cm” pose and tune the filter and scaling live.
-    static float y = 0.0f;
     // Normalization behavior: map raw ADC to 0..1 so gesture logic stays sensor-agnostic,
     // then low-pass to smooth jitter without erasing quick dips.
     float x = constrain(raw / 1023.0f, 0.0f, 1.0f);
-    y = 0.85f * y + 0.15f * x;  // slightly faster than optical to catch hand waves
+    float y = y_.update(x, now);  // slightly faster than optical to catch hand waves
     // Cheap floor clamp for noisy rooms; edit in class if your sensor never
     // truly rests at 0.0 while idle.
-    if (y < 0.02f) y = 0.0f;
+    if (y < 0.02f) {
+      y = 0.0f;
+      y_.reset(0.0f, now);
+    }
     // Common failure modes: ambient IR swamping the receiver (always high),
     // over-aggressive RC filtering (sluggish bow response), or A2 floating
     // because the analog helper board isn't powered.
-    return {y, micros()};
+    return {y, now};
   }
+
+ private:
+  OnePole y_{6200.0f};  // 6.2 ms: the old 0.85/0.15 blend at a 1 kHz loop
 };
 
+#endif  // TOF_I2C
+
 Sensor& get_time_of_flight_sensor() {
   static TimeOfFlightSensor sensor_impl;
   return sensor_impl;
@@ -0,0 +1,354 @@
+#include "vl53l0x.h"
+
+// Register names follow ST's API headers so the sequence can be checked line by
+// line against the datasheet / API source.
+namespace {
+const uint8_t kSysrangeStart = 0x00;
+const uint8_t kSystemInterruptClear = 0x0B;
+const uint8_t kResultInterruptStatus = 0x13;
+const uint8_t kResultRangeMm = 0x14 + 10;
+const uint8_t kI2cSlaveDeviceAddress = 0x8A;
+}  // namespace
+
+// Bring-up is a table, not code: each row is one register operation, run one
+// per bus transaction. Adding ST's tuning writes later means adding rows.
+const Vl53l0x::Op Vl53l0x::kBringUp[] = {
+    {OpKind::DelayUs, 0, 2000},        // tBOOT is 1.2 ms max after XSHUT rises
+    {OpKind::Expect, 0xC0, 0xEE},      // IDENTIFICATION_MODEL_ID: is anybody there?
+    {OpKind::SetAddress, kI2cSlaveDeviceAddress, 0},
+    {OpKind::Or8, 0x89, 0x01},         // VHV_CONFIG_PAD_SCL_SDA__EXTSUP_HV: 2V8 I/O
+    {OpKind::W8, 0x88, 0x00},          // standard I²C mode
+    {OpKind::W8, 0x80, 0x01},
+    {OpKind::W8, 0xFF, 0x01},
+    {OpKind::W8, 0x00, 0x00},
+    {OpKind::SaveStop, 0x91, 0},       // "stop variable", restored before every start
+    {OpKind::W8, 0x00, 0x01},
+    {OpKind::W8, 0xFF, 0x00},
+    {OpKind::W8, 0x80, 0x00},
+    {OpKind::Or8, 0x60, 0x12},         // MSRC_CONFIG_CONTROL: drop MSRC/pre-range signal checks
+    {OpKind::W16, 0x44, 0x0020},       // final range min count rate: 0.25 MCPS (Q9.7)
+    {OpKind::W8, 0x01, 0xFF},          // SYSTEM_SEQUENCE_CONFIG
+    {OpKind::W8, 0x0A, 0x04},          // SYSTEM_INTERRUPT_CONFIG_GPIO: new sample ready
+    {OpKind::And8, 0x84, 0xEF},        // GPIO_HV_MUX_ACTIVE_HIGH: GPIO1 active low
+    {OpKind::W8, kSystemInterruptClear, 0x01},
+    // Reference calibration: VHV, then phase. Each is a single-shot measurement
+    // we wait on without blocking.
+    {OpKind::W8, 0x01, 0x01},
+    {OpKind::W8, kSysrangeStart, 0x41},
+    {OpKind::WaitReady, kResultInterruptStatus, 0},
+    {OpKind::W8, kSystemInterruptClear, 0x01},
+    {OpKind::W8, kSysrangeStart, 0x00},
+    {OpKind::W8, 0x01, 0x02},
+    {OpKind::W8, kSysrangeStart, 0x01},
+    {OpKind::WaitReady, kResultInterruptStatus, 0},
+    {OpKind::W8, kSystemInterruptClear, 0x01},
+    {OpKind::W8, kSysrangeStart, 0x00},
+    {OpKind::W8, 0x01, 0xE8},          // sequence: DSS, pre-range, final range
+    // Continuous back-to-back ranging.
+    {OpKind::W8, 0x80, 0x01},
+    {OpKind::W8, 0xFF, 0x01},
+    {OpKind::W8, 0x00, 0x00},
+    {OpKind::RestoreStop, 0x91, 0},
+    {OpKind::W8, 0x00, 0x01},
+    {OpKind::W8, 0xFF, 0x00},
+    {OpKind::W8, 0x80, 0x00},
+    {OpKind::W8, kSysrangeStart, 0x02},
+};
+const uint8_t Vl53l0x::kBringUpLen = sizeof(kBringUp) / sizeof(kBringUp[0]);
+
+Vl53l0x::Vl53l0x(I2cBus& bus) : bus_(bus) {}
+
+void Vl53l0x::begin(uint32_t now_us, uint8_t new_address) {
+  state_ = State::BringUp;
+  address_ = kDefaultAddress;
+  target_address_ = new_address & 0x7F;
+  op_ = 0;
+  phase_ = 0;
+  op_start_us_ = now_us;
+  last_poll_us_ = now_us;
+  loop_ = Loop::Wait;
+  ready_flag_ = false;
+  fresh_ = false;
+  in_flight_ = false;
+}
+
+void Vl53l0x::notify_data_ready(uint32_t stamp_us) {
+  ready_stamp_us_ = stamp_us;
+  ready_flag_ = true;
+}
+
+bool Vl53l0x::take(TofReading* out) {
+  if (!fresh_) return false;
+  *out = latest_;
+  fresh_ = false;
+  return true;
+}
+
+void Vl53l0x::step(uint32_t now_us) {
+  if (state_ == State::Off || state_ == State::Failed) return;
+
+  if (in_flight_) {
+    I2cStatus s = txn_.status;
+    if (s == I2cStatus::Pending) {
+      // A wedged bus must not wedge the instrument: give up on this sensor.
+      if (now_us - txn_start_us_ > kTransactionTimeoutUs) fail();
+      return;
+    }
+    in_flight_ = false;
+    if (s != I2cStatus::Done) {
+      fail();
+      return;
+    }
+    if (state_ == State::BringUp) {
+      finish_bring_up_op(now_us);
+    } else {
+      finish_ranging(now_us);
+    }
+    if (state_ == State::Failed) return;
+  }
+
+  // Whatever just finished, try to start the next transaction in the same call.
+  if (state_ == State::BringUp) {
+    run_bring_up(now_us);
+  } else {
+    run_ranging(now_us);
+  }
+}
+
+void Vl53l0x::run_bring_up(uint32_t now_us) {
+  if (op_ >= kBringUpLen) {
+    state_ = State::Ranging;
+    loop_ = Loop::Wait;
+    last_poll_us_ = now_us;
+    return;
+  }
+  const Op& op = kBringUp[op_];
+  switch (op.kind) {
+    case OpKind::DelayUs:
+      if (now_us - op_start_us_ >= op.value) next_op(now_us);
+      return;
+    case OpKind::W8:
+      write8(op.reg, static_cast<uint8_t>(op.value), now_us);
+      return;
+    case OpKind::W16:
+      write16(op.reg, op.value, now_us);
+      return;
+    case OpKind::Or8:
+    case OpKind::And8:
+      if (phase_ == 0) {
+        read(op.reg, 1, now_us);
+      } else {
+        write8(op.reg, scratch_, now_us);
+      }
+      return;
+    case OpKind::SaveStop:
+    case OpKind::Expect:
+      read(op.reg, 1, now_us);
+      return;
+    case OpKind::RestoreStop:
+      write8(op.reg, stop_variable_, now_us);
+      return;
+    case OpKind::WaitReady:
+      if (now_us - op_start_us_ > kReadyTimeoutUs) {
+        fail();
+        return;
+      }
+      // First look right away, then at the poll interval.
+      if (phase_ > 0 && now_us - last_poll_us_ < kPollIntervalUs) return;
+      if (read(op.reg, 1, now_us)) last_poll_us_ = now_us;
+      return;
+    case OpKind::SetAddress:
+      if (target_address_ == address_) {
+        next_op(now_us);
+        return;
+      }
+      write8(op.reg, target_address_, now_us);
+      return;
+  }
+}
+
+void Vl53l0x::finish_bring_up_op(uint32_t now_us) {
+  const Op& op = kBringUp[op_];
+  switch (op.kind) {
+    case OpKind::Or8:
+    case OpKind::And8:
+      if (phase_ == 0) {
+        scratch_ = op.kind == OpKind::Or8 ? static_cast<uint8_t>(rx_[0] | op.value)
+                                          : static_cast<uint8_t>(rx_[0] & op.value);
+        phase_ = 1;
+        return;
+      }
+      break;
+    case OpKind::SaveStop:
+      stop_variable_ = rx_[0];
+      break;
+    case OpKind::Expect:
+      if (rx_[0] != op.value) {
+        fail();
+        return;
+      }
+      break;
+    case OpKind::WaitReady:
+      if ((rx_[0] & 0x07) == 0) {
+        phase_ = 1;  // not yet; poll again later
+        return;
+      }
+      break;
+    case OpKind::SetAddress:
+      address_ = target_address_;
+      break;
+    default:
+      break;
+  }
+  next_op(now_us);
+}
+
+void Vl53l0x::run_ranging(uint32_t now_us) {
+  switch (loop_) {
+    case Loop::Wait:
+      if (use_ready_pin_ && ready_flag_) {
+        // GPIO1 already told us; skip the status read and stamp with the edge.
+        ready_flag_ = false;
+        pending_stamp_us_ = ready_stamp_us_;
+        last_poll_us_ = now_us;  // restarts the missed-edge fallback timer
+        loop_ = Loop::Range;
+        break;
+      }
+      // Without the pin (or if an edge went missing—GPIO1 stays asserted until
+      // cleared, so a lost edge would otherwise stall us forever) poll status.
+      if (now_us - last_poll_us_ < (use_ready_pin_ ? kReadyTimeoutUs : kPollIntervalUs)) return;
+      if (read(kResultInterruptStatus, 1, now_us)) {
+        last_poll_us_ = now_us;
+        loop_ = Loop::Status;
+      }
+      return;
+    case Loop::Status:
+      return;  // only reached while the status read is in flight
+    case Loop::Range:
+    case Loop::Clear:
+      break;
+  }
+  if (loop_ == Loop::Range) {
+    read(kResultRangeMm, 2, now_us);
+  } else {
+    write8(kSystemInterruptClear, 0x01, now_us);
+  }
+}
+
+void Vl53l0x::finish_ranging(uint32_t now_us) {
+  switch (loop_) {
+    case Loop::Status:
+      if (rx_[0] & 0x07) {
+        pending_stamp_us_ = now_us;
+        loop_ = Loop::Range;
+      } else {
+        loop_ = Loop::Wait;
+      }
+      return;
+    case Loop::Range:
+      latest_.mm = static_cast<uint16_t>((rx_[0] << 8) | rx_[1]);
+      latest_.stamp_us = pending_stamp_us_;
+      fresh_ = true;
+      ++readings_;
+      loop_ = Loop::Clear;
+      return;
+    case Loop::Clear:
+      loop_ = Loop::Wait;
+      return;
+    case Loop::Wait:
+      return;
+  }
+}
+
+void Vl53l0x::next_op(uint32_t now_us) {
+  ++op_;
+  phase_ = 0;
+  op_start_us_ = now_us;
+}
+
+void Vl53l0x::fail() {
+  state_ = State::Failed;
+  fresh_ = false;
+}
+
+bool Vl53l0x::write8(uint8_t reg, uint8_t value, uint32_t now_us) {
+  tx_[0] = reg;
+  tx_[1] = value;
+  return issue(2, 0, now_us);
+}
+
+bool Vl53l0x::write16(uint8_t reg, uint16_t value, uint32_t now_us) {
+  tx_[0] = reg;
+  tx_[1] = static_cast<uint8_t>(value >> 8);
+  tx_[2] = static_cast<uint8_t>(value);
+  return issue(3, 0, now_us);
+}
+
+bool Vl53l0x::read(uint8_t reg, uint8_t len, uint32_t now_us) {
+  tx_[0] = reg;
+  return issue(1, len, now_us);
+}
+
+bool Vl53l0x::issue(uint8_t tx_len, uint8_t rx_len, uint32_t now_us) {
+  txn_.address = address_;
+  txn_.tx = tx_;
+  txn_.tx_len = tx_len;
+  txn_.rx = rx_;
+  txn_.rx_len = rx_len;
+  // Busy bus: nothing changes, we simply try again on the next step().
+  if (!bus_.submit(&txn_)) return false;
+  in_flight_ = true;
+  txn_start_us_ = now_us;
+  return true;
+}
+
+// ---- TofArray ---------------------------------------------------------------
+
+static_assert(TofArray::kMaxSensors == 4, "TofArray constructor initializes four sensors");
+
+TofArray::TofArray(I2cBus& bus, GpioOut& gpio)
+    : gpio_(gpio), sensors_{Vl53l0x(bus), Vl53l0x(bus), Vl53l0x(bus), Vl53l0x(bus)} {}
+
+bool TofArray::add(uint8_t xshut_pin, uint8_t address) {
+  if (count_ >= kMaxSensors) return false;
+  xshut_[count_] = xshut_pin;
+  addresses_[count_] = address;
+  ++count_;
+  return true;
+}
+
+void TofArray::begin(uint32_t now_us) {
+  for (uint8_t i = 0; i < count_; ++i) gpio_.write(xshut_[i], false);
+  powered_ = 0;
+  turn_ = 0;
+  reset_us_ = now_us;
+}
+
+void TofArray::step(uint32_t now_us) {
+  if (powered_ < count_) {
+    bool release = false;
+    if (powered_ == 0) {
+      release = now_us - reset_us_ >= kResetHoldUs;
+    } else {
+      Vl53l0x& prev = sensors_[powered_ - 1];
+      if (prev.state() == Vl53l0x::State::Failed && prev.address() == Vl53l0x::kDefaultAddress) {
+        // It never moved off 0x29; hold it in reset so it cannot answer for the next one.
+        gpio_.write(xshut_[powered_ - 1], false);
+        release = true;
+      } else {
+        release = prev.address() != Vl53l0x::kDefaultAddress || prev.state() != Vl53l0x::State::BringUp;
+      }
+    }
+    if (release) {
+      gpio_.write(xshut_[powered_], true);
+      sensors_[powered_].begin(now_us, addresses_[powered_]);
+      ++powered_;
+    }
+  }
+
+  // Rotate who goes first: whoever steps first grabs a free bus.
+  for (uint8_t i = 0; i < powered_; ++i) {
+    sensors_[(turn_ + i) % powered_].step(now_us);
+  }
+  if (powered_ > 0) turn_ = static_cast<uint8_t>((turn_ + 1) % powered_);
+}
@@ -0,0 +1,203 @@
+#include <unity.h>
+
+#include "adc_scan.h"
+
+static const uint8_t kPins[] = {14, 16, 17};  // A0, A2, A3 on a Teensy 4.0
+
+// Builds `frames` interleaved frames where channel c of frame f reads 100*c + f.
+static void make_frames(uint16_t* out, uint16_t frames, uint16_t offset) {
+  for (uint16_t f = 0; f < frames; ++f) {
+    for (uint8_t c = 0; c < 3; ++c) out[f * 3 + c] = static_cast<uint16_t>(100 * c + f + offset);
+  }
+}
+
+void test_deinterleaves_blocks_per_channel() {
+  AdcScanner scan;
+  TEST_ASSERT_TRUE(scan.configure(kPins, 3, 4000));
+  TEST_ASSERT_EQUAL(250, scan.period_us());
+  TEST_ASSERT_EQUAL(1, scan.channel_of(16));
+  TEST_ASSERT_EQUAL(-1, scan.channel_of(18));
+
+  uint16_t buf[kAdcBlockFrames * 3];
+  make_frames(buf, kAdcBlockFrames, 0);
+  scan.ingest(buf, kAdcBlockFrames, 10000);
+
+  for (uint8_t c = 0; c < 3; ++c) {
+    AdcBlock b;
+    TEST_ASSERT_TRUE(scan.read_block(c, &b));
+    TEST_ASSERT_EQUAL(kAdcBlockFrames, b.count);
+    TEST_ASSERT_EQUAL(10000, b.stamps[0]);  // same clock for every channel
+    TEST_ASSERT_EQUAL(10250, b.stamps[1]);
+    for (uint16_t i = 0; i < b.count; ++i) TEST_ASSERT_EQUAL(100 * c + i, b.samples[i]);
+    TEST_ASSERT_FALSE(scan.read_block(c, &b));  // caught up
+  }
+}
+
+void test_partial_block_only_visible_through_latest() {
+  AdcScanner scan;
+  scan.configure(kPins, 3, 1000);
+  uint16_t buf[4 * 3];
+  make_frames(buf, 4, 0);
+
+  uint16_t v = 0;
+  uint32_t t = 0;
+  TEST_ASSERT_FALSE(scan.latest(0, &v, &t));
+  scan.ingest(buf, 4, 500);
+
+  AdcBlock b;
+  TEST_ASSERT_FALSE(scan.read_block(2, &b));
+  TEST_ASSERT_TRUE(scan.latest(2, &v, &t));
+  TEST_ASSERT_EQUAL(203, v);
+  TEST_ASSERT_EQUAL(500 + 3 * 1000, t);
+}
+
+void test_frame_at_a_time_ingest_matches_bulk() {
+  AdcScanner scan;
+  scan.configure(kPins, 3, 2000);
+  uint16_t frame[3];
+  // Interrupt-driven backends hand over one frame at a time with its own stamp.
+  for (uint16_t f = 0; f < kAdcBlockFrames; ++f) {
+    for (uint8_t c = 0; c < 3; ++c) frame[c] = static_cast<uint16_t>(100 * c + f);
+    scan.ingest(frame, 1, 7000 + f * 500);
+  }
+  AdcBlock b;
+  TEST_ASSERT_TRUE(scan.read_block(1, &b));
+  TEST_ASSERT_EQUAL(7000, b.stamps[0]);
+  TEST_ASSERT_EQUAL(100 + kAdcBlockFrames - 1, b.samples[kAdcBlockFrames - 1]);
+}
+
+void test_slow_reader_counts_overruns() {
+  AdcScanner scan;
+  scan.configure(kPins, 3, 4000);
+  uint16_t buf[kAdcBlockFrames * 3];
+  const uint16_t blocks = kAdcBlockSlots + 3;
+  for (uint16_t k = 0; k < blocks; ++k) {
+    make_frames(buf, kAdcBlockFrames, static_cast<uint16_t>(k * kAdcBlockFrames));
+    scan.ingest(buf, kAdcBlockFrames, k * kAdcBlockFrames * 250u);
+  }
+
+  AdcBlock b;
+  int got = 0;
+  uint32_t first_seen = 0;
+  while (scan.read_block(0, &b)) {
+    if (got == 0) first_seen = b.stamps[0];
+    ++got;
+  }
+  TEST_ASSERT_EQUAL(kAdcBlockSlots - 1, got);
+  TEST_ASSERT_EQUAL(blocks - (kAdcBlockSlots - 1), scan.overruns(0));
+  // The oldest surviving block is intact, not half-overwritten.
+  TEST_ASSERT_EQUAL((blocks - (kAdcBlockSlots - 1)) * kAdcBlockFrames * 250u, first_seen);
+  TEST_ASSERT_EQUAL(0, scan.overruns(1));
+}
+
+void test_block_is_a_copy_the_producer_cannot_touch() {
+  AdcScanner scan;
+  scan.configure(kPins, 3, 4000);
+  uint16_t buf[kAdcBlockFrames * 3];
+  // Lag the reader as far as allowed: its oldest block sits right behind the
+  // slot being filled.
+  for (uint16_t k = 0; k < kAdcBlockSlots - 1; ++k) {
+    make_frames(buf, kAdcBlockFrames, static_cast<uint16_t>(k * kAdcBlockFrames));
+    scan.ingest(buf, kAdcBlockFrames, k * kAdcBlockFrames * 250u);
+  }
+  AdcBlock b;
+  TEST_ASSERT_TRUE(scan.read_block(0, &b));
+  // The producer publishes one more block and starts refilling that slot.
+  make_frames(buf, kAdcBlockFrames, 500);
+  scan.ingest(buf, kAdcBlockFrames, 90000);
+  scan.ingest(buf, kAdcBlockFrames / 2, 95000);
+  TEST_ASSERT_EQUAL(0, b.stamps[0]);
+  for (uint16_t i = 0; i < kAdcBlockFrames; ++i) TEST_ASSERT_EQUAL(i, b.samples[i]);
+}
+
+// Drains channel 0 into `stamps`, checking time never runs backwards.
+static uint16_t drain_stamps(AdcScanner& scan, uint32_t* stamps, uint16_t have) {
+  AdcBlock b;
+  while (scan.read_block(0, &b)) {
+    for (uint16_t i = 0; i < b.count; ++i) {
+      if (have > 0) TEST_ASSERT_TRUE(b.stamps[i] >= stamps[have - 1]);
+      stamps[have++] = b.stamps[i];
+    }
+  }
+  return have;
+}
+
+void test_dma_batches_do_not_drift_from_the_clock() {
+  // 3 kHz truncates to a 333 µs period, and this ADC really runs at 2980 Hz.
+  // Stamping by frame count would be ~12 ms off after 1.6 s; re-anchoring on
+  // every batch bounds the error by one batch's worth of rate error (~120 µs)
+  // plus how late the batch was drained.
+  AdcScanner scan;
+  scan.configure(kPins, 3, 3000);
+  TEST_ASSERT_EQUAL(333, scan.period_us());
+  const uint16_t kBatch = 48, kBatches = 100;
+  static uint32_t stamps[kBatch * kBatches];
+  uint16_t buf[kBatch * 3] = {0};
+  uint16_t have = 0;
+  for (uint16_t k = 0; k < kBatches; ++k) {
+    uint32_t last_true = static_cast<uint32_t>((k + 1) * kBatch - 1) * 1000000ull / 2980;
+    scan.ingest_ending(buf, kBatch, last_true + 150);  // drained a little late
+    have = drain_stamps(scan, stamps, have);
+  }
+  TEST_ASSERT_EQUAL(kBatch * kBatches, have);
+  for (uint16_t f = 0; f < have; ++f) {
+    uint32_t truth = static_cast<uint32_t>(f * 1000000ull / 2980);
+    TEST_ASSERT_UINT32_WITHIN(300, truth, stamps[f]);
+  }
+}
+
+void test_dropped_frames_only_shift_their_own_batch() {
+  AdcScanner scan;
+  scan.configure(kPins, 3, 4000);  // 250 µs
+  static uint32_t stamps[64];
+  uint16_t buf[32 * 3] = {0};
+  scan.ingest_ending(buf, 16, 15 * 250);
+  // DMA lost 8 frames before this batch: 16 frames arrive, the last sampled
+  // at frame 39. The batch lands where it happened, not 8 frames early.
+  scan.ingest_ending(buf, 16, 39 * 250);
+  scan.ingest_ending(buf, 32, 71 * 250);
+  uint16_t have = drain_stamps(scan, stamps, 0);
+  TEST_ASSERT_EQUAL(64, have);
+  TEST_ASSERT_EQUAL(15 * 250, stamps[15]);
+  TEST_ASSERT_EQUAL(24 * 250, stamps[16]);
+  TEST_ASSERT_EQUAL(39 * 250, stamps[31]);
+  TEST_ASSERT_EQUAL(40 * 250, stamps[32]);  // the next batch is back on the grid
+  TEST_ASSERT_EQUAL(71 * 250, stamps[63]);
+}
+
+void test_crowded_batch_spreads_instead_of_running_backwards() {
+  AdcScanner scan;
+  scan.configure(kPins, 3, 4000);
+  static uint32_t stamps[32];
+  uint16_t buf[16 * 3] = {0};
+  scan.ingest_ending(buf, 16, 10000);
+  // 16 more frames but only 1600 µs later: back-dating by 250 µs would reach
+  // before 10000, so they share the gap evenly instead.
+  scan.ingest_ending(buf, 16, 11600);
+  uint16_t have = drain_stamps(scan, stamps, 0);  // asserts monotonic
+  TEST_ASSERT_EQUAL(32, have);
+  TEST_ASSERT_EQUAL(10100, stamps[16]);
+  TEST_ASSERT_EQUAL(11600, stamps[31]);
+}
+
+void test_rejects_bad_configuration() {
+  AdcScanner scan;
+  uint8_t many[kAdcMaxChannels + 1] = {0};
+  TEST_ASSERT_FALSE(scan.configure(many, 0, 1000));
+  TEST_ASSERT_FALSE(scan.configure(many, kAdcMaxChannels + 1, 1000));
+  TEST_ASSERT_FALSE(scan.configure(kPins, 3, 0));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_deinterleaves_blocks_per_channel);
+  RUN_TEST(test_partial_block_only_visible_through_latest);
+  RUN_TEST(test_frame_at_a_time_ingest_matches_bulk);
+  RUN_TEST(test_slow_reader_counts_overruns);
+  RUN_TEST(test_block_is_a_copy_the_producer_cannot_touch);
+  RUN_TEST(test_dma_batches_do_not_drift_from_the_clock);
+  RUN_TEST(test_dropped_frames_only_shift_their_own_batch);
+  RUN_TEST(test_crowded_batch_spreads_instead_of_running_backwards);
+  RUN_TEST(test_rejects_bad_configuration);
+  return UNITY_END();
+}
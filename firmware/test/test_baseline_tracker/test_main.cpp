@@ -0,0 +1,77 @@
+#include <unity.h>
+
+#include <stdint.h>
+
+#include "baseline_tracker.h"
+
+// Deterministic "room noise": a tiny LCG mapped to ±amp so runs are repeatable.
+static float noise(uint32_t* state, float amp) {
+  *state = *state * 1664525u + 1013904223u;
+  return ((*state >> 8) / 16777216.0f * 2.0f - 1.0f) * amp;
+}
+
+void test_learns_mean_and_noise_floor() {
+  BaselineTracker t;
+  uint32_t rng = 1;
+  for (int i = 0; i < 20000; ++i) t.update(0.30f + noise(&rng, 0.01f));
+
+  TEST_ASSERT_FLOAT_WITHIN(0.002f, 0.30f, t.mean());
+  // Uniform ±a has σ = a/√3 ≈ 0.00577.
+  TEST_ASSERT_FLOAT_WITHIN(0.0015f, 0.00577f, t.sigma());
+}
+
+void test_touch_barely_moves_baseline() {
+  BaselineTracker t;
+  uint32_t rng = 7;
+  for (int i = 0; i < 5000; ++i) t.update(0.30f + noise(&rng, 0.01f));
+  float before = t.mean();
+
+  // A one-second held touch well outside the noise gate.
+  for (int i = 0; i < 1000; ++i) t.update(0.80f);
+  // The old constant-rate follower would have drifted ~63% of the way (≈0.31);
+  // the gated tracker leaks at min_weight so the touch stays visible.
+  TEST_ASSERT_LESS_THAN(0.05f, t.mean() - before);
+  TEST_ASSERT_GREATER_THAN(0.40f, 0.80f - t.mean());
+}
+
+void test_slow_drift_is_followed() {
+  BaselineTracker t;
+  uint32_t rng = 3;
+  float level = 0.20f;
+  for (int i = 0; i < 5000; ++i) t.update(level + noise(&rng, 0.01f));
+  // Humidity creeps the pad up by 0.1 over 20k samples: always inside the gate.
+  for (int i = 0; i < 20000; ++i) {
+    level += 0.1f / 20000.0f;
+    t.update(level + noise(&rng, 0.01f));
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, level, t.mean());
+}
+
+void test_asymmetric_fall_for_darkening_room() {
+  BaselineConfig c;
+  c.rate = 0.005f;
+  c.fall_rate = 0.05f;
+  c.gate_below = false;
+  BaselineTracker t(c);
+  t.seed(0.5f);
+  for (int i = 0; i < 200; ++i) t.update(0.5f);
+  // Lights go off: the floor should chase the darker room within ~100 samples.
+  for (int i = 0; i < 100; ++i) t.update(0.1f);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.1f, t.mean());
+}
+
+void test_update_returns_deviation_before_adapting() {
+  BaselineTracker t;
+  t.seed(0.25f);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.5f, t.update(0.75f));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_learns_mean_and_noise_floor);
+  RUN_TEST(test_touch_barely_moves_baseline);
+  RUN_TEST(test_slow_drift_is_followed);
+  RUN_TEST(test_asymmetric_fall_for_darkening_room);
+  RUN_TEST(test_update_returns_deviation_before_adapting);
+  return UNITY_END();
+}
@@ -0,0 +1,190 @@
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+
+#include <vector>
+
+#include "flight_recorder.h"
+#include "gesture_engine.h"
+
+namespace {
+// Every surviving block, oldest first, decoded back into records: what the
+// dump command plus tools/flight_dump.py hand to a replay.
+std::vector<FlightRecord> read_all(const FlightRecorder& rec) {
+  std::vector<FlightRecord> out;
+  uint8_t block[kFlightBlockBytes];
+  for (uint32_t seq = rec.oldest_seq(); seq != 0 && seq <= rec.newest_seq(); ++seq) {
+    size_t n = rec.copy_block(seq, block);
+    TEST_ASSERT_TRUE(n > 0);
+    FlightBlockReader reader;
+    TEST_ASSERT_TRUE(reader.open(block, n));
+    TEST_ASSERT_EQUAL_UINT32(seq, reader.seq());
+    FlightRecord r;
+    while (reader.next(&r)) out.push_back(r);
+  }
+  return out;
+}
+
+// A played take: 1 kHz with a little jitter, two plucks and a bowed stretch.
+float take(uint32_t i) {
+  float t = static_cast<float>(i) / 1000.0f;
+  float v = 0.03f + 0.004f * sinf(t * 377.0f);  // hum
+  if (i >= 200 && i < 260) v = 0.75f;
+  if (i >= 500 && i < 540) v = 0.9f;
+  if (i >= 800 && i < 1400) v = 0.6f + 0.05f * sinf(t * 20.0f);
+  return v;
+}
+}  // namespace
+
+void test_round_trip_keeps_order_time_and_value() {
+  static uint8_t storage[64 * kFlightBlockBytes];
+  FlightRecorder rec(storage, sizeof(storage));
+  std::vector<SensorSample> written;
+  uint32_t us = 0xFFFFFFFFu - 700000;  // micros() wraps mid-take
+  for (uint32_t i = 0; i < 2000; ++i) {
+    us += 1000 + ((i % 7 == 0) ? 13 : 0);  // mostly steady, sometimes late
+    SensorSample s{take(i), us};
+    rec.sample(s);
+    written.push_back(s);
+    if (i == 200) {
+      rec.gesture(us + 40, static_cast<uint8_t>(Gesture::Pluck), 96, 64);
+      rec.midi(us + 55, 0x90, 64, 96);
+    }
+    if (i == 260) rec.gesture(us, static_cast<uint8_t>(Gesture::Idle), 0, -1);
+  }
+  std::vector<FlightRecord> got = read_all(rec);
+  TEST_ASSERT_EQUAL_UINT32(rec.records(), got.size());
+
+  size_t k = 0;
+  bool saw_pluck = false;
+  bool saw_note_on = false;
+  for (const FlightRecord& r : got) {
+    if (r.type == FlightRecordType::Sample) {
+      TEST_ASSERT_EQUAL_UINT32(written[k].micros, r.us);
+      TEST_ASSERT_FLOAT_WITHIN(0.5f / kFlightValueScale + 1e-7f, written[k].value, r.value);
+      ++k;
+    } else if (r.type == FlightRecordType::Gesture && r.gesture == static_cast<uint8_t>(Gesture::Pluck)) {
+      saw_pluck = true;
+      TEST_ASSERT_EQUAL_UINT32(written[200].micros + 40, r.us);
+      TEST_ASSERT_EQUAL_UINT8(96, r.amount);
+      TEST_ASSERT_EQUAL_INT16(64, r.note);
+    } else if (r.type == FlightRecordType::Midi) {
+      saw_note_on = true;
+      TEST_ASSERT_EQUAL_UINT32(written[200].micros + 55, r.us);
+      TEST_ASSERT_EQUAL_HEX8(0x90, r.midi[0]);
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(written.size(), k);
+  TEST_ASSERT_TRUE(saw_pluck);
+  TEST_ASSERT_TRUE(saw_note_on);
+}
+
+void test_overwrite_keeps_blocks_self_contained() {
+  static uint8_t storage[4 * kFlightBlockBytes + 100];  // ragged tail is ignored
+  FlightRecorder rec(storage, sizeof(storage));
+  TEST_ASSERT_EQUAL_UINT32(4, rec.block_count());
+  uint32_t us = 0;
+  for (uint32_t i = 0; i < 5000; ++i) {
+    us += 1000;
+    rec.sample({take(i % 2000), us});
+  }
+  TEST_ASSERT_TRUE(rec.newest_seq() > 4);
+  TEST_ASSERT_EQUAL_UINT32(rec.newest_seq() - 3, rec.oldest_seq());
+  uint8_t block[kFlightBlockBytes];
+  TEST_ASSERT_EQUAL_UINT32(0, rec.copy_block(rec.oldest_seq() - 1, block));  // gone
+  TEST_ASSERT_EQUAL_UINT32(0, rec.copy_block(rec.newest_seq() + 1, block));  // not yet
+
+  // The oldest survivor decodes from its own keyframe: its samples line up
+  // with what was written, even though everything before it is gone.
+  std::vector<FlightRecord> got = read_all(rec);
+  TEST_ASSERT_EQUAL_UINT32(5000000, got.back().us);
+  for (size_t i = 0; i < got.size(); ++i) {
+    uint32_t idx = got[i].us / 1000 - 1;
+    TEST_ASSERT_EQUAL_UINT32(0, got[i].us % 1000);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, take(idx % 2000), got[i].value);
+    if (i > 0) TEST_ASSERT_EQUAL_UINT32(got[i - 1].us + 1000, got[i].us);
+  }
+  TEST_ASSERT_EQUAL_UINT32(got.back().us - got.front().us, rec.span_us());
+}
+
+void test_quiet_stream_costs_about_a_byte_per_sample() {
+  static uint8_t storage[256 * kFlightBlockBytes];  // 64 KB, the ESP32 default
+  FlightRecorder rec(storage, sizeof(storage));
+  uint32_t us = 0;
+  for (uint32_t i = 0; i < 30000; ++i) {  // 30 s of hum at 1 kHz
+    us += 1000;
+    rec.sample({0.03f + 0.002f * sinf(static_cast<float>(i) * 0.377f), us});
+  }
+  // Each 256-byte block holds ~244 one-byte samples after its header.
+  TEST_ASSERT_TRUE(rec.newest_seq() <= 30000 / 230 + 1);
+  TEST_ASSERT_EQUAL_UINT32(1, rec.oldest_seq());  // nothing overwritten yet
+}
+
+void test_replay_reproduces_the_gestures() {
+  // Record what the engine saw while it ran live, then replay the dump through
+  // a fresh engine: same calls at the same times.
+  static uint8_t storage[64 * kFlightBlockBytes];
+  FlightRecorder rec(storage, sizeof(storage));
+  GestureParams params;
+  GestureEngine live(params);
+  std::vector<Gesture> live_calls;
+  for (uint32_t i = 0; i < 2000; ++i) {
+    SensorSample s{take(i), 5000 + i * 1000};
+    Gesture g = live.update(s);
+    rec.sample(s);
+    if (g != Gesture::Idle && g != Gesture::Bow) {
+      live_calls.push_back(g);
+      rec.gesture(s.micros, static_cast<uint8_t>(g), 0, -1);
+    }
+  }
+  TEST_ASSERT_TRUE(live_calls.size() >= 2);
+
+  GestureEngine replay(params);
+  std::vector<Gesture> replay_calls;
+  std::vector<Gesture> recorded_calls;
+  for (const FlightRecord& r : read_all(rec)) {
+    if (r.type == FlightRecordType::Sample) {
+      Gesture g = replay.update({r.value, r.us});
+      if (g != Gesture::Idle && g != Gesture::Bow) replay_calls.push_back(g);
+    } else if (r.type == FlightRecordType::Gesture) {
+      recorded_calls.push_back(static_cast<Gesture>(r.gesture));
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(live_calls.size(), replay_calls.size());
+  TEST_ASSERT_EQUAL_UINT32(live_calls.size(), recorded_calls.size());
+  for (size_t i = 0; i < live_calls.size(); ++i) {
+    TEST_ASSERT_EQUAL(live_calls[i], replay_calls[i]);
+    TEST_ASSERT_EQUAL(live_calls[i], recorded_calls[i]);
+  }
+}
+
+void test_base64_and_malformed_blocks() {
+  char out[16];
+  const uint8_t man[] = {'M', 'a', 'n', 'M', 'a'};
+  TEST_ASSERT_EQUAL_UINT32(8, flight_base64(man, 5, out));
+  TEST_ASSERT_EQUAL_STRING("TWFuTWE=", out);
+
+  FlightBlockReader reader;
+  uint8_t junk[kFlightBlockBytes];
+  memset(junk, 0xEE, sizeof(junk));
+  TEST_ASSERT_FALSE(reader.open(junk, sizeof(junk)));  // used = 0xEEEE: refused
+  junk[10] = 16;
+  junk[11] = 0;
+  TEST_ASSERT_TRUE(reader.open(junk, sizeof(junk)));
+  FlightRecord r;
+  TEST_ASSERT_FALSE(reader.next(&r));  // same-dt sample with no dt yet: stop, don't guess
+
+  FlightRecorder none(junk, kFlightBlockBytes);  // one block: too small, records nothing
+  none.sample({0.5f, 10});
+  TEST_ASSERT_EQUAL_UINT32(0, none.newest_seq());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip_keeps_order_time_and_value);
+  RUN_TEST(test_overwrite_keeps_blocks_self_contained);
+  RUN_TEST(test_quiet_stream_costs_about_a_byte_per_sample);
+  RUN_TEST(test_replay_reproduces_the_gestures);
+  RUN_TEST(test_base64_and_malformed_blocks);
+  return UNITY_END();
+}
@@ -0,0 +1,100 @@
+#include <math.h>
+#include <unity.h>
+
+#include "gate_envelope.h"
+
+void test_matches_closed_form() {
+  GateEnvelope env(10000.0f, 40000.0f);
+  env.reset(false, 0);
+  env.edge(true, 1000);
+  // 10 ms after the rising edge: one attack time constant.
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f - expf(-1.0f), env.value_at(11000));
+  float at_fall = env.value_at(21000);
+  env.edge(false, 21000);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, at_fall * expf(-0.5f), env.value_at(41000));
+}
+
+void test_independent_of_poll_rate() {
+  // Same edges, one envelope polled every 100 µs, one asked once at the end.
+  const uint32_t edges[] = {5000, 9000, 30000, 31000, 32000, 60000};
+  GateEnvelope busy(8000.0f, 20000.0f);
+  GateEnvelope lazy(8000.0f, 20000.0f);
+  busy.reset(false, 0);
+  lazy.reset(false, 0);
+  uint8_t next = 0;
+  bool level = false;
+  for (uint32_t t = 0; t <= 80000; t += 100) {
+    if (next < 6 && edges[next] <= t) {
+      level = !level;
+      busy.edge(level, edges[next]);
+      ++next;
+    }
+    busy.value_at(t);
+  }
+  level = false;
+  for (uint8_t i = 0; i < 6; ++i) {
+    level = !level;
+    lazy.edge(level, edges[i]);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, busy.value_at(80000), lazy.value_at(80000));
+}
+
+void test_holdoff_swallows_chatter_then_resyncs() {
+  GateEnvelope env(1000.0f, 1000.0f, 2000);
+  env.reset(false, 0);
+  env.edge(true, 10000);
+  // Bounce: low/high/low inside the holdoff. The pin finally settles low.
+  env.edge(false, 10300);
+  env.edge(true, 10600);
+  env.edge(false, 11000);
+  TEST_ASSERT_TRUE(env.level());  // still holding the accepted edge
+  env.value_at(12500);
+  TEST_ASSERT_FALSE(env.level());  // holdoff over: settled level applied at 12000
+  TEST_ASSERT_EQUAL(12000, env.last_edge_us());
+
+  // A bounce that settles back where it started leaves no trace.
+  GateEnvelope clean(1000.0f, 1000.0f, 2000);
+  clean.reset(false, 0);
+  clean.edge(true, 10000);
+  clean.edge(false, 10300);
+  clean.edge(true, 10600);
+  env.reset(false, 0);
+  env.edge(true, 10000);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, env.value_at(20000), clean.value_at(20000));
+}
+
+void test_survives_micros_wrap() {
+  GateEnvelope env(10000.0f, 10000.0f);
+  const uint32_t start = 0xFFFFF000u;
+  env.reset(false, start);
+  env.edge(true, start + 0x800);
+  // 10 ms after the edge, on the far side of the wrap.
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f - expf(-1.0f), env.value_at(start + 0x800 + 10000));
+}
+
+void test_ring_drops_and_flags_overflow() {
+  EdgeRing ring;
+  for (uint32_t i = 0; i < EdgeRing::kCapacity + 4; ++i) ring.push(i * 10, (i & 1) != 0);
+  TEST_ASSERT_TRUE(ring.dropped() > 0);
+  TEST_ASSERT_TRUE(ring.take_overflow());
+  TEST_ASSERT_FALSE(ring.take_overflow());
+  GateEdge e;
+  uint32_t n = 0;
+  uint32_t last = 0;
+  while (ring.pop(&e)) {
+    TEST_ASSERT_TRUE(n == 0 || e.stamp_us > last);  // order preserved
+    last = e.stamp_us;
+    ++n;
+  }
+  TEST_ASSERT_EQUAL(EdgeRing::kCapacity - 1, n);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_matches_closed_form);
+  RUN_TEST(test_independent_of_poll_rate);
+  RUN_TEST(test_holdoff_swallows_chatter_then_resyncs);
+  RUN_TEST(test_survives_micros_wrap);
+  RUN_TEST(test_ring_drops_and_flags_overflow);
+  return UNITY_END();
+}
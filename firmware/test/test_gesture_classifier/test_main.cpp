@@ -0,0 +1,116 @@
+#include <unity.h>
+
+#include "gesture_classifier.h"
+#include "gesture_tree_model.h"
+
+namespace {
+// max <= 30 → Idle; else flips <= 1 → Pluck, else Tremolo.
+const GestureTreeNode kHandTree[] = {
+    {kFeatMax, 30, 1, 2},
+    {-1, 0, static_cast<uint8_t>(Gesture::Idle), 255},
+    {kFeatFlips, 1, 3, 4},
+    {-1, 0, static_cast<uint8_t>(Gesture::Pluck), 200},
+    {-1, 0, static_cast<uint8_t>(Gesture::Tremolo), 128},
+};
+const uint8_t kHandCount = sizeof(kHandTree) / sizeof(kHandTree[0]);
+
+SensorSample at(uint32_t us, float v) { return SensorSample{v, us}; }
+}  // namespace
+
+void test_features_match_hand_math() {
+  GestureClassifier c(kHandTree, kHandCount);
+  c.process(at(0, 0.0f));
+  c.process(at(1000, 0.5f));
+  c.process(at(2000, 0.0f));
+  c.process(at(3000, 0.5f));
+  const int8_t* f = c.features();
+  TEST_ASSERT_EQUAL_INT8(64, f[kFeatValue]);  // 0.5 * 127 rounds to 64
+  TEST_ASSERT_EQUAL_INT8(32, f[kFeatMean]);
+  TEST_ASSERT_EQUAL_INT8(0, f[kFeatMin]);
+  TEST_ASSERT_EQUAL_INT8(64, f[kFeatMax]);
+  TEST_ASSERT_EQUAL_INT8(64, f[kFeatRange]);
+  TEST_ASSERT_EQUAL_INT8(64, f[kFeatSlope]);  // short window: newest minus oldest
+  TEST_ASSERT_EQUAL_INT8(2, f[kFeatFlips]);
+  TEST_ASSERT_EQUAL_INT8(3, f[kFeatSpanMs]);
+}
+
+void test_window_slides_and_span_survives_wrap() {
+  GestureClassifier c(kHandTree, kHandCount);
+  const uint32_t start = 0xFFFFFFFFu - 10000;  // micros() wraps mid-window
+  for (uint32_t i = 0; i < 40; ++i) c.process(at(start + i * 1000, i < 8 ? 1.0f : 0.25f));
+  const int8_t* f = c.features();
+  // The eight loud samples have slid out; only the last 32 remain.
+  TEST_ASSERT_EQUAL_INT8(32, f[kFeatMax]);
+  TEST_ASSERT_EQUAL_INT8(0, f[kFeatRange]);
+  TEST_ASSERT_EQUAL_INT8(31, f[kFeatSpanMs]);
+}
+
+void test_one_shots_fire_once_bow_repeats() {
+  GestureClassifier c(kHandTree, kHandCount);
+  TEST_ASSERT_EQUAL(Gesture::Idle, c.process(at(0, 0.0f)).gesture);
+  GestureResult r = c.process(at(1000, 0.8f));
+  TEST_ASSERT_EQUAL(Gesture::Pluck, r.gesture);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 200.0f / 255.0f, r.confidence);
+  TEST_ASSERT_EQUAL(Gesture::Idle, c.process(at(2000, 0.8f)).gesture);
+  TEST_ASSERT_EQUAL(Gesture::Pluck, c.label());
+  // Wobble until the window holds two flips.
+  c.process(at(3000, 0.5f));
+  TEST_ASSERT_EQUAL(Gesture::Tremolo, c.process(at(4000, 0.8f)).gesture);
+  TEST_ASSERT_EQUAL(Gesture::Idle, c.process(at(5000, 0.5f)).gesture);
+
+  const GestureTreeNode bow_only[] = {{-1, 0, static_cast<uint8_t>(Gesture::Bow), 255}};
+  GestureClassifier b(bow_only, 1);
+  for (uint32_t i = 0; i < 3; ++i) TEST_ASSERT_EQUAL(Gesture::Bow, b.process(at(i * 1000, 0.6f)).gesture);
+}
+
+void test_validate_rejects_broken_trees() {
+  TEST_ASSERT_TRUE(GestureClassifier::validate(kHandTree, kHandCount));
+  TEST_ASSERT_TRUE(GestureClassifier::validate(
+      kGestureTreeModel, static_cast<uint8_t>(sizeof(kGestureTreeModel) / sizeof(kGestureTreeModel[0]))));
+
+  const GestureTreeNode cycle[] = {{kFeatMax, 10, 0, 1}, {-1, 0, 0, 255}};
+  TEST_ASSERT_FALSE(GestureClassifier::validate(cycle, 2));
+  const GestureTreeNode dangling[] = {{kFeatMax, 10, 1, 5}, {-1, 0, 0, 255}};
+  TEST_ASSERT_FALSE(GestureClassifier::validate(dangling, 2));
+  const GestureTreeNode bad_feature[] = {{kTreeFeatureCount, 10, 1, 2}, {-1, 0, 0, 255}, {-1, 0, 0, 255}};
+  TEST_ASSERT_FALSE(GestureClassifier::validate(bad_feature, 3));
+  const GestureTreeNode bad_label[] = {{-1, 0, 42, 255}};
+  TEST_ASSERT_FALSE(GestureClassifier::validate(bad_label, 1));
+
+  // A chain one decision deeper than kTreeMaxDepth.
+  GestureTreeNode deep[2 * kTreeMaxDepth + 3];
+  uint8_t n = 0;
+  for (uint8_t d = 0; d <= kTreeMaxDepth; ++d) {
+    deep[n] = {kFeatValue, 0, static_cast<uint8_t>(n + 1), static_cast<uint8_t>(n + 2)};
+    deep[n + 1] = {-1, 0, 0, 255};
+    n = static_cast<uint8_t>(n + 2);
+  }
+  deep[n] = {-1, 0, 0, 255};
+  TEST_ASSERT_FALSE(GestureClassifier::validate(deep, static_cast<uint8_t>(n + 1)));
+}
+
+void test_walk_is_bounded_on_malformed_tree() {
+  const GestureTreeNode loop[] = {{kFeatValue, 127, 0, 0}};
+  GestureClassifier c(loop, 1);
+  GestureResult r = c.process(at(0, 0.9f));
+  TEST_ASSERT_EQUAL(Gesture::Idle, r.gesture);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, r.confidence);
+}
+
+void test_shipped_model_stays_idle_at_rest() {
+  GestureClassifier c;
+  for (uint32_t i = 0; i < 200; ++i) {
+    TEST_ASSERT_EQUAL(Gesture::Idle, c.process(at(i * 1000, 0.03f)).gesture);
+  }
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_features_match_hand_math);
+  RUN_TEST(test_window_slides_and_span_survives_wrap);
+  RUN_TEST(test_one_shots_fire_once_bow_repeats);
+  RUN_TEST(test_validate_rejects_broken_trees);
+  RUN_TEST(test_walk_is_bounded_on_malformed_tree);
+  RUN_TEST(test_shipped_model_stays_idle_at_rest);
+  return UNITY_END();
+}
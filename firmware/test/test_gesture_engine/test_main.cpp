@@ -42,12 +42,137 @@ void test_vibrato_after_wobbles() {
   TEST_ASSERT_EQUAL(Gesture::Vibrato, engine.update({0.78f, 130000}));
 }
 
+void test_noise_relative_thresholds() {
+  GestureParams params;
+  params.on_sigmas = 8.0f;
+  params.off_sigmas = 4.0f;
+  GestureEngine engine(params);
+  engine.set_noise_floor(0.02f);  // quiet room: contact at 0.16, release at 0.08
+
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.16f, engine.effective_on_thresh());
+  TEST_ASSERT_EQUAL(Gesture::Idle, engine.update({0.1f, 0}));
+  TEST_ASSERT_EQUAL(Gesture::Pluck, engine.update({0.2f, 100000}));
+
+  // The room gets noisy: the same light touch no longer clears the bar.
+  engine.set_noise_floor(0.05f);
+  TEST_ASSERT_EQUAL(Gesture::Idle, engine.update({0.05f, 200000}));  // release
+  TEST_ASSERT_EQUAL(Gesture::Idle, engine.update({0.2f, 300000}));
+  TEST_ASSERT_EQUAL(Gesture::Pluck, engine.update({0.45f, 400000}));
+}
+
+void test_result_carries_features_and_confidence() {
+  GestureParams params;
+  GestureEngine engine(params);
+
+  engine.process({0.0f, 0});
+  GestureResult pluck = engine.process({0.7f, 100000});
+  TEST_ASSERT_EQUAL(Gesture::Pluck, pluck.gesture);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 7.0f, pluck.features.velocity);  // 0.7 in 100 ms
+  TEST_ASSERT_TRUE(pluck.features.contact);
+
+  // Wobble 0.5 ↔ 0.8 with a flip every 20 ms: 25 Hz, depth 0.3 around 0.65.
+  engine.process({0.5f, 120000});
+  engine.process({0.8f, 140000});
+  engine.process({0.5f, 160000});
+  GestureResult vib = engine.process({0.8f, 180000});
+  TEST_ASSERT_EQUAL(Gesture::Vibrato, vib.gesture);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.3f, vib.features.wobble_depth);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.65f, vib.features.wobble_center);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 25.0f, vib.features.wobble_rate_hz);
+  TEST_ASSERT_EQUAL(4, vib.features.wobble_count);
+  TEST_ASSERT_EQUAL(80000, vib.features.contact_us);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.8f, vib.features.peak);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, vib.confidence);  // twice the vibrato depth floor
+
+  // A pluck that barely clears the bar is a less confident call than a firm one.
+  GestureEngine weak(params);
+  weak.process({0.0f, 0});
+  GestureResult barely = weak.process({0.56f, 100000});
+  TEST_ASSERT_EQUAL(Gesture::Pluck, barely.gesture);
+  TEST_ASSERT_TRUE(barely.confidence < pluck.confidence);
+  TEST_ASSERT_TRUE(barely.confidence >= 0.5f);
+}
+
+// Sample a linear attack (0 → peak over rise_us, starting at t0) every
+// `period_us` and return the Pluck result. The crossing time and strike should
+// not care how often the loop happened to look.
+static GestureResult pluck_sampled_every(uint32_t period_us, float peak, uint32_t rise_us) {
+  GestureParams params;
+  params.attack_lookahead_us = 4000;
+  GestureEngine engine(params);
+  const uint32_t t0 = 1000000;
+  for (uint32_t t = t0 - 3 * period_us;; t += period_us) {
+    float x = t <= t0 ? 0.0f : std::min(peak, peak * static_cast<float>(t - t0) / static_cast<float>(rise_us));
+    GestureResult r = engine.process({x, t});
+    if (r.gesture == Gesture::Pluck) return r;
+    if (t > t0 + 100000) return r;
+  }
+}
+
+void test_onset_and_strike_independent_of_loop_rate() {
+  const uint32_t t0 = 1000000;
+  // 0 → 0.9 over 3 ms: crosses 0.55 at t0 + 1833 µs.
+  GestureResult fast = pluck_sampled_every(250, 0.9f, 3000);
+  GestureResult slow = pluck_sampled_every(1300, 0.9f, 3000);
+  TEST_ASSERT_EQUAL(Gesture::Pluck, fast.gesture);
+  TEST_ASSERT_EQUAL(Gesture::Pluck, slow.gesture);
+  TEST_ASSERT_UINT32_WITHIN(2, t0 + 1833, fast.features.onset_us);
+  TEST_ASSERT_UINT32_WITHIN(2, t0 + 1833, slow.features.onset_us);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 300.0f, fast.features.attack_slope);  // 0.9 per 3 ms
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 300.0f, slow.features.attack_slope);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, fast.features.strike, slow.features.strike);
+  // Held back long enough to see the attack top out.
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.9f, fast.features.peak);
+}
+
+void test_lookahead_separates_soft_and_hard_strikes() {
+  // Both cross on_thresh on their first contact sample at nearly the same
+  // value; only the look-ahead sees one keep climbing fast and the other creep.
+  GestureResult hard = pluck_sampled_every(500, 1.0f, 2000);
+  GestureResult soft = pluck_sampled_every(500, 0.6f, 20000);
+  TEST_ASSERT_TRUE(hard.features.strike > 0.9f);
+  TEST_ASSERT_TRUE(soft.features.strike < 0.3f);
+  TEST_ASSERT_TRUE(hard.confidence > soft.confidence);
+}
+
+void test_mute_tap_inside_lookahead_stays_a_mute() {
+  GestureParams params;
+  params.attack_lookahead_us = 3000;  // the firmware's default
+  GestureEngine engine(params);
+  TEST_ASSERT_EQUAL(Gesture::Idle, engine.update({0.0f, 0}));
+  TEST_ASSERT_EQUAL(Gesture::Idle, engine.update({0.7f, 100000}));  // onset; waiting
+  GestureResult r = engine.process({0.1f, 102000});                 // damped before 3 ms
+  TEST_ASSERT_EQUAL(Gesture::Muted, r.gesture);
+  TEST_ASSERT_FALSE(r.features.contact);
+  TEST_ASSERT_EQUAL(Gesture::Idle, engine.update({0.1f, 103000}));  // and no late Pluck
+}
+
+void test_short_contact_inside_long_lookahead_still_plucks() {
+  GestureParams params;
+  params.attack_lookahead_us = 20000;  // longer than the mute window below
+  params.mute_window_us = 5000;
+  GestureEngine engine(params);
+  TEST_ASSERT_EQUAL(Gesture::Idle, engine.update({0.0f, 0}));
+  TEST_ASSERT_EQUAL(Gesture::Idle, engine.update({0.7f, 100000}));  // onset; waiting
+  GestureResult r = engine.process({0.1f, 110000});                 // too long for a mute
+  TEST_ASSERT_EQUAL(Gesture::Pluck, r.gesture);
+  TEST_ASSERT_FALSE(r.features.contact);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.7f, r.features.peak);
+  TEST_ASSERT_EQUAL(Gesture::Idle, engine.update({0.1f, 111000}));
+}
+
 int main(int argc, char **argv) {
   UNITY_BEGIN();
   RUN_TEST(test_pluck_then_bow_transition);
   RUN_TEST(test_scrape_vs_pluck_spacing);
   RUN_TEST(test_quick_release_marks_mute);
   RUN_TEST(test_vibrato_after_wobbles);
+  RUN_TEST(test_noise_relative_thresholds);
+  RUN_TEST(test_result_carries_features_and_confidence);
+  RUN_TEST(test_onset_and_strike_independent_of_loop_rate);
+  RUN_TEST(test_lookahead_separates_soft_and_hard_strikes);
+  RUN_TEST(test_mute_tap_inside_lookahead_stays_a_mute);
+  RUN_TEST(test_short_contact_inside_long_lookahead_still_plucks);
   return UNITY_END();
 }
 
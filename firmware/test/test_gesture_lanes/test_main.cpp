@@ -0,0 +1,237 @@
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+
+#include <chrono>
+#include <vector>
+
+#include "gesture_lanes.h"
+
+namespace {
+const uint16_t kLanes = 64;
+
+// A deterministic player for one lane: rests, plucks, scrape bursts, light
+// harmonic touches, vibrato, and quick mutes, with hum on top. Values sit on
+// a 1/1024 grid and times on the 16 µs tick grid, so no sample lands within
+// rounding distance of a threshold or window edge; that is what lets the
+// packed lane be held to *exactly* the same calls.
+class Player {
+ public:
+  explicit Player(uint32_t seed) : rng_(seed * 2654435761u + 1) {}
+
+  SensorSample next(uint32_t us) {
+    if (left_ == 0) pick();
+    --left_;
+    ++i_;
+    float v = 0.03f + 0.004f * sinf(static_cast<float>(i_) * 0.377f);
+    switch (kind_) {
+      case 1: v = level_ * (1.0f - 0.3f * static_cast<float>(i_ - start_) / static_cast<float>(len_)); break;  // pluck
+      case 2: v = ((i_ - start_) % 25 < 12) ? level_ : 0.2f; break;  // scrape grains
+      case 3: v = level_ + 0.008f * sinf(static_cast<float>(i_)); break;  // harmonic: light and still
+      case 4: v = level_ + (((i_ - start_) / 9) % 2 ? depth_ : -depth_); break;  // vibrato / tremolo
+      case 5: v = (i_ - start_ < 30) ? 0.7f : 0.05f; break;  // quick touch → mute
+      default: break;
+    }
+    v = floorf(fminf(fmaxf(v, 0.0f), 0.999f) * 1024.0f) / 1024.0f + 0.5f / 1024.0f;
+    return {v, us};
+  }
+
+ private:
+  uint32_t rng_;
+  uint32_t i_ = 0, start_ = 0, len_ = 1, left_ = 0;
+  uint8_t kind_ = 0;
+  float level_ = 0.0f, depth_ = 0.0f;
+
+  uint32_t rand(uint32_t n) {
+    rng_ = rng_ * 1664525u + 1013904223u;
+    return (rng_ >> 8) % n;
+  }
+  void pick() {
+    kind_ = kind_ == 0 ? static_cast<uint8_t>(1 + rand(5)) : 0;  // always rest in between
+    start_ = i_;
+    len_ = kind_ == 0 ? 80 + rand(150) : 60 + rand(500);
+    level_ = 0.6f + 0.003f * static_cast<float>(rand(100));
+    if (kind_ == 3) level_ = 0.47f + 0.001f * static_cast<float>(rand(60));
+    depth_ = 0.04f + 0.002f * static_cast<float>(rand(80));
+    left_ = len_;
+  }
+};
+
+GestureParams bass_params() {
+  GestureParams p;
+  p.on_thresh = 0.5f;
+  p.off_thresh = 0.3f;
+  p.tremolo_min_delta = 0.04f;
+  return p;
+}
+
+// Sample period for step i: ~1 kHz with jitter, always on the tick grid.
+uint32_t step_us(uint32_t i) { return 1008 + 16 * ((i * 7) % 5) - 32; }
+}  // namespace
+
+void test_lane_fits_its_budget() {
+  TEST_ASSERT_TRUE(sizeof(PackedLane) <= 24);
+  PackedLane storage[kLanes];
+  GestureLanes lanes(storage, kLanes, GestureParams());
+  size_t packed = sizeof(storage) + sizeof(lanes);
+  size_t engines = kLanes * sizeof(GestureEngine);
+  TEST_ASSERT_TRUE(packed * 3 < engines);
+}
+
+void test_every_lane_makes_the_same_calls_as_gesture_engine() {
+  static PackedLane storage[kLanes];
+  GestureLanes lanes(storage, kLanes, GestureParams());
+  int bass = lanes.add_params(bass_params());
+  TEST_ASSERT_EQUAL(1, bass);
+  std::vector<GestureEngine> engines;
+  std::vector<Player> players;
+  for (uint16_t k = 0; k < kLanes; ++k) {
+    engines.push_back(GestureEngine(k < kLanes / 2 ? GestureParams() : bass_params()));
+    if (k >= kLanes / 2) lanes.assign(k, static_cast<uint8_t>(bass));
+    players.push_back(Player(k));
+  }
+  // Half the lanes get a noise-relative threshold too.
+  GestureParams noisy;
+  noisy.on_sigmas = 40.0f;
+  noisy.off_sigmas = 25.0f;
+  int noisy_block = lanes.add_params(noisy);
+  for (uint16_t k = 0; k < kLanes; k += 4) {
+    engines[k] = GestureEngine(noisy);
+    lanes.assign(k, static_cast<uint8_t>(noisy_block));
+    float sigma = 14.0f / 2048.0f;  // exactly representable in the packed lane
+    engines[k].set_noise_floor(sigma);
+    lanes.set_noise_floor(k, sigma);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, engines[k].effective_on_thresh(), lanes.effective_on_thresh(k));
+  }
+
+  uint32_t us = 0xFFFFFFF0u - 16 * 200000;  // micros() wraps ~3 s in
+  uint32_t calls[8] = {};
+  for (uint32_t i = 0; i < 8000; ++i) {
+    us += step_us(i);
+    for (uint16_t k = 0; k < kLanes; ++k) {
+      SensorSample s = players[k].next(us);
+      GestureResult want = engines[k].process(s);
+      GestureResult got = lanes.process(k, s);
+      if (want.gesture != got.gesture) {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "lane %u sample %u: %d vs %d", k, i, static_cast<int>(want.gesture),
+                 static_cast<int>(got.gesture));
+        TEST_FAIL_MESSAGE(msg);
+      }
+      ++calls[static_cast<int>(got.gesture)];
+      const GestureFeatures& a = want.features;
+      const GestureFeatures& b = got.features;
+      TEST_ASSERT_EQUAL(a.contact, b.contact);
+      TEST_ASSERT_FLOAT_WITHIN(1e-4f, a.peak, b.peak);
+      TEST_ASSERT_FLOAT_WITHIN(2e-4f, a.wobble_depth, b.wobble_depth);
+      TEST_ASSERT_FLOAT_WITHIN(0.01f, a.strike, b.strike);
+      TEST_ASSERT_UINT32_WITHIN(16, a.contact_us, b.contact_us);
+      // Only while touching: the release sample's last flip can read hundreds
+      // of Hz, past what the packed byte holds, and nothing uses it after.
+      if (a.contact) TEST_ASSERT_FLOAT_WITHIN(1.0f, a.wobble_rate_hz, b.wobble_rate_hz);
+      TEST_ASSERT_FLOAT_WITHIN(0.04f, want.confidence, got.confidence);
+    }
+  }
+  // The take exercised every call, not just Idle and Bow.
+  for (int g = 1; g < 8; ++g) TEST_ASSERT_TRUE_MESSAGE(calls[g] > 0, "a gesture never came up");
+}
+
+void test_windows_past_the_age_range_are_refused() {
+  static PackedLane storage[4];
+  GestureLanes lanes(storage, 4, GestureParams());
+  TEST_ASSERT_TRUE(lanes.valid());
+
+  // A 2 s harmonic hold: the packed age stops at ~1.05 s and would never
+  // get past it, so the block is refused instead of silently never firing.
+  GestureParams slow;
+  slow.harmonic_hold_us = 2000000;
+  TEST_ASSERT_FALSE(GestureLanes::fits(slow));
+  TEST_ASSERT_EQUAL(GestureLanes::kWindowTooLong, lanes.add_params(slow));
+  TEST_ASSERT_EQUAL(1, lanes.block_count());
+
+  GestureParams edge;
+  edge.min_retrigger_us = kLaneMaxAgeUs - 1;
+  TEST_ASSERT_EQUAL(1, lanes.add_params(edge));
+  edge.min_retrigger_us = kLaneMaxAgeUs;
+  TEST_ASSERT_EQUAL(GestureLanes::kWindowTooLong, lanes.add_params(edge));
+
+  // The same mistake in the constructor leaves no lanes to disagree with.
+  GestureParams guard;
+  guard.min_retrigger_us = 1500000;
+  GestureLanes refused(storage, 4, guard);
+  TEST_ASSERT_FALSE(refused.valid());
+  TEST_ASSERT_EQUAL(0, refused.lane_count());
+  TEST_ASSERT_EQUAL(Gesture::Idle, refused.update(0, {0.9f, 1000}));
+
+  GestureLanes fill(storage, 4, GestureParams());
+  for (int i = 1; i < GestureLanes::kMaxBlocks; ++i) TEST_ASSERT_EQUAL(i, fill.add_params(GestureParams()));
+  TEST_ASSERT_EQUAL(GestureLanes::kBlocksFull, fill.add_params(GestureParams()));
+}
+
+void test_lookahead_plucks_land_within_a_sample() {
+  GestureParams p;
+  p.attack_lookahead_us = 3000;
+  PackedLane storage[1];
+  GestureLanes lanes(storage, 1, p);
+  GestureEngine engine(p);
+  Player player(7);
+  std::vector<uint32_t> want, got;
+  uint32_t us = 1000000;  // clear of GestureEngine's boot-time retrigger guard
+  for (uint32_t i = 0; i < 20000; ++i) {
+    us += step_us(i);
+    SensorSample s = player.next(us);
+    if (engine.update(s) == Gesture::Pluck) want.push_back(us);
+    if (lanes.update(0, s) == Gesture::Pluck) got.push_back(us);
+  }
+  TEST_ASSERT_TRUE(want.size() > 10);
+  TEST_ASSERT_EQUAL_UINT32(want.size(), got.size());
+  for (size_t i = 0; i < want.size(); ++i) TEST_ASSERT_UINT32_WITHIN(1100, want[i], got[i]);
+}
+
+// Not a pass/fail gate on speed (CI machines vary); it prints the numbers
+// the packed layout exists for, and checks the footprint claim.
+void test_benchmark_footprint_and_throughput() {
+  const uint32_t kSteps = 4000;
+  std::vector<std::vector<SensorSample>> takes(kLanes);
+  uint32_t us = 1000000;  // clear of GestureEngine's boot-time retrigger guard
+  std::vector<Player> players;
+  for (uint16_t k = 0; k < kLanes; ++k) players.push_back(Player(100 + k));
+  for (uint32_t i = 0; i < kSteps; ++i) {
+    us += step_us(i);
+    for (uint16_t k = 0; k < kLanes; ++k) takes[k].push_back(players[k].next(us));
+  }
+
+  std::vector<GestureEngine> engines(kLanes, GestureEngine(GestureParams()));
+  static PackedLane storage[kLanes];
+  GestureLanes lanes(storage, kLanes, GestureParams());
+  uint32_t sink_a = 0, sink_b = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < kSteps; ++i) {
+    for (uint16_t k = 0; k < kLanes; ++k) sink_a += static_cast<uint32_t>(engines[k].update(takes[k][i]));
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < kSteps; ++i) {
+    for (uint16_t k = 0; k < kLanes; ++k) sink_b += static_cast<uint32_t>(lanes.update(k, takes[k][i]));
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  TEST_ASSERT_EQUAL_UINT32(sink_a, sink_b);  // same calls, so the timing compares like with like
+
+  double n = static_cast<double>(kSteps) * kLanes;
+  double engine_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+  double lane_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / n;
+  printf("%u lanes: GestureEngine %u B/lane, %.1f ns/sample | GestureLanes %u B/lane + %u B shared, %.1f ns/sample\n",
+         kLanes, static_cast<unsigned>(sizeof(GestureEngine)), engine_ns, static_cast<unsigned>(sizeof(PackedLane)),
+         static_cast<unsigned>(sizeof(GestureLanes)), lane_ns);
+  TEST_ASSERT_TRUE(sizeof(PackedLane) * 4 < sizeof(GestureEngine));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_lane_fits_its_budget);
+  RUN_TEST(test_every_lane_makes_the_same_calls_as_gesture_engine);
+  RUN_TEST(test_windows_past_the_age_range_are_refused);
+  RUN_TEST(test_lookahead_plucks_land_within_a_sample);
+  RUN_TEST(test_benchmark_footprint_and_throughput);
+  return UNITY_END();
+}
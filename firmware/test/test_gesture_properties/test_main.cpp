@@ -0,0 +1,540 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include <chrono>
+
+#include "gesture_engine.h"
+
+/*
+ * Property tests for GestureEngine. test_gesture_engine shows the rules on
+ * short hand-written takes; this suite throws millions of random and hostile
+ * samples at the engine and checks what must hold for *every* stream:
+ *
+ *   - contact follows the hysteresis: on at on_thresh, off at off_thresh
+ *   - an onset is a Scrape inside scrape_window_us of the last accepted
+ *     onset, swallowed up to min_retrigger_us, and a Pluck after that (so no
+ *     Pluck inside the guard, and no Pluck lost to a wrapped clock either)
+ *   - at most one Pluck, one Harmonic and one Tremolo/Vibrato per contact
+ *   - Muted on the sample that ends a contact, exactly when it was short or
+ *     a light touch that dipped toward release
+ *   - every feature and confidence is a finite number in its range
+ *
+ * The streams mix plucks, bows, scrapes, wobbles and light touches with the
+ * nasty cases: micros() wrapping mid-contact, repeated timestamps, 1 µs and
+ * 35-minute sample gaps, NaN/inf/huge values, and chatter a hair either side
+ * of both thresholds. Time is kept as a 64-bit "true" µs alongside the
+ * 32-bit micros() the engine sees, so the checks never share the engine's
+ * wrap arithmetic. Seeds are fixed; a failure names the seed and sample.
+ */
+
+namespace {
+// xorshift32: small, fast, and the same sequence on every machine.
+class Rng {
+ public:
+  explicit Rng(uint32_t seed) : s_(seed * 2654435761u + 0x9E3779B9u) {
+    if (s_ == 0) s_ = 1;
+  }
+  uint32_t next() {
+    s_ ^= s_ << 13;
+    s_ ^= s_ >> 17;
+    s_ ^= s_ << 5;
+    return s_;
+  }
+  uint32_t below(uint32_t n) { return n == 0 ? 0 : next() % n; }
+  float unit() { return static_cast<float>(next() >> 8) * (1.0f / 16777216.0f); }
+  float between(float lo, float hi) { return lo + (hi - lo) * unit(); }
+  bool one_in(uint32_t n) { return below(n) == 0; }
+
+ private:
+  uint32_t s_;
+};
+
+struct Sample {
+  int64_t t;  // true µs since the stream began; never wraps
+  float value;
+};
+
+// What the engine does to a raw value before the rules see it: non-finite
+// holds the last value, anything else is clamped to 0..1.
+float sanitized(float raw, float last) {
+  if (!std::isfinite(raw)) return last;
+  return std::min(std::max(raw, 0.0f), 1.0f);
+}
+
+uint32_t saturate_us(int64_t us) { return us >= 0xFFFFFFFFll ? 0xFFFFFFFFu : static_cast<uint32_t>(us); }
+
+/**
+ * A random player. Each segment picks what the "hand" does (rest, pluck,
+ * bow, scrape, wobble, harmonic touch, threshold chatter, sensor garbage) and,
+ * separately, how the loop samples it (repeated stamps, 1 µs to 100 ms steps,
+ * ragged jitter, or one enormous gap).
+ */
+class Stream {
+ public:
+  Stream(uint32_t seed, float on, float off) : rng_(seed), on_(on), off_(off) {}
+
+  Sample next() {
+    if (left_ == 0) pick();
+    --left_;
+    ++i_;
+    t_ += step();
+    return {t_, value()};
+  }
+
+ private:
+  enum Kind { Rest, Pluck, Bow, Scrape, Wobble, Harmonic, ChatterOn, ChatterOff, ChatterBoth, Garbage, kKinds };
+  enum Timing { Repeat, Micro, Fast, Loop, Jitter, Slow, Ragged, Gap, kTimings };
+
+  void pick() {
+    kind_ = static_cast<Kind>(rng_.below(kKinds));
+    timing_ = static_cast<Timing>(rng_.below(kTimings));
+    left_ = 1 + rng_.below(rng_.one_in(8) ? 20000 : 400);
+    start_ = i_;
+    level_ = rng_.between(0.0f, 1.0f);
+    depth_ = rng_.between(0.0f, 0.4f);
+    flip_ = 1 + rng_.below(12);
+    // How close to the line the chatter sits: a float step, a rounding error,
+    // or a visible wiggle.
+    const float eps[] = {0.0f, 1e-7f, 1e-5f, 1e-3f, 0.03f};
+    eps_ = eps[rng_.below(5)];
+  }
+
+  int64_t step() {
+    switch (timing_) {
+      case Repeat: return rng_.one_in(16) ? 1 : 0;
+      case Micro: return 1;
+      case Fast: return 10;                        // 100 kHz
+      case Loop: return 1000;                      // the usual 1 kHz
+      case Jitter: return 900 + rng_.below(201);   // 1 kHz with a ragged loop
+      case Slow: return 100000;                    // a stalled board
+      case Ragged: return rng_.below(200000);
+      case Gap:  // one long silence, up to half the micros() range
+        if (i_ == start_ + 1) return 1000000ll + rng_.below(0x7FFFFFFFu - 1000000u);
+        return 1000;
+      default: return 1000;
+    }
+  }
+
+  float value() {
+    const uint32_t k = i_ - start_;
+    const float hum = 0.01f * rng_.between(-1.0f, 1.0f);
+    switch (kind_) {
+      case Rest: return 0.03f + hum;
+      case Pluck: return k < 3 ? level_ * static_cast<float>(k + 1) / 3.0f : level_ * expf(-0.002f * k) + hum;
+      case Bow: return level_ + hum;
+      case Scrape: return (k / flip_) % 2 ? level_ : 0.05f;
+      case Wobble: return level_ + ((k / flip_) % 2 ? depth_ : -depth_);
+      case Harmonic: return 0.5f + 0.001f * sinf(static_cast<float>(k));
+      case ChatterOn: return on_ + (k % 2 ? eps_ : -eps_);
+      case ChatterOff: return off_ + (k % 2 ? eps_ : -eps_);
+      case ChatterBoth: return k % 2 ? on_ + eps_ : off_ - eps_;
+      case Garbage: {
+        switch (rng_.below(10)) {
+          case 0: return NAN;
+          case 1: return INFINITY;
+          case 2: return -INFINITY;
+          case 3: return 3.0e38f;
+          case 4: return -3.0e38f;
+          case 5: return 1e-40f;  // denormal
+          case 6: return -0.0f;
+          case 7: return rng_.between(-2.0f, 3.0f);
+          default: {  // any bit pattern at all
+            uint32_t bits = rng_.next();
+            float x;
+            memcpy(&x, &bits, sizeof(x));
+            return x;
+          }
+        }
+      }
+      default: return 0.0f;
+    }
+  }
+
+  Rng rng_;
+  float on_, off_;
+  Kind kind_ = Rest;
+  Timing timing_ = Loop;
+  uint32_t left_ = 0, i_ = 0, start_ = 0, flip_ = 1;
+  int64_t t_ = 0;
+  float level_ = 0.0f, depth_ = 0.0f, eps_ = 0.0f;
+};
+
+// Per-sample cost of process(), gathered across every checker. process() has
+// no loops, no allocation and nothing that grows with the take, so its cost
+// is bounded by its longest branch. On a desktop the single worst sample is
+// mostly the scheduler; the 99.99th percentile is the number to compare
+// against the sample period (100 µs at 10 kHz).
+struct Timing {
+  uint64_t samples = 0;
+  double total_ns = 0.0;
+  double worst_ns = 0.0;
+  uint64_t buckets[64] = {};  // 16 ns wide; the last one catches everything slower
+
+  double percentile(double q) const {
+    uint64_t want = static_cast<uint64_t>(q * static_cast<double>(samples));
+    uint64_t seen = 0;
+    for (int b = 0; b < 64; ++b) {
+      seen += buckets[b];
+      if (seen > want) return 16.0 * (b + 1);
+    }
+    return worst_ns;
+  }
+};
+Timing g_timing;
+
+/**
+ * Feeds one engine and checks every verdict against a reference model kept
+ * in true time. `base` is what micros() read when the stream's clock was 0,
+ * so a base near 2^32 puts the wrap wherever the test likes.
+ */
+class Checker {
+ public:
+  Checker(const GestureParams& p, uint32_t base, uint32_t seed) : p_(p), engine_(p), base_(base), seed_(seed) {}
+
+  GestureEngine& engine() { return engine_; }
+  uint32_t micros_at(int64_t t) const { return static_cast<uint32_t>(base_ + static_cast<uint64_t>(t)); }
+
+  GestureResult feed(const Sample& x) {
+    const uint32_t us = micros_at(x.t);
+    if (n_ == 0) last_accept_t_ = x.t - us;  // the engine's guard counts from micros() == 0
+    const float on = engine_.effective_on_thresh();
+    const float off = engine_.effective_off_thresh();
+
+    auto t0 = std::chrono::steady_clock::now();
+    GestureResult r = engine_.process({x.value, us});
+    auto t1 = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    ++g_timing.samples;
+    g_timing.total_ns += ns;
+    g_timing.worst_ns = std::max(g_timing.worst_ns, ns);
+    ++g_timing.buckets[std::min(static_cast<int>(ns / 16.0), 63)];
+
+    check(x, us, on, off, r);
+    prev_us_ = us;
+    ++n_;
+    return r;
+  }
+
+  uint64_t count(Gesture g) const { return counts_[static_cast<int>(g)]; }
+  uint64_t contacts() const { return contacts_; }
+
+ private:
+  void expect(bool ok, const char* what, const Sample& x, const GestureResult& r) {
+    if (ok) return;
+    char msg[256];
+    snprintf(msg, sizeof(msg), "%s (seed %u, sample %llu, t=%lld us, value %g, gesture %d, contact %d)", what, seed_,
+             static_cast<unsigned long long>(n_), static_cast<long long>(x.t), static_cast<double>(x.value),
+             static_cast<int>(r.gesture), static_cast<int>(r.features.contact));
+    TEST_FAIL_MESSAGE(msg);
+  }
+
+  void check(const Sample& x, uint32_t us, float on, float off, const GestureResult& r) {
+    const GestureFeatures& f = r.features;
+    const Gesture g = r.gesture;
+    ++counts_[static_cast<int>(g)];
+
+    // Numbers a MIDI mapping or a telemetry line can use as they are.
+    value_ = sanitized(x.value, value_);
+    expect(f.value == value_, "value not sanitized", x, r);
+    expect(std::isfinite(f.velocity) && std::isfinite(f.wobble_rate_hz) && std::isfinite(f.attack_slope),
+           "non-finite feature", x, r);
+    expect(f.peak >= 0.0f && f.peak <= 1.0f && f.wobble_center >= -1.0f && f.wobble_center <= 1.0f &&
+               f.wobble_depth >= -1.0f && f.wobble_depth <= 1.0f,
+           "feature out of range", x, r);
+    expect(r.confidence >= 0.0f && r.confidence <= 1.0f, "confidence out of 0..1", x, r);
+    expect(f.strike >= 0.0f && f.strike <= 1.0f, "strike out of 0..1", x, r);
+
+    // Hysteresis, in the engine's order: on first, then off.
+    if (value_ <= off) {
+      expect(!f.contact, "contact held below off_thresh", x, r);
+    } else if (value_ >= on) {
+      expect(f.contact, "no contact above on_thresh", x, r);
+    } else {
+      expect(f.contact == contact_, "contact changed inside the hysteresis band", x, r);
+    }
+
+    const bool onset = f.contact && !contact_;
+    const bool release = !f.contact && contact_;
+    contact_ = f.contact;
+
+    if (onset) {
+      contact_t_ = x.t;
+      ++contacts_;
+      harmonics_ = modulations_ = 0;
+      mute_candidate_ = false;
+      expect(n_ == 0 || static_cast<uint32_t>(us - f.onset_us) <= static_cast<uint32_t>(us - prev_us_),
+             "onset interpolated outside the sample gap", x, r);
+      expect(f.contact_us == 0, "contact_us not reset at onset", x, r);
+      const int64_t gap = x.t - last_accept_t_;
+      if (gap < p_.scrape_window_us) {
+        expect(g == Gesture::Scrape, "onset inside scrape_window_us is not a Scrape", x, r);
+        last_accept_t_ = x.t;
+      } else if (gap < p_.min_retrigger_us) {
+        expect(g == Gesture::Idle, "onset inside min_retrigger_us was not swallowed", x, r);
+      } else {
+        last_accept_t_ = x.t;
+        if (p_.attack_lookahead_us == 0) {
+          expect(g == Gesture::Pluck, "onset clear of the guard is not a Pluck", x, r);
+        } else {
+          expect(g == Gesture::Idle, "look-ahead Pluck reported early", x, r);
+          pending_ = true;
+          onset_us_ = f.onset_us;
+        }
+      }
+      return;
+    }
+
+    if (pending_ && release) {
+      // A tap over inside the look-ahead is judged by the mute rule first.
+      pending_ = false;
+      const uint32_t hold = saturate_us(x.t - contact_t_);
+      expect(f.contact_us == hold, "contact_us on release is not the hold time", x, r);
+      expect(g == (hold <= p_.mute_window_us ? Gesture::Muted : Gesture::Pluck),
+             "release inside the look-ahead is not Muted-or-Pluck by the mute rule", x, r);
+      return;
+    }
+    if (pending_) {
+      const bool due = static_cast<uint32_t>(us - onset_us_) >= p_.attack_lookahead_us;
+      expect(g == (due ? Gesture::Pluck : Gesture::Idle), "look-ahead Pluck not reported exactly once", x, r);
+      pending_ = !due;
+      if (due) return;
+    }
+    expect(g != Gesture::Pluck && g != Gesture::Scrape, "Pluck or Scrape away from an onset", x, r);
+
+    if (f.contact) {
+      expect(f.contact_us == saturate_us(x.t - contact_t_), "contact_us is not the contact's age", x, r);
+      if (pending_) return;
+      expect(g != Gesture::Idle && g != Gesture::Muted, "contact reported as Idle or Muted", x, r);
+      // A light contact that dips toward release is remembered as a mute.
+      if (f.peak <= p_.mute_peak_thresh && value_ <= p_.mute_release_thresh) mute_candidate_ = true;
+      if (g == Gesture::Harmonic) {
+        expect(++harmonics_ == 1, "second Harmonic in one contact", x, r);
+        expect(x.t - contact_t_ > p_.harmonic_hold_us, "Harmonic before harmonic_hold_us", x, r);
+      }
+      if (g == Gesture::Tremolo || g == Gesture::Vibrato) {
+        expect(++modulations_ == 1, "second Tremolo/Vibrato in one contact", x, r);
+        expect(f.wobble_count >= p_.wobble_goal, "modulation before wobble_goal flips", x, r);
+      }
+    } else if (release) {
+      const uint32_t hold = saturate_us(x.t - contact_t_);
+      expect(f.contact_us == hold, "contact_us on release is not the hold time", x, r);
+      const bool muted = hold <= p_.mute_window_us || mute_candidate_;
+      expect(g == (muted ? Gesture::Muted : Gesture::Idle), "release is not Muted exactly when short or light", x,
+             r);
+    } else {
+      expect(g == Gesture::Idle, "gesture without contact", x, r);
+      expect(f.contact_us == 0, "contact_us while released", x, r);
+    }
+  }
+
+  GestureParams p_;
+  GestureEngine engine_;
+  uint32_t base_;
+  uint32_t seed_;
+  uint64_t n_ = 0;
+  uint64_t counts_[8] = {};
+  uint64_t contacts_ = 0;
+  float value_ = 0.0f;
+  bool contact_ = false;
+  bool pending_ = false;
+  bool mute_candidate_ = false;
+  uint32_t onset_us_ = 0;
+  uint32_t prev_us_ = 0;
+  int64_t contact_t_ = 0;
+  int64_t last_accept_t_ = 0;
+  int harmonics_ = 0;
+  int modulations_ = 0;
+};
+
+// Any thresholds and windows a student could push over Serial, hysteresis
+// intact: off below on, the scrape window inside the retrigger guard.
+GestureParams random_params(Rng* rng) {
+  GestureParams p;
+  p.on_thresh = rng->between(0.05f, 0.95f);
+  p.off_thresh = std::max(0.01f, p.on_thresh - rng->between(0.0f, 0.3f));
+  p.min_retrigger_us = rng->below(200000);
+  p.scrape_window_us = rng->below(p.min_retrigger_us + 1);
+  p.harmonic_peak_min = rng->between(0.0f, 0.6f);
+  p.harmonic_peak_max = p.harmonic_peak_min + rng->between(0.0f, 0.4f);
+  p.harmonic_hold_us = rng->below(200000);
+  p.harmonic_variation_eps = rng->between(0.0f, 0.1f);
+  p.mute_peak_thresh = rng->between(0.0f, 0.5f);
+  p.mute_window_us = rng->below(100000);
+  p.mute_release_thresh = rng->between(0.0f, 0.3f);
+  p.tremolo_min_delta = rng->between(0.0f, 0.2f);
+  p.tremolo_max_period_us = rng->below(60000);
+  p.tremolo_grace_us = rng->below(20000);
+  p.wobble_goal = static_cast<uint8_t>(rng->below(8));
+  p.vibrato_depth_min = rng->between(0.0f, 0.3f);
+  p.attack_lookahead_us = rng->one_in(2) ? 0 : rng->below(10000);
+  p.attack_slope_full = rng->between(0.0f, 500.0f);
+  if (rng->one_in(4)) {
+    p.on_sigmas = rng->between(1.0f, 12.0f);
+    p.off_sigmas = p.on_sigmas * rng->between(0.2f, 1.0f);
+  }
+  return p;
+}
+
+// Noise floors as a sensor might report them, broken ones included.
+float random_noise(Rng* rng) {
+  switch (rng->below(6)) {
+    case 0: return 0.0f;
+    case 1: return NAN;
+    case 2: return INFINITY;
+    case 3: return -0.01f;
+    default: return rng->between(0.001f, 0.2f);
+  }
+}
+
+void run_random(uint32_t seed, uint32_t samples, bool default_params) {
+  Rng rng(seed);
+  GestureParams p = default_params ? GestureParams() : random_params(&rng);
+  const uint32_t base = rng.next();  // wraps somewhere in most runs
+  Checker c(p, base, seed);
+  c.engine().set_noise_floor(random_noise(&rng));
+  Stream stream(seed ^ 0xA5A5A5A5u, c.engine().effective_on_thresh(), c.engine().effective_off_thresh());
+  for (uint32_t i = 0; i < samples; ++i) {
+    if (p.on_sigmas > 0.0f && rng.one_in(5000)) c.engine().set_noise_floor(random_noise(&rng));
+    c.feed(stream.next());
+  }
+}
+}  // namespace
+
+void test_random_streams_keep_the_invariants() {
+  const uint32_t kRuns = 96, kSamples = 40000;
+  for (uint32_t seed = 1; seed <= kRuns; ++seed) run_random(seed, kSamples, seed % 3 == 0);
+  printf("%llu samples: process() mean %.1f ns, 99.99%% under %.0f ns, worst %.0f ns\n",
+         static_cast<unsigned long long>(g_timing.samples), g_timing.total_ns / static_cast<double>(g_timing.samples),
+         g_timing.percentile(0.9999), g_timing.worst_ns);
+}
+
+// Time only ever enters the engine as differences, so sliding the whole take
+// across the micros() wrap must not change a single verdict.
+void test_micros_wrap_changes_nothing() {
+  for (uint32_t seed = 1; seed <= 16; ++seed) {
+    Rng rng(seed * 77);
+    GestureParams p = seed % 2 ? GestureParams() : random_params(&rng);
+    const int64_t t0 = 5000000;  // both clocks start well clear of the boot guard
+    Checker plain(p, 0, seed);
+    Checker wrapped(p, 0u - static_cast<uint32_t>(t0) - rng.below(60000000), seed);
+    Stream stream(seed, plain.engine().effective_on_thresh(), plain.engine().effective_off_thresh());
+    for (uint32_t i = 0; i < 40000; ++i) {
+      Sample x = stream.next();
+      x.t += t0;
+      GestureResult a = plain.feed(x);
+      GestureResult b = wrapped.feed(x);
+      TEST_ASSERT_EQUAL(static_cast<int>(a.gesture), static_cast<int>(b.gesture));
+      TEST_ASSERT_EQUAL_MEMORY(&a.confidence, &b.confidence, sizeof(float));
+      TEST_ASSERT_EQUAL_UINT32(a.features.contact_us, b.features.contact_us);
+      if (a.features.contact) {
+        TEST_ASSERT_EQUAL_UINT32(a.features.onset_us - plain.micros_at(x.t),
+                                 b.features.onset_us - wrapped.micros_at(x.t));
+      }
+      TEST_ASSERT_EQUAL_MEMORY(&a.features.strike, &b.features.strike, sizeof(float));
+      TEST_ASSERT_EQUAL_MEMORY(&a.features.wobble_rate_hz, &b.features.wobble_rate_hz, sizeof(float));
+    }
+  }
+}
+
+// The retrigger guard measures from the last accepted onset. A quiet hour
+// and change later, micros() has come all the way round; a fresh pluck that
+// lands "near" the old one on the wrapped clock is still a fresh pluck.
+void test_guard_outlives_a_full_micros_cycle() {
+  GestureEngine engine{GestureParams()};
+  uint32_t us = 1000000;
+  TEST_ASSERT_EQUAL(Gesture::Idle, engine.update({0.0f, us}));
+  const uint32_t onset = us + 1000;
+  TEST_ASSERT_EQUAL(Gesture::Pluck, engine.update({0.8f, onset}));
+  TEST_ASSERT_EQUAL(Gesture::Idle, engine.update({0.0f, onset + 200000}));
+  for (uint64_t t = 1000000; t < 0x100000000ull; t += 1000000) {
+    TEST_ASSERT_EQUAL(Gesture::Idle, engine.update({0.0f, static_cast<uint32_t>(onset + t)}));
+  }
+  TEST_ASSERT_EQUAL(Gesture::Pluck, engine.update({0.8f, onset + 20000}));  // 2^32 + 20 ms later
+}
+
+// Likewise a contact held past a whole micros() cycle (a cup left resting on
+// the string) is a long contact, not a 10 ms mute.
+void test_hold_longer_than_a_micros_cycle() {
+  GestureEngine engine{GestureParams()};
+  const uint32_t start = 1000000;
+  engine.update({0.0f, start - 1000});
+  TEST_ASSERT_EQUAL(Gesture::Pluck, engine.update({0.8f, start}));
+  for (uint64_t t = 500000; t < 0x100000000ull; t += 500000) {
+    TEST_ASSERT_EQUAL(Gesture::Bow, engine.update({0.8f, static_cast<uint32_t>(start + t)}));
+  }
+  GestureResult r = engine.process({0.0f, start + 10000});
+  TEST_ASSERT_EQUAL(Gesture::Idle, r.gesture);
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu, r.features.contact_us);  // saturated, not wrapped
+}
+
+// A dropout (NaN, inf) carries no information: the engine holds the last
+// value rather than letting one bad read end a bow or poison the velocity.
+void test_non_finite_values_are_held() {
+  GestureEngine engine{GestureParams()};
+  GestureResult first = engine.process({NAN, 1000000});
+  TEST_ASSERT_EQUAL(Gesture::Idle, first.gesture);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, first.features.value);
+  TEST_ASSERT_EQUAL(Gesture::Pluck, engine.update({0.7f, 1001000}));
+  const float junk[] = {NAN, INFINITY, -INFINITY, NAN};
+  uint32_t us = 1002000;
+  for (float x : junk) {
+    GestureResult r = engine.process({x, us += 1000});
+    TEST_ASSERT_EQUAL(Gesture::Bow, r.gesture);
+    TEST_ASSERT_EQUAL_FLOAT(0.7f, r.features.value);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, r.features.velocity);
+  }
+  // Finite but absurd values are clamped to the normalized range.
+  GestureResult big = engine.process({3.0e38f, us += 1000});
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, big.features.value);
+  TEST_ASSERT_EQUAL_FLOAT(300.0f, big.features.velocity);  // 0.3 in 1 ms
+  GestureResult low = engine.process({-3.0e38f, us += 100000});
+  TEST_ASSERT_EQUAL(Gesture::Idle, low.gesture);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, low.features.value);
+  TEST_ASSERT_FALSE(low.features.contact);
+}
+
+// A second of chatter a hair either side of each threshold, one sample per
+// µs. Inside the band it is one contact; straddling the whole band it is one
+// accepted onset per min_retrigger_us at most.
+void test_threshold_chatter() {
+  GestureParams p;
+  GestureEngine engine(p);
+  uint32_t us = 1000000;
+  engine.update({0.0f, us});
+  uint32_t plucks = 0, contacts = 0;
+  bool contact = false;
+  for (uint32_t i = 0; i < 1000000; ++i) {
+    GestureResult r = engine.process({i % 2 ? p.on_thresh + 1e-7f : p.on_thresh - 1e-7f, ++us});
+    plucks += r.gesture == Gesture::Pluck;
+    contacts += r.features.contact && !contact;
+    contact = r.features.contact;
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, plucks);
+  TEST_ASSERT_EQUAL_UINT32(1, contacts);
+
+  plucks = 0;
+  uint32_t scrapes = 0, onsets = 0;
+  for (uint32_t i = 0; i < 1000000; ++i) {
+    GestureResult r = engine.process({i % 2 ? p.on_thresh : p.off_thresh, ++us});
+    plucks += r.gesture == Gesture::Pluck;
+    scrapes += r.gesture == Gesture::Scrape;
+    onsets += r.features.contact && !contact;
+    contact = r.features.contact;
+  }
+  TEST_ASSERT_EQUAL_UINT32(500000, onsets);
+  TEST_ASSERT_TRUE(plucks <= 1000000 / p.min_retrigger_us + 1);
+  TEST_ASSERT_TRUE(scrapes > 0);  // every onset inside the scrape window restarts it
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_random_streams_keep_the_invariants);
+  RUN_TEST(test_micros_wrap_changes_nothing);
+  RUN_TEST(test_guard_outlives_a_full_micros_cycle);
+  RUN_TEST(test_hold_longer_than_a_micros_cycle);
+  RUN_TEST(test_non_finite_values_are_held);
+  RUN_TEST(test_threshold_chatter);
+  return UNITY_END();
+}
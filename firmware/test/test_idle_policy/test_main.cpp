@@ -0,0 +1,185 @@
+#include <math.h>
+#include <unity.h>
+
+#include "idle_policy.h"
+#include "signal_filters.h"
+
+namespace {
+const float kOn = 0.55f;
+const float kOff = 0.40f;  // quiet level = 0.20 with the default margin
+
+// Stand-in for loop(): read at full rate (every `full_us`) unless the policy
+// grants a nap, in which case "sleep" until the next idle sample is due.
+struct Rig {
+  IdlePolicy policy;
+  uint32_t now = 0;
+  uint32_t full_us = 100;
+
+  // Defaults to a sensor smoothed slowly enough that the full 10 ms idle
+  // period is safe, so the tests below see the configured period.
+  explicit Rig(const IdleParams& p = IdleParams(), uint32_t start = 0, float rise_tau_us = 100000.0f)
+      : policy(p), now(start) {
+    policy.set_rise_tau_us(rise_tau_us);
+  }
+
+  template <typename Signal>
+  void run_until(uint32_t end, Signal signal) {
+    while (static_cast<int32_t>(end - now) > 0) {
+      policy.observe({signal(now), now}, kOn, kOff);
+      uint32_t nap = policy.sleep_budget_us(now + full_us);
+      now += full_us;
+      if (nap) {
+        policy.note_slept(nap);
+        now += nap;
+      }
+    }
+  }
+};
+}  // namespace
+
+void test_dozes_only_after_quiet_period() {
+  Rig rig;
+  rig.run_until(1900000, [](uint32_t) { return 0.05f; });
+  TEST_ASSERT_FALSE(rig.policy.dozing());
+  rig.run_until(2100000, [](uint32_t) { return 0.05f; });
+  TEST_ASSERT_TRUE(rig.policy.dozing());
+  rig.policy.observe({0.05f, rig.now}, kOn, kOff);
+  TEST_ASSERT_EQUAL_UINT32(9900, rig.policy.sleep_budget_us(rig.now + 100));
+
+  // Hovering between the quiet level and off_thresh is not quiet: no doze.
+  Rig hover;
+  hover.run_until(5000000, [](uint32_t) { return 0.3f; });
+  TEST_ASSERT_FALSE(hover.policy.dozing());
+}
+
+void test_wakes_before_onset_on_a_real_attack() {
+  Rig rig;
+  rig.run_until(3000000, [](uint32_t) { return 0.02f; });
+  TEST_ASSERT_TRUE(rig.policy.dozing());
+  // A 50 ms rise to 0.9: passes the 0.2 quiet level ~11 ms before on_thresh,
+  // more than one idle period, so the wake lands first.
+  const uint32_t t0 = rig.now + 3333;  // off the sampling grid on purpose
+  auto touch = [t0](uint32_t t) {
+    if (static_cast<int32_t>(t - t0) <= 0) return 0.02f;
+    float x = 0.9f * static_cast<float>(t - t0) / 50000.0f;
+    return x > 0.9f ? 0.9f : x;
+  };
+  uint32_t woke_at = 0;
+  while (rig.now < t0 + 60000) {
+    bool was_dozing = rig.policy.dozing();
+    rig.run_until(rig.now + 1, touch);
+    if (was_dozing && !rig.policy.dozing() && woke_at == 0) woke_at = rig.now;
+    if (woke_at) {
+      // Back at full rate right after the waking sample.
+      TEST_ASSERT_EQUAL_UINT32(0, rig.policy.sleep_budget_us(rig.now));
+    }
+  }
+  IdleStats st = rig.policy.stats();
+  TEST_ASSERT_EQUAL_UINT32(1, st.wakes);
+  TEST_ASSERT_EQUAL_UINT32(0, st.late_wakes);
+  TEST_ASSERT_TRUE(st.last_wake_latency_us <= 10000);
+  TEST_ASSERT_TRUE(touch(woke_at - 100) < kOn);  // full rate before the crossing
+}
+
+void test_late_wake_shrinks_idle_period() {
+  Rig rig;
+  rig.run_until(3000000, [](uint32_t) { return 0.0f; });
+  // A slap: 0 → 1 in one step, so the dozing sample sees it past on_thresh.
+  const uint32_t t0 = rig.now + 5000;
+  rig.run_until(t0 + 20000, [t0](uint32_t t) { return static_cast<int32_t>(t - t0) >= 0 ? 1.0f : 0.0f; });
+  IdleStats st = rig.policy.stats();
+  TEST_ASSERT_EQUAL_UINT32(1, st.late_wakes);
+  TEST_ASSERT_EQUAL_UINT32(5000, st.idle_period_us);
+
+  // Repeated slaps bottom out at the floor.
+  for (int i = 0; i < 5; ++i) {
+    uint32_t quiet_end = rig.now + 2100000;
+    rig.run_until(quiet_end, [](uint32_t) { return 0.0f; });
+    uint32_t hit = rig.now + 100;
+    rig.run_until(hit + 20000, [hit](uint32_t t) { return static_cast<int32_t>(t - hit) >= 0 ? 1.0f : 0.0f; });
+  }
+  TEST_ASSERT_EQUAL_UINT32(1000, rig.policy.stats().idle_period_us);
+}
+
+void test_late_period_recovers_after_on_time_wakes() {
+  Rig rig;
+  rig.run_until(3000000, [](uint32_t) { return 0.0f; });
+  uint32_t hit = rig.now + 100;
+  rig.run_until(hit + 20000, [hit](uint32_t t) { return static_cast<int32_t>(t - hit) >= 0 ? 1.0f : 0.0f; });
+  TEST_ASSERT_EQUAL_UINT32(5000, rig.policy.stats().idle_period_us);
+
+  // Slow touches the dozing board catches before on_thresh, four in a row.
+  for (int i = 0; i < 4; ++i) {
+    rig.run_until(rig.now + 2100000, [](uint32_t) { return 0.0f; });
+    TEST_ASSERT_TRUE(rig.policy.dozing());
+    rig.run_until(rig.now + 20000, [](uint32_t) { return 0.3f; });
+  }
+  IdleStats st = rig.policy.stats();
+  TEST_ASSERT_EQUAL_UINT32(1, st.late_wakes);
+  TEST_ASSERT_EQUAL_UINT32(10000, st.idle_period_us);
+}
+
+void test_percussive_sensor_never_dozes() {
+  Rig rig(IdleParams(), 0, 0.0f);  // piezo: no smoothing to lean on
+  rig.run_until(5000000, [](uint32_t) { return 0.0f; });
+  TEST_ASSERT_FALSE(rig.policy.dozing());
+  TEST_ASSERT_FALSE(rig.policy.stats().can_doze);
+  TEST_ASSERT_EQUAL_UINT32(0, rig.policy.sleep_budget_us(rig.now));
+}
+
+void test_onset_latency_survives_a_doze() {
+  // An optical-style envelope: a 9.5 ms one-pole over a full-scale slap,
+  // which is the fastest that sensor's output can ever climb. Whatever the
+  // slap's phase against the dozing grid, on_thresh must be seen no later
+  // than the envelope really crosses it plus one full-rate read.
+  const float tau = 9500.0f;
+  const uint32_t cross_us = static_cast<uint32_t>(tau * logf(1.0f / (1.0f - kOn)));
+  for (uint32_t phase = 0; phase < 10000; phase += 777) {
+    Rig rig(IdleParams(), 0, tau);
+    rig.run_until(3000000, [](uint32_t) { return 0.0f; });
+    TEST_ASSERT_TRUE(rig.policy.dozing());
+    TEST_ASSERT_TRUE(rig.policy.stats().idle_period_us < 10000);  // held under the rise
+
+    const uint32_t t0 = rig.now + phase;
+    OnePole env(tau);
+    env.reset(0.0f, rig.now);
+    uint32_t seen = 0;
+    auto slap = [&](uint32_t t) {
+      float y = env.update(static_cast<int32_t>(t - t0) >= 0 ? 1.0f : 0.0f, t);
+      if (y >= kOn && seen == 0) seen = t;
+      return y;
+    };
+    while (seen == 0) rig.run_until(rig.now + 1, slap);
+    TEST_ASSERT_EQUAL_UINT32(0, rig.policy.stats().late_wakes);
+    TEST_ASSERT_TRUE(seen <= t0 + cross_us + rig.full_us);
+  }
+}
+
+void test_duty_cycle_and_wraparound() {
+  IdleParams p;
+  p.idle_after_us = 1000000;
+  Rig rig(p, 0xFFFFFFFFu - 500000);  // micros() wraps during the run
+  uint32_t end = rig.now + 11000000;
+  rig.run_until(end, [](uint32_t) { return 0.01f; });
+  IdleStats st = rig.policy.stats();
+  // 1 s at full rate, then 10 s of 100 µs awake per 10 ms.
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, (1.0f + 10.0f * 0.01f) / 11.0f, st.duty);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 10.0f / 11.0f, st.dozing);
+
+  rig.policy.set_enabled(false);
+  TEST_ASSERT_FALSE(rig.policy.dozing());
+  rig.run_until(rig.now + 3000000, [](uint32_t) { return 0.01f; });
+  TEST_ASSERT_FALSE(rig.policy.dozing());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_dozes_only_after_quiet_period);
+  RUN_TEST(test_wakes_before_onset_on_a_real_attack);
+  RUN_TEST(test_late_wake_shrinks_idle_period);
+  RUN_TEST(test_late_period_recovers_after_on_time_wakes);
+  RUN_TEST(test_percussive_sensor_never_dozes);
+  RUN_TEST(test_onset_latency_survives_a_doze);
+  RUN_TEST(test_duty_cycle_and_wraparound);
+  return UNITY_END();
+}
@@ -0,0 +1,208 @@
+#include <unity.h>
+
+#include "midi_output.h"
+
+enum class Kind { NoteOn, NoteOff, Cc, Bend, Pressure };
+
+struct Msg {
+  Kind kind;
+  int a;  // note / cc number / bend / pressure
+  int b;  // velocity / cc value
+  int ch;
+};
+
+class RecordingSink : public MidiSink {
+ public:
+  Msg log[128];
+  int count = 0;
+
+  void note_on(uint8_t note, uint8_t velocity, uint8_t channel) override { push({Kind::NoteOn, note, velocity, channel}); }
+  void note_off(uint8_t note, uint8_t velocity, uint8_t channel) override { push({Kind::NoteOff, note, velocity, channel}); }
+  void control_change(uint8_t number, uint8_t value, uint8_t channel) override { push({Kind::Cc, number, value, channel}); }
+  void pitch_bend(int16_t bend, uint8_t channel) override { push({Kind::Bend, bend, 0, channel}); }
+  void channel_pressure(uint8_t pressure, uint8_t channel) override { push({Kind::Pressure, pressure, 0, channel}); }
+
+  void clear() { count = 0; }
+  int count_kind(Kind k) const {
+    int n = 0;
+    for (int i = 0; i < count; ++i) n += log[i].kind == k;
+    return n;
+  }
+
+ private:
+  void push(const Msg& m) {
+    if (count < 128) log[count++] = m;
+  }
+};
+
+static void assert_msg(const Msg& m, Kind kind, int a, int b, int ch) {
+  TEST_ASSERT_EQUAL(kind, m.kind);
+  TEST_ASSERT_EQUAL(a, m.a);
+  TEST_ASSERT_EQUAL(b, m.b);
+  TEST_ASSERT_EQUAL(ch, m.ch);
+}
+
+void test_global_mode_keeps_classic_lanes() {
+  RecordingSink sink;
+  MidiVoiceRouter router(sink);
+
+  router.note_on(60, 100);
+  router.set_pressure(60, 40);
+  router.set_pressure(60, 40);  // unchanged → stays off the wire
+  router.set_timbre(60, 90);
+  router.set_bend(60, 1000);
+
+  TEST_ASSERT_EQUAL(4, sink.count);
+  assert_msg(sink.log[0], Kind::NoteOn, 60, 100, 1);
+  assert_msg(sink.log[1], Kind::Cc, 1, 40, 1);
+  assert_msg(sink.log[2], Kind::Cc, 11, 90, 1);
+  assert_msg(sink.log[3], Kind::Bend, 1000, 0, 1);
+}
+
+void test_mpe_mode_announces_zone() {
+  RecordingSink sink;
+  MidiVoiceRouter router(sink, 4);
+  router.set_mode(MidiMode::Mpe);
+
+  // CC123 from the implicit all-notes-off, then RPN 6 = 4 members, then RPN null.
+  TEST_ASSERT_EQUAL(6 + 4 * 6, sink.count);
+  assert_msg(sink.log[0], Kind::Cc, 123, 0, 1);
+  assert_msg(sink.log[1], Kind::Cc, 101, 0, 1);
+  assert_msg(sink.log[2], Kind::Cc, 100, 6, 1);
+  assert_msg(sink.log[3], Kind::Cc, 6, 4, 1);
+  assert_msg(sink.log[4], Kind::Cc, 101, 127, 1);
+  assert_msg(sink.log[5], Kind::Cc, 100, 127, 1);
+  // Then each member's bend range back to ±2 semitones (RPN 0), so a
+  // full-scale bend means the same in MPE as on the Global channel.
+  for (uint8_t m = 0; m < 4; ++m) {
+    const Msg* r = &sink.log[6 + 6 * m];
+    uint8_t ch = static_cast<uint8_t>(2 + m);
+    assert_msg(r[0], Kind::Cc, 101, 0, ch);
+    assert_msg(r[1], Kind::Cc, 100, 0, ch);
+    assert_msg(r[2], Kind::Cc, 6, 2, ch);
+    assert_msg(r[3], Kind::Cc, 38, 0, ch);
+    assert_msg(r[4], Kind::Cc, 101, 127, ch);
+    assert_msg(r[5], Kind::Cc, 100, 127, ch);
+  }
+}
+
+void test_mpe_expression_stays_on_its_note() {
+  RecordingSink sink;
+  MidiVoiceRouter router(sink);
+  router.set_mode(MidiMode::Mpe);
+  sink.clear();
+
+  router.note_on(60, 90);
+  router.note_on(64, 80);
+  TEST_ASSERT_EQUAL(2, router.channel_for(60));
+  TEST_ASSERT_EQUAL(3, router.channel_for(64));
+  // Each note: neutral bend, timbre, pressure, then the NoteOn.
+  TEST_ASSERT_EQUAL(8, sink.count);
+  assert_msg(sink.log[0], Kind::Bend, 0, 0, 2);
+  assert_msg(sink.log[1], Kind::Cc, 74, 64, 2);
+  assert_msg(sink.log[2], Kind::Pressure, 0, 0, 2);
+  assert_msg(sink.log[3], Kind::NoteOn, 60, 90, 2);
+  assert_msg(sink.log[7], Kind::NoteOn, 64, 80, 3);
+  sink.clear();
+
+  router.set_bend(64, -2048);
+  router.set_bend(64, -2048);
+  router.set_pressure(60, 70);
+  router.set_pressure(60, 70);
+  router.set_timbre(64, 64);  // already neutral from the note-on
+  TEST_ASSERT_EQUAL(2, sink.count);
+  assert_msg(sink.log[0], Kind::Bend, -2048, 0, 3);
+  assert_msg(sink.log[1], Kind::Pressure, 70, 0, 2);
+}
+
+void test_mpe_reuses_quietest_channel_and_steals_oldest() {
+  RecordingSink sink;
+  MidiVoiceRouter router(sink, 2);
+  router.set_mode(MidiMode::Mpe);
+
+  router.note_on(60, 100);  // ch2
+  router.note_on(62, 100);  // ch3
+  router.note_off(60);      // ch2 free
+  router.note_on(64, 100);
+  TEST_ASSERT_EQUAL(2, router.channel_for(64));
+  sink.clear();
+
+  // Both members busy: the oldest voice (62 on ch3) is stolen.
+  router.note_on(67, 100);
+  TEST_ASSERT_EQUAL(0, router.channel_for(62));
+  TEST_ASSERT_EQUAL(3, router.channel_for(67));
+  assert_msg(sink.log[0], Kind::NoteOff, 62, 0, 3);
+  assert_msg(sink.log[sink.count - 1], Kind::NoteOn, 67, 100, 3);
+}
+
+void test_mode_switch_releases_sounding_notes() {
+  RecordingSink sink;
+  MidiVoiceRouter router(sink);
+  router.set_mode(MidiMode::Mpe);
+  router.note_on(60, 100);
+  router.note_on(65, 100);
+  sink.clear();
+
+  router.set_mode(MidiMode::Global);
+  TEST_ASSERT_EQUAL(2, sink.count_kind(Kind::NoteOff));
+  // Zone closed with zero members.
+  assert_msg(sink.log[4], Kind::Cc, 6, 0, 1);
+  TEST_ASSERT_EQUAL(MidiMode::Global, router.mode());
+  TEST_ASSERT_EQUAL(1, router.channel_for(60));
+}
+
+void test_zone_wide_expression_without_a_note() {
+  RecordingSink sink;
+  MidiVoiceRouter router(sink);
+  router.set_mode(MidiMode::Mpe);
+  sink.clear();
+
+  router.set_timbre(-1, 20);
+  router.set_bend(72, 300);  // not sounding → manager channel
+  TEST_ASSERT_EQUAL(2, sink.count);
+  assert_msg(sink.log[0], Kind::Cc, 74, 20, 1);
+  assert_msg(sink.log[1], Kind::Bend, 300, 0, 1);
+}
+
+void test_routed_cc_keeps_expression_cache_honest() {
+  // Global: a route writes CC11 directly; timbre's cache must follow, so
+  // restoring the earlier timbre value goes back on the wire.
+  RecordingSink sink;
+  MidiVoiceRouter router(sink);
+  router.set_timbre(-1, 90);
+  router.set_cc(-1, 11, 30);
+  router.set_timbre(-1, 90);
+  router.set_pressure(-1, 40);
+  router.set_cc(-1, 1, 100);
+  router.set_pressure(-1, 40);
+  router.set_cc(-1, 20, 5);    // not a lane: passes straight through
+  router.set_timbre(-1, 90);   // unchanged since it was restored → silent
+  TEST_ASSERT_EQUAL(7, sink.count);
+  assert_msg(sink.log[2], Kind::Cc, 11, 90, 1);
+  assert_msg(sink.log[5], Kind::Cc, 1, 40, 1);
+  assert_msg(sink.log[6], Kind::Cc, 20, 5, 1);
+
+  // MPE: CC74 on the note's channel is the timbre lane there.
+  RecordingSink mpe_sink;
+  MidiVoiceRouter mpe(mpe_sink);
+  mpe.set_mode(MidiMode::Mpe);
+  mpe.note_on(60, 100);  // timbre starts at 64 on its channel
+  uint8_t ch = mpe.channel_for(60);
+  mpe_sink.clear();
+  mpe.set_cc(60, 74, 120);
+  mpe.set_timbre(60, 64);
+  TEST_ASSERT_EQUAL(2, mpe_sink.count);
+  assert_msg(mpe_sink.log[1], Kind::Cc, 74, 64, ch);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_global_mode_keeps_classic_lanes);
+  RUN_TEST(test_mpe_mode_announces_zone);
+  RUN_TEST(test_mpe_expression_stays_on_its_note);
+  RUN_TEST(test_mpe_reuses_quietest_channel_and_steals_oldest);
+  RUN_TEST(test_mode_switch_releases_sounding_notes);
+  RUN_TEST(test_zone_wide_expression_without_a_note);
+  RUN_TEST(test_routed_cc_keeps_expression_cache_honest);
+  return UNITY_END();
+}
@@ -0,0 +1,287 @@
+#include <string.h>
+#include <unity.h>
+
+#include "midi_routes.h"
+
+enum class Kind { NoteOn, NoteOff, Cc, Bend, Pressure };
+
+struct Msg {
+  Kind kind;
+  int a;  // note / cc number / bend / pressure
+  int b;  // velocity / cc value
+  int ch;
+};
+
+class RecordingSink : public MidiSink {
+ public:
+  Msg log[64];
+  int count = 0;
+
+  void note_on(uint8_t note, uint8_t velocity, uint8_t channel) override { push({Kind::NoteOn, note, velocity, channel}); }
+  void note_off(uint8_t note, uint8_t velocity, uint8_t channel) override { push({Kind::NoteOff, note, velocity, channel}); }
+  void control_change(uint8_t number, uint8_t value, uint8_t channel) override { push({Kind::Cc, number, value, channel}); }
+  void pitch_bend(int16_t bend, uint8_t channel) override { push({Kind::Bend, bend, 0, channel}); }
+  void channel_pressure(uint8_t pressure, uint8_t channel) override { push({Kind::Pressure, pressure, 0, channel}); }
+
+  void clear() { count = 0; }
+
+ private:
+  void push(const Msg& m) {
+    if (count < 64) log[count++] = m;
+  }
+};
+
+// The firmware's round-robin scale, reduced to a counter.
+class Scale : public NoteSupply {
+ public:
+  uint8_t next = 60;
+  uint8_t next_note() override { return next++; }
+};
+
+static void assert_msg(const Msg& m, Kind kind, int a, int b, int ch) {
+  TEST_ASSERT_EQUAL(kind, m.kind);
+  TEST_ASSERT_EQUAL(a, m.a);
+  TEST_ASSERT_EQUAL(b, m.b);
+  TEST_ASSERT_EQUAL(ch, m.ch);
+}
+
+static RouteFrame frame(Gesture g, float value, bool contact = true) {
+  GestureResult r;
+  r.gesture = g;
+  r.features.value = value;
+  r.features.contact = contact;
+  return route_frame(r);
+}
+
+void test_defaults_play_the_old_mapping() {
+  RecordingSink sink;
+  MidiVoiceRouter midi(sink);
+  RouteMatrix routes;
+  Scale scale;
+
+  GestureResult pluck;
+  pluck.gesture = Gesture::Pluck;
+  pluck.features.contact = true;
+  pluck.features.strike = 1.0f;
+  RouteOutcome o = routes.dispatch(route_frame(pluck), midi, scale);
+  TEST_ASSERT_EQUAL(60, o.note);
+  TEST_ASSERT_EQUAL_UINT8(127, o.velocity);
+  assert_msg(sink.log[0], Kind::NoteOn, 60, 127, 1);
+
+  routes.dispatch(frame(Gesture::Bow, 0.5f), midi, scale);  // CC1, as 0.5 * 127 truncated
+  routes.dispatch(frame(Gesture::Bow, 0.5f), midi, scale);  // unchanged: nothing
+  routes.dispatch(frame(Gesture::Tremolo, 0.25f), midi, scale);
+  TEST_ASSERT_EQUAL(3, sink.count);
+  assert_msg(sink.log[1], Kind::Cc, 1, 63, 1);
+  assert_msg(sink.log[2], Kind::Cc, 11, 31, 1);
+
+  // Vibrato: bend around the wobble's center, then rate and depth knobs.
+  GestureResult vib;
+  vib.gesture = Gesture::Vibrato;
+  vib.features.contact = true;
+  vib.features.value = 0.5f;
+  vib.features.wobble_center = 0.5f;
+  vib.features.wobble_rate_hz = 8.0f;
+  vib.features.wobble_depth = 0.5f;
+  sink.clear();
+  routes.dispatch(route_frame(vib), midi, scale);
+  TEST_ASSERT_EQUAL(3, sink.count);
+  assert_msg(sink.log[0], Kind::Bend, 0, 0, 1);  // centered means centered
+  assert_msg(sink.log[1], Kind::Cc, 76, 63, 1);
+  assert_msg(sink.log[2], Kind::Cc, 77, 63, 1);
+
+  sink.clear();
+  o = routes.dispatch(frame(Gesture::Harmonic, 0.2f), midi, scale);
+  TEST_ASSERT_EQUAL(61 + 12, o.note);
+  assert_msg(sink.log[0], Kind::NoteOff, 60, 0, 1);  // no stacked notes
+  assert_msg(sink.log[1], Kind::NoteOn, 73, 96, 1);
+
+  sink.clear();
+  o = routes.dispatch(frame(Gesture::Scrape, 0.2f), midi, scale);
+  assert_msg(sink.log[0], Kind::NoteOn, 62, 50, 1);
+  assert_msg(sink.log[1], Kind::NoteOff, 62, 0, 1);
+  TEST_ASSERT_EQUAL(73, routes.current_note());  // grains leave the sustain alone
+
+  sink.clear();
+  o = routes.dispatch(frame(Gesture::Muted, 0.0f), midi, scale);
+  TEST_ASSERT_EQUAL(73, o.released);
+  assert_msg(sink.log[0], Kind::NoteOff, 73, 0, 1);
+  TEST_ASSERT_EQUAL(-1, routes.current_note());
+}
+
+void test_curves() {
+  RouteSpec s;
+  int16_t lut[128];
+  build_route_curve(s, lut);  // linear 0..127 is the identity
+  for (int i = 0; i < 128; ++i) TEST_ASSERT_EQUAL_INT16(i, lut[i]);
+
+  s.shape = CurveShape::Exp;
+  s.k = 2.0f;
+  build_route_curve(s, lut);
+  TEST_ASSERT_EQUAL_INT16(0, lut[0]);
+  TEST_ASSERT_EQUAL_INT16(127, lut[127]);
+  TEST_ASSERT_EQUAL_INT16(32, lut[64]);  // (64/127)^2 * 127 ≈ 32.3: slow start
+  s.shape = CurveShape::Log;
+  build_route_curve(s, lut);
+  TEST_ASSERT_EQUAL_INT16(96, lut[64]);  // 1 - (63/127)^2 ≈ 0.754: fast start
+  for (int i = 1; i < 128; ++i) TEST_ASSERT_TRUE(lut[i] >= lut[i - 1]);
+
+  // Out-of-range endpoints are clamped to what the destination can carry.
+  s.shape = CurveShape::Linear;
+  s.dest = RouteDest::Note;
+  s.lo = 0;
+  build_route_curve(s, lut);
+  TEST_ASSERT_EQUAL_INT16(1, lut[0]);  // velocity 0 would be a note-off
+
+  s.dest = RouteDest::Bend;
+  s.shape = CurveShape::Points;
+  s.point_count = 3;
+  s.point_in[0] = 32;
+  s.point_out[0] = -4000;
+  s.point_in[1] = 64;
+  s.point_out[1] = 0;
+  s.point_in[2] = 96;
+  s.point_out[2] = 4000;
+  build_route_curve(s, lut);
+  TEST_ASSERT_EQUAL_INT16(-4000, lut[0]);  // flat outside the points
+  TEST_ASSERT_EQUAL_INT16(-2000, lut[48]);
+  TEST_ASSERT_EQUAL_INT16(0, lut[64]);
+  TEST_ASSERT_EQUAL_INT16(4000, lut[127]);
+}
+
+void test_parse_and_list_round_trip() {
+  RouteSpec s;
+  const char* err = nullptr;
+  TEST_ASSERT_FALSE(parse_route_spec("{\"routes\":\"list\"}", &s, &err));
+  TEST_ASSERT_TRUE(parse_route_spec(
+      "{\"route\":{\"on\":\"bow\", \"in\":\"value\", \"to\":\"cc\", \"cc\":74, \"curve\":\"exp\", \"k\":1.5, \"lo\":10}}", &s,
+      &err));
+  TEST_ASSERT_NULL(err);
+  TEST_ASSERT_EQUAL(RouteTrigger::Bow, s.trigger);
+  TEST_ASSERT_EQUAL(RouteDest::Cc, s.dest);
+  TEST_ASSERT_EQUAL_INT16(74, s.param);  // "to":"cc" did not shadow "cc":74
+  TEST_ASSERT_EQUAL(CurveShape::Exp, s.shape);
+  TEST_ASSERT_EQUAL_INT16(10, s.lo);
+  TEST_ASSERT_EQUAL_INT16(127, s.hi);
+
+  char text[kRouteJsonMax];
+  format_route_spec(s, text);
+  TEST_ASSERT_EQUAL_STRING("{\"route\":{\"on\":\"bow\",\"in\":\"value\",\"to\":\"cc\",\"cc\":74,\"curve\":\"exp\",\"k\":1.50,\"lo\":10,\"hi\":127}}",
+                           text);
+  RouteSpec again;
+  TEST_ASSERT_TRUE(parse_route_spec(text, &again, &err));
+  TEST_ASSERT_NULL(err);
+  TEST_ASSERT_EQUAL_INT16(s.param, again.param);
+  TEST_ASSERT_EQUAL_FLOAT(s.k, again.k);
+
+  TEST_ASSERT_TRUE(parse_route_spec("{\"route\":{\"on\":\"vibrato\",\"in\":\"wobble\",\"to\":\"bend\",\"pts\":[0,-8192, 64,0, 127,8191]}}",
+                                    &s, &err));
+  TEST_ASSERT_NULL(err);
+  TEST_ASSERT_EQUAL(CurveShape::Points, s.shape);
+  TEST_ASSERT_EQUAL_UINT8(3, s.point_count);
+  TEST_ASSERT_EQUAL_INT16(-8192, s.point_out[0]);
+  format_route_spec(s, text);
+  TEST_ASSERT_EQUAL_STRING("{\"route\":{\"on\":\"vibrato\",\"in\":\"wobble\",\"to\":\"bend\",\"curve\":\"pts\",\"pts\":[0,-8192,64,0,127,8191]}}",
+                           text);
+
+  // Typos are reported, not guessed at.
+  const char* bad[] = {
+      "{\"route\":{\"on\":\"bowing\",\"to\":\"pressure\"}}",
+      "{\"route\":{\"on\":\"bow\"}}",
+      "{\"route\":{\"on\":\"bow\",\"to\":\"cc\"}}",
+      "{\"route\":{\"on\":\"bow\",\"to\":\"cc\",\"cc\":123}}",
+      "{\"route\":{\"on\":\"bow\",\"to\":\"pressure\",\"hi\":300}}",
+      "{\"route\":{\"on\":\"bow\",\"to\":\"pressure\",\"curve\":\"exp\",\"k\":0}}",
+      "{\"route\":{\"on\":\"bow\",\"to\":\"pressure\",\"pts\":[64,0,32,127]}}",
+      "{\"route\":{\"on\":\"bow\",\"to\":\"pressure\",\"curve\":\"pts\"}}",
+  };
+  for (const char* line : bad) {
+    err = nullptr;
+    TEST_ASSERT_TRUE(parse_route_spec(line, &s, &err));
+    TEST_ASSERT_TRUE_MESSAGE(err != nullptr, line);
+  }
+}
+
+void test_staging_is_invisible_until_commit() {
+  RecordingSink sink;
+  MidiVoiceRouter midi(sink);
+  midi.set_mode(MidiMode::Mpe);
+  RouteMatrix routes;
+  Scale scale;
+  const uint8_t defaults = routes.count();
+
+  RouteSpec s;
+  const char* err = nullptr;
+  parse_route_spec("{\"route\":{\"on\":\"pluck\",\"in\":\"strike\",\"to\":\"note\",\"tr\":-12}}", &s, &err);
+  TEST_ASSERT_TRUE(routes.add(s));
+  parse_route_spec("{\"route\":{\"on\":\"contact\",\"to\":\"cc\",\"cc\":74,\"curve\":\"log\",\"k\":3}}", &s, &err);
+  TEST_ASSERT_TRUE(routes.add(s));
+  TEST_ASSERT_EQUAL_UINT8(2, routes.staged());
+  TEST_ASSERT_EQUAL_UINT8(defaults, routes.count());
+
+  // Still the old table: bow pressure goes out, the staged CC74 does not.
+  sink.clear();
+  routes.dispatch(frame(Gesture::Bow, 0.5f), midi, scale);
+  TEST_ASSERT_EQUAL(1, sink.count);
+  assert_msg(sink.log[0], Kind::Pressure, 63, 0, 1);
+
+  routes.commit();
+  TEST_ASSERT_EQUAL_UINT8(2, routes.count());
+  TEST_ASSERT_EQUAL_UINT8(0, routes.staged());
+
+  // Pluck an octave down on its own MPE channel, then CC74 rides that channel
+  // on every contact frame, change-only.
+  GestureResult pluck;
+  pluck.gesture = Gesture::Pluck;
+  pluck.features.contact = true;
+  pluck.features.value = 0.5f;
+  pluck.features.strike = 0.5f;
+  sink.clear();
+  RouteOutcome o = routes.dispatch(route_frame(pluck), midi, scale);
+  TEST_ASSERT_EQUAL(48, o.note);
+  const int ch = midi.channel_for(48);
+  TEST_ASSERT_TRUE(ch >= 2);
+  TEST_ASSERT_EQUAL(Kind::NoteOn, sink.log[sink.count - 2].kind);
+  assert_msg(sink.log[sink.count - 1], Kind::Cc, 74, 111, ch);  // 1 - (1 - 63/127)^3
+  sink.clear();
+  routes.dispatch(frame(Gesture::Bow, 0.5f), midi, scale);
+  TEST_ASSERT_EQUAL(0, sink.count);  // same value; and bow has no route now
+
+  // Contact ends: the note-off happens even though no route asks for it.
+  o = routes.dispatch(frame(Gesture::Idle, 0.0f, false), midi, scale);
+  TEST_ASSERT_EQUAL(48, o.released);
+  assert_msg(sink.log[0], Kind::NoteOff, 48, 0, ch);
+
+  // Staging fills up without touching what plays.
+  for (uint8_t i = 0; i < RouteMatrix::kMaxRoutes; ++i) TEST_ASSERT_TRUE(routes.add(s));
+  TEST_ASSERT_FALSE(routes.add(s));
+  routes.discard();
+  TEST_ASSERT_EQUAL_UINT8(0, routes.staged());
+  TEST_ASSERT_EQUAL_UINT8(2, routes.count());
+
+  routes.load_defaults();
+  TEST_ASSERT_EQUAL_UINT8(defaults, routes.count());
+}
+
+void test_nan_features_stay_in_the_table() {
+  GestureResult r;
+  r.gesture = Gesture::Vibrato;
+  r.features.value = 0.0f / 0.0f;
+  r.features.strike = 5.0f;
+  r.features.wobble_rate_hz = -3.0f;
+  r.confidence = 0.0f / 0.0f;
+  RouteFrame f = route_frame(r);
+  for (uint8_t i = 0; i < kRouteInputCount; ++i) TEST_ASSERT_TRUE(f.in[i] <= 127);
+  TEST_ASSERT_EQUAL_UINT8(127, f.in[static_cast<uint8_t>(RouteInput::Strike)]);
+  TEST_ASSERT_EQUAL_UINT8(0, f.in[static_cast<uint8_t>(RouteInput::Value)]);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_defaults_play_the_old_mapping);
+  RUN_TEST(test_curves);
+  RUN_TEST(test_parse_and_list_round_trip);
+  RUN_TEST(test_staging_is_invisible_until_commit);
+  RUN_TEST(test_nan_features_stay_in_the_table);
+  return UNITY_END();
+}
@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include <string>
+
+#include "midi_transport.h"
+
+namespace {
+// Host stand-in for the USB link: one timeline of what reached the host, in
+// order. MIDI shows up as "[90 3C 64]", text as itself. `room` models the CDC
+// buffer; `shared` puts MIDI bytes in that same buffer (the non-MIDI_USB build).
+struct Host : public MidiPort, public TextPort {
+  std::string wire;
+  size_t room = 1 << 20;
+  bool shared = false;
+
+  bool send(const MidiMessage& m) override {
+    if (shared) {
+      if (room < 3) return false;
+      room -= 3;
+    }
+    char buf[16];
+    snprintf(buf, sizeof(buf), "[%02X %02X %02X]", m.status, m.data1, m.data2);
+    wire += buf;
+    return true;
+  }
+  bool shares_text_port() const override { return shared; }
+  size_t writable() override { return room; }
+  size_t write(const char* data, size_t n) override {
+    if (n > room) n = room;
+    wire.append(data, n);
+    room -= n;
+    return n;
+  }
+};
+
+void print(LineQueue& q, const char* s) {
+  while (*s) q.put(*s++);
+}
+}  // namespace
+
+void test_note_on_never_waits_behind_json() {
+  MidiQueue midi;
+  MidiQueueSink sink(midi);
+  LineQueue text;
+  Host host;
+  TransportPump pump(midi, host, text, host);
+
+  // The loop narrates first, then plays: telemetry is queued before the note.
+  print(text, "{\"gesture\":\"pluck\",\"value\":90,\"note\":60}\n");
+  sink.note_on(60, 100, 1);
+  pump.pump();
+  TEST_ASSERT_EQUAL_STRING("[90 3C 64]{\"gesture\":\"pluck\",\"value\":90,\"note\":60}\n", host.wire.c_str());
+}
+
+void test_busy_shared_link_holds_text_back() {
+  MidiQueue midi;
+  MidiQueueSink sink(midi);
+  LineQueue text;
+  Host host;
+  host.shared = true;
+  TransportPump pump(midi, host, text, host);
+
+  print(text, "{\"gesture\":\"bow\"}\n");
+  sink.note_on(62, 90, 1);
+  sink.note_off(60, 0, 1);
+  host.room = 4;  // one message fits, the second does not
+  pump.pump();
+  TEST_ASSERT_EQUAL_STRING("[90 3E 5A]", host.wire.c_str());
+  TEST_ASSERT_EQUAL_UINT8(1, midi.size());
+
+  host.room = 64;
+  pump.pump();
+  TEST_ASSERT_EQUAL_STRING("[90 3E 5A][80 3C 00]{\"gesture\":\"bow\"}\n", host.wire.c_str());
+}
+
+void test_shared_link_never_splits_a_line() {
+  MidiQueue midi;
+  MidiQueueSink sink(midi);
+  LineQueue text;
+  Host host;
+  host.shared = true;
+  TransportPump pump(midi, host, text, host);
+
+  print(text, "{\"gesture\":\"bow\",\"value\":40}\n{\"ok\":true}\n");
+  host.room = 5;
+  pump.pump();  // the port takes "{\"ges" and nothing more
+  TEST_ASSERT_EQUAL_STRING("{\"ges", host.wire.c_str());
+
+  // A note arrives mid-line: the line finishes first, through small windows,
+  // then the note goes ahead of the next line.
+  sink.note_on(64, 100, 1);
+  while (midi.size() > 0) {
+    host.room = 5;
+    pump.pump();
+  }
+  for (int i = 0; i < 10; ++i) {
+    host.room = 5;
+    pump.pump();
+  }
+  TEST_ASSERT_EQUAL_STRING("{\"gesture\":\"bow\",\"value\":40}\n[90 40 64]{\"ok\":true}\n", host.wire.c_str());
+}
+
+void test_lines_are_whole_or_dropped() {
+  LineQueue text;
+  print(text, "{\"partial\":");  // not drainable until its newline
+  TEST_ASSERT_EQUAL(0u, text.pending());
+
+  // Fill the rest of the ring, then overflow mid-line.
+  std::string line(100, 'x');
+  line += '\n';
+  while (text.dropped_lines() == 0) print(text, line.c_str());
+  TEST_ASSERT_EQUAL_UINT32(1, text.dropped_lines());
+  // Every committed byte belongs to a complete line.
+  const char* data = nullptr;
+  size_t n = text.peek(&data);
+  TEST_ASSERT_EQUAL('\n', data[n - 1]);
+
+  // Draining makes room again; the next line goes through intact.
+  text.consume(n);
+  print(text, "{\"ok\":1}\n");
+  n = text.peek(&data);
+  TEST_ASSERT_EQUAL(9u, n);
+  TEST_ASSERT_EQUAL_INT(0, strncmp(data, "{\"ok\":1}\n", 9));
+}
+
+void test_text_resumes_across_wrap_and_small_windows() {
+  MidiQueue midi;
+  LineQueue text;
+  Host host;
+  TransportPump pump(midi, host, text, host);
+  std::string expected;
+  // Push well past the ring size, draining through a 7-byte window.
+  for (int i = 0; i < 200; ++i) {
+    char line[32];
+    snprintf(line, sizeof(line), "{\"raw\":[%d,0.5]}\n", i * 1000);
+    print(text, line);
+    expected += line;
+    for (int k = 0; k < 4; ++k) {
+      host.room = 7;
+      pump.pump();
+    }
+  }
+  while (text.pending() > 0) {
+    host.room = 7;
+    pump.pump();
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, text.dropped_lines());
+  TEST_ASSERT_TRUE(expected == host.wire);
+}
+
+void test_midi_queue_is_bounded_and_encodes() {
+  MidiQueue midi;
+  MidiQueueSink sink(midi);
+  sink.pitch_bend(0, 2);
+  sink.pitch_bend(-8192, 16);
+  sink.channel_pressure(77, 3);
+  const MidiMessage* m = midi.front();
+  TEST_ASSERT_EQUAL_HEX8(0xE1, m->status);
+  TEST_ASSERT_EQUAL_HEX8(0x00, m->data1);
+  TEST_ASSERT_EQUAL_HEX8(0x40, m->data2);
+  TEST_ASSERT_EQUAL_INT16(0, m->bend());
+  midi.pop();
+  TEST_ASSERT_EQUAL_HEX8(0xEF, midi.front()->status);
+  TEST_ASSERT_EQUAL_INT16(-8192, midi.front()->bend());
+  midi.pop();
+  TEST_ASSERT_EQUAL(3, midi.front()->channel());
+  midi.pop();
+
+  for (int i = 0; i < MidiQueue::kCapacity + 5; ++i) sink.control_change(1, static_cast<uint8_t>(i), 1);
+  TEST_ASSERT_EQUAL_UINT8(MidiQueue::kCapacity, midi.size());
+  TEST_ASSERT_EQUAL_UINT32(5, midi.dropped());
+  TEST_ASSERT_EQUAL_UINT8(0, midi.front()->data2);  // oldest kept, newest dropped
+}
+
+void test_full_queue_keeps_note_offs() {
+  MidiQueue midi;
+  MidiQueueSink sink(midi);
+  sink.note_on(60, 100, 1);
+  for (int i = 1; i < MidiQueue::kCapacity; ++i) sink.control_change(1, static_cast<uint8_t>(i), 1);
+  sink.note_off(60, 0, 1);  // takes the newest CC's slot
+  TEST_ASSERT_EQUAL_UINT8(MidiQueue::kCapacity, midi.size());
+  TEST_ASSERT_EQUAL_UINT32(1, midi.dropped());
+
+  // Full of notes: a note-off displaces the newest NoteOn, never another note-off.
+  MidiQueue notes;
+  MidiQueueSink notes_sink(notes);
+  for (int i = 0; i < MidiQueue::kCapacity / 2; ++i) {
+    notes_sink.note_on(static_cast<uint8_t>(40 + i), 100, 1);
+    notes_sink.note_off(static_cast<uint8_t>(40 + i), 0, 1);
+  }
+  notes_sink.note_on(90, 100, 1);   // no room, and not a note-off: dropped
+  notes_sink.note_off(91, 0, 1);    // evicts NoteOn 71
+  TEST_ASSERT_EQUAL_UINT32(2, notes.dropped());
+  uint8_t ons = 0, offs = 0;
+  const MidiMessage* last = nullptr;
+  while (const MidiMessage* m = notes.front()) {
+    ons += m->type() == kMidiNoteOn;
+    offs += m->type() == kMidiNoteOff;
+    last = m;
+    notes.pop();
+  }
+  TEST_ASSERT_EQUAL_UINT8(MidiQueue::kCapacity / 2 - 1, ons);
+  TEST_ASSERT_EQUAL_UINT8(MidiQueue::kCapacity / 2 + 1, offs);
+  TEST_ASSERT_EQUAL_UINT8(91, last->data1);
+
+  // A queue of nothing but note-offs has nothing to give up: the newest is lost, and counted.
+  MidiQueue offs_only;
+  MidiQueueSink offs_sink(offs_only);
+  for (int i = 0; i < MidiQueue::kCapacity + 3; ++i) offs_sink.note_off(60, 0, 1);
+  TEST_ASSERT_EQUAL_UINT32(3, offs_only.dropped());
+  TEST_ASSERT_EQUAL_UINT8(MidiQueue::kCapacity, offs_only.size());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_note_on_never_waits_behind_json);
+  RUN_TEST(test_busy_shared_link_holds_text_back);
+  RUN_TEST(test_shared_link_never_splits_a_line);
+  RUN_TEST(test_lines_are_whole_or_dropped);
+  RUN_TEST(test_text_resumes_across_wrap_and_small_windows);
+  RUN_TEST(test_midi_queue_is_bounded_and_encodes);
+  RUN_TEST(test_full_queue_keeps_note_offs);
+  return UNITY_END();
+}
@@ -0,0 +1,107 @@
+#include <math.h>
+#include <unity.h>
+
+#include "signal_filters.h"
+
+void test_one_pole_matches_old_coefficient_at_1khz() {
+  // The optical smoother was 0.9 * env + 0.1 * x at a ~1 kHz loop.
+  OnePole lp(-1000.0f / logf(0.9f));
+  float old_env = 0.0f;
+  lp.reset(0.0f, 0);
+  for (uint32_t i = 1; i <= 50; ++i) {
+    old_env = 0.9f * old_env + 0.1f * 1.0f;
+    lp.update(1.0f, i * 1000);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, old_env, lp.value());
+}
+
+void test_one_pole_step_is_rate_independent() {
+  // Same step, three loop rates (one of them ragged): all land on 1 - e^-1
+  // one time constant later.
+  const float tau = 8000.0f;
+  const uint32_t periods[] = {100, 1000, 0};
+  for (uint8_t k = 0; k < 3; ++k) {
+    OnePole lp(tau);
+    lp.reset(0.0f, 0);
+    uint32_t t = 0;
+    uint32_t step = 0;
+    while (t < 8000) {
+      step = periods[k] ? periods[k] : 150 + (t * 7) % 900;  // uneven gaps
+      if (t + step > 8000) step = 8000 - t;
+      t += step;
+      lp.update(1.0f, t);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f - expf(-1.0f), lp.value());
+  }
+}
+
+void test_mean_decimator_averages_and_rejects_alias() {
+  // 10 kHz acquisition of a 5 kHz square wave (0, 1, 0, 1, ...): far above the
+  // 1 kHz output rate, so the output must sit at its average, not alias.
+  Decimator d(1000, DecimateMode::Mean);
+  SensorSample out;
+  uint8_t outputs = 0;
+  for (uint32_t i = 0; i <= 100; ++i) {
+    if (d.push({static_cast<float>(i & 1), i * 100}, &out)) {
+      ++outputs;
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.5f, out.value);
+      TEST_ASSERT_EQUAL_UINT32(0, out.micros % 1000);  // steady output grid
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT8(10, outputs);
+}
+
+void test_mean_decimator_weights_by_time() {
+  // Ragged acquisition: a dense burst of zeros, then one sample of 1 held for
+  // most of the period. Time weighting sees 0.8, not the sample count's 1/9.
+  Decimator d(1000, DecimateMode::Mean);
+  SensorSample out;
+  for (uint32_t t = 0; t < 200; t += 25) d.push({0.0f, t}, &out);
+  d.push({1.0f, 200}, &out);
+  TEST_ASSERT_TRUE(d.push({1.0f, 1000}, &out));
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.8f, out.value);
+  TEST_ASSERT_EQUAL_UINT32(1000, out.micros);
+}
+
+void test_peak_decimator_keeps_clicks_and_their_time() {
+  Decimator d(1000, DecimateMode::Peak);
+  SensorSample out;
+  bool saw_click = false;
+  for (uint32_t i = 0; i < 40; ++i) {
+    uint32_t t = 0xFFFFFFFFu - 1500 + i * 100;  // wraps mid-run
+    float v = (i == 23) ? 0.9f : 0.05f;        // one 100 µs click
+    if (d.push({v, t}, &out) && out.value > 0.5f) {
+      saw_click = true;
+      TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu - 1500 + 2300, out.micros);
+    }
+  }
+  TEST_ASSERT_TRUE(saw_click);
+}
+
+void test_stall_skips_empty_periods_and_zero_period_passes_through() {
+  Decimator d(1000, DecimateMode::Mean);
+  SensorSample out;
+  d.push({0.2f, 0}, &out);
+  d.push({0.2f, 500}, &out);
+  TEST_ASSERT_TRUE(d.push({0.6f, 5300}, &out));  // loop stalled for ~5 periods
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.2f, out.value);
+  TEST_ASSERT_EQUAL_UINT32(1000, out.micros);
+  TEST_ASSERT_TRUE(d.push({0.6f, 6000}, &out));  // one output, not five stale ones
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.2f * 0.3f + 0.6f * 0.7f, out.value);
+  TEST_ASSERT_EQUAL_UINT32(6000, out.micros);
+
+  Decimator pass(0);
+  TEST_ASSERT_TRUE(pass.push({0.3f, 17}, &out));
+  TEST_ASSERT_EQUAL_UINT32(17, out.micros);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_one_pole_matches_old_coefficient_at_1khz);
+  RUN_TEST(test_one_pole_step_is_rate_independent);
+  RUN_TEST(test_mean_decimator_averages_and_rejects_alias);
+  RUN_TEST(test_mean_decimator_weights_by_time);
+  RUN_TEST(test_peak_decimator_keeps_clicks_and_their_time);
+  RUN_TEST(test_stall_skips_empty_periods_and_zero_period_passes_through);
+  return UNITY_END();
+}
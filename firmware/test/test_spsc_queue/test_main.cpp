@@ -0,0 +1,101 @@
+#include <thread>
+#include <unity.h>
+
+#include "spsc_queue.h"
+
+namespace {
+// Big enough that a torn copy would show: every field derives from seq.
+struct Frame {
+  uint32_t seq;
+  uint32_t stamp;
+  float value;
+  uint32_t check;
+};
+
+Frame make_frame(uint32_t seq) {
+  return Frame{seq, seq * 7u, static_cast<float>(seq & 0xFFFF), seq ^ 0xA5A5A5A5u};
+}
+
+bool frame_ok(const Frame& f) {
+  return f.stamp == f.seq * 7u && f.value == static_cast<float>(f.seq & 0xFFFF) &&
+         f.check == (f.seq ^ 0xA5A5A5A5u);
+}
+}  // namespace
+
+void test_fifo_order_and_drop_when_full() {
+  SpscQueue<uint32_t, 4> q;
+  uint32_t out = 0;
+  TEST_ASSERT_FALSE(q.pop(&out));
+  for (uint32_t i = 0; i < 4; ++i) TEST_ASSERT_TRUE(q.push(i));
+  TEST_ASSERT_FALSE(q.push(99));  // full: the new item goes, the old ones stay
+  TEST_ASSERT_EQUAL_UINT32(1, q.dropped());
+  TEST_ASSERT_EQUAL_UINT32(4, q.size());
+  for (uint32_t i = 0; i < 4; ++i) {
+    TEST_ASSERT_TRUE(q.pop(&out));
+    TEST_ASSERT_EQUAL_UINT32(i, out);
+  }
+  TEST_ASSERT_FALSE(q.pop(&out));
+  TEST_ASSERT_EQUAL_UINT32(4, q.high_water());
+}
+
+void test_slots_recycle_across_many_laps() {
+  SpscQueue<Frame, 8> q;
+  Frame f;
+  uint32_t next = 0;
+  for (uint32_t seq = 0; seq < 10000; ++seq) {
+    TEST_ASSERT_TRUE(q.push(make_frame(seq)));
+    if (seq % 3 == 2) {  // drain in uneven bursts so head and tail drift apart
+      while (q.pop(&f)) {
+        TEST_ASSERT_EQUAL_UINT32(next++, f.seq);
+        TEST_ASSERT_TRUE(frame_ok(f));
+      }
+    }
+  }
+  while (q.pop(&f)) TEST_ASSERT_EQUAL_UINT32(next++, f.seq);
+  TEST_ASSERT_EQUAL_UINT32(10000, next);
+  TEST_ASSERT_EQUAL_UINT32(0, q.dropped());
+  TEST_ASSERT_EQUAL_UINT32(3, q.high_water());
+}
+
+void test_two_threads_never_tear_or_reorder() {
+  // Stand-in for the two cores: a producer that never waits and a consumer
+  // that drains whenever it gets scheduled.
+  static SpscQueue<Frame, 64> q;
+  const uint32_t kFrames = 500000;
+  uint32_t pushed = 0;
+  std::thread producer([&pushed, kFrames] {
+    for (uint32_t seq = 0; seq < kFrames; ++seq) {
+      if (q.push(make_frame(seq))) ++pushed;
+    }
+  });
+  uint32_t received = 0;
+  uint32_t torn = 0;
+  uint32_t reordered = 0;
+  int64_t last = -1;
+  Frame f;
+  bool done = false;
+  while (!done) {
+    done = received + q.dropped() >= kFrames;
+    while (q.pop(&f)) {
+      if (!frame_ok(f)) ++torn;
+      if (static_cast<int64_t>(f.seq) <= last) ++reordered;
+      last = f.seq;
+      ++received;
+    }
+  }
+  producer.join();
+  while (q.pop(&f)) ++received;
+  TEST_ASSERT_EQUAL_UINT32(0, torn);
+  TEST_ASSERT_EQUAL_UINT32(0, reordered);
+  TEST_ASSERT_EQUAL_UINT32(pushed, received);
+  TEST_ASSERT_EQUAL_UINT32(kFrames, received + q.dropped());
+  TEST_ASSERT_TRUE(q.high_water() <= 64);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fifo_order_and_drop_when_full);
+  RUN_TEST(test_slots_recycle_across_many_laps);
+  RUN_TEST(test_two_threads_never_tear_or_reorder);
+  return UNITY_END();
+}
@@ -0,0 +1,84 @@
+#include <unity.h>
+
+#include "telemetry_streams.h"
+
+void test_boot_defaults_keep_old_visualizers_working() {
+  TelemetryStreams t;
+  TEST_ASSERT_TRUE(t.subscribed(TelemetryStream::Gestures));
+  TEST_ASSERT_FALSE(t.subscribed(TelemetryStream::Raw));
+  TEST_ASSERT_FALSE(t.subscribed(TelemetryStream::Envelope));
+  TEST_ASSERT_FALSE(t.subscribed(TelemetryStream::Latency));
+  TEST_ASSERT_FALSE(t.subscribed(TelemetryStream::Engine));
+  // Uncapped: every call goes out.
+  for (uint32_t i = 0; i < 100; ++i) TEST_ASSERT_TRUE(t.due(TelemetryStream::Gestures, i * 1000));
+  TEST_ASSERT_FALSE(t.due(TelemetryStream::Raw, 0));
+}
+
+void test_rate_cap_decimates_on_device() {
+  TelemetryStreams t;
+  t.subscribe(TelemetryStream::Envelope, 100);  // 1 kHz frames, at most 100 lines/s
+  uint32_t sent = 0;
+  uint32_t now = 0xFFFFFFFFu - 250000;  // wraps a quarter second in
+  for (uint32_t i = 0; i < 1000; ++i) {
+    now += 1000;
+    if (t.due(TelemetryStream::Envelope, now)) ++sent;
+  }
+  TEST_ASSERT_EQUAL_UINT32(100, sent);
+
+  // Ragged frame times never exceed the cap either.
+  t.subscribe(TelemetryStream::Raw, 30);
+  sent = 0;
+  uint32_t elapsed = 0;
+  for (uint32_t i = 0; i < 2000; ++i) {
+    uint32_t step = 300 + (i * 37) % 900;
+    now += step;
+    elapsed += step;
+    if (t.due(TelemetryStream::Raw, now)) ++sent;
+  }
+  TEST_ASSERT_TRUE(sent > 0);
+  TEST_ASSERT_TRUE(sent <= elapsed / (1000000 / 30) + 1);
+}
+
+void test_sub_command_sets_leaves_and_clears() {
+  TelemetryStreams t;
+  TEST_ASSERT_FALSE(t.apply_command("{\"notes\":[60]}"));
+  TEST_ASSERT_TRUE(t.apply_command("{\"sub\":{\"raw\":500, \"env\": 30, \"engine\":true}}"));
+  TEST_ASSERT_TRUE(t.subscribed(TelemetryStream::Raw));
+  TEST_ASSERT_EQUAL_UINT16(500, t.max_hz(TelemetryStream::Raw));
+  TEST_ASSERT_EQUAL_UINT16(30, t.max_hz(TelemetryStream::Envelope));
+  TEST_ASSERT_TRUE(t.subscribed(TelemetryStream::Engine));
+  TEST_ASSERT_EQUAL_UINT16(0, t.max_hz(TelemetryStream::Engine));
+  TEST_ASSERT_TRUE(t.subscribed(TelemetryStream::Gestures));  // not named: unchanged
+
+  // The logging rig drops gestures and env; a typo'd value is ignored.
+  TEST_ASSERT_TRUE(t.apply_command("{\"sub\":{\"gestures\":false,\"env\":0,\"latency\":\"fast\",\"bogus\":5}}"));
+  TEST_ASSERT_FALSE(t.subscribed(TelemetryStream::Gestures));
+  TEST_ASSERT_FALSE(t.subscribed(TelemetryStream::Envelope));
+  TEST_ASSERT_FALSE(t.subscribed(TelemetryStream::Latency));
+  TEST_ASSERT_TRUE(t.subscribed(TelemetryStream::Raw));
+
+  TEST_ASSERT_TRUE(t.apply_command("{\"sub\":\"?\"}"));  // report only
+  TEST_ASSERT_TRUE(t.subscribed(TelemetryStream::Raw));
+  TEST_ASSERT_TRUE(t.apply_command("{\"sub\":\"none\"}"));
+  for (uint8_t i = 0; i < kStreamCount; ++i) TEST_ASSERT_FALSE(t.subscribed(static_cast<TelemetryStream>(i)));
+}
+
+void test_resubscribe_sends_the_next_line_at_once() {
+  TelemetryStreams t;
+  t.subscribe(TelemetryStream::Latency, 1);
+  TEST_ASSERT_TRUE(t.due(TelemetryStream::Latency, 5000));
+  TEST_ASSERT_FALSE(t.due(TelemetryStream::Latency, 6000));
+  t.subscribe(TelemetryStream::Latency, 2);  // host changed its mind: no waiting out the old period
+  TEST_ASSERT_TRUE(t.due(TelemetryStream::Latency, 7000));
+  TEST_ASSERT_FALSE(t.due(TelemetryStream::Latency, 7000 + 499999));
+  TEST_ASSERT_TRUE(t.due(TelemetryStream::Latency, 7000 + 500000));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_boot_defaults_keep_old_visualizers_working);
+  RUN_TEST(test_rate_cap_decimates_on_device);
+  RUN_TEST(test_sub_command_sets_leaves_and_clears);
+  RUN_TEST(test_resubscribe_sends_the_next_line_at_once);
+  return UNITY_END();
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string.h>
+
+#include "i2c_bus.h"
+
+// Test double: an I²C bus with a few VL53L0X-shaped register files hanging off
+// it. Transactions finish only when the test advances the clock, the way the
+// real ones finish from an interrupt some time after submit().
+struct SimVl53l0x {
+  bool powered = false;
+  uint8_t address = 0x29;
+  uint8_t regs[256];
+  bool continuous = false;
+  uint32_t next_sample_us = 0;
+  uint16_t distance_mm = 500;
+  uint32_t reads_of_status = 0;
+
+  void power(bool on) {
+    powered = on;
+    if (!on) return;
+    memset(regs, 0, sizeof(regs));
+    address = 0x29;
+    continuous = false;
+    regs[0xC0] = 0xEE;  // model id
+    regs[0x91] = 0x3C;  // stop variable
+  }
+
+  void write(uint8_t reg, uint8_t value, uint32_t now_us) {
+    regs[reg] = value;
+    if (reg == 0x8A) address = value & 0x7F;
+    if (reg == 0x0B && value == 0x01) regs[0x13] = 0;
+    // 0x00 is SYSRANGE_START only on the default page; the 0x80/0xFF dance
+    // around the stop variable pokes a different 0x00.
+    if (reg == 0x00 && regs[0x80] == 0 && regs[0xFF] == 0) {
+      if (value == 0x41 || value == 0x01) regs[0x13] = 0x03;  // single shot: done at once
+      continuous = value == 0x02;
+      next_sample_us = now_us + 30000;
+    }
+  }
+
+  void tick(uint32_t now_us) {
+    if (!continuous || static_cast<int32_t>(now_us - next_sample_us) < 0) return;
+    regs[0x1E] = static_cast<uint8_t>(distance_mm >> 8);
+    regs[0x1F] = static_cast<uint8_t>(distance_mm);
+    regs[0x13] = 0x04;
+    next_sample_us += 30000;
+  }
+};
+
+class SimBus : public I2cBus, public GpioOut {
+ public:
+  static const uint8_t kDevices = 3;
+  SimVl53l0x dev[kDevices];
+  uint8_t xshut_pin[kDevices] = {10, 11, 12};
+  uint32_t latency_us = 150;
+  uint32_t now_us = 0;
+  uint32_t transactions = 0;
+  uint32_t refused = 0;
+
+  bool submit(I2cTransaction* t) override {
+    if (current_) {
+      ++refused;
+      return false;
+    }
+    current_ = t;
+    t->status = I2cStatus::Pending;
+    done_at_ = now_us + latency_us;
+    ++transactions;
+    return true;
+  }
+  bool busy() const override { return current_ != nullptr; }
+
+  void write(uint8_t pin, bool high) override {
+    for (uint8_t i = 0; i < kDevices; ++i) {
+      if (xshut_pin[i] == pin && dev[i].powered != high) dev[i].power(high);
+    }
+  }
+
+  // Moves the clock and lets the "interrupt" finish a due transaction.
+  void advance(uint32_t to_us) {
+    now_us = to_us;
+    for (uint8_t i = 0; i < kDevices; ++i) {
+      if (dev[i].powered) dev[i].tick(now_us);
+    }
+    if (!current_ || static_cast<int32_t>(now_us - done_at_) < 0) return;
+    I2cTransaction* t = current_;
+    current_ = nullptr;
+    SimVl53l0x* d = find(t->address);
+    if (!d) {
+      t->status = I2cStatus::Nack;
+      return;
+    }
+    uint8_t reg = t->tx[0];
+    for (uint8_t i = 1; i < t->tx_len; ++i) d->write(static_cast<uint8_t>(reg + i - 1), t->tx[i], now_us);
+    for (uint8_t i = 0; i < t->rx_len; ++i) {
+      if (reg + i == 0x13) ++d->reads_of_status;
+      t->rx[i] = d->regs[static_cast<uint8_t>(reg + i)];
+    }
+    t->status = I2cStatus::Done;
+  }
+
+ private:
+  I2cTransaction* current_ = nullptr;
+  uint32_t done_at_ = 0;
+
+  SimVl53l0x* find(uint8_t address) {
+    SimVl53l0x* hit = nullptr;
+    for (uint8_t i = 0; i < kDevices; ++i) {
+      if (!dev[i].powered || dev[i].address != address) continue;
+      if (hit) return nullptr;  // two parts answering at once: garbage on the wire
+      hit = &dev[i];
+    }
+    return hit;
+  }
+};
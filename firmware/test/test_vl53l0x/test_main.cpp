@@ -0,0 +1,115 @@
+#include <unity.h>
+
+#include "sim_vl53l0x.h"
+#include "vl53l0x.h"
+
+// Runs `steps` loop() iterations, 100 µs apart, stepping `fn` each time.
+template <typename Fn>
+static void run(SimBus& bus, uint32_t steps, Fn fn) {
+  for (uint32_t i = 0; i < steps; ++i) {
+    bus.advance(bus.now_us + 100);
+    fn(bus.now_us);
+  }
+}
+
+void test_single_sensor_ranges_without_blocking() {
+  SimBus bus;
+  bus.dev[0].power(true);
+  bus.dev[0].distance_mm = 321;
+  Vl53l0x tof(bus);
+  tof.begin(0);
+
+  // Every step returns with the transaction still in flight (the sim only
+  // finishes it on the next advance), so nothing ever waited on the bus.
+  uint32_t steps = 0;
+  TofReading r;
+  bool got = false;
+  run(bus, 2000, [&](uint32_t now) {
+    tof.step(now);
+    ++steps;
+    if (!got && tof.take(&r)) got = true;
+  });
+
+  TEST_ASSERT_EQUAL(2000, steps);
+  TEST_ASSERT_TRUE(tof.state() == Vl53l0x::State::Ranging);
+  TEST_ASSERT_TRUE(got);
+  TEST_ASSERT_EQUAL(321, r.mm);
+  TEST_ASSERT_TRUE(r.stamp_us > 0);
+  // 200 ms of continuous ranging at ~30 ms per sample.
+  TEST_ASSERT_TRUE(tof.readings() >= 4);
+}
+
+void test_missing_sensor_fails_fast() {
+  SimBus bus;  // nothing powered: every address NACKs
+  Vl53l0x tof(bus);
+  tof.begin(0);
+  run(bus, 100, [&](uint32_t now) { tof.step(now); });
+  TEST_ASSERT_TRUE(tof.state() == Vl53l0x::State::Failed);
+  TofReading r;
+  TEST_ASSERT_FALSE(tof.take(&r));
+}
+
+void test_array_reassigns_addresses_and_reads_each() {
+  SimBus bus;
+  bus.dev[0].distance_mm = 100;
+  bus.dev[1].distance_mm = 200;
+  bus.dev[2].distance_mm = 300;
+  TofArray array(bus, bus);
+  TEST_ASSERT_TRUE(array.add(10, 0x30));
+  TEST_ASSERT_TRUE(array.add(11, 0x31));
+  TEST_ASSERT_TRUE(array.add(12, 0x32));
+  array.begin(0);
+
+  uint16_t last[3] = {0, 0, 0};
+  run(bus, 6000, [&](uint32_t now) {
+    array.step(now);
+    TofReading r;
+    for (uint8_t i = 0; i < 3; ++i) {
+      if (array.sensor(i).take(&r)) last[i] = r.mm;
+    }
+  });
+
+  for (uint8_t i = 0; i < 3; ++i) {
+    TEST_ASSERT_TRUE(array.sensor(i).state() == Vl53l0x::State::Ranging);
+    TEST_ASSERT_EQUAL(0x30 + i, array.sensor(i).address());
+    TEST_ASSERT_EQUAL(0x30 + i, bus.dev[i].address);
+    TEST_ASSERT_EQUAL(100 * (i + 1), last[i]);
+  }
+  // Sharing one bus: sensors were refused while another held it, and kept going.
+  TEST_ASSERT_TRUE(bus.refused > 0);
+}
+
+void test_data_ready_pin_skips_status_polls() {
+  SimBus bus;
+  bus.dev[0].power(true);
+  Vl53l0x tof(bus);
+  tof.use_data_ready_pin(true);
+  tof.begin(0);
+  run(bus, 300, [&](uint32_t now) { tof.step(now); });  // bring-up
+  TEST_ASSERT_TRUE(tof.state() == Vl53l0x::State::Ranging);
+
+  uint32_t status_reads = bus.dev[0].reads_of_status;
+  uint32_t last_sample = 0;
+  TofReading r;
+  uint32_t stamps_ok = 0;
+  run(bus, 2000, [&](uint32_t now) {
+    // Emulate the GPIO1 falling-edge ISR.
+    if (bus.dev[0].regs[0x13] == 0x04 && bus.dev[0].next_sample_us != last_sample) {
+      last_sample = bus.dev[0].next_sample_us;
+      tof.notify_data_ready(now);
+    }
+    tof.step(now);
+    if (tof.take(&r) && r.stamp_us <= now) ++stamps_ok;
+  });
+  TEST_ASSERT_TRUE(stamps_ok >= 5);
+  TEST_ASSERT_EQUAL(status_reads, bus.dev[0].reads_of_status);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_single_sensor_ranges_without_blocking);
+  RUN_TEST(test_missing_sensor_fails_fast);
+  RUN_TEST(test_array_reassigns_addresses_and_reads_each);
+  RUN_TEST(test_data_ready_pin_skips_status_polls);
+  return UNITY_END();
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "clock_sync.h"
+#include "event_merger.h"
+#include "frame.h"
+
+/**
+ * Several boards, one instrument: read N serial ports at once, put every line
+ * on the host's clock, and write one time-ordered stream.
+ *
+ *   board 0 ──▶ lines ──▶ unwrap micros() ──▶ ClockModel 0 ──┐
+ *   board 1 ──▶ lines ──▶ unwrap micros() ──▶ ClockModel 1 ──┼──▶ EventMerger ──▶ one stream
+ *   ...          ▲ {"ping":n} every ping_ms, {"pong":[n,us]} ─┘
+ *
+ * Each output line wraps the board's original line:
+ *
+ *   {"t":1234567,"b":1,"dev":4295012345,"ev":{"gesture":"pluck",...}}
+ *
+ * `t` is host µs since the aggregator started, `b` the board's index on the
+ * command line, and `dev` the board's own clock extended to 64 bits. A line
+ * with no stamp of its own (acknowledgements, feature dumps) takes the
+ * board's latest stamp. Lines that arrive before a board's first pong wait
+ * until it has one (at most kMaxUnsynced of them).
+ *
+ * Same single-threaded epoll shape as Bridge, and the same reopen-on-unplug
+ * behaviour. A board that reconnects may have rebooted, so its clock model
+ * starts over.
+ */
+
+struct AggregatorConfig {
+  std::vector<std::string> boards;  // serial device paths, in "b" order
+  int baud = 115200;
+  uint32_t ping_ms = 250;           // steady-state clock-sync rate per board
+  uint32_t max_latency_ms = 50;     // no event waits in the merge longer than this
+  uint32_t reorder_us = 5000;       // a board's own lines may be this far out of order
+  uint32_t reopen_ms = 1000;
+  size_t max_pending = 4096;        // merge depth before events are forced out early
+};
+
+struct BoardStats {
+  std::string path;
+  bool open = false;
+  bool synced = false;
+  uint64_t lines = 0;
+  uint64_t bad_lines = 0;
+  uint64_t dropped_unsynced = 0;  // arrived before the first pong, and there were too many
+  uint64_t pings = 0;
+  uint64_t pongs = 0;
+  uint64_t opens = 0;
+  double drift_ppm = 0.0;
+  double offset_us = 0.0;    // host minus device clock, at the board's latest stamp
+  double residual_us = 0.0;  // see ClockModel
+  double bound_us = 0.0;
+  int64_t device_us = 0;     // latest stamp, unwrapped
+};
+
+class Aggregator {
+ public:
+  static const size_t kMaxUnsynced = 256;
+  static const uint32_t kStartupPings = 8;     // sent quickly after (re)open, for a first fit
+  static const uint32_t kStartupPingMs = 20;
+
+  using Output = std::function<void(const std::string&)>;
+
+  Aggregator(const AggregatorConfig& config, Output out);
+  ~Aggregator();
+  Aggregator(const Aggregator&) = delete;
+  Aggregator& operator=(const Aggregator&) = delete;
+
+  bool open(std::string* error);
+  void run_once(int timeout_ms);
+  // Release everything still in the merge (on shutdown).
+  void drain();
+
+  // Host timeline: µs since open().
+  int64_t now_us() const;
+  std::vector<BoardStats> boards() const;
+  const MergeStats& merge_stats() const { return merger_.stats(); }
+
+ private:
+  struct Board;
+  using Clock = std::chrono::steady_clock;
+
+  AggregatorConfig config_;
+  Output out_;
+  EventMerger merger_;
+  Clock::time_point epoch_;
+  int epoll_fd_ = -1;
+  std::vector<std::unique_ptr<Board>> boards_;
+
+  void try_open(Board* b);
+  void close_board(Board* b);
+  void on_readable(Board* b);
+  void on_line(Board* b, const char* line, size_t len);
+  void send_ping(Board* b);
+  void submit(Board* b, int64_t device_us, int64_t arrived_us, std::string line);
+  void emit(const MergedEvent& e);
+};
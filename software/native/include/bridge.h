@@ -0,0 +1,156 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "client_queue.h"
+#include "frame.h"
+
+/**
+ * The fan-out daemon's core: one thread, one epoll set, no blocking calls.
+ *
+ *   board ──serial──▶ LineSplitter ──▶ parse_frame ──▶ encode once per protocol
+ *                                                        │
+ *                  ┌─────────────────────────────────────┴──────────────┐
+ *                  ▼                                                    ▼
+ *    every WebSocket client's ClientQueue            every OSC target's ClientQueue
+ *    (every JSON line, as a text frame)              (gesture lines, /stringfield/gesture)
+ *
+ * Each client drains its own queue when its socket says it can take more.
+ * A client that stops reading fills its queue and starts losing frames; the
+ * serial port keeps being read and every other client keeps up. The kernel
+ * send buffer of each WebSocket is capped too (`sndbuf_bytes`), so "slow"
+ * shows up in the drop counters within a second instead of hiding behind
+ * megabytes of socket buffer.
+ *
+ * If the board goes away (unplugged, reset), the serial side closes and is
+ * retried every `reopen_ms`; clients stay connected and simply see a gap.
+ */
+
+struct OscTarget {
+  std::string host;  // dotted IPv4
+  uint16_t port = 0;
+};
+
+// "host:port" or just "port" (localhost). False on anything else.
+bool parse_osc_target(const std::string& spec, OscTarget* out);
+
+struct BridgeConfig {
+  std::string serial_path;
+  int baud = 115200;
+  std::string bind_host = "0.0.0.0";  // WebSocket and OSC listen address
+  uint16_t ws_port = 8765;            // 0 = let the kernel pick (tests), see Bridge::ws_port()
+  uint16_t osc_port = 9001;           // where OSC clients send /stringfield/subscribe; 0 = kernel picks
+  std::vector<OscTarget> osc_targets; // always sent to, subscribed or not
+  size_t queue_frames = 256;          // per client
+  size_t queue_bytes = 256 * 1024;    // per client
+  int sndbuf_bytes = 32 * 1024;       // per WebSocket; 0 = kernel default
+  size_t max_ws_clients = 64;
+  uint32_t handshake_ms = 5000;       // a WebSocket still mid-handshake after this gives up its slot
+  size_t max_osc_clients = 64;        // subscribed targets, on top of osc_targets
+  uint32_t reopen_ms = 1000;
+};
+
+struct BridgeStats {
+  uint64_t lines = 0;         // complete lines read from serial
+  uint64_t bad_lines = 0;     // not a JSON object: dropped, never forwarded
+  uint64_t long_lines = 0;    // over LineSplitter::kMaxLine: dropped
+  uint64_t gestures = 0;      // lines forwarded to OSC as well
+  uint64_t serial_opens = 0;  // successful (re)opens
+  uint64_t ws_accepted = 0;
+  uint64_t ws_rejected = 0;   // bad handshake or over max_ws_clients
+  uint64_t ws_timed_out = 0;  // no complete handshake within handshake_ms
+  uint64_t ws_closed = 0;
+  uint64_t dropped = 0;       // frames lost to full client queues, all clients, ever
+  size_t ws_clients = 0;      // open now (handshake finished)
+  size_t osc_clients = 0;     // static + subscribed
+  bool serial_open = false;
+};
+
+// One row of Bridge::clients(): who is connected and how well they keep up.
+struct ClientInfo {
+  bool websocket = false;  // else OSC
+  std::string peer;        // "10.0.0.7:53122"
+  size_t queued = 0;
+  size_t high_water = 0;
+  uint64_t sent = 0;
+  uint64_t dropped = 0;
+};
+
+class Bridge {
+ public:
+  explicit Bridge(const BridgeConfig& config);
+  ~Bridge();
+  Bridge(const Bridge&) = delete;
+  Bridge& operator=(const Bridge&) = delete;
+
+  // Bind the sockets and try the serial port once. A missing board is not an
+  // error (it is retried); a port that cannot be bound is.
+  bool open(std::string* error);
+
+  // Wait up to `timeout_ms` for I/O and handle all of it. A signal cuts the
+  // wait short, so a caller looping on a flag set by its handler stops
+  // promptly.
+  void run_once(int timeout_ms);
+
+  uint16_t ws_port() const { return ws_port_; }
+  uint16_t osc_port() const { return osc_port_; }
+  const BridgeStats& stats() const { return stats_; }
+  // Why the serial port is not open right now ("" while it is).
+  const std::string& serial_error() const { return serial_error_; }
+  std::vector<ClientInfo> clients() const;
+
+ private:
+  struct Client;
+  using Clock = std::chrono::steady_clock;
+
+  BridgeConfig config_;
+  BridgeStats stats_;
+  int epoll_fd_ = -1;
+  int serial_fd_ = -1;
+  int ws_listen_fd_ = -1;
+  int osc_fd_ = -1;
+  bool osc_want_write_ = false;
+  uint16_t ws_port_ = 0;
+  uint16_t osc_port_ = 0;
+  Clock::time_point reopen_at_;
+  LineSplitter splitter_;
+  std::string serial_error_;
+  std::unordered_map<int, std::unique_ptr<Client>> ws_clients_;  // by fd
+  std::vector<std::unique_ptr<Client>> osc_clients_;
+  std::vector<int> doomed_;  // ws fds to close after this round of events
+  // WebSockets still handshaking, by deadline. One fixed timeout means accept
+  // order is deadline order, so only the front ever needs looking at.
+  struct Handshake {
+    int fd;
+    Clock::time_point by;
+  };
+  std::deque<Handshake> handshakes_;
+
+  void try_open_serial();
+  void close_serial();
+  void on_serial_readable();
+  void on_line(const char* line, size_t len);
+
+  void on_ws_accept();
+  void on_ws_readable(Client* c);
+  void flush_ws(Client* c);
+  void close_ws(Client* c);
+  void expire_handshakes(Clock::time_point now);
+
+  void on_osc_readable();
+  void flush_osc();
+  void add_osc_client(const sockaddr_in& addr);
+
+  void watch(int fd, uint32_t events);
+  void set_events(int fd, uint32_t events);
+};
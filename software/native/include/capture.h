@@ -0,0 +1,203 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * A capture you can seek in. `tools/serial_logger.py` writes CSV, which is
+ * right for a spreadsheet and wrong for an hour of 1 kHz samples: every look
+ * at minute 47 re-parses the 46 minutes before it. A `.sfcap` file holds the
+ * same session in fixed-size records, laid out so a tool can mmap it and read
+ * any time range straight out of the page cache, parsing nothing:
+ *
+ *   ┌ header ┐┌ samples ──────────┐┌ events ──┐┌ index ─┐┌ text ──┐┌ notes ┐
+ *    144 B     16 B each, by time    32 B each   16 B per   event     the CSV's
+ *                                    by time     bucket     lines     # lines
+ *
+ * - **Samples** are the `{"raw":[micros,value]}` lines: host time, board
+ *   time, value. Sixteen bytes, so sample i is at a known offset.
+ * - **Events** are every other line: gestures (with name, value and note
+ *   already pulled out, so "all plucks in this range" is a scan over 32-byte
+ *   records), acknowledgements, telemetry, boot chatter. Each keeps its
+ *   original text in the text section.
+ * - **The index** has one entry per `bucket_us` of capture time (100 ms by
+ *   default): the first sample and first event at or after the bucket's
+ *   start. Seeking is a division, then a binary search over one bucket.
+ *
+ * Times (`t_us`) are host µs since the capture began: the CSV's
+ * elapsed_seconds. Everything is little-endian with natural alignment, and
+ * sections start on 64-byte boundaries, so numpy.memmap reads it as well.
+ * Raw lines come back numerically identical but re-printed in the firmware's
+ * own format (`value_decimals` places); every other line comes back byte for
+ * byte.
+ */
+
+static const char kCaptureMagic[8] = {'S', 'F', 'C', 'A', 'P', '\r', '\n', '\x1a'};
+static const uint32_t kCaptureVersion = 1;
+
+struct CaptureHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;  // sizeof(CaptureHeader); the record sizes guard the layout too
+  uint32_t sample_size;
+  uint32_t event_size;
+  uint32_t index_entry_size;
+  uint32_t bucket_us;
+  int64_t t_begin_us;     // first record's time; bucket 0 starts here
+  int64_t t_end_us;       // last record's time
+  int64_t start_unix_us;  // wall clock at t_us = 0, 0 when unknown
+  uint64_t sample_offset;
+  uint64_t sample_count;
+  uint64_t event_offset;
+  uint64_t event_count;
+  uint64_t index_offset;
+  uint64_t index_count;
+  uint64_t text_offset;
+  uint64_t text_size;
+  uint64_t notes_offset;
+  uint64_t notes_size;
+  uint32_t value_decimals;  // how raw values are printed on replay
+  uint32_t reserved;
+};
+static_assert(sizeof(CaptureHeader) == 144, "the header is part of the file format");
+
+struct CaptureSample {
+  int64_t t_us;
+  uint32_t device_us;  // the board's micros(), as it wrote it
+  float value;
+};
+static_assert(sizeof(CaptureSample) == 16, "samples are part of the file format");
+
+enum class CaptureEventKind : uint8_t {
+  Gesture,    // {"gesture":...}: what the board played
+  Telemetry,  // any other JSON object
+  Text,       // not JSON: boot chatter, a stray printf
+};
+
+// The firmware's gesture names (gesture_name() in firmware/src/main.cpp).
+// Stored in event records: new names go on the end, never in between.
+enum class CaptureGesture : uint8_t { Other, Pluck, Bow, Scrape, Mute, Tremolo, Vibrato, Release, Idle, Harmonic };
+
+struct CaptureEvent {
+  int64_t t_us;
+  uint64_t text_offset;  // into the text section
+  uint32_t text_len;
+  uint32_t device_us;    // when flags has kCaptureHasDeviceUs
+  CaptureEventKind kind;
+  CaptureGesture gesture;  // Gesture events only
+  uint8_t value;           // 0-127, Gesture events only
+  int8_t note;             // -1 when the line has none
+  uint8_t flags;
+  uint8_t reserved[3];
+};
+static_assert(sizeof(CaptureEvent) == 32, "events are part of the file format");
+static const uint8_t kCaptureHasDeviceUs = 1;
+
+struct CaptureIndexEntry {
+  uint64_t sample;  // first sample with t_us >= this bucket's start
+  uint64_t event;   // first event, likewise
+};
+static_assert(sizeof(CaptureIndexEntry) == 16, "index entries are part of the file format");
+
+CaptureGesture capture_gesture_code(const std::string& name);
+const char* capture_gesture_name(CaptureGesture g);
+
+/**
+ * Collects a session in memory, then writes it in one go (to a temporary
+ * name, renamed into place, so a reader never maps half a file). An hour at
+ * 1 kHz is about 60 MB of samples.
+ */
+class CaptureBuilder {
+ public:
+  static const uint32_t kDefaultBucketUs = 100000;
+
+  explicit CaptureBuilder(uint32_t bucket_us = kDefaultBucketUs) : bucket_us_(bucket_us) {}
+
+  // One serial line received at `t_us`: a canonical raw line becomes a
+  // sample, anything else an event.
+  void add_line(int64_t t_us, const char* line, size_t len);
+  void add_sample(int64_t t_us, uint32_t device_us, float value);
+  void add_note(const std::string& note) { notes_ += note + "\n"; }
+  void set_start_unix_us(int64_t us) { start_unix_us_ = us; }
+
+  size_t samples() const { return samples_.size(); }
+  size_t events() const { return events_.size(); }
+
+  bool write(const std::string& path, std::string* error);
+
+ private:
+  uint32_t bucket_us_;
+  int64_t start_unix_us_ = 0;
+  uint32_t value_decimals_ = 0;
+  std::vector<CaptureSample> samples_;
+  std::vector<CaptureEvent> events_;
+  std::string text_;
+  std::string notes_;
+};
+
+/**
+ * A .sfcap file, mapped read-only. open() checks the header and that every
+ * section and every event's text lies inside the file, so after that the
+ * accessors are plain pointer arithmetic. Samples are not touched at open:
+ * a tool that looks at one minute of an hour only pages in that minute.
+ */
+class CaptureFile {
+ public:
+  CaptureFile() = default;
+  ~CaptureFile();
+  CaptureFile(const CaptureFile&) = delete;
+  CaptureFile& operator=(const CaptureFile&) = delete;
+
+  bool open(const std::string& path, std::string* error);
+  void close();
+
+  const CaptureHeader& header() const { return *header_; }
+  const CaptureSample* samples() const { return samples_; }
+  size_t sample_count() const { return static_cast<size_t>(header_->sample_count); }
+  const CaptureEvent* events() const { return events_; }
+  size_t event_count() const { return static_cast<size_t>(header_->event_count); }
+  std::string_view text(const CaptureEvent& e) const { return std::string_view(text_ + e.text_offset, e.text_len); }
+  std::string_view notes() const { return std::string_view(notes_, static_cast<size_t>(header_->notes_size)); }
+
+  // Index of the first sample / event at or after `t_us` (count when none).
+  size_t sample_at(int64_t t_us) const;
+  size_t event_at(int64_t t_us) const;
+
+  // Ask the kernel to start reading [from_us, to_us) in now (madvise
+  // WILLNEED), before replay walks it.
+  void prefetch(int64_t from_us, int64_t to_us) const;
+
+  // Everything in [from_us, to_us), samples and events merged in time order
+  // (a sample first when they share a microsecond).
+  template <typename OnSample, typename OnEvent>
+  void replay(int64_t from_us, int64_t to_us, OnSample on_sample, OnEvent on_event) const {
+    size_t s = sample_at(from_us), s_end = sample_at(to_us);
+    size_t e = event_at(from_us), e_end = event_at(to_us);
+    while (s < s_end || e < e_end) {
+      if (e == e_end || (s < s_end && samples_[s].t_us <= events_[e].t_us)) {
+        on_sample(samples_[s++]);
+      } else {
+        on_event(events_[e++]);
+      }
+    }
+  }
+
+ private:
+  void* map_ = nullptr;
+  size_t map_size_ = 0;
+  const CaptureHeader* header_ = nullptr;
+  const CaptureSample* samples_ = nullptr;
+  const CaptureEvent* events_ = nullptr;
+  const CaptureIndexEntry* index_ = nullptr;
+  const char* text_ = nullptr;
+  const char* notes_ = nullptr;
+
+  size_t bucket_of(int64_t t_us) const;
+};
+
+// `{"raw":[device_us,value]}` the way the firmware prints it.
+std::string capture_raw_line(const CaptureSample& s, uint32_t value_decimals);
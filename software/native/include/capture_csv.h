@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+#include "capture.h"
+
+/**
+ * The bridge between .sfcap and the CSV every other tool speaks.
+ *
+ * serial_logger.py (and flight_dump.py) write `# ` comment lines, then
+ * `timestamp_iso,elapsed_seconds,line` rows through Python's csv module:
+ * "\r\n" row endings, and the JSON line quoted with doubled quotes. The
+ * importer reads exactly that, in one pass over a mapped file. Comment lines
+ * become the capture's notes, and the first row's wall-clock stamp, less its
+ * elapsed time, becomes start_unix_us.
+ *
+ * Going back, rows are written the same way, so a replayed slice can go
+ * straight into train_gesture_tree.py or a notebook. timestamp_iso is rebuilt
+ * from the session start plus elapsed time, so it matches the original to
+ * within the host clock's wander during the session.
+ */
+
+struct CsvImportStats {
+  uint64_t rows = 0;
+  uint64_t comments = 0;
+  uint64_t skipped = 0;  // rows without three fields or with an unreadable elapsed_seconds
+};
+
+bool capture_import_csv(const std::string& csv_path, CaptureBuilder* out, CsvImportStats* stats,
+                        std::string* error);
+
+// "2024-05-01T12:34:56.123456+00:00" (any UTC offset) → µs since the epoch.
+bool capture_parse_iso_time(const std::string& text, int64_t* unix_us);
+// The inverse, in UTC, the way Python's isoformat() writes it (no fraction
+// when it is zero).
+std::string capture_iso_time(int64_t unix_us);
+
+// One `timestamp_iso,elapsed_seconds,line` row, "\r\n"-terminated.
+std::string capture_csv_row(const std::string& timestamp_iso, int64_t t_us, const std::string& line);
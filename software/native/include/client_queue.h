@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+
+// One encoded frame, shared by every client it goes to: the bridge encodes a
+// line once per protocol, and fan-out to 30 browsers costs 30 pointer copies,
+// not 30 string copies.
+using Payload = std::shared_ptr<const std::string>;
+
+/**
+ * Per-client bounded FIFO of payloads, plus how far into the front one the
+ * socket has taken. A slow client fills its own queue and then loses *new*
+ * frames (counted), the same rule as the firmware's MIDI and telemetry
+ * queues. Nobody else waits for it, and a frame that has started going out
+ * always finishes, so a WebSocket never sees half a frame.
+ *
+ * Bounded two ways: a frame count (what a visualizer can usefully catch up
+ * on) and a byte total (what the daemon is willing to hold for one client).
+ */
+class ClientQueue {
+ public:
+  ClientQueue(size_t max_frames, size_t max_bytes) : max_frames_(max_frames), max_bytes_(max_bytes) {}
+
+  // False when full; the payload is dropped and counted.
+  bool push(Payload p);
+  // Control replies (handshake, pong, close) skip the bounds: they are tiny,
+  // rare, and a client that never hears them misbehaves.
+  void push_control(Payload p);
+
+  bool empty() const { return frames_.empty(); }
+  // Unsent bytes of the front payload.
+  const char* front_data() const { return frames_.front()->data() + offset_; }
+  size_t front_size() const { return frames_.front()->size() - offset_; }
+  // Point up to `max` iovecs at the unsent bytes, oldest first, so a stream
+  // socket takes a backlog in one writev() instead of one send() per frame.
+  size_t gather(iovec* iov, size_t max) const;
+  // The socket took `n` bytes, possibly spanning several payloads.
+  void consume(size_t n);
+
+  size_t size() const { return frames_.size(); }
+  size_t bytes() const { return bytes_; }
+  size_t high_water() const { return high_water_; }
+  uint64_t dropped() const { return dropped_; }
+  uint64_t sent() const { return sent_; }
+
+ private:
+  std::deque<Payload> frames_;
+  size_t offset_ = 0;
+  size_t bytes_ = 0;
+  size_t high_water_ = 0;
+  size_t max_frames_;
+  size_t max_bytes_;
+  uint64_t dropped_ = 0;
+  uint64_t sent_ = 0;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Putting several boards on one clock.
+ *
+ * Every board stamps its lines with its own micros(). That clock is 32 bits
+ * and wraps every ~71.6 minutes. It starts whenever that board booted, and it
+ * ticks at its own crystal's idea of a microsecond: tens of ppm off, and
+ * wandering with temperature. To merge boards, the host needs one map per
+ * board:
+ *
+ *     host_us ≈ ref_host + rate · (device_us - ref_device)
+ *
+ * It learns that map the way NTP does. The host sends {"ping":n} at t0, the
+ * board answers {"pong":[n,tb]}, and the host reads the answer at t3. If the
+ * trip out and the trip back took equally long, the board read tb at host time
+ * (t0+t3)/2, give or take (t3-t0)/2.
+ *
+ * A USB round trip is usually well under a millisecond. Often, though, the
+ * pong waits behind queued telemetry, or the host is busy when it arrives,
+ * and the trip takes several times longer on one leg than the other. Those
+ * exchanges lie by up to half their round trip, and they can be the
+ * majority. So the model keeps a window of recent exchanges, fits a line
+ * through only those nearly as fast as the fastest one, and refits on every
+ * new one. Drift is tracked continuously, not measured once at startup.
+ */
+
+/** 32-bit micros() → 64-bit, across any number of wraps. */
+class MicrosUnwrapper {
+ public:
+  // Stamps may arrive a little out of order (a sample line written after a
+  // later-stamped gesture line). Any stamp within ±35 minutes of the newest
+  // one lands on the right side of a wrap.
+  int64_t unwrap(uint32_t us);
+  bool started() const { return started_; }
+  int64_t latest() const { return latest_; }
+  void reset() { started_ = false; }
+
+ private:
+  bool started_ = false;
+  uint32_t latest32_ = 0;
+  int64_t latest_ = 0;
+};
+
+class ClockModel {
+ public:
+  static const size_t kWindow = 64;            // exchanges remembered
+  static constexpr double kRttSlackUs = 50.0;  // fitted: round trip within 2x fastest + this
+  static const int64_t kMinDriftSpanUs = 200000;  // fit a rate only across at least this much device time
+  static constexpr double kMaxDriftPpm = 1000.0;  // anything past this is a broken exchange, not a crystal
+
+  // One ping/pong exchange, all in 64-bit µs: the board's stamp, and the host
+  // times the ping left and the pong arrived.
+  void add(int64_t device_us, int64_t host_send_us, int64_t host_recv_us);
+  void reset();
+
+  bool synced() const { return count_ > 0; }
+  double to_host(int64_t device_us) const { return ref_host_ + rate_ * static_cast<double>(device_us - ref_device_); }
+
+  // How fast the board's crystal runs against the host's: +50 gains 50 µs a second.
+  double drift_ppm() const { return (1.0 / rate_ - 1.0) * 1e6; }
+  // RMS distance of the exchanges the line was fitted through from the line:
+  // how well the model explains its own evidence.
+  double residual_us() const { return residual_us_; }
+  // Half the fastest round trip in the window: no single exchange could be
+  // further off than this, so neither can a well-fitted line.
+  double bound_us() const { return bound_us_; }
+  size_t samples() const { return count_; }
+
+ private:
+  struct Exchange {
+    int64_t device_us;
+    double host_mid_us;
+    double rtt_us;
+  };
+  Exchange ring_[kWindow];
+  size_t count_ = 0;
+  size_t head_ = 0;
+  int64_t ref_device_ = 0;
+  double ref_host_ = 0.0;
+  double rate_ = 1.0;
+  double residual_us_ = 0.0;
+  double bound_us_ = 0.0;
+
+  void fit();
+};
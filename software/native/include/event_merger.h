@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * N time-stamped streams in, one time-ordered stream out, with a bound on how
+ * long any event waits.
+ *
+ * Each board's events already arrive in (nearly) time order, so an event is
+ * safe to release once every board has been heard from past its time: the
+ * *watermark*, the minimum over boards of "latest time heard, minus a little
+ * reorder slack". Nothing that arrives later can be earlier than that. A
+ * board that goes quiet would hold the watermark back forever, so there is a
+ * second rule: nothing waits longer than `max_latency_us` on the host clock.
+ *
+ * If an event turns up after something later than it was already released
+ * (a board stalled for longer than the latency bound), it goes out at once,
+ * keeps its true timestamp, and is marked late. The stream is never silently
+ * reordered, and `late` counts how often the bound was too tight.
+ */
+struct MergedEvent {
+  int64_t host_us = 0;    // on the host timeline: the merge order
+  int64_t device_us = 0;  // the board's own clock, unwrapped to 64 bits
+  size_t board = 0;
+  bool late = false;      // released after a later event already was
+  std::string line;       // the board's JSON line, untouched
+};
+
+struct MergeStats {
+  uint64_t pushed = 0;
+  uint64_t released = 0;
+  uint64_t late = 0;       // released out of order (see above)
+  uint64_t forced = 0;     // released early because max_pending was reached
+  uint64_t overdue = 0;    // released by the latency bound, not the watermark
+  size_t pending = 0;
+  size_t high_water = 0;
+  int64_t worst_wait_us = 0;  // longest any event sat in the merge
+};
+
+class EventMerger {
+ public:
+  EventMerger(size_t boards, int64_t max_latency_us, int64_t reorder_us, size_t max_pending);
+
+  // `arrived_us` is when the host read it (the latency bound counts from there).
+  void push(size_t board, int64_t host_us, int64_t device_us, int64_t arrived_us, std::string line);
+  // Board `b` has been heard from up to `host_us`; only its active boards
+  // hold the watermark back (an unplugged board should not stall the rest).
+  void heard(size_t board, int64_t host_us);
+  void set_active(size_t board, bool active);
+
+  // Release everything due at host time `now_us`, in order.
+  template <typename Emit>
+  void release(int64_t now_us, Emit emit) {
+    int64_t mark = watermark();
+    while (!heap_.empty()) {
+      const Slot& top = heap_.front();
+      bool safe = top.event.host_us <= mark;
+      bool overdue = now_us - top.arrived_us >= max_latency_us_;
+      bool forced = heap_.size() > max_pending_;
+      if (!safe && !overdue && !forced) break;
+      if (!safe && overdue) ++stats_.overdue;
+      if (!safe && !overdue) ++stats_.forced;
+      emit(take(now_us));
+    }
+    stats_.pending = heap_.size();
+  }
+  // Everything, now (shutting down).
+  template <typename Emit>
+  void drain(int64_t now_us, Emit emit) {
+    while (!heap_.empty()) emit(take(now_us));
+    stats_.pending = 0;
+  }
+
+  const MergeStats& stats() const { return stats_; }
+
+ private:
+  struct Slot {
+    MergedEvent event;
+    int64_t arrived_us;
+    uint64_t seq;  // arrival order breaks ties, so equal stamps stay stable
+  };
+  struct Later {
+    bool operator()(const Slot& a, const Slot& b) const {
+      if (a.event.host_us != b.event.host_us) return a.event.host_us > b.event.host_us;
+      return a.seq > b.seq;
+    }
+  };
+  struct Board {
+    bool active = true;
+    bool heard = false;
+    int64_t latest_us = 0;
+  };
+
+  std::vector<Slot> heap_;  // a binary heap under Later: earliest at front()
+  std::vector<Board> boards_;
+  int64_t max_latency_us_;
+  int64_t reorder_us_;
+  size_t max_pending_;
+  uint64_t seq_ = 0;
+  bool released_any_ = false;
+  int64_t last_released_us_ = 0;
+  MergeStats stats_;
+
+  int64_t watermark() const;
+  MergedEvent take(int64_t now_us);
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+/**
+ * From serial bytes to frames. The firmware speaks newline-terminated JSON,
+ * one object per line (firmware/src/main.cpp, emit_gesture_event and
+ * friends). The bridge cuts the stream into lines once, parses each line
+ * once, and hands the same parsed frame to every client.
+ *
+ * There is no binary telemetry on the wire today: even the flight recorder
+ * dump is base64 inside JSON. If one ever appears, it gets its own splitter
+ * next to this one; everything after parse_frame() stays the same.
+ */
+
+/**
+ * Bounded line assembler. Bytes go in as the serial port delivers them (half
+ * a line, three lines, whatever); complete lines come out. A '\r' before the
+ * '\n' is dropped, as are blank lines. A line longer than kMaxLine is dropped
+ * whole and counted: half a JSON object is worse than none.
+ */
+class LineSplitter {
+ public:
+  static const size_t kMaxLine = 2048;  // the firmware's help text is the longest line, ~1 KB
+
+  template <typename OnLine>
+  void feed(const char* data, size_t n, OnLine on_line) {
+    for (size_t i = 0; i < n; ++i) {
+      char c = data[i];
+      if (c == '\n') {
+        if (!skipping_) {
+          size_t len = buf_.size();
+          if (len > 0 && buf_[len - 1] == '\r') --len;
+          if (len > 0) on_line(buf_.data(), len);
+        }
+        buf_.clear();
+        skipping_ = false;
+        continue;
+      }
+      if (skipping_) continue;
+      if (buf_.size() == kMaxLine) {
+        buf_.clear();
+        skipping_ = true;  // resynchronize on the next newline
+        ++overlong_;
+        continue;
+      }
+      buf_.push_back(c);
+    }
+  }
+
+  // Forget a partial line (the port closed mid-line).
+  void reset() {
+    buf_.clear();
+    skipping_ = false;
+  }
+  uint32_t overlong() const { return overlong_; }
+
+ private:
+  std::string buf_;
+  bool skipping_ = false;
+  uint32_t overlong_ = 0;
+};
+
+enum class FrameKind : uint8_t {
+  Gesture,    // {"gesture":"pluck","value":90,"note":64,"us":...}
+  Telemetry,  // any other JSON object: raw, env, features, acknowledgements
+  Pong,       // {"pong":[seq,micros]}, the answer to a {"ping":seq}
+};
+
+struct Frame {
+  FrameKind kind = FrameKind::Telemetry;
+  std::string gesture;  // Gesture frames only
+  float value = 0.0f;   // 0-127, the MIDI-ish value the firmware reports
+  int note = -1;        // -1 when the line carries no note
+  float conf = -1.0f;   // -1 when the line carries no confidence
+  // The board's micros() the line was stamped with, when it carries one:
+  // "us" on gesture lines, the first element of "raw" and "env", the second
+  // of "pong". 32 bits, so it wraps every ~71.6 minutes.
+  bool has_us = false;
+  uint32_t us = 0;
+  uint32_t pong_seq = 0;  // Pong frames only
+};
+
+/**
+ * Parse one line. Returns false when it is not a JSON object (boot noise, a
+ * stray printf); those are counted and dropped, never forwarded. Only the
+ * top-level keys count, so {"features":{"gesture":...}} stays telemetry, and
+ * so does the tree's shadow verdict {"ab":"tree","gesture":...}: it is what
+ * the other backend *would* have said, not what the board played.
+ */
+bool parse_frame(const char* line, size_t len, Frame* out);
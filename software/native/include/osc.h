@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+/**
+ * Open Sound Control 1.0, the slice the bridge needs: build one message with
+ * string, int32, and float32 arguments, and read the address back out of a
+ * message a client sent us. Everything is big-endian and padded to 4 bytes.
+ *
+ * The bridge builds each gesture's message once and sends the same bytes to
+ * every OSC target, so a patch made for the Processing bridge keeps working:
+ *   /stringfield/gesture  ,sff  gesture  value (0-127)  normalized (0-1)
+ */
+class OscMessage {
+ public:
+  explicit OscMessage(const char* address);
+
+  OscMessage& add(const char* s);
+  OscMessage& add(int32_t i);
+  OscMessage& add(float f);
+
+  // Address, type tags, then arguments, ready for one UDP datagram.
+  std::string bytes() const;
+
+ private:
+  std::string address_;
+  std::string tags_ = ",";
+  std::string args_;
+};
+
+/**
+ * Address of the message in `data`, or false when it is not an OSC message
+ * (bundles included: nobody subscribes with a bundle).
+ */
+bool osc_address(const uint8_t* data, size_t len, std::string* address);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+/**
+ * Open the board's serial device non-blocking, raw (no echo, no line editing,
+ * no CR/LF rewriting), at `baud`. Works the same on a pty, which is how the
+ * tests stand in for a board. Returns the fd, or -1 with `error` filled in.
+ *
+ * USB CDC ignores the baud rate; it is set anyway for boards behind a real
+ * UART bridge.
+ */
+int open_serial(const std::string& path, int baud, std::string* error);
+
+// True when `baud` is one open_serial() can set.
+bool serial_baud_supported(int baud);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+/**
+ * RFC 6455, the server half, without a library: the opening handshake,
+ * unmasked frames going out, and masked frames coming in. Browsers only ever
+ * need this much to read a stream, so the whole protocol fits on a page a
+ * student can read next to the spec.
+ *
+ * The bridge is read-only from a browser's side: text a client sends is read
+ * and ignored. Ping gets a pong and close gets a close, because browsers
+ * expect both.
+ */
+
+enum class WsOpcode : uint8_t {
+  Continuation = 0x0,
+  Text = 0x1,
+  Binary = 0x2,
+  Close = 0x8,
+  Ping = 0x9,
+  Pong = 0xA,
+};
+
+// Incoming frames bigger than this close the connection (a visualizer has
+// nothing big to say to us).
+static const size_t kWsMaxClientPayload = 4096;
+// The request headers must arrive within this many bytes.
+static const size_t kWsMaxHandshake = 4096;
+
+/**
+ * Where the opening request stands. Incomplete until the blank line after
+ * the headers arrives; Bad when it is not a WebSocket upgrade at all.
+ */
+enum class WsHandshake : uint8_t { Incomplete, Ok, Bad };
+
+/**
+ * Look at the bytes received so far. On Ok, `key` holds Sec-WebSocket-Key
+ * and `consumed` the request length (a client may pipeline a frame behind
+ * it).
+ */
+WsHandshake ws_read_handshake(const std::string& request, std::string* key, size_t* consumed);
+
+// base64(SHA-1(key + the RFC's fixed GUID)): proof we read the key.
+std::string ws_accept_key(const std::string& key);
+
+// The 101 Switching Protocols response for that key.
+std::string ws_handshake_response(const std::string& key);
+
+// One unmasked, final frame, header and payload together.
+std::string ws_frame(WsOpcode op, const char* payload, size_t len);
+
+struct WsFrame {
+  WsOpcode opcode = WsOpcode::Text;
+  bool fin = true;
+  std::string payload;  // unmasked
+};
+
+enum class WsRead : uint8_t { Incomplete, Frame, Error };
+
+/**
+ * Read one client frame from the front of `data`. On Frame, `consumed` says
+ * how many bytes it took. Error means a protocol violation (an unmasked
+ * client frame, a payload over kWsMaxClientPayload) and the connection should
+ * close.
+ */
+WsRead ws_read_frame(const uint8_t* data, size_t len, WsFrame* out, size_t* consumed);
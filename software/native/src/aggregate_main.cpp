@@ -0,0 +1,155 @@
+// stringfield-aggregate: several boards, one timeline.
+//
+// A big installation runs more than one board: a harp's worth of strings
+// split across two or three controllers. Each stamps its lines with its own
+// micros(), so their streams cannot simply be interleaved. This daemon syncs
+// every board's clock to the host's (ping/pong, see clock_sync.h), merges
+// their lines in host-time order with a bounded delay (event_merger.h), and
+// writes the result to stdout, one JSON line per event. Status and sync
+// quality go to stderr.
+//
+//   stringfield-aggregate /dev/ttyACM0 /dev/ttyACM1 > session.jsonl
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <string>
+
+#include "aggregator.h"
+#include "serial_port.h"
+
+namespace {
+volatile sig_atomic_t g_stop = 0;
+
+void on_signal(int) { g_stop = 1; }
+
+void usage(FILE* out) {
+  fprintf(out,
+          "usage: stringfield-aggregate [options] SERIAL_DEVICE...\n"
+          "  --baud N          serial baud rate (default 115200)\n"
+          "  --ping-ms N       clock-sync ping interval per board (default 250)\n"
+          "  --latency-ms N    longest any event is held for ordering (default 50)\n"
+          "  --reorder-us N    how far out of order one board's own lines may be (default 5000)\n"
+          "  --stats SECONDS   print a sync/merge stats line to stderr every SECONDS (default 0 = off)\n");
+}
+
+bool parse_positive(const char* s, uint32_t* out) {
+  char* end = nullptr;
+  long v = strtol(s, &end, 10);
+  if (*end != '\0' || v <= 0) return false;
+  *out = static_cast<uint32_t>(v);
+  return true;
+}
+
+void print_stats(const Aggregator& agg) {
+  const MergeStats& m = agg.merge_stats();
+  fprintf(stderr,
+          "{\"aggregate\":{\"pushed\":%llu,\"released\":%llu,\"pending\":%zu,\"hw\":%zu,\"late\":%llu,"
+          "\"overdue\":%llu,\"forced\":%llu,\"worst_wait_us\":%lld,\"boards\":[",
+          static_cast<unsigned long long>(m.pushed), static_cast<unsigned long long>(m.released), m.pending,
+          m.high_water, static_cast<unsigned long long>(m.late), static_cast<unsigned long long>(m.overdue),
+          static_cast<unsigned long long>(m.forced), static_cast<long long>(m.worst_wait_us));
+  bool first = true;
+  for (const BoardStats& b : agg.boards()) {
+    fprintf(stderr,
+            "%s{\"path\":\"%s\",\"open\":%s,\"synced\":%s,\"lines\":%llu,\"bad\":%llu,"
+            "\"dropped_unsynced\":%llu,\"pings\":%llu,\"pongs\":%llu,\"drift_ppm\":%.1f,\"offset_us\":%.0f,\"residual_us\":%.1f,\"bound_us\":%.1f}",
+            first ? "" : ",", b.path.c_str(), b.open ? "true" : "false", b.synced ? "true" : "false",
+            static_cast<unsigned long long>(b.lines), static_cast<unsigned long long>(b.bad_lines),
+            static_cast<unsigned long long>(b.dropped_unsynced), static_cast<unsigned long long>(b.pings),
+            static_cast<unsigned long long>(b.pongs), b.drift_ppm, b.offset_us, b.residual_us, b.bound_us);
+    first = false;
+  }
+  fprintf(stderr, "]}}\n");
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  AggregatorConfig config;
+  int stats_every_s = 0;
+  static const option kOptions[] = {
+      {"baud", required_argument, nullptr, 'b'},       {"ping-ms", required_argument, nullptr, 'p'},
+      {"latency-ms", required_argument, nullptr, 'l'}, {"reorder-us", required_argument, nullptr, 'r'},
+      {"stats", required_argument, nullptr, 's'},      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "h", kOptions, nullptr)) != -1) {
+    switch (opt) {
+      case 'b':
+        config.baud = atoi(optarg);
+        if (!serial_baud_supported(config.baud)) {
+          fprintf(stderr, "unsupported baud rate: %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'p':
+        if (!parse_positive(optarg, &config.ping_ms)) {
+          fprintf(stderr, "bad --ping-ms: %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'l':
+        if (!parse_positive(optarg, &config.max_latency_ms)) {
+          fprintf(stderr, "bad --latency-ms: %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'r':
+        if (!parse_positive(optarg, &config.reorder_us)) {
+          fprintf(stderr, "bad --reorder-us: %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 's': stats_every_s = atoi(optarg); break;
+      case 'h': usage(stdout); return 0;
+      default: usage(stderr); return 2;
+    }
+  }
+  if (optind >= argc) {
+    usage(stderr);
+    return 2;
+  }
+  for (int i = optind; i < argc; ++i) config.boards.push_back(argv[i]);
+
+  struct sigaction sa {};
+  sa.sa_handler = on_signal;  // no SA_RESTART: epoll_wait returns and the loop sees the flag
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+
+  bool wrote = false;
+  Aggregator agg(config, [&wrote](const std::string& line) {
+    fwrite(line.data(), 1, line.size(), stdout);
+    fputc('\n', stdout);
+    wrote = true;
+  });
+  std::string error;
+  if (!agg.open(&error)) {
+    fprintf(stderr, "{\"aggregate\":{\"error\":\"%s\"}}\n", error.c_str());
+    return 1;
+  }
+  fprintf(stderr, "{\"aggregate\":{\"boards\":%zu,\"latency_ms\":%u}}\n", config.boards.size(),
+          config.max_latency_ms);
+
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point next_stats = Clock::now() + std::chrono::seconds(stats_every_s);
+  while (!g_stop) {
+    agg.run_once(250);
+    if (wrote) {
+      fflush(stdout);  // downstream is usually a pipe: hand lines on as they are released
+      wrote = false;
+    }
+    if (stats_every_s > 0 && Clock::now() >= next_stats) {
+      print_stats(agg);
+      next_stats += std::chrono::seconds(stats_every_s);
+    }
+  }
+  agg.drain();
+  fflush(stdout);
+  print_stats(agg);
+  return 0;
+}
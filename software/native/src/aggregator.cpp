@@ -0,0 +1,256 @@
+#include "aggregator.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <deque>
+
+#include "serial_port.h"
+
+namespace {
+const int kReadsPerWake = 16;
+}  // namespace
+
+struct Aggregator::Board {
+  struct Held {
+    bool has_us;
+    int64_t device_us;
+    int64_t arrived_us;
+    std::string line;
+  };
+
+  size_t index = 0;
+  int fd = -1;
+  LineSplitter splitter;
+  MicrosUnwrapper clock;
+  ClockModel model;
+  Clock::time_point reopen_at;
+  Clock::time_point next_ping;
+  uint32_t startup_pings_left = 0;
+  uint32_t ping_seq = 0;
+  bool ping_out = false;   // a ping is waiting for its pong
+  int64_t ping_sent_us = 0;
+  std::deque<Held> unsynced;  // lines that came before the first pong
+  BoardStats stats;
+};
+
+Aggregator::Aggregator(const AggregatorConfig& config, Output out)
+    : config_(config),
+      out_(std::move(out)),
+      merger_(config.boards.size(), static_cast<int64_t>(config.max_latency_ms) * 1000, config.reorder_us,
+              config.max_pending),
+      epoch_(Clock::now()) {
+  for (size_t i = 0; i < config_.boards.size(); ++i) {
+    std::unique_ptr<Board> b(new Board());
+    b->index = i;
+    b->stats.path = config_.boards[i];
+    b->reopen_at = epoch_;
+    merger_.set_active(i, false);  // until its first pong
+    boards_.push_back(std::move(b));
+  }
+}
+
+Aggregator::~Aggregator() {
+  for (auto& b : boards_) {
+    if (b->fd >= 0) close(b->fd);
+  }
+  if (epoll_fd_ >= 0) close(epoll_fd_);
+}
+
+bool Aggregator::open(std::string* error) {
+  if (boards_.empty()) {
+    *error = "no boards given";
+    return false;
+  }
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    *error = std::string("epoll_create1: ") + strerror(errno);
+    return false;
+  }
+  epoch_ = Clock::now();
+  for (auto& b : boards_) try_open(b.get());
+  return true;
+}
+
+int64_t Aggregator::now_us() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - epoch_).count();
+}
+
+// ---- Event loop -------------------------------------------------------------
+
+void Aggregator::run_once(int timeout_ms) {
+  Clock::time_point now = Clock::now();
+  Clock::time_point wake = now + std::chrono::milliseconds(timeout_ms);
+  for (auto& b : boards_) {
+    if (b->fd < 0 && now >= b->reopen_at) try_open(b.get());
+    if (b->fd >= 0 && now >= b->next_ping) send_ping(b.get());
+    wake = std::min(wake, b->fd < 0 ? b->reopen_at : b->next_ping);
+  }
+  if (merger_.stats().pending > 0) {
+    // Come back in time to honour the latency bound.
+    wake = std::min(wake, now + std::chrono::milliseconds(std::max<uint32_t>(1, config_.max_latency_ms / 5)));
+  }
+  int wait = static_cast<int>(
+      std::max<long long>(0, std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count()));
+
+  epoll_event events[16];
+  int n = epoll_wait(epoll_fd_, events, 16, std::min(wait, timeout_ms));
+  for (int i = 0; i < n; ++i) on_readable(boards_[events[i].data.u64].get());
+
+  merger_.release(now_us(), [this](const MergedEvent& e) { emit(e); });
+}
+
+void Aggregator::drain() {
+  merger_.drain(now_us(), [this](const MergedEvent& e) { emit(e); });
+}
+
+// ---- Boards -----------------------------------------------------------------
+
+void Aggregator::try_open(Board* b) {
+  std::string error;
+  int fd = open_serial(config_.boards[b->index], config_.baud, &error);
+  if (fd < 0) {
+    b->reopen_at = Clock::now() + std::chrono::milliseconds(config_.reopen_ms);
+    return;
+  }
+  b->fd = fd;
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.u64 = b->index;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+  // Possibly a different board, or the same one rebooted: nothing carries over.
+  b->splitter.reset();
+  b->clock.reset();
+  b->model.reset();
+  b->unsynced.clear();
+  b->ping_out = false;
+  b->startup_pings_left = kStartupPings;
+  b->next_ping = Clock::now();
+  b->stats.open = true;
+  b->stats.synced = false;
+  ++b->stats.opens;
+}
+
+void Aggregator::close_board(Board* b) {
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, b->fd, nullptr);
+  close(b->fd);
+  b->fd = -1;
+  b->stats.open = false;
+  b->stats.synced = false;
+  b->reopen_at = Clock::now() + std::chrono::milliseconds(config_.reopen_ms);
+  merger_.set_active(b->index, false);  // the others stop waiting for it
+}
+
+void Aggregator::send_ping(Board* b) {
+  Clock::time_point now = Clock::now();
+  bool startup = b->startup_pings_left > 0;
+  b->next_ping = now + std::chrono::milliseconds(startup ? kStartupPingMs : config_.ping_ms);
+  if (startup) --b->startup_pings_left;
+
+  // A ping still waiting for its pong is abandoned; a late pong for it will
+  // not match the new sequence number and is ignored.
+  char msg[32];
+  int len = snprintf(msg, sizeof(msg), "{\"ping\":%u}\n", ++b->ping_seq);
+  b->ping_sent_us = now_us();
+  if (write(b->fd, msg, static_cast<size_t>(len)) == len) {
+    b->ping_out = true;
+    ++b->stats.pings;
+  } else {
+    b->ping_out = false;  // the port is backed up; try again next time
+  }
+}
+
+void Aggregator::on_readable(Board* b) {
+  char buf[4096];
+  for (int reads = 0; reads < kReadsPerWake; ++reads) {
+    ssize_t n = read(b->fd, buf, sizeof(buf));
+    if (n > 0) {
+      b->splitter.feed(buf, static_cast<size_t>(n), [this, b](const char* line, size_t len) { on_line(b, line, len); });
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && errno == EAGAIN) return;
+    close_board(b);
+    return;
+  }
+}
+
+void Aggregator::on_line(Board* b, const char* line, size_t len) {
+  int64_t arrived = now_us();
+  ++b->stats.lines;
+  Frame f;
+  if (!parse_frame(line, len, &f)) {
+    ++b->stats.bad_lines;
+    return;
+  }
+
+  if (f.kind == FrameKind::Pong) {
+    if (!b->ping_out || f.pong_seq != b->ping_seq) return;  // stale, or not ours
+    b->ping_out = false;
+    ++b->stats.pongs;
+    int64_t device = b->clock.unwrap(f.us);
+    b->model.add(device, b->ping_sent_us, arrived);
+    merger_.heard(b->index, llround(b->model.to_host(device)));
+    if (!b->stats.synced) {
+      b->stats.synced = true;
+      merger_.set_active(b->index, true);
+      merger_.heard(b->index, llround(b->model.to_host(device)));
+      while (!b->unsynced.empty()) {
+        Board::Held& h = b->unsynced.front();
+        submit(b, h.has_us ? h.device_us : device, h.arrived_us, std::move(h.line));
+        b->unsynced.pop_front();
+      }
+    }
+    return;
+  }
+
+  bool stamped = f.has_us;
+  int64_t device = stamped ? b->clock.unwrap(f.us) : b->clock.latest();
+  std::string copy(line, len);
+  if (!b->model.synced()) {
+    if (b->unsynced.size() == kMaxUnsynced) {
+      b->unsynced.pop_front();
+      ++b->stats.dropped_unsynced;
+    }
+    b->unsynced.push_back({stamped || b->clock.started(), device, arrived, std::move(copy)});
+    return;
+  }
+  submit(b, device, arrived, std::move(copy));
+}
+
+void Aggregator::submit(Board* b, int64_t device_us, int64_t arrived_us, std::string line) {
+  b->stats.device_us = std::max(b->stats.device_us, device_us);
+  merger_.push(b->index, llround(b->model.to_host(device_us)), device_us, arrived_us, std::move(line));
+}
+
+void Aggregator::emit(const MergedEvent& e) {
+  char head[96];
+  int n = snprintf(head, sizeof(head), "{\"t\":%lld,\"b\":%zu,\"dev\":%lld,%s\"ev\":", static_cast<long long>(e.host_us),
+                   e.board, static_cast<long long>(e.device_us), e.late ? "\"late\":true," : "");
+  std::string out(head, static_cast<size_t>(n));
+  out += e.line;
+  out += '}';
+  out_(out);
+}
+
+std::vector<BoardStats> Aggregator::boards() const {
+  std::vector<BoardStats> out;
+  for (auto& b : boards_) {
+    BoardStats s = b->stats;
+    if (b->model.synced()) {
+      s.drift_ppm = b->model.drift_ppm();
+      s.residual_us = b->model.residual_us();
+      s.bound_us = b->model.bound_us();
+      int64_t at = b->clock.latest();
+      s.device_us = at;
+      s.offset_us = b->model.to_host(at) - static_cast<double>(at);
+    }
+    out.push_back(s);
+  }
+  return out;
+}
@@ -0,0 +1,499 @@
+#include "bridge.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "osc.h"
+#include "serial_port.h"
+#include "websocket.h"
+
+struct Bridge::Client {
+  explicit Client(const BridgeConfig& c) : queue(c.queue_frames, c.queue_bytes) {}
+
+  int fd = -1;              // WebSocket only; OSC clients share osc_fd_
+  sockaddr_in addr{};
+  bool open = false;        // WebSocket: handshake done, frames may flow
+  bool closing = false;     // send what is queued (a close frame, a 400), then hang up
+  bool dead = false;        // closed this round; freed once the round ends
+  bool want_write = false;  // EPOLLOUT armed: the socket pushed back
+  bool subscribed = false;  // OSC: joined by message, so it may also leave
+  Clock::time_point handshake_by;  // WebSocket: dropped if not open by then
+  std::string in;           // WebSocket bytes not yet parsed
+  ClientQueue queue;
+};
+
+namespace {
+const char* kSubscribe = "/stringfield/subscribe";
+const char* kUnsubscribe = "/stringfield/unsubscribe";
+const size_t kMaxIov = 64;
+const int kSerialReadsPerWake = 16;  // then let the clients have a turn
+
+std::string peer_name(const sockaddr_in& a) {
+  char host[INET_ADDRSTRLEN] = "?";
+  inet_ntop(AF_INET, &a.sin_addr, host, sizeof(host));
+  return std::string(host) + ":" + std::to_string(ntohs(a.sin_port));
+}
+
+bool same_peer(const sockaddr_in& a, const sockaddr_in& b) {
+  return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+bool make_addr(const std::string& host, uint16_t port, sockaddr_in* out) {
+  memset(out, 0, sizeof(*out));
+  out->sin_family = AF_INET;
+  out->sin_port = htons(port);
+  const char* h = host == "localhost" ? "127.0.0.1" : host.c_str();
+  return inet_pton(AF_INET, h, &out->sin_addr) == 1;
+}
+
+int bound_socket(int type, const std::string& host, uint16_t port, uint16_t* bound, std::string* error) {
+  sockaddr_in addr;
+  if (!make_addr(host, port, &addr)) {
+    *error = "bad bind address " + host;
+    return -1;
+  }
+  int fd = socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    *error = std::string("socket: ") + strerror(errno);
+    return -1;
+  }
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      (type == SOCK_STREAM && listen(fd, 64) != 0)) {
+    *error = host + ":" + std::to_string(port) + ": " + strerror(errno);
+    close(fd);
+    return -1;
+  }
+  socklen_t len = sizeof(addr);
+  getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+  *bound = ntohs(addr.sin_port);
+  return fd;
+}
+
+Payload share(std::string s) { return std::make_shared<const std::string>(std::move(s)); }
+}  // namespace
+
+bool parse_osc_target(const std::string& spec, OscTarget* out) {
+  size_t colon = spec.rfind(':');
+  std::string host = colon == std::string::npos ? "127.0.0.1" : spec.substr(0, colon);
+  std::string port = colon == std::string::npos ? spec : spec.substr(colon + 1);
+  char* end = nullptr;
+  long p = strtol(port.c_str(), &end, 10);
+  sockaddr_in probe;
+  if (port.empty() || *end != '\0' || p <= 0 || p > 65535 || !make_addr(host, 1, &probe)) return false;
+  out->host = host;
+  out->port = static_cast<uint16_t>(p);
+  return true;
+}
+
+Bridge::Bridge(const BridgeConfig& config) : config_(config), reopen_at_(Clock::now()) {}
+
+Bridge::~Bridge() {
+  for (auto& kv : ws_clients_) close(kv.first);
+  for (int fd : {serial_fd_, ws_listen_fd_, osc_fd_, epoll_fd_}) {
+    if (fd >= 0) close(fd);
+  }
+}
+
+bool Bridge::open(std::string* error) {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    *error = std::string("epoll_create1: ") + strerror(errno);
+    return false;
+  }
+  ws_listen_fd_ = bound_socket(SOCK_STREAM, config_.bind_host, config_.ws_port, &ws_port_, error);
+  if (ws_listen_fd_ < 0) return false;
+  osc_fd_ = bound_socket(SOCK_DGRAM, config_.bind_host, config_.osc_port, &osc_port_, error);
+  if (osc_fd_ < 0) return false;
+  watch(ws_listen_fd_, EPOLLIN);
+  watch(osc_fd_, EPOLLIN);
+
+  for (const OscTarget& t : config_.osc_targets) {
+    std::unique_ptr<Client> c(new Client(config_));
+    if (!make_addr(t.host, t.port, &c->addr)) {
+      *error = "bad OSC target " + t.host;
+      return false;
+    }
+    osc_clients_.push_back(std::move(c));
+  }
+  stats_.osc_clients = osc_clients_.size();
+  try_open_serial();
+  return true;
+}
+
+// ---- Event loop -------------------------------------------------------------
+
+void Bridge::run_once(int timeout_ms) {
+  Clock::time_point now = Clock::now();
+  auto wake_by = [&](Clock::time_point at) {
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(at - now).count() + 1;
+    timeout_ms = std::min<int>(timeout_ms, static_cast<int>(std::max<long long>(wait, 0)));
+  };
+  if (serial_fd_ < 0 && !config_.serial_path.empty()) {
+    if (now >= reopen_at_) try_open_serial();
+    if (serial_fd_ < 0) wake_by(reopen_at_);
+  }
+  if (!handshakes_.empty()) wake_by(handshakes_.front().by);
+
+  epoll_event events[64];
+  int n = epoll_wait(epoll_fd_, events, 64, timeout_ms);
+  for (int i = 0; i < n; ++i) {
+    int fd = events[i].data.fd;
+    uint32_t ev = events[i].events;
+    if (fd == serial_fd_) {
+      on_serial_readable();
+    } else if (fd == ws_listen_fd_) {
+      on_ws_accept();
+    } else if (fd == osc_fd_) {
+      if (ev & EPOLLIN) on_osc_readable();
+      if (ev & EPOLLOUT) flush_osc();
+    } else {
+      auto it = ws_clients_.find(fd);
+      if (it == ws_clients_.end() || it->second->dead) continue;
+      Client* c = it->second.get();
+      if (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) on_ws_readable(c);
+      if ((ev & EPOLLOUT) && !c->dead) flush_ws(c);
+    }
+  }
+
+  // New frames went into queues above; push them at every socket that has
+  // not already said "later". One writev per client per round.
+  for (auto& kv : ws_clients_) {
+    Client* c = kv.second.get();
+    if (!c->dead && !c->want_write && !c->queue.empty()) flush_ws(c);
+  }
+  if (!osc_want_write_) flush_osc();
+  expire_handshakes(Clock::now());
+
+  for (int fd : doomed_) {
+    close(fd);
+    ws_clients_.erase(fd);
+  }
+  doomed_.clear();
+}
+
+void Bridge::watch(int fd, uint32_t events) {
+  epoll_event ev{};
+  ev.events = events;
+  ev.data.fd = fd;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+}
+
+void Bridge::set_events(int fd, uint32_t events) {
+  epoll_event ev{};
+  ev.events = events;
+  ev.data.fd = fd;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+}
+
+// ---- Serial -----------------------------------------------------------------
+
+void Bridge::try_open_serial() {
+  std::string error;
+  int fd = open_serial(config_.serial_path, config_.baud, &error);
+  if (fd < 0) {
+    serial_error_ = error;
+    reopen_at_ = Clock::now() + std::chrono::milliseconds(config_.reopen_ms);
+    return;
+  }
+  serial_fd_ = fd;
+  serial_error_.clear();
+  splitter_.reset();
+  watch(fd, EPOLLIN);
+  ++stats_.serial_opens;
+  stats_.serial_open = true;
+}
+
+void Bridge::close_serial() {
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, serial_fd_, nullptr);
+  close(serial_fd_);
+  serial_fd_ = -1;
+  stats_.serial_open = false;
+  serial_error_ = "serial port closed";
+  reopen_at_ = Clock::now() + std::chrono::milliseconds(config_.reopen_ms);
+}
+
+void Bridge::on_serial_readable() {
+  char buf[4096];
+  for (int reads = 0; reads < kSerialReadsPerWake; ++reads) {
+    ssize_t n = read(serial_fd_, buf, sizeof(buf));
+    if (n > 0) {
+      splitter_.feed(buf, static_cast<size_t>(n), [this](const char* line, size_t len) { on_line(line, len); });
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && errno == EAGAIN) break;
+    close_serial();  // EOF, or EIO from a pty/USB device that went away
+    break;
+  }
+  stats_.long_lines = splitter_.overlong();
+}
+
+void Bridge::on_line(const char* line, size_t len) {
+  ++stats_.lines;
+  Frame f;
+  if (!parse_frame(line, len, &f)) {
+    ++stats_.bad_lines;
+    return;
+  }
+  if (stats_.ws_clients > 0) {
+    Payload ws = share(ws_frame(WsOpcode::Text, line, len));
+    for (auto& kv : ws_clients_) {
+      Client* c = kv.second.get();
+      if (!c->open || c->closing || c->dead) continue;
+      if (!c->queue.push(ws)) ++stats_.dropped;
+    }
+  }
+  if (f.kind != FrameKind::Gesture) return;
+  ++stats_.gestures;
+  if (osc_clients_.empty()) return;
+  float normalized = std::min(std::max(f.value / 127.0f, 0.0f), 1.0f);
+  Payload osc = share(OscMessage("/stringfield/gesture").add(f.gesture.c_str()).add(f.value).add(normalized).bytes());
+  for (auto& c : osc_clients_) {
+    if (!c->queue.push(osc)) ++stats_.dropped;
+  }
+}
+
+// ---- WebSocket clients ------------------------------------------------------
+
+void Bridge::on_ws_accept() {
+  for (;;) {
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int fd = accept4(ws_listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;  // EAGAIN: all taken; anything else: try again next wake
+    if (ws_clients_.size() >= config_.max_ws_clients) {
+      static const char kFull[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+      send(fd, kFull, sizeof(kFull) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+      close(fd);
+      ++stats_.ws_rejected;
+      continue;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (config_.sndbuf_bytes > 0) {
+      setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &config_.sndbuf_bytes, sizeof(config_.sndbuf_bytes));
+    }
+    std::unique_ptr<Client> c(new Client(config_));
+    c->fd = fd;
+    c->addr = addr;
+    c->handshake_by = Clock::now() + std::chrono::milliseconds(config_.handshake_ms);
+    handshakes_.push_back({fd, c->handshake_by});
+    watch(fd, EPOLLIN | EPOLLRDHUP);
+    ws_clients_[fd] = std::move(c);
+  }
+}
+
+void Bridge::on_ws_readable(Client* c) {
+  char buf[4096];
+  for (;;) {
+    ssize_t n = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n > 0) {
+      if (!c->closing) c->in.append(buf, static_cast<size_t>(n));
+      if (c->in.size() > kWsMaxHandshake + kWsMaxClientPayload) break;  // parse what we have
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && errno == EAGAIN) break;
+    close_ws(c);  // peer hung up or reset
+    return;
+  }
+
+  if (!c->open) {
+    std::string key;
+    size_t used = 0;
+    WsHandshake h = ws_read_handshake(c->in, &key, &used);
+    if (h == WsHandshake::Incomplete) return;
+    if (h == WsHandshake::Bad) {
+      ++stats_.ws_rejected;
+      c->in.clear();
+      c->closing = true;
+      c->queue.push_control(share("HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"));
+      return;
+    }
+    c->in.erase(0, used);
+    c->open = true;
+    c->queue.push_control(share(ws_handshake_response(key)));
+    ++stats_.ws_accepted;
+    ++stats_.ws_clients;
+  }
+
+  size_t at = 0;
+  while (!c->closing) {
+    WsFrame f;
+    size_t used = 0;
+    WsRead r = ws_read_frame(reinterpret_cast<const uint8_t*>(c->in.data()) + at, c->in.size() - at, &f, &used);
+    if (r == WsRead::Incomplete) break;
+    if (r == WsRead::Error) {
+      close_ws(c);
+      return;
+    }
+    at += used;
+    if (f.opcode == WsOpcode::Ping) {
+      c->queue.push_control(share(ws_frame(WsOpcode::Pong, f.payload.data(), f.payload.size())));
+    } else if (f.opcode == WsOpcode::Close) {
+      // Echo the status code, then hang up once it is out.
+      c->queue.push_control(share(ws_frame(WsOpcode::Close, f.payload.data(), std::min<size_t>(f.payload.size(), 2))));
+      c->closing = true;
+    }
+    // Text and binary from a browser are read and ignored: the bridge is a
+    // one-way street, and nothing here writes to the board.
+  }
+  c->in.erase(0, at);
+  if (c->closing) c->in.clear();
+}
+
+void Bridge::flush_ws(Client* c) {
+  while (!c->queue.empty()) {
+    iovec iov[kMaxIov];
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = c->queue.gather(iov, kMaxIov);
+    ssize_t n = sendmsg(c->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n > 0) {
+      c->queue.consume(static_cast<size_t>(n));
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && errno == EAGAIN) {
+      if (!c->want_write) {
+        c->want_write = true;
+        set_events(c->fd, EPOLLIN | EPOLLRDHUP | EPOLLOUT);
+      }
+      return;
+    }
+    close_ws(c);
+    return;
+  }
+  if (c->want_write) {
+    c->want_write = false;
+    set_events(c->fd, EPOLLIN | EPOLLRDHUP);
+  }
+  if (c->closing) close_ws(c);
+}
+
+void Bridge::close_ws(Client* c) {
+  if (c->dead) return;
+  c->dead = true;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, c->fd, nullptr);
+  if (c->open) {
+    --stats_.ws_clients;
+    ++stats_.ws_closed;
+  }
+  // The fd stays open until the round ends, so accept() cannot hand the same
+  // number to a new client while an event for the old one is still pending.
+  doomed_.push_back(c->fd);
+}
+
+// A connection that never finishes its handshake (a port scan, a tab frozen
+// mid-connect, a slow-loris) would otherwise hold a max_ws_clients slot for
+// good. Entries whose client opened, closed, or gave its fd to a newer client
+// are stale and just fall off the front.
+void Bridge::expire_handshakes(Clock::time_point now) {
+  while (!handshakes_.empty()) {
+    const Handshake& h = handshakes_.front();
+    auto it = ws_clients_.find(h.fd);
+    bool waiting = it != ws_clients_.end() && !it->second->open && !it->second->dead &&
+                   it->second->handshake_by == h.by;
+    if (waiting && now < h.by) return;
+    if (waiting) {
+      ++stats_.ws_timed_out;
+      close_ws(it->second.get());
+    }
+    handshakes_.pop_front();
+  }
+}
+
+// ---- OSC clients ------------------------------------------------------------
+
+void Bridge::on_osc_readable() {
+  uint8_t buf[512];
+  for (;;) {
+    sockaddr_in from;
+    socklen_t len = sizeof(from);
+    ssize_t n = recvfrom(osc_fd_, buf, sizeof(buf), MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&from), &len);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return;  // EAGAIN, or an ICMP error from a target that went away
+    }
+    std::string address;
+    if (!osc_address(buf, static_cast<size_t>(n), &address)) continue;
+    if (address == kSubscribe) {
+      add_osc_client(from);
+    } else if (address == kUnsubscribe) {
+      osc_clients_.erase(std::remove_if(osc_clients_.begin(), osc_clients_.end(),
+                                        [&](const std::unique_ptr<Client>& c) {
+                                          return c->subscribed && same_peer(c->addr, from);
+                                        }),
+                         osc_clients_.end());
+      stats_.osc_clients = osc_clients_.size();
+    }
+  }
+}
+
+void Bridge::add_osc_client(const sockaddr_in& addr) {
+  size_t subscribed = 0;
+  for (auto& c : osc_clients_) {
+    if (same_peer(c->addr, addr)) return;  // already hearing us
+    if (c->subscribed) ++subscribed;
+  }
+  if (subscribed >= config_.max_osc_clients) return;
+  std::unique_ptr<Client> c(new Client(config_));
+  c->addr = addr;
+  c->subscribed = true;
+  osc_clients_.push_back(std::move(c));
+  stats_.osc_clients = osc_clients_.size();
+}
+
+void Bridge::flush_osc() {
+  for (auto& c : osc_clients_) {
+    while (!c->queue.empty()) {
+      ssize_t n = sendto(osc_fd_, c->queue.front_data(), c->queue.front_size(), MSG_DONTWAIT,
+                         reinterpret_cast<const sockaddr*>(&c->addr), sizeof(c->addr));
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0 && (errno == EAGAIN || errno == ENOBUFS)) {
+        // The socket's send buffer is full for everyone; wait for room.
+        if (!osc_want_write_) {
+          osc_want_write_ = true;
+          set_events(osc_fd_, EPOLLIN | EPOLLOUT);
+        }
+        return;
+      }
+      // Sent, or refused by this one target (nobody listening there yet):
+      // either way the datagram is done with.
+      c->queue.consume(c->queue.front_size());
+    }
+  }
+  if (osc_want_write_) {
+    osc_want_write_ = false;
+    set_events(osc_fd_, EPOLLIN);
+  }
+}
+
+std::vector<ClientInfo> Bridge::clients() const {
+  std::vector<ClientInfo> out;
+  auto row = [&out](const Client& c, bool websocket) {
+    ClientInfo info;
+    info.websocket = websocket;
+    info.peer = peer_name(c.addr);
+    info.queued = c.queue.size();
+    info.high_water = c.queue.high_water();
+    info.sent = c.queue.sent();
+    info.dropped = c.queue.dropped();
+    out.push_back(info);
+  };
+  for (auto& kv : ws_clients_) {
+    if (kv.second->open && !kv.second->dead) row(*kv.second, true);
+  }
+  for (auto& c : osc_clients_) row(*c, false);
+  return out;
+}
@@ -0,0 +1,345 @@
+#include "capture.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "frame.h"
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "the .sfcap layout is little-endian, written as-is");
+
+namespace {
+const char* const kGestureNames[] = {"",        "pluck",   "bow",     "scrape", "mute",
+                                     "tremolo", "vibrato", "release", "idle",   "harmonic"};
+static_assert(sizeof(kGestureNames) / sizeof(kGestureNames[0]) == static_cast<size_t>(CaptureGesture::Harmonic) + 1,
+              "one name per CaptureGesture");
+const uint32_t kFirmwareDecimals = 4;  // Serial.print(value, 4) in emit_raw_sample
+const uint32_t kMaxDecimals = 9;
+const uint64_t kAlign = 64;
+
+uint64_t align_up(uint64_t n) { return (n + kAlign - 1) / kAlign * kAlign; }
+
+// `{"raw":[123456,0.4200]}` exactly, as the firmware and flight_dump.py write
+// it. Anything else (extra keys, spaces, a third element) stays an event, so
+// nothing is lost by turning the rest into 16-byte samples.
+bool parse_raw_line(const char* p, size_t len, uint32_t* device_us, float* value, uint32_t* decimals) {
+  static const char kHead[] = "{\"raw\":[";
+  const size_t head = sizeof(kHead) - 1;
+  if (len < head + 5 || memcmp(p, kHead, head) != 0 || memcmp(p + len - 2, "]}", 2) != 0) return false;
+  const char* end = p + len - 2;
+  const char* q = p + head;
+  uint64_t us = 0;
+  const char* digits = q;
+  while (q < end && *q >= '0' && *q <= '9' && q - digits < 10) us = us * 10 + static_cast<uint64_t>(*q++ - '0');
+  if (q == digits || us > UINT32_MAX || q == end || *q++ != ',') return false;
+
+  const char* v = q;
+  if (q < end && *q == '-') ++q;
+  const char* int_digits = q;
+  while (q < end && *q >= '0' && *q <= '9') ++q;
+  if (q == int_digits) return false;
+  uint32_t places = 0;
+  if (q < end && *q == '.') {
+    ++q;
+    while (q < end && *q >= '0' && *q <= '9') {
+      ++q;
+      ++places;
+    }
+    if (places == 0) return false;
+  }
+  if (q != end || places > kMaxDecimals) return false;
+
+  char buf[48];
+  size_t n = static_cast<size_t>(end - v);
+  if (n >= sizeof(buf)) return false;
+  memcpy(buf, v, n);
+  buf[n] = '\0';
+  *device_us = static_cast<uint32_t>(us);
+  *value = strtof(buf, nullptr);
+  *decimals = places;
+  return true;
+}
+
+bool write_all(FILE* f, const void* data, size_t n) { return n == 0 || fwrite(data, 1, n, f) == n; }
+
+bool pad_to(FILE* f, uint64_t at) {
+  static const char zeros[kAlign] = {};
+  long pos = ftell(f);
+  if (pos < 0 || static_cast<uint64_t>(pos) > at) return false;
+  return write_all(f, zeros, static_cast<size_t>(at - static_cast<uint64_t>(pos)));
+}
+
+// Does [offset, offset + count * size) fit inside a file of `file` bytes?
+bool section_fits(uint64_t offset, uint64_t count, uint64_t size, uint64_t file) {
+  if (offset > file || offset % 8 != 0) return false;
+  return count <= (file - offset) / size;
+}
+}  // namespace
+
+CaptureGesture capture_gesture_code(const std::string& name) {
+  for (size_t i = 1; i < sizeof(kGestureNames) / sizeof(kGestureNames[0]); ++i) {
+    if (name == kGestureNames[i]) return static_cast<CaptureGesture>(i);
+  }
+  return CaptureGesture::Other;
+}
+
+const char* capture_gesture_name(CaptureGesture g) {
+  size_t i = static_cast<size_t>(g);
+  return i < sizeof(kGestureNames) / sizeof(kGestureNames[0]) && i > 0 ? kGestureNames[i] : "other";
+}
+
+std::string capture_raw_line(const CaptureSample& s, uint32_t value_decimals) {
+  char buf[64];
+  int n = snprintf(buf, sizeof(buf), "{\"raw\":[%u,%.*f]}", s.device_us, static_cast<int>(value_decimals),
+                   static_cast<double>(s.value));
+  return std::string(buf, static_cast<size_t>(n));
+}
+
+// ---- Writing ----------------------------------------------------------------
+
+void CaptureBuilder::add_sample(int64_t t_us, uint32_t device_us, float value) {
+  samples_.push_back(CaptureSample{t_us, device_us, value});
+}
+
+void CaptureBuilder::add_line(int64_t t_us, const char* line, size_t len) {
+  uint32_t device_us = 0, places = 0;
+  float value = 0.0f;
+  if (parse_raw_line(line, len, &device_us, &value, &places)) {
+    add_sample(t_us, device_us, value);
+    value_decimals_ = std::max(value_decimals_, places);
+    return;
+  }
+
+  CaptureEvent e{};
+  e.t_us = t_us;
+  e.text_offset = text_.size();
+  e.text_len = static_cast<uint32_t>(len);
+  e.note = -1;
+  Frame f;
+  if (!parse_frame(line, len, &f)) {
+    e.kind = CaptureEventKind::Text;
+  } else if (f.kind == FrameKind::Gesture) {
+    e.kind = CaptureEventKind::Gesture;
+    e.gesture = capture_gesture_code(f.gesture);
+    e.value = static_cast<uint8_t>(std::min(127.0f, std::max(0.0f, f.value)));
+    e.note = static_cast<int8_t>(f.note >= 0 && f.note <= 127 ? f.note : -1);
+  } else {
+    e.kind = CaptureEventKind::Telemetry;
+  }
+  if (f.has_us) {
+    e.flags |= kCaptureHasDeviceUs;
+    e.device_us = f.us;
+  }
+  text_.append(line, len);
+  events_.push_back(e);
+}
+
+bool CaptureBuilder::write(const std::string& path, std::string* error) {
+  // serial_logger.py rows are already in time order; a merged or hand-made
+  // capture might not be. Stable, so equal times keep their arrival order.
+  auto by_time = [](const auto& a, const auto& b) { return a.t_us < b.t_us; };
+  if (!std::is_sorted(samples_.begin(), samples_.end(), by_time)) {
+    std::stable_sort(samples_.begin(), samples_.end(), by_time);
+  }
+  if (!std::is_sorted(events_.begin(), events_.end(), by_time)) {
+    std::stable_sort(events_.begin(), events_.end(), by_time);
+  }
+
+  CaptureHeader h{};
+  memcpy(h.magic, kCaptureMagic, sizeof(h.magic));
+  h.version = kCaptureVersion;
+  h.header_size = sizeof(CaptureHeader);
+  h.sample_size = sizeof(CaptureSample);
+  h.event_size = sizeof(CaptureEvent);
+  h.index_entry_size = sizeof(CaptureIndexEntry);
+  h.bucket_us = bucket_us_;
+  h.start_unix_us = start_unix_us_;
+  h.value_decimals = value_decimals_ > 0 ? value_decimals_ : kFirmwareDecimals;
+
+  std::vector<CaptureIndexEntry> index;
+  if (!samples_.empty() || !events_.empty()) {
+    h.t_begin_us = INT64_MAX;
+    h.t_end_us = INT64_MIN;
+    if (!samples_.empty()) {
+      h.t_begin_us = samples_.front().t_us;
+      h.t_end_us = samples_.back().t_us;
+    }
+    if (!events_.empty()) {
+      h.t_begin_us = std::min(h.t_begin_us, events_.front().t_us);
+      h.t_end_us = std::max(h.t_end_us, events_.back().t_us);
+    }
+    uint64_t buckets = static_cast<uint64_t>(h.t_end_us - h.t_begin_us) / bucket_us_ + 1;
+    index.resize(buckets);
+    size_t s = 0, e = 0;
+    for (uint64_t b = 0; b < buckets; ++b) {
+      int64_t start = h.t_begin_us + static_cast<int64_t>(b * bucket_us_);
+      while (s < samples_.size() && samples_[s].t_us < start) ++s;
+      while (e < events_.size() && events_[e].t_us < start) ++e;
+      index[b] = CaptureIndexEntry{s, e};
+    }
+  }
+
+  h.sample_offset = align_up(sizeof(CaptureHeader));
+  h.sample_count = samples_.size();
+  h.event_offset = align_up(h.sample_offset + h.sample_count * sizeof(CaptureSample));
+  h.event_count = events_.size();
+  h.index_offset = align_up(h.event_offset + h.event_count * sizeof(CaptureEvent));
+  h.index_count = index.size();
+  h.text_offset = align_up(h.index_offset + h.index_count * sizeof(CaptureIndexEntry));
+  h.text_size = text_.size();
+  h.notes_offset = h.text_offset + h.text_size;
+  h.notes_size = notes_.size();
+
+  std::string tmp = path + ".tmp";
+  FILE* f = fopen(tmp.c_str(), "wb");
+  if (!f) {
+    *error = tmp + ": " + strerror(errno);
+    return false;
+  }
+  bool ok = write_all(f, &h, sizeof(h)) && pad_to(f, h.sample_offset) &&
+            write_all(f, samples_.data(), samples_.size() * sizeof(CaptureSample)) && pad_to(f, h.event_offset) &&
+            write_all(f, events_.data(), events_.size() * sizeof(CaptureEvent)) && pad_to(f, h.index_offset) &&
+            write_all(f, index.data(), index.size() * sizeof(CaptureIndexEntry)) && pad_to(f, h.text_offset) &&
+            write_all(f, text_.data(), text_.size()) && write_all(f, notes_.data(), notes_.size());
+  ok = (fclose(f) == 0) && ok;
+  if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+    *error = path + ": " + strerror(errno);
+    unlink(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+// ---- Reading ----------------------------------------------------------------
+
+CaptureFile::~CaptureFile() { close(); }
+
+void CaptureFile::close() {
+  if (map_) munmap(map_, map_size_);
+  map_ = nullptr;
+  map_size_ = 0;
+  header_ = nullptr;
+}
+
+bool CaptureFile::open(const std::string& path, std::string* error) {
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = path + ": " + strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(CaptureHeader))) {
+    *error = path + ": too short to be a capture";
+    ::close(fd);
+    return false;
+  }
+  void* map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);  // the mapping keeps the file
+  if (map == MAP_FAILED) {
+    *error = path + ": mmap: " + strerror(errno);
+    return false;
+  }
+  map_ = map;
+  map_size_ = static_cast<size_t>(st.st_size);
+  const char* base = static_cast<const char*>(map_);
+  const CaptureHeader& h = *reinterpret_cast<const CaptureHeader*>(base);
+  uint64_t size = map_size_;
+
+  const char* why = nullptr;
+  if (memcmp(h.magic, kCaptureMagic, sizeof(kCaptureMagic)) != 0) {
+    why = "not a .sfcap file";
+  } else if (h.version != kCaptureVersion) {
+    why = "unsupported .sfcap version";
+  } else if (h.header_size != sizeof(CaptureHeader) || h.sample_size != sizeof(CaptureSample) ||
+             h.event_size != sizeof(CaptureEvent) || h.index_entry_size != sizeof(CaptureIndexEntry) ||
+             h.bucket_us == 0) {
+    why = "record layout does not match this build";
+  } else if (!section_fits(h.sample_offset, h.sample_count, sizeof(CaptureSample), size) ||
+             !section_fits(h.event_offset, h.event_count, sizeof(CaptureEvent), size) ||
+             !section_fits(h.index_offset, h.index_count, sizeof(CaptureIndexEntry), size) ||
+             h.text_offset > size || h.text_size > size - h.text_offset || h.notes_offset > size ||
+             h.notes_size > size - h.notes_offset) {
+    why = "truncated";
+  } else if ((h.sample_count + h.event_count == 0) != (h.index_count == 0) ||
+             (h.index_count > 0 && (h.t_end_us < h.t_begin_us ||
+                                    h.index_count != static_cast<uint64_t>(h.t_end_us - h.t_begin_us) / h.bucket_us + 1))) {
+    why = "index does not cover the capture";
+  }
+  if (!why) {
+    header_ = &h;
+    samples_ = reinterpret_cast<const CaptureSample*>(base + h.sample_offset);
+    events_ = reinterpret_cast<const CaptureEvent*>(base + h.event_offset);
+    index_ = reinterpret_cast<const CaptureIndexEntry*>(base + h.index_offset);
+    text_ = base + h.text_offset;
+    notes_ = base + h.notes_offset;
+    // The index and the events are small next to the samples; checking them
+    // here means no accessor can step outside the mapping later.
+    uint64_t s = 0, e = 0;
+    for (uint64_t i = 0; i < h.index_count && !why; ++i) {
+      if (index_[i].sample < s || index_[i].sample > h.sample_count || index_[i].event < e ||
+          index_[i].event > h.event_count) {
+        why = "index is corrupt";
+      }
+      s = index_[i].sample;
+      e = index_[i].event;
+    }
+    for (uint64_t i = 0; i < h.event_count && !why; ++i) {
+      if (events_[i].text_offset > h.text_size || events_[i].text_len > h.text_size - events_[i].text_offset) {
+        why = "event text outside the text section";
+      }
+    }
+  }
+  if (why) {
+    *error = path + ": " + why;
+    close();
+    return false;
+  }
+  return true;
+}
+
+size_t CaptureFile::bucket_of(int64_t t_us) const {
+  return static_cast<size_t>(static_cast<uint64_t>(t_us - header_->t_begin_us) / header_->bucket_us);
+}
+
+size_t CaptureFile::sample_at(int64_t t_us) const {
+  size_t n = sample_count();
+  if (n == 0 || t_us <= header_->t_begin_us) return 0;
+  if (t_us > header_->t_end_us) return n;
+  size_t b = bucket_of(t_us);
+  size_t lo = static_cast<size_t>(index_[b].sample);
+  size_t hi = b + 1 < header_->index_count ? static_cast<size_t>(index_[b + 1].sample) : n;
+  const CaptureSample* at = std::lower_bound(samples_ + lo, samples_ + hi, t_us,
+                                             [](const CaptureSample& s, int64_t t) { return s.t_us < t; });
+  return static_cast<size_t>(at - samples_);
+}
+
+size_t CaptureFile::event_at(int64_t t_us) const {
+  size_t n = event_count();
+  if (n == 0 || t_us <= header_->t_begin_us) return 0;
+  if (t_us > header_->t_end_us) return n;
+  size_t b = bucket_of(t_us);
+  size_t lo = static_cast<size_t>(index_[b].event);
+  size_t hi = b + 1 < header_->index_count ? static_cast<size_t>(index_[b + 1].event) : n;
+  const CaptureEvent* at = std::lower_bound(events_ + lo, events_ + hi, t_us,
+                                            [](const CaptureEvent& e, int64_t t) { return e.t_us < t; });
+  return static_cast<size_t>(at - events_);
+}
+
+void CaptureFile::prefetch(int64_t from_us, int64_t to_us) const {
+  const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  auto advise = [page](const void* first, const void* last) {
+    uintptr_t a = reinterpret_cast<uintptr_t>(first) & ~(page - 1);
+    uintptr_t b = reinterpret_cast<uintptr_t>(last);
+    if (b > a) madvise(reinterpret_cast<void*>(a), b - a, MADV_WILLNEED);
+  };
+  advise(samples_ + sample_at(from_us), samples_ + sample_at(to_us));
+  advise(events_ + event_at(from_us), events_ + event_at(to_us));
+}
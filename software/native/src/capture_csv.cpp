@@ -0,0 +1,206 @@
+#include "capture_csv.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <vector>
+
+namespace {
+// One CSV record out of [p, end), Python csv dialect: fields split on ',',
+// a field that starts with '"' runs to the matching '"' with "" as an escaped
+// quote (and may span lines). Returns where the next record starts.
+const char* read_record(const char* p, const char* end, std::vector<std::string>* fields) {
+  fields->clear();
+  fields->emplace_back();
+  while (p < end) {
+    std::string& field = fields->back();
+    if (field.empty() && *p == '"') {
+      ++p;
+      while (p < end) {
+        if (*p == '"') {
+          if (p + 1 < end && p[1] == '"') {
+            field.push_back('"');
+            p += 2;
+            continue;
+          }
+          ++p;
+          break;
+        }
+        field.push_back(*p++);
+      }
+      continue;
+    }
+    char c = *p++;
+    if (c == ',') {
+      fields->emplace_back();
+    } else if (c == '\n') {
+      break;
+    } else if (c == '\r' && (p == end || *p == '\n')) {
+      // the "\r\n" row ending; the '\n' ends the record next time round
+    } else {
+      field.push_back(c);
+    }
+  }
+  return p;
+}
+
+int digits(const char* p, int n) {
+  int v = 0;
+  for (int i = 0; i < n; ++i) {
+    if (p[i] < '0' || p[i] > '9') return -1;
+    v = v * 10 + (p[i] - '0');
+  }
+  return v;
+}
+}  // namespace
+
+bool capture_parse_iso_time(const std::string& text, int64_t* unix_us) {
+  const char* p = text.c_str();
+  size_t n = text.size();
+  if (n < 19 || p[4] != '-' || p[7] != '-' || (p[10] != 'T' && p[10] != ' ') || p[13] != ':' || p[16] != ':') {
+    return false;
+  }
+  struct tm tm {};
+  tm.tm_year = digits(p, 4) - 1900;
+  tm.tm_mon = digits(p + 5, 2) - 1;
+  tm.tm_mday = digits(p + 8, 2);
+  tm.tm_hour = digits(p + 11, 2);
+  tm.tm_min = digits(p + 14, 2);
+  tm.tm_sec = digits(p + 17, 2);
+  if (tm.tm_year < 0 || tm.tm_mon < 0 || tm.tm_mday < 0 || tm.tm_hour < 0 || tm.tm_min < 0 || tm.tm_sec < 0) {
+    return false;
+  }
+  size_t at = 19;
+  int64_t frac = 0;
+  if (at < n && p[at] == '.') {
+    ++at;
+    int64_t scale = 100000;
+    while (at < n && p[at] >= '0' && p[at] <= '9') {
+      frac += (p[at++] - '0') * scale;
+      scale /= 10;
+    }
+  }
+  int64_t offset_s = 0;
+  if (at < n && (p[at] == '+' || p[at] == '-')) {
+    if (n - at < 6 || p[at + 3] != ':') return false;
+    int hh = digits(p + at + 1, 2), mm = digits(p + at + 4, 2);
+    if (hh < 0 || mm < 0) return false;
+    offset_s = (p[at] == '-' ? -1 : 1) * (hh * 3600 + mm * 60);
+    at += 6;
+  } else if (at < n && p[at] == 'Z') {
+    ++at;
+  }
+  if (at != n) return false;
+  *unix_us = (static_cast<int64_t>(timegm(&tm)) - offset_s) * 1000000 + frac;
+  return true;
+}
+
+std::string capture_iso_time(int64_t unix_us) {
+  int64_t s = unix_us >= 0 ? unix_us / 1000000 : -((-unix_us + 999999) / 1000000);
+  int64_t us = unix_us - s * 1000000;
+  time_t t = static_cast<time_t>(s);
+  struct tm tm {};
+  gmtime_r(&t, &tm);
+  char buf[48];
+  size_t n = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+  if (us != 0) n += static_cast<size_t>(snprintf(buf + n, sizeof(buf) - n, ".%06lld", static_cast<long long>(us)));
+  snprintf(buf + n, sizeof(buf) - n, "+00:00");
+  return buf;
+}
+
+std::string capture_csv_row(const std::string& timestamp_iso, int64_t t_us, const std::string& line) {
+  char elapsed[32];
+  snprintf(elapsed, sizeof(elapsed), "%s%lld.%06lld", t_us < 0 ? "-" : "", static_cast<long long>(llabs(t_us) / 1000000),
+           static_cast<long long>(llabs(t_us) % 1000000));
+  std::string row = timestamp_iso;
+  row += ',';
+  row += elapsed;
+  row += ',';
+  if (line.find_first_of(",\"\r\n") == std::string::npos) {
+    row += line;
+  } else {
+    row += '"';
+    for (char c : line) {
+      if (c == '"') row += '"';
+      row += c;
+    }
+    row += '"';
+  }
+  row += "\r\n";
+  return row;
+}
+
+bool capture_import_csv(const std::string& csv_path, CaptureBuilder* out, CsvImportStats* stats,
+                        std::string* error) {
+  int fd = open(csv_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = csv_path + ": " + strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    *error = csv_path + ": " + strerror(errno);
+    close(fd);
+    return false;
+  }
+  size_t size = static_cast<size_t>(st.st_size);
+  const char* data = nullptr;
+  void* map = nullptr;
+  if (size > 0) {
+    map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      *error = csv_path + ": mmap: " + strerror(errno);
+      close(fd);
+      return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(map);
+  }
+  close(fd);
+
+  const char* p = data;
+  const char* end = data + size;
+  std::vector<std::string> fields;
+  bool have_start = false;
+  while (p < end) {
+    if (*p == '#') {
+      const char* eol = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+      if (!eol) eol = end;
+      const char* text = p + 1;
+      if (text < eol && *text == ' ') ++text;
+      const char* stop = eol;
+      if (stop > text && stop[-1] == '\r') --stop;
+      out->add_note(std::string(text, static_cast<size_t>(stop - text)));
+      ++stats->comments;
+      p = eol < end ? eol + 1 : end;
+      continue;
+    }
+    p = read_record(p, end, &fields);
+    if (fields.size() == 1 && fields[0].empty()) continue;  // blank line
+    if (fields.size() >= 2 && fields[1] == "elapsed_seconds") continue;  // the header row
+    char* stop = nullptr;
+    double elapsed = fields.size() >= 3 ? strtod(fields[1].c_str(), &stop) : 0.0;
+    if (fields.size() < 3 || stop == fields[1].c_str() || *stop != '\0' || !isfinite(elapsed)) {
+      ++stats->skipped;
+      continue;
+    }
+    int64_t t_us = llround(elapsed * 1e6);
+    int64_t wall = 0;
+    if (!have_start && capture_parse_iso_time(fields[0], &wall)) {
+      out->set_start_unix_us(wall - t_us);
+      have_start = true;
+    }
+    out->add_line(t_us, fields[2].data(), fields[2].size());
+    ++stats->rows;
+  }
+  if (map) munmap(map, size);
+  return true;
+}
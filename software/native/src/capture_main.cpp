@@ -0,0 +1,174 @@
+// stringfield-capture: CSV captures in, seekable .sfcap files out, and any
+// slice of one played back.
+//
+//   stringfield-capture convert take01.csv take01.sfcap
+//   stringfield-capture info take01.sfcap
+//   stringfield-capture replay take01.sfcap --from 2820 --to 2835 --csv > slice.csv
+//
+// The tuning loop jumps around hour-long sessions. Converting once makes each
+// jump an mmap and a seek instead of a re-parse (see include/capture.h).
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+
+#include "capture.h"
+#include "capture_csv.h"
+
+namespace {
+void usage(FILE* out) {
+  fprintf(out,
+          "usage: stringfield-capture convert IN.csv OUT.sfcap\n"
+          "       stringfield-capture info FILE.sfcap\n"
+          "       stringfield-capture replay FILE.sfcap [options]\n"
+          "  --from SECONDS    start of the slice, capture time (default: the beginning)\n"
+          "  --to SECONDS      end of the slice, exclusive (default: the end)\n"
+          "  --csv             write serial_logger CSV rows instead of bare lines\n"
+          "  --gestures        gesture lines only\n"
+          "  --speed X         pace the output at X times real time (default 0 = as fast as possible)\n");
+}
+
+bool parse_seconds(const char* s, int64_t* us) {
+  char* end = nullptr;
+  double v = strtod(s, &end);
+  if (*end != '\0' || !isfinite(v)) return false;
+  *us = llround(v * 1e6);
+  return true;
+}
+
+int convert(const char* in, const char* out) {
+  CaptureBuilder builder;
+  CsvImportStats stats;
+  std::string error;
+  if (!capture_import_csv(in, &builder, &stats, &error) || !builder.write(out, &error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  fprintf(stderr, "{\"convert\":{\"rows\":%llu,\"samples\":%zu,\"events\":%zu,\"comments\":%llu,\"skipped\":%llu}}\n",
+          static_cast<unsigned long long>(stats.rows), builder.samples(), builder.events(),
+          static_cast<unsigned long long>(stats.comments), static_cast<unsigned long long>(stats.skipped));
+  return 0;
+}
+
+int info(const char* path) {
+  CaptureFile cap;
+  std::string error;
+  if (!cap.open(path, &error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  const CaptureHeader& h = cap.header();
+  size_t gestures = 0;
+  for (size_t i = 0; i < cap.event_count(); ++i) gestures += cap.events()[i].kind == CaptureEventKind::Gesture;
+  double span_s = cap.sample_count() + cap.event_count() > 0 ? (h.t_end_us - h.t_begin_us) / 1e6 : 0.0;
+  printf("{\"capture\":{\"start\":\"%s\",\"span_s\":%.3f,\"samples\":%llu,\"events\":%zu,\"gestures\":%zu,"
+         "\"buckets\":%llu,\"bucket_us\":%u,\"bytes\":%llu}}\n",
+         h.start_unix_us ? capture_iso_time(h.start_unix_us).c_str() : "", span_s,
+         static_cast<unsigned long long>(h.sample_count), cap.event_count(), gestures,
+         static_cast<unsigned long long>(h.index_count), h.bucket_us,
+         static_cast<unsigned long long>(h.notes_offset + h.notes_size));
+  return 0;
+}
+
+int replay(int argc, char** argv) {
+  int64_t from = INT64_MIN, to = INT64_MAX;
+  bool csv = false, gestures_only = false;
+  double speed = 0.0;
+  static const option kOptions[] = {
+      {"from", required_argument, nullptr, 'f'}, {"to", required_argument, nullptr, 't'},
+      {"csv", no_argument, nullptr, 'c'},        {"gestures", no_argument, nullptr, 'g'},
+      {"speed", required_argument, nullptr, 's'}, {nullptr, 0, nullptr, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "", kOptions, nullptr)) != -1) {
+    switch (opt) {
+      case 'f':
+        if (!parse_seconds(optarg, &from)) {
+          fprintf(stderr, "bad --from: %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 't':
+        if (!parse_seconds(optarg, &to)) {
+          fprintf(stderr, "bad --to: %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'c': csv = true; break;
+      case 'g': gestures_only = true; break;
+      case 's': speed = atof(optarg); break;
+      default: usage(stderr); return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(stderr);
+    return 2;
+  }
+  CaptureFile cap;
+  std::string error;
+  if (!cap.open(argv[optind], &error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  const CaptureHeader& h = cap.header();
+  cap.prefetch(from, to);
+
+  if (csv) printf("timestamp_iso,elapsed_seconds,line\r\n");
+  timespec origin{};
+  clock_gettime(CLOCK_MONOTONIC, &origin);
+  int64_t first = INT64_MIN;
+  auto put = [&](int64_t t_us, const std::string& line) {
+    if (speed > 0.0) {
+      if (first == INT64_MIN) first = t_us;
+      double due_s = (t_us - first) / 1e6 / speed;
+      timespec due = origin;
+      due.tv_sec += static_cast<time_t>(due_s);
+      due.tv_nsec += static_cast<long>((due_s - floor(due_s)) * 1e9);
+      if (due.tv_nsec >= 1000000000L) {
+        due.tv_nsec -= 1000000000L;
+        ++due.tv_sec;
+      }
+      fflush(stdout);
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, nullptr);
+    }
+    if (csv) {
+      std::string stamp = h.start_unix_us ? capture_iso_time(h.start_unix_us + t_us) : "";
+      fputs(capture_csv_row(stamp, t_us, line).c_str(), stdout);
+    } else {
+      fwrite(line.data(), 1, line.size(), stdout);
+      fputc('\n', stdout);
+    }
+  };
+  cap.replay(
+      from, to,
+      [&](const CaptureSample& s) {
+        if (!gestures_only) put(s.t_us, capture_raw_line(s, h.value_decimals));
+      },
+      [&](const CaptureEvent& e) {
+        if (!gestures_only || e.kind == CaptureEventKind::Gesture) put(e.t_us, std::string(cap.text(e)));
+      });
+  fflush(stdout);
+  return 0;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    usage(stderr);
+    return 2;
+  }
+  if (strcmp(argv[1], "convert") == 0 && argc == 4) return convert(argv[2], argv[3]);
+  if (strcmp(argv[1], "info") == 0 && argc == 3) return info(argv[2]);
+  if (strcmp(argv[1], "replay") == 0) return replay(argc - 1, argv + 1);
+  if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0) {
+    usage(stdout);
+    return 0;
+  }
+  usage(stderr);
+  return 2;
+}
@@ -0,0 +1,42 @@
+#include "client_queue.h"
+
+bool ClientQueue::push(Payload p) {
+  if (frames_.size() >= max_frames_ || bytes_ + p->size() > max_bytes_) {
+    ++dropped_;
+    return false;
+  }
+  push_control(std::move(p));
+  return true;
+}
+
+void ClientQueue::push_control(Payload p) {
+  bytes_ += p->size();
+  frames_.push_back(std::move(p));
+  if (frames_.size() > high_water_) high_water_ = frames_.size();
+}
+
+size_t ClientQueue::gather(iovec* iov, size_t max) const {
+  size_t n = 0;
+  size_t skip = offset_;
+  for (auto it = frames_.begin(); it != frames_.end() && n < max; ++it, ++n) {
+    iov[n].iov_base = const_cast<char*>((*it)->data() + skip);
+    iov[n].iov_len = (*it)->size() - skip;
+    skip = 0;
+  }
+  return n;
+}
+
+void ClientQueue::consume(size_t n) {
+  bytes_ -= n;
+  while (n > 0) {
+    size_t left = frames_.front()->size() - offset_;
+    if (n < left) {
+      offset_ += n;
+      return;
+    }
+    n -= left;
+    frames_.pop_front();
+    offset_ = 0;
+    ++sent_;
+  }
+}
@@ -0,0 +1,89 @@
+#include "clock_sync.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+int64_t MicrosUnwrapper::unwrap(uint32_t us) {
+  if (!started_) {
+    started_ = true;
+    latest32_ = us;
+    latest_ = us;
+    return latest_;
+  }
+  // The signed 32-bit difference is the true distance as long as it is
+  // under half the wrap period, whichever side of a wrap either stamp is on.
+  int32_t delta = static_cast<int32_t>(us - latest32_);
+  int64_t out = latest_ + delta;
+  if (delta > 0) {
+    latest32_ = us;
+    latest_ = out;
+  }
+  return out;
+}
+
+void ClockModel::reset() {
+  count_ = 0;
+  head_ = 0;
+  rate_ = 1.0;
+  residual_us_ = 0.0;
+  bound_us_ = 0.0;
+}
+
+void ClockModel::add(int64_t device_us, int64_t host_send_us, int64_t host_recv_us) {
+  Exchange& e = ring_[head_];
+  e.device_us = device_us;
+  e.host_mid_us = 0.5 * static_cast<double>(host_send_us + host_recv_us);
+  e.rtt_us = static_cast<double>(host_recv_us - host_send_us);
+  head_ = (head_ + 1) % kWindow;
+  if (count_ < kWindow) ++count_;
+  fit();
+}
+
+void ClockModel::fit() {
+  // Only the exchanges nearly as quick as the quickest: a slow one was slow
+  // on one leg more than the other, and is off by up to half its round trip.
+  Exchange* used[kWindow] = {};
+  for (size_t i = 0; i < count_; ++i) used[i] = &ring_[i];
+  std::sort(used, used + count_, [](const Exchange* a, const Exchange* b) { return a->rtt_us < b->rtt_us; });
+  double fastest = used[0]->rtt_us;
+  double limit = 2.0 * fastest + kRttSlackUs;
+  size_t n = 1;
+  while (n < count_ && used[n]->rtt_us <= limit) ++n;
+  bound_us_ = 0.5 * fastest;
+
+  // Centre on the first used exchange so the sums stay small numbers.
+  int64_t x0 = used[0]->device_us;
+  double mean_x = 0.0, mean_y = 0.0;
+  int64_t lo = x0, hi = x0;
+  for (size_t i = 0; i < n; ++i) {
+    mean_x += static_cast<double>(used[i]->device_us - x0);
+    mean_y += used[i]->host_mid_us;
+    lo = std::min(lo, used[i]->device_us);
+    hi = std::max(hi, used[i]->device_us);
+  }
+  mean_x /= static_cast<double>(n);
+  mean_y /= static_cast<double>(n);
+
+  if (n >= 2 && hi - lo >= kMinDriftSpanUs) {
+    double sxx = 0.0, sxy = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+      double dx = static_cast<double>(used[i]->device_us - x0) - mean_x;
+      sxx += dx * dx;
+      sxy += dx * (used[i]->host_mid_us - mean_y);
+    }
+    double rate = sxy / sxx;
+    if (fabs(rate - 1.0) * 1e6 <= kMaxDriftPpm) rate_ = rate;
+  }
+  // Too little spread for a rate yet: keep the last one (1.0 to begin with)
+  // and fit the offset alone.
+  ref_device_ = x0 + static_cast<int64_t>(llround(mean_x));
+  ref_host_ = mean_y - rate_ * (mean_x - static_cast<double>(ref_device_ - x0));
+
+  double sq = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    double miss = used[i]->host_mid_us - to_host(used[i]->device_us);
+    sq += miss * miss;
+  }
+  residual_us_ = sqrt(sq / static_cast<double>(n));
+}
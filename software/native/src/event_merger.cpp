@@ -0,0 +1,64 @@
+#include "event_merger.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+EventMerger::EventMerger(size_t boards, int64_t max_latency_us, int64_t reorder_us, size_t max_pending)
+    : boards_(boards), max_latency_us_(max_latency_us), reorder_us_(reorder_us), max_pending_(max_pending) {}
+
+void EventMerger::push(size_t board, int64_t host_us, int64_t device_us, int64_t arrived_us, std::string line) {
+  Slot s;
+  s.event.host_us = host_us;
+  s.event.device_us = device_us;
+  s.event.board = board;
+  s.event.line = std::move(line);
+  s.arrived_us = arrived_us;
+  s.seq = seq_++;
+  heap_.push_back(std::move(s));
+  std::push_heap(heap_.begin(), heap_.end(), Later());
+  heard(board, host_us);
+  ++stats_.pushed;
+  stats_.pending = heap_.size();
+  if (heap_.size() > stats_.high_water) stats_.high_water = heap_.size();
+}
+
+void EventMerger::heard(size_t board, int64_t host_us) {
+  Board& b = boards_[board];
+  if (!b.heard || host_us > b.latest_us) b.latest_us = host_us;
+  b.heard = true;
+}
+
+void EventMerger::set_active(size_t board, bool active) {
+  boards_[board].active = active;
+  if (!active) boards_[board].heard = false;  // a replugged board starts over
+}
+
+int64_t EventMerger::watermark() const {
+  int64_t mark = std::numeric_limits<int64_t>::max();
+  bool any = false;
+  for (const Board& b : boards_) {
+    if (!b.active) continue;
+    if (!b.heard) return std::numeric_limits<int64_t>::min();  // an active board we know nothing about yet
+    mark = std::min(mark, b.latest_us - reorder_us_);
+    any = true;
+  }
+  return any ? mark : std::numeric_limits<int64_t>::min();
+}
+
+MergedEvent EventMerger::take(int64_t now_us) {
+  std::pop_heap(heap_.begin(), heap_.end(), Later());
+  Slot s = std::move(heap_.back());
+  heap_.pop_back();
+  if (released_any_ && s.event.host_us < last_released_us_) {
+    s.event.late = true;
+    ++stats_.late;
+  } else {
+    last_released_us_ = s.event.host_us;
+  }
+  released_any_ = true;
+  ++stats_.released;
+  int64_t waited = now_us - s.arrived_us;
+  if (waited > stats_.worst_wait_us) stats_.worst_wait_us = waited;
+  return std::move(s.event);
+}
@@ -0,0 +1,190 @@
+#include "frame.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+/**
+ * Just enough JSON to walk one object's top-level keys. Nested values are
+ * skipped by matching brackets (strings respected), not built, because the
+ * bridge forwards the original line and only needs a handful of fields.
+ */
+class Cursor {
+ public:
+  Cursor(const char* p, size_t n) : p_(p), end_(p + n) {}
+
+  void space() {
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\r' || *p_ == '\n')) ++p_;
+  }
+  bool at_end() const { return p_ == end_; }
+  bool eat(char c) {
+    space();
+    if (p_ < end_ && *p_ == c) {
+      ++p_;
+      return true;
+    }
+    return false;
+  }
+  char peek() {
+    space();
+    return p_ < end_ ? *p_ : '\0';
+  }
+
+  // A string, with the simple escapes decoded; \uXXXX is kept as written
+  // (no key or gesture name the firmware sends needs it).
+  bool string(std::string* out) {
+    if (!eat('"')) return false;
+    out->clear();
+    while (p_ < end_) {
+      char c = *p_++;
+      if (c == '"') return true;
+      if (c != '\\') {
+        out->push_back(c);
+        continue;
+      }
+      if (p_ == end_) return false;
+      char e = *p_++;
+      switch (e) {
+        case 'n': out->push_back('\n'); break;
+        case 't': out->push_back('\t'); break;
+        case 'r': out->push_back('\r'); break;
+        case 'b': out->push_back('\b'); break;
+        case 'f': out->push_back('\f'); break;
+        case 'u': out->append("\\u"); break;
+        default: out->push_back(e); break;  // \" \\ \/
+      }
+    }
+    return false;
+  }
+
+  bool number(double* out) {
+    space();
+    char buf[32];
+    size_t n = 0;
+    while (p_ + n < end_ && n < sizeof(buf) - 1 && strchr("+-0123456789.eE", p_[n])) {
+      buf[n] = p_[n];
+      ++n;
+    }
+    if (n == 0) return false;
+    buf[n] = '\0';
+    char* stop = nullptr;
+    *out = strtod(buf, &stop);
+    if (stop != buf + n) return false;
+    p_ += n;
+    return true;
+  }
+
+  // An array's leading numbers (up to `max`), then the rest of it skipped.
+  // Returns how many numbers were read, or -1 when it is not an array.
+  int leading_numbers(double* out, int max) {
+    if (!eat('[')) return -1;
+    if (eat(']')) return 0;
+    int got = 0;
+    bool collecting = true;  // until the first element that is not a number
+    do {
+      char d = peek();
+      if (collecting && got < max && (d == '-' || (d >= '0' && d <= '9'))) {
+        if (!number(&out[got++])) return -1;
+      } else {
+        collecting = false;
+        if (!skip()) return -1;
+      }
+    } while (eat(','));
+    return eat(']') ? got : -1;
+  }
+
+  // Any value, discarded.
+  bool skip() {
+    char c = peek();
+    if (c == '"') {
+      std::string ignored;
+      return string(&ignored);
+    }
+    if (c == '{' || c == '[') {
+      int depth = 0;
+      while (p_ < end_) {
+        char d = *p_;
+        if (d == '"') {
+          std::string ignored;
+          if (!string(&ignored)) return false;
+          continue;
+        }
+        ++p_;
+        if (d == '{' || d == '[') ++depth;
+        if (d == '}' || d == ']') {
+          if (--depth == 0) return true;
+        }
+      }
+      return false;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+      double ignored;
+      return number(&ignored);
+    }
+    for (const char* word : {"true", "false", "null"}) {
+      size_t n = strlen(word);
+      if (static_cast<size_t>(end_ - p_) >= n && memcmp(p_, word, n) == 0) {
+        p_ += n;
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  const char* p_;
+  const char* end_;
+};
+}  // namespace
+
+bool parse_frame(const char* line, size_t len, Frame* out) {
+  *out = Frame();
+  Cursor c(line, len);
+  if (!c.eat('{')) return false;
+  bool has_gesture = false, shadow = false, pong = false;
+  std::string key;
+  if (!c.eat('}')) {
+    do {
+      if (!c.string(&key) || !c.eat(':')) return false;
+      double num = 0.0;
+      if (key == "gesture" && c.peek() == '"') {
+        if (!c.string(&out->gesture)) return false;
+        has_gesture = true;
+      } else if (key == "value" && c.number(&num)) {
+        out->value = static_cast<float>(num);
+      } else if (key == "note" && c.number(&num)) {
+        out->note = static_cast<int>(num);
+      } else if (key == "conf" && c.number(&num)) {
+        out->conf = static_cast<float>(num);
+      } else if (key == "us" && c.number(&num)) {
+        out->has_us = true;
+        out->us = static_cast<uint32_t>(num);
+      } else if ((key == "raw" || key == "env" || key == "pong") && c.peek() == '[') {
+        double nums[2];
+        int got = c.leading_numbers(nums, 2);
+        if (got < 0) return false;
+        if (key == "pong" && got == 2) {
+          pong = true;
+          out->pong_seq = static_cast<uint32_t>(nums[0]);
+          out->has_us = true;
+          out->us = static_cast<uint32_t>(nums[1]);
+        } else if (key != "pong" && got >= 1) {
+          out->has_us = true;
+          out->us = static_cast<uint32_t>(nums[0]);
+        }
+      } else {
+        if (key == "ab") shadow = true;
+        if (!c.skip()) return false;
+      }
+    } while (c.eat(','));
+    if (!c.eat('}')) return false;
+  }
+  c.space();
+  if (!c.at_end()) return false;
+  if (pong) {
+    out->kind = FrameKind::Pong;
+  } else {
+    out->kind = (has_gesture && !shadow) ? FrameKind::Gesture : FrameKind::Telemetry;
+  }
+  return true;
+}
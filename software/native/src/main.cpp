@@ -0,0 +1,154 @@
+// stringfield-bridge: one serial reader, many listeners.
+//
+// The Processing bridge and the p5.js sketch each open the board's serial port
+// themselves, so only one of them can listen at a time. This daemon opens it
+// once and fans every line out to as many WebSocket clients (browsers) and
+// OSC targets (Pd, SuperCollider, Max, a DAW) as the room brings. Status goes
+// to stderr as JSON lines, in the same voice as the firmware's telemetry.
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <string>
+
+#include "bridge.h"
+#include "serial_port.h"
+
+namespace {
+volatile sig_atomic_t g_stop = 0;
+
+void on_signal(int) { g_stop = 1; }
+
+void usage(FILE* out) {
+  fprintf(out,
+          "usage: stringfield-bridge [options] SERIAL_DEVICE\n"
+          "  --baud N          serial baud rate (default 115200)\n"
+          "  --bind ADDR       listen address for WebSocket + OSC (default 0.0.0.0)\n"
+          "  --ws-port N       WebSocket port (default 8765)\n"
+          "  --osc HOST:PORT   always send gestures here (repeatable; PORT alone = localhost)\n"
+          "  --osc-port N      port OSC clients send /stringfield/subscribe to (default 9001)\n"
+          "  --queue N         frames queued per client before it starts dropping (default 256)\n"
+          "  --stats SECONDS   print a stats line to stderr every SECONDS (default 0 = off)\n");
+}
+
+bool parse_port(const char* s, uint16_t* out) {
+  char* end = nullptr;
+  long v = strtol(s, &end, 10);
+  if (*end != '\0' || v < 0 || v > 65535) return false;
+  *out = static_cast<uint16_t>(v);
+  return true;
+}
+
+void print_stats(const Bridge& bridge) {
+  const BridgeStats& s = bridge.stats();
+  fprintf(stderr,
+          "{\"bridge\":{\"serial\":%s,\"lines\":%llu,\"bad\":%llu,\"long\":%llu,\"gestures\":%llu,"
+          "\"ws\":%zu,\"osc\":%zu,\"dropped\":%llu,\"clients\":[",
+          s.serial_open ? "true" : "false", static_cast<unsigned long long>(s.lines),
+          static_cast<unsigned long long>(s.bad_lines), static_cast<unsigned long long>(s.long_lines),
+          static_cast<unsigned long long>(s.gestures), s.ws_clients, s.osc_clients,
+          static_cast<unsigned long long>(s.dropped));
+  bool first = true;
+  for (const ClientInfo& c : bridge.clients()) {
+    fprintf(stderr, "%s{\"%s\":\"%s\",\"queued\":%zu,\"hw\":%zu,\"sent\":%llu,\"dropped\":%llu}", first ? "" : ",",
+            c.websocket ? "ws" : "osc", c.peer.c_str(), c.queued, c.high_water,
+            static_cast<unsigned long long>(c.sent), static_cast<unsigned long long>(c.dropped));
+    first = false;
+  }
+  fprintf(stderr, "]}}\n");
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  BridgeConfig config;
+  int stats_every_s = 0;
+  static const option kOptions[] = {
+      {"baud", required_argument, nullptr, 'b'},     {"bind", required_argument, nullptr, 'a'},
+      {"ws-port", required_argument, nullptr, 'w'},  {"osc", required_argument, nullptr, 'o'},
+      {"osc-port", required_argument, nullptr, 'p'}, {"queue", required_argument, nullptr, 'q'},
+      {"stats", required_argument, nullptr, 's'},    {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "h", kOptions, nullptr)) != -1) {
+    OscTarget target;
+    switch (opt) {
+      case 'b':
+        config.baud = atoi(optarg);
+        if (!serial_baud_supported(config.baud)) {
+          fprintf(stderr, "unsupported baud rate: %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'a': config.bind_host = optarg; break;
+      case 'w':
+        if (!parse_port(optarg, &config.ws_port)) {
+          fprintf(stderr, "bad --ws-port: %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'o':
+        if (!parse_osc_target(optarg, &target)) {
+          fprintf(stderr, "bad --osc target (want HOST:PORT): %s\n", optarg);
+          return 2;
+        }
+        config.osc_targets.push_back(target);
+        break;
+      case 'p':
+        if (!parse_port(optarg, &config.osc_port)) {
+          fprintf(stderr, "bad --osc-port: %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'q': config.queue_frames = static_cast<size_t>(atoi(optarg) > 0 ? atoi(optarg) : 1); break;
+      case 's': stats_every_s = atoi(optarg); break;
+      case 'h': usage(stdout); return 0;
+      default: usage(stderr); return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(stderr);
+    return 2;
+  }
+  config.serial_path = argv[optind];
+
+  struct sigaction sa {};
+  sa.sa_handler = on_signal;  // no SA_RESTART: epoll_wait returns and the loop sees the flag
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+
+  Bridge bridge(config);
+  std::string error;
+  if (!bridge.open(&error)) {
+    fprintf(stderr, "{\"bridge\":{\"error\":\"%s\"}}\n", error.c_str());
+    return 1;
+  }
+  fprintf(stderr, "{\"bridge\":{\"serial\":\"%s\",\"ws_port\":%u,\"osc_port\":%u,\"osc_targets\":%zu}}\n",
+          config.serial_path.c_str(), bridge.ws_port(), bridge.osc_port(), config.osc_targets.size());
+
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point next_stats = Clock::now() + std::chrono::seconds(stats_every_s);
+  bool was_open = !bridge.stats().serial_open;  // force the first report
+  while (!g_stop) {
+    bridge.run_once(250);
+    bool open = bridge.stats().serial_open;
+    if (open != was_open) {
+      if (open) {
+        fprintf(stderr, "{\"bridge\":{\"board\":\"connected\"}}\n");
+      } else {
+        fprintf(stderr, "{\"bridge\":{\"board\":\"waiting\",\"why\":\"%s\"}}\n", bridge.serial_error().c_str());
+      }
+      was_open = open;
+    }
+    if (stats_every_s > 0 && Clock::now() >= next_stats) {
+      print_stats(bridge);
+      next_stats += std::chrono::seconds(stats_every_s);
+    }
+  }
+  print_stats(bridge);
+  return 0;
+}
@@ -0,0 +1,56 @@
+#include "osc.h"
+
+#include <string.h>
+
+namespace {
+void put_padded(std::string* out, const std::string& s) {
+  out->append(s);
+  size_t pad = 4 - (s.size() % 4);  // at least one NUL terminates the string
+  out->append(pad, '\0');
+}
+
+void put_u32(std::string* out, uint32_t v) {
+  out->push_back(static_cast<char>(v >> 24));
+  out->push_back(static_cast<char>(v >> 16));
+  out->push_back(static_cast<char>(v >> 8));
+  out->push_back(static_cast<char>(v));
+}
+}  // namespace
+
+OscMessage::OscMessage(const char* address) : address_(address) {}
+
+OscMessage& OscMessage::add(const char* s) {
+  tags_.push_back('s');
+  put_padded(&args_, s);
+  return *this;
+}
+
+OscMessage& OscMessage::add(int32_t i) {
+  tags_.push_back('i');
+  put_u32(&args_, static_cast<uint32_t>(i));
+  return *this;
+}
+
+OscMessage& OscMessage::add(float f) {
+  tags_.push_back('f');
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  put_u32(&args_, bits);
+  return *this;
+}
+
+std::string OscMessage::bytes() const {
+  std::string out;
+  put_padded(&out, address_);
+  put_padded(&out, tags_);
+  out.append(args_);
+  return out;
+}
+
+bool osc_address(const uint8_t* data, size_t len, std::string* address) {
+  if (len < 4 || len % 4 != 0 || data[0] != '/') return false;
+  const void* nul = memchr(data, '\0', len);
+  if (!nul) return false;
+  address->assign(reinterpret_cast<const char*>(data), static_cast<const uint8_t*>(nul) - data);
+  return true;
+}
@@ -0,0 +1,56 @@
+#include "serial_port.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+speed_t speed_for(int baud) {
+  switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return B0;
+  }
+}
+}  // namespace
+
+bool serial_baud_supported(int baud) { return speed_for(baud) != B0; }
+
+int open_serial(const std::string& path, int baud, std::string* error) {
+  speed_t speed = speed_for(baud);
+  if (speed == B0) {
+    *error = "unsupported baud rate " + std::to_string(baud);
+    return -1;
+  }
+  int fd = open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    *error = path + ": " + strerror(errno);
+    return -1;
+  }
+  if (isatty(fd)) {
+    termios tio;
+    if (tcgetattr(fd, &tio) != 0) {
+      *error = path + ": tcgetattr: " + strerror(errno);
+      close(fd);
+      return -1;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+      *error = path + ": tcsetattr: " + strerror(errno);
+      close(fd);
+      return -1;
+    }
+  }
+  return fd;
+}
@@ -0,0 +1,176 @@
+#include "websocket.h"
+
+#include <ctype.h>
+#include <string.h>
+
+namespace {
+// ---- SHA-1 (FIPS 180-1), only ever fed a 60-byte handshake key ---------------
+uint32_t rol(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+void sha1(const std::string& msg, uint8_t digest[20]) {
+  uint32_t h[5] = {0x67452301u, 0xEFCDAB89u, 0x98BADCFEu, 0x10325476u, 0xC3D2E1F0u};
+  std::string m = msg;
+  uint64_t bits = static_cast<uint64_t>(msg.size()) * 8;
+  m.push_back(static_cast<char>(0x80));
+  while (m.size() % 64 != 56) m.push_back('\0');
+  for (int i = 7; i >= 0; --i) m.push_back(static_cast<char>(bits >> (i * 8)));
+
+  for (size_t block = 0; block < m.size(); block += 64) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; ++i) {
+      const uint8_t* p = reinterpret_cast<const uint8_t*>(m.data() + block + i * 4);
+      w[i] = (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    }
+    for (int i = 16; i < 80; ++i) w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; ++i) {
+      uint32_t f, k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999u;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1u;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDCu;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6u;
+      }
+      uint32_t t = rol(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = rol(b, 30);
+      b = a;
+      a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+  for (int i = 0; i < 5; ++i) {
+    digest[i * 4] = static_cast<uint8_t>(h[i] >> 24);
+    digest[i * 4 + 1] = static_cast<uint8_t>(h[i] >> 16);
+    digest[i * 4 + 2] = static_cast<uint8_t>(h[i] >> 8);
+    digest[i * 4 + 3] = static_cast<uint8_t>(h[i]);
+  }
+}
+
+std::string base64(const uint8_t* data, size_t len) {
+  static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  for (size_t i = 0; i < len; i += 3) {
+    uint32_t v = static_cast<uint32_t>(data[i]) << 16;
+    if (i + 1 < len) v |= static_cast<uint32_t>(data[i + 1]) << 8;
+    if (i + 2 < len) v |= data[i + 2];
+    out.push_back(kAlphabet[(v >> 18) & 63]);
+    out.push_back(kAlphabet[(v >> 12) & 63]);
+    out.push_back(i + 1 < len ? kAlphabet[(v >> 6) & 63] : '=');
+    out.push_back(i + 2 < len ? kAlphabet[v & 63] : '=');
+  }
+  return out;
+}
+
+std::string lower(std::string s) {
+  for (char& c : s) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+  return s;
+}
+
+std::string trim(const std::string& s) {
+  size_t a = s.find_first_not_of(" \t");
+  if (a == std::string::npos) return std::string();
+  size_t b = s.find_last_not_of(" \t");
+  return s.substr(a, b - a + 1);
+}
+}  // namespace
+
+WsHandshake ws_read_handshake(const std::string& request, std::string* key, size_t* consumed) {
+  size_t end = request.find("\r\n\r\n");
+  if (end == std::string::npos) {
+    return request.size() > kWsMaxHandshake ? WsHandshake::Bad : WsHandshake::Incomplete;
+  }
+  if (end + 4 > kWsMaxHandshake || request.compare(0, 4, "GET ") != 0) return WsHandshake::Bad;
+
+  bool upgrade = false, connection = false;
+  key->clear();
+  size_t line = request.find("\r\n") + 2;  // past the request line
+  while (line < end + 2) {
+    size_t eol = request.find("\r\n", line);
+    std::string header = request.substr(line, eol - line);
+    line = eol + 2;
+    size_t colon = header.find(':');
+    if (colon == std::string::npos) continue;
+    std::string name = lower(trim(header.substr(0, colon)));
+    std::string value = trim(header.substr(colon + 1));
+    // Connection may list several tokens ("keep-alive, Upgrade").
+    if (name == "upgrade") upgrade = lower(value) == "websocket";
+    if (name == "connection") connection = lower(value).find("upgrade") != std::string::npos;
+    if (name == "sec-websocket-key") *key = value;
+  }
+  if (!upgrade || !connection || key->empty()) return WsHandshake::Bad;
+  *consumed = end + 4;
+  return WsHandshake::Ok;
+}
+
+std::string ws_accept_key(const std::string& key) {
+  uint8_t digest[20];
+  sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", digest);
+  return base64(digest, sizeof(digest));
+}
+
+std::string ws_handshake_response(const std::string& key) {
+  return "HTTP/1.1 101 Switching Protocols\r\n"
+         "Upgrade: websocket\r\n"
+         "Connection: Upgrade\r\n"
+         "Sec-WebSocket-Accept: " +
+         ws_accept_key(key) + "\r\n\r\n";
+}
+
+std::string ws_frame(WsOpcode op, const char* payload, size_t len) {
+  std::string out;
+  out.reserve(len + 10);
+  out.push_back(static_cast<char>(0x80 | static_cast<uint8_t>(op)));
+  if (len < 126) {
+    out.push_back(static_cast<char>(len));
+  } else if (len <= 0xFFFF) {
+    out.push_back(126);
+    out.push_back(static_cast<char>(len >> 8));
+    out.push_back(static_cast<char>(len));
+  } else {
+    out.push_back(127);
+    for (int i = 7; i >= 0; --i) out.push_back(static_cast<char>(static_cast<uint64_t>(len) >> (i * 8)));
+  }
+  out.append(payload, len);
+  return out;
+}
+
+WsRead ws_read_frame(const uint8_t* data, size_t len, WsFrame* out, size_t* consumed) {
+  if (len < 2) return WsRead::Incomplete;
+  bool masked = data[1] & 0x80;
+  if (!masked) return WsRead::Error;  // RFC 6455 §5.1: clients always mask
+  uint64_t n = data[1] & 0x7F;
+  size_t at = 2;
+  if (n == 126) {
+    if (len < 4) return WsRead::Incomplete;
+    n = (static_cast<uint64_t>(data[2]) << 8) | data[3];
+    at = 4;
+  } else if (n == 127) {
+    if (len < 10) return WsRead::Incomplete;
+    n = 0;
+    for (int i = 0; i < 8; ++i) n = (n << 8) | data[2 + i];
+    at = 10;
+  }
+  if (n > kWsMaxClientPayload) return WsRead::Error;
+  if (len < at + 4 + n) return WsRead::Incomplete;
+  const uint8_t* mask = data + at;
+  at += 4;
+  out->fin = data[0] & 0x80;
+  out->opcode = static_cast<WsOpcode>(data[0] & 0x0F);
+  out->payload.resize(n);
+  for (size_t i = 0; i < n; ++i) out->payload[i] = static_cast<char>(data[at + i] ^ mask[i % 4]);
+  *consumed = at + n;
+  return WsRead::Frame;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// A dozen lines of test harness, so the bridge builds and tests with nothing
+// but a compiler and CMake. Same shape as the firmware's Unity tests: one
+// void function per case, RUN_TEST in main, non-zero exit on any failure.
+
+#include <stdio.h>
+
+static int g_checks_failed = 0;
+static int g_tests_run = 0;
+static const char* g_current_test = "";
+
+#define CHECK(cond)                                                                   \
+  do {                                                                                \
+    if (!(cond)) {                                                                    \
+      fprintf(stderr, "FAIL %s:%d %s: %s\n", __FILE__, __LINE__, g_current_test, #cond); \
+      ++g_checks_failed;                                                              \
+      return;                                                                         \
+    }                                                                                 \
+  } while (0)
+
+#define RUN_TEST(fn)       \
+  do {                     \
+    g_current_test = #fn;  \
+    ++g_tests_run;         \
+    fn();                  \
+  } while (0)
+
+inline int checks_done() {
+  printf("%d tests, %d failures\n", g_tests_run, g_checks_failed);
+  return g_checks_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+// End to end: ptys stand in for several boards, each with its own crystal
+// error and its micros() about to wrap. The aggregator's own host clock
+// (now_us) is the ground truth the simulated boards tick against, so the test
+// can say exactly how far off each merged timestamp is.
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "aggregator.h"
+#include "check.h"
+
+namespace {
+// One board: a pty master behind a symlink (so it can be unplugged and
+// replugged), a drifting clock, and a firmware stand-in that answers pings.
+class SimBoard {
+ public:
+  SimBoard(const std::string& link, double ppm, uint32_t start) : link_(link), ppm_(ppm), start_(start) { plug(); }
+  ~SimBoard() {
+    unplug();
+    unlink(link_.c_str());
+    rmdir(link_.substr(0, link_.rfind('/')).c_str());
+  }
+
+  void plug() {
+    master_ = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    grantpt(master_);
+    unlockpt(master_);
+    std::string tmp = link_ + ".new";
+    unlink(tmp.c_str());
+    if (symlink(ptsname(master_), tmp.c_str()) != 0 || rename(tmp.c_str(), link_.c_str()) != 0) perror("symlink");
+  }
+  void unplug() {
+    if (master_ >= 0) close(master_);
+    master_ = -1;
+  }
+
+  uint32_t micros(int64_t host_us) const {
+    return static_cast<uint32_t>(static_cast<int64_t>(start_) + llround(host_us * (1.0 + ppm_ * 1e-6)));
+  }
+
+  // Answer whatever pings have arrived, stamped at host time `now`.
+  void serve(int64_t now) {
+    char buf[512];
+    ssize_t n;
+    while ((n = read(master_, buf, sizeof(buf))) > 0) in_.append(buf, static_cast<size_t>(n));
+    size_t nl;
+    while ((nl = in_.find('\n')) != std::string::npos) {
+      unsigned seq = 0;
+      if (sscanf(in_.c_str(), "{\"ping\":%u}", &seq) == 1) {
+        char pong[64];
+        snprintf(pong, sizeof(pong), "{\"pong\":[%u,%u]}\n", seq, micros(now));
+        say(pong);
+      }
+      in_.erase(0, nl + 1);
+    }
+  }
+
+  bool plugged() const { return master_ >= 0; }
+  void say(const std::string& line) {
+    if (master_ >= 0 && write(master_, line.data(), line.size()) < 0) perror("write");
+  }
+
+ private:
+  std::string link_;
+  double ppm_;
+  uint32_t start_;
+  int master_ = -1;
+  std::string in_;
+};
+
+std::string temp_link() {
+  char dir[] = "/tmp/sfaggregate-XXXXXX";
+  if (!mkdtemp(dir)) perror("mkdtemp");
+  return std::string(dir) + "/board";
+}
+
+struct Out {
+  int64_t t;
+  size_t b;
+  bool late;
+  int id;
+};
+
+// The aggregator's lines, read back: {"t":..,"b":..,"dev":..,["late":true,]"ev":{... "value":id ...}}
+bool read_out(const std::string& line, Out* o) {
+  long long t = 0, dev = 0;
+  if (sscanf(line.c_str(), "{\"t\":%lld,\"b\":%zu,\"dev\":%lld,", &t, &o->b, &dev) != 3) return false;
+  o->t = t;
+  o->late = line.find("\"late\":true") != std::string::npos;
+  size_t v = line.find("\"value\":");
+  o->id = v == std::string::npos ? -1 : atoi(line.c_str() + v + 8);
+  return line.find("\"ev\":{") != std::string::npos;
+}
+
+struct Rig {
+  std::vector<std::unique_ptr<SimBoard>> boards;
+  std::vector<std::string> out;
+  std::vector<int64_t> out_at;  // host µs each line was written
+  std::unique_ptr<Aggregator> agg;
+  std::map<int, int64_t> truth;  // event id → host µs it happened at
+  int next_id = 0;
+
+  Rig(const std::vector<double>& ppm, AggregatorConfig cfg) {
+    for (size_t i = 0; i < ppm.size(); ++i) {
+      std::string link = temp_link();
+      // Every clock starts within two seconds of wrapping, on a different phase.
+      boards.emplace_back(new SimBoard(link, ppm[i], 0xFFFFFFFFu - 2000000u + static_cast<uint32_t>(i) * 333333u));
+      cfg.boards.push_back(link);
+    }
+    agg.reset(new Aggregator(cfg, [this](const std::string& line) {
+      out.push_back(line);
+      out_at.push_back(agg->now_us());
+    }));
+  }
+
+  // Longest any gesture played after `since` took to come out the other end.
+  int64_t worst_delay(int64_t since) const {
+    int64_t worst = 0;
+    for (size_t i = 0; i < out.size(); ++i) {
+      Out o;
+      if (!read_out(out[i], &o) || o.id < 0) continue;
+      int64_t played = truth.at(o.id);
+      if (played >= since) worst = std::max(worst, out_at[i] - played);
+    }
+    return worst;
+  }
+
+  // Run for `ms`; every board plays a gesture every `every_ms` (0: none).
+  void play(int ms, int every_ms) {
+    int64_t until = agg->now_us() + ms * 1000ll;
+    std::vector<int64_t> next(boards.size(), agg->now_us());
+    while (agg->now_us() < until) {
+      // Real firmware answers a ping within microseconds. Blocking in
+      // run_once here would hold every pong back a whole millisecond and
+      // make each exchange lopsided, so poll instead.
+      agg->run_once(0);
+      usleep(100);
+      int64_t now = agg->now_us();
+      for (size_t i = 0; i < boards.size(); ++i) {
+        boards[i]->serve(now);
+        if (every_ms == 0 || !boards[i]->plugged() || now < next[i]) continue;
+        next[i] = now + every_ms * 1000ll;
+        int id = next_id++;
+        truth[id] = now;
+        char line[96];
+        snprintf(line, sizeof(line), "{\"gesture\":\"pluck\",\"value\":%d,\"us\":%u}\n", id, boards[i]->micros(now));
+        boards[i]->say(line);
+      }
+    }
+  }
+};
+
+AggregatorConfig test_config() {
+  AggregatorConfig c;
+  c.ping_ms = 25;
+  c.max_latency_ms = 30;
+  c.reopen_ms = 50;
+  return c;
+}
+}  // namespace
+
+void test_boards_merge_onto_one_clock() {
+  Rig rig({+300.0, -150.0, 0.0}, test_config());
+  std::string error;
+  CHECK(rig.agg->open(&error));
+  rig.play(3000, 7);
+  rig.play(50, 0);  // let the last lines through the ptys
+  rig.agg->drain();
+
+  // Every board crossed its wrap, synced, and learned its crystal.
+  std::vector<BoardStats> stats = rig.agg->boards();
+  CHECK(stats.size() == 3);
+  const double ppm[] = {300.0, -150.0, 0.0};
+  for (size_t i = 0; i < stats.size(); ++i) {
+    CHECK(stats[i].synced);
+    CHECK(stats[i].device_us > 0xFFFFFFFFll);
+    CHECK(stats[i].pongs > ClockModel::kWindow / 2);
+    CHECK(fabs(stats[i].drift_ppm - ppm[i]) < 60.0);  // 3 s over ptys; test_clock_sync pins it down
+  }
+
+  // One stream, in order, nothing lost, no pongs in it, and each stamp close
+  // to when the gesture really happened.
+  std::map<int, int64_t> seen;
+  int64_t last = INT64_MIN;
+  size_t late = 0;
+  double worst = 0.0;
+  for (const std::string& line : rig.out) {
+    Out o;
+    CHECK(read_out(line, &o));
+    CHECK(line.find("pong") == std::string::npos);
+    if (o.late) {
+      ++late;
+    } else {
+      CHECK(o.t >= last);
+      last = o.t;
+    }
+    if (o.id < 0) continue;
+    CHECK(rig.truth.count(o.id) == 1);
+    seen[o.id] = o.t;
+    // The first few lines are placed before the drift is known; judge the
+    // steady state.
+    if (rig.truth[o.id] > 1000000) worst = std::max(worst, fabs(static_cast<double>(o.t - rig.truth[o.id])));
+  }
+  CHECK(seen.size() == rig.truth.size());
+  CHECK(late == 0);
+  CHECK(worst < 300.0);
+  // Nothing was held much past the bound.
+  CHECK(rig.worst_delay(1000000) < (30 + 15) * 1000);
+}
+
+void test_an_unplugged_board_neither_stalls_nor_poisons_the_rest() {
+  Rig rig({+100.0, -100.0}, test_config());
+  std::string error;
+  CHECK(rig.agg->open(&error));
+  rig.play(500, 5);
+  rig.boards[1]->unplug();
+  int64_t unplugged = rig.agg->now_us();
+  size_t before = rig.out.size();
+  rig.play(300, 5);
+  CHECK(!rig.agg->boards()[1].open);
+  CHECK(rig.out.size() > before + 40);  // board 0 kept flowing...
+  CHECK(rig.worst_delay(unplugged) < (30 + 15) * 1000);  // ...without waiting on board 1
+
+  // Back again, possibly rebooted: it resyncs from scratch and rejoins.
+  rig.boards[1]->plug();
+  for (int i = 0; i < 100 && !rig.agg->boards()[1].open; ++i) rig.play(10, 0);
+  rig.play(600, 5);
+  std::vector<BoardStats> stats = rig.agg->boards();
+  CHECK(stats[1].open && stats[1].synced);
+  CHECK(stats[1].opens == 2);
+  size_t from_b1 = 0;
+  for (size_t i = before; i < rig.out.size(); ++i) {
+    Out o;
+    CHECK(read_out(rig.out[i], &o));
+    if (o.b == 1) ++from_b1;
+  }
+  CHECK(from_b1 > 40);
+  CHECK(rig.agg->merge_stats().late == 0);
+}
+
+int main() {
+  RUN_TEST(test_boards_merge_onto_one_clock);
+  RUN_TEST(test_an_unplugged_board_neither_stalls_nor_poisons_the_rest);
+  return checks_done();
+}
@@ -0,0 +1,462 @@
+// End to end: a pty stands in for the board, loopback sockets stand in for
+// the classroom. Everything runs on one thread: the test writes a few lines,
+// turns the bridge's crank (run_once), and reads whatever each client got.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bridge.h"
+#include "check.h"
+#include "osc.h"
+#include "websocket.h"
+
+namespace {
+// The board: a pty master, reached by the bridge through a symlink so the
+// "unplug and replug" test can swap the device underneath it.
+class Board {
+ public:
+  explicit Board(const std::string& link) : link_(link) { plug(); }
+  ~Board() {
+    unplug();
+    unlink(link_.c_str());
+    rmdir(link_.substr(0, link_.rfind('/')).c_str());
+  }
+
+  void plug() {
+    master_ = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    grantpt(master_);
+    unlockpt(master_);
+    std::string tmp = link_ + ".new";
+    unlink(tmp.c_str());
+    if (symlink(ptsname(master_), tmp.c_str()) != 0 || rename(tmp.c_str(), link_.c_str()) != 0) perror("symlink");
+  }
+  void unplug() {
+    if (master_ >= 0) close(master_);
+    master_ = -1;
+  }
+  // Whatever the pty takes right now; the caller pumps the bridge and retries.
+  size_t write_some(const std::string& bytes) {
+    ssize_t n = write(master_, bytes.data(), bytes.size());
+    return n > 0 ? static_cast<size_t>(n) : 0;
+  }
+
+ private:
+  std::string link_;
+  int master_ = -1;
+};
+
+// A browser tab: connects, handshakes, and collects text frames.
+class WsClient {
+ public:
+  explicit WsClient(uint16_t port, int rcvbuf = 0) {
+    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (rcvbuf > 0) setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    connect(fd_, reinterpret_cast<sockaddr*>(&a), sizeof(a));
+    fcntl(fd_, F_SETFL, O_NONBLOCK);
+  }
+  ~WsClient() {
+    if (fd_ >= 0) close(fd_);
+  }
+
+  void send_raw(const std::string& bytes) { send(fd_, bytes.data(), bytes.size(), MSG_NOSIGNAL); }
+  void send_handshake() {
+    send_raw(
+        "GET / HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n");
+  }
+  void send_frame(WsOpcode op, const std::string& payload) {
+    std::string f;
+    f.push_back(static_cast<char>(0x80 | static_cast<uint8_t>(op)));
+    f.push_back(static_cast<char>(0x80 | payload.size()));
+    f.append("\0\0\0\0", 4);  // a zero mask is still a mask
+    f.append(payload);
+    send_raw(f);
+  }
+
+  // Read what has arrived; split the response header and frames out of it.
+  void poll() {
+    char buf[65536];
+    for (;;) {
+      ssize_t n = recv(fd_, buf, sizeof(buf), MSG_DONTWAIT);
+      if (n > 0) {
+        in_.append(buf, static_cast<size_t>(n));
+        continue;
+      }
+      if (n == 0) hung_up = true;
+      break;
+    }
+    if (status.empty()) {
+      size_t end = in_.find("\r\n\r\n");
+      if (end == std::string::npos) return;
+      status = in_.substr(0, in_.find("\r\n"));
+      in_.erase(0, end + 4);
+    }
+    for (;;) {
+      if (in_.size() < 2) return;
+      const uint8_t* b = reinterpret_cast<const uint8_t*>(in_.data());
+      size_t n = b[1] & 0x7F, at = 2;
+      if (n == 126) {
+        if (in_.size() < 4) return;
+        n = (static_cast<size_t>(b[2]) << 8) | b[3];
+        at = 4;
+      }
+      if (in_.size() < at + n) return;
+      opcodes.push_back(b[0] & 0x0F);
+      frames.push_back(in_.substr(at, n));
+      in_.erase(0, at + n);
+    }
+  }
+
+  std::string status;  // "HTTP/1.1 101 Switching Protocols", once it arrives
+  std::vector<std::string> frames;
+  std::vector<int> opcodes;
+  bool hung_up = false;
+
+ private:
+  int fd_ = -1;
+  std::string in_;
+};
+
+// An OSC listener on a loopback port.
+class OscClient {
+ public:
+  OscClient() {
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd_, reinterpret_cast<sockaddr*>(&a), sizeof(a));
+    socklen_t len = sizeof(a);
+    getsockname(fd_, reinterpret_cast<sockaddr*>(&a), &len);
+    port = ntohs(a.sin_port);
+  }
+  ~OscClient() { close(fd_); }
+
+  void send_to(uint16_t bridge_port, const char* address) {
+    std::string m = OscMessage(address).bytes();
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(bridge_port);
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sendto(fd_, m.data(), m.size(), 0, reinterpret_cast<sockaddr*>(&a), sizeof(a));
+  }
+  void poll() {
+    char buf[1024];
+    ssize_t n;
+    while ((n = recv(fd_, buf, sizeof(buf), MSG_DONTWAIT)) > 0) messages.push_back(std::string(buf, n));
+  }
+
+  uint16_t port = 0;
+  std::vector<std::string> messages;
+
+ private:
+  int fd_ = -1;
+};
+
+std::string temp_link() {
+  char dir[] = "/tmp/sfbridge-XXXXXX";
+  if (!mkdtemp(dir)) perror("mkdtemp");
+  return std::string(dir) + "/board";
+}
+
+BridgeConfig test_config(const std::string& link) {
+  BridgeConfig c;
+  c.serial_path = link;
+  c.bind_host = "127.0.0.1";
+  c.ws_port = 0;
+  c.osc_port = 0;
+  c.reopen_ms = 20;
+  return c;
+}
+
+// Turn the crank until `done` says so (or two seconds pass).
+bool pump(Bridge& bridge, const std::function<bool()>& done) {
+  auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (std::chrono::steady_clock::now() < give_up) {
+    bridge.run_once(1);
+    if (done()) return true;
+  }
+  return false;
+}
+
+void write_all(Bridge& bridge, Board& board, const std::string& bytes) {
+  size_t at = 0;
+  while (at < bytes.size()) {
+    at += board.write_some(bytes.substr(at));
+    bridge.run_once(0);
+  }
+}
+
+std::unique_ptr<WsClient> connect_ws(Bridge& bridge, int rcvbuf = 0) {
+  std::unique_ptr<WsClient> c(new WsClient(bridge.ws_port(), rcvbuf));
+  c->send_handshake();
+  WsClient* raw = c.get();
+  pump(bridge, [raw] {
+    raw->poll();
+    return !raw->status.empty();
+  });
+  return c;
+}
+}  // namespace
+
+void test_one_board_many_listeners() {
+  std::string link = temp_link();
+  Board board(link);
+  OscClient fixed, subscriber;
+  BridgeConfig cfg = test_config(link);
+  cfg.osc_targets.push_back({"127.0.0.1", fixed.port});
+  Bridge bridge(cfg);
+  std::string error;
+  CHECK(bridge.open(&error));
+  CHECK(bridge.stats().serial_open);
+
+  // A classroom's worth of browsers.
+  std::vector<std::unique_ptr<WsClient>> tabs;
+  for (int i = 0; i < 30; ++i) tabs.push_back(connect_ws(bridge));
+  for (auto& t : tabs) CHECK(t->status == "HTTP/1.1 101 Switching Protocols");
+  CHECK(bridge.stats().ws_clients == 30);
+
+  subscriber.send_to(bridge.osc_port(), "/stringfield/subscribe");
+  CHECK(pump(bridge, [&] { return bridge.stats().osc_clients == 2; }));
+
+  write_all(bridge, board,
+            "StringField boot noise\r\n"
+            "{\"gesture\":\"pluck\",\"value\":90,\"note\":64,\"conf\":0.93}\r\n"
+            "{\"raw\":[1000,0.41]}\n"
+            "{\"features\":{\"gesture\":\"bow\"}}\n"
+            "{\"gesture\":\"bow\",\"value\":127,\"note\":64}\n"
+            "{\"gesture\":\"release\",\"value\":0}\n");
+  auto all_heard = [&] {
+    for (auto& t : tabs) t->poll();
+    fixed.poll();
+    subscriber.poll();
+    for (auto& t : tabs) {
+      if (t->frames.size() < 5) return false;
+    }
+    return fixed.messages.size() == 3 && subscriber.messages.size() == 3;
+  };
+  CHECK(pump(bridge, all_heard));
+
+  for (auto& t : tabs) {
+    CHECK(t->frames.size() == 5);
+    CHECK(t->frames[0] == "{\"gesture\":\"pluck\",\"value\":90,\"note\":64,\"conf\":0.93}");
+    CHECK(t->frames[1] == "{\"raw\":[1000,0.41]}");
+    CHECK(t->frames[4] == "{\"gesture\":\"release\",\"value\":0}");
+    CHECK(t->opcodes[0] == 0x1);
+  }
+  std::string want = OscMessage("/stringfield/gesture").add("pluck").add(90.0f).add(90.0f / 127.0f).bytes();
+  CHECK(fixed.messages[0] == want);
+  CHECK(subscriber.messages[0] == want);
+  CHECK(subscriber.messages[2].find("release") != std::string::npos);
+
+  const BridgeStats& s = bridge.stats();
+  CHECK(s.lines == 6);
+  CHECK(s.bad_lines == 1);
+  CHECK(s.gestures == 3);
+  CHECK(s.dropped == 0);
+
+  // Leaving works; a fixed target cannot be unsubscribed by a stranger.
+  subscriber.send_to(bridge.osc_port(), "/stringfield/unsubscribe");
+  CHECK(pump(bridge, [&] { return bridge.stats().osc_clients == 1; }));
+}
+
+void test_a_stalled_tab_drops_frames_and_nobody_waits() {
+  std::string link = temp_link();
+  Board board(link);
+  BridgeConfig cfg = test_config(link);
+  cfg.queue_frames = 64;
+  Bridge bridge(cfg);
+  std::string error;
+  CHECK(bridge.open(&error));
+
+  std::unique_ptr<WsClient> fast = connect_ws(bridge);
+  std::unique_ptr<WsClient> stalled = connect_ws(bridge, 4096);  // handshakes, then never reads again
+  CHECK(bridge.stats().ws_clients == 2);
+
+  const int kLines = 4000;
+  std::string padding(80, '.');
+  for (int i = 0; i < kLines; i += 16) {
+    std::string burst;
+    for (int j = i; j < i + 16 && j < kLines; ++j) {
+      burst += "{\"raw\":[" + std::to_string(j) + ",0.5],\"pad\":\"" + padding + "\"}\n";
+    }
+    write_all(bridge, board, burst);
+    // The fast tab keeps up: it has read this burst before the next one.
+    size_t want = static_cast<size_t>(std::min(i + 16, kLines));
+    CHECK(pump(bridge, [&] {
+      fast->poll();
+      return fast->frames.size() >= want;
+    }));
+  }
+  CHECK(fast->frames.size() == static_cast<size_t>(kLines));
+
+  // The fast tab saw every line, in order.
+  for (int i = 0; i < kLines; i += 97) {
+    CHECK(fast->frames[i].compare(0, 8 + std::to_string(i).size(), "{\"raw\":[" + std::to_string(i)) == 0);
+  }
+  // The stalled one lost frames, and only it did.
+  uint64_t fast_dropped = 0, stalled_dropped = 0;
+  size_t stalled_queued = 0;
+  for (const ClientInfo& c : bridge.clients()) {
+    if (c.sent >= static_cast<uint64_t>(kLines)) {
+      fast_dropped = c.dropped;
+    } else {
+      stalled_dropped = c.dropped;
+      stalled_queued = c.queued;
+    }
+  }
+  CHECK(fast_dropped == 0);
+  CHECK(stalled_dropped > 0);
+  CHECK(stalled_queued <= cfg.queue_frames);
+  CHECK(bridge.stats().dropped == stalled_dropped);
+
+  // When it wakes up it gets whole frames: everything parses, nothing torn.
+  CHECK(pump(bridge, [&] {
+    stalled->poll();
+    return stalled->frames.size() + stalled_dropped >= static_cast<size_t>(kLines);
+  }));
+  for (const std::string& f : stalled->frames) CHECK(f.compare(0, 8, "{\"raw\":[") == 0 && f.back() == '}');
+}
+
+void test_ping_close_and_strangers() {
+  std::string link = temp_link();
+  Board board(link);
+  BridgeConfig cfg = test_config(link);
+  cfg.max_ws_clients = 2;
+  Bridge bridge(cfg);
+  std::string error;
+  CHECK(bridge.open(&error));
+
+  std::unique_ptr<WsClient> tab = connect_ws(bridge);
+  tab->send_frame(WsOpcode::Ping, "tick");
+  tab->send_frame(WsOpcode::Text, "{\"notes\":[60]}");  // read and ignored: the bridge never writes to the board
+  tab->send_frame(WsOpcode::Close, std::string("\x03\xe8", 2));
+  CHECK(pump(bridge, [&] {
+    tab->poll();
+    return tab->hung_up;
+  }));
+  CHECK(tab->frames.size() == 2);
+  CHECK(tab->opcodes[0] == 0xA && tab->frames[0] == "tick");
+  CHECK(tab->opcodes[1] == 0x8 && tab->frames[1] == std::string("\x03\xe8", 2));
+  CHECK(bridge.stats().ws_closed == 1);
+  CHECK(bridge.stats().ws_clients == 0);
+
+  // A plain HTTP request gets a 400 and the door.
+  WsClient curious(bridge.ws_port());
+  curious.send_raw("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  CHECK(pump(bridge, [&] {
+    curious.poll();
+    return curious.hung_up;
+  }));
+  CHECK(curious.status == "HTTP/1.1 400 Bad Request");
+
+  // Past max_ws_clients: 503.
+  std::unique_ptr<WsClient> a = connect_ws(bridge), b = connect_ws(bridge);
+  WsClient late(bridge.ws_port());
+  CHECK(pump(bridge, [&] {
+    late.poll();
+    return late.hung_up;
+  }));
+  CHECK(late.status == "HTTP/1.1 503 Service Unavailable");
+  CHECK(bridge.stats().ws_rejected == 2);
+}
+
+void test_half_open_sockets_give_back_their_slots() {
+  std::string link = temp_link();
+  Board board(link);
+  BridgeConfig cfg = test_config(link);
+  cfg.max_ws_clients = 2;
+  cfg.handshake_ms = 200;
+  Bridge bridge(cfg);
+  std::string error;
+  CHECK(bridge.open(&error));
+
+  WsClient silent(bridge.ws_port());  // connects, never says a word
+  WsClient trickle(bridge.ws_port());
+  trickle.send_raw("GET / HTTP/1.1\r\nHost: localhost\r\n");  // starts, never finishes
+  WsClient late(bridge.ws_port());
+  CHECK(pump(bridge, [&] {
+    late.poll();
+    return late.hung_up;
+  }));
+  CHECK(late.status == "HTTP/1.1 503 Service Unavailable");
+
+  // Nothing to read from either, yet the loop wakes for the deadline.
+  auto start = std::chrono::steady_clock::now();
+  CHECK(pump(bridge, [&] {
+    silent.poll();
+    trickle.poll();
+    return silent.hung_up && trickle.hung_up;
+  }));
+  CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(100));
+  CHECK(bridge.stats().ws_timed_out == 2);
+  CHECK(bridge.stats().ws_closed == 0);  // they never opened
+
+  // The slots are free again, and an open tab outlives the deadline.
+  std::unique_ptr<WsClient> tab = connect_ws(bridge);
+  CHECK(tab->status == "HTTP/1.1 101 Switching Protocols");
+  auto past = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+  while (std::chrono::steady_clock::now() < past) bridge.run_once(10);
+  tab->poll();
+  CHECK(!tab->hung_up);
+  CHECK(bridge.stats().ws_clients == 1);
+  CHECK(bridge.stats().ws_timed_out == 2);
+}
+
+void test_board_unplugged_and_back() {
+  std::string link = temp_link();
+  Board board(link);
+  Bridge bridge(test_config(link));
+  std::string error;
+  CHECK(bridge.open(&error));
+  std::unique_ptr<WsClient> tab = connect_ws(bridge);
+
+  write_all(bridge, board, "{\"gesture\":\"pluck\",\"value\":80}\n{\"gesture\":\"bo");  // yanked mid-line
+  CHECK(pump(bridge, [&] {
+    tab->poll();
+    return tab->frames.size() == 1;
+  }));
+  board.unplug();
+  CHECK(pump(bridge, [&] { return !bridge.stats().serial_open; }));
+  CHECK(!bridge.serial_error().empty());
+
+  board.plug();  // same path, new device
+  CHECK(pump(bridge, [&] { return bridge.stats().serial_open; }));
+  CHECK(bridge.stats().serial_opens == 2);
+  write_all(bridge, board, "w\"}\n{\"gesture\":\"mute\",\"value\":10}\n");
+  CHECK(pump(bridge, [&] {
+    tab->poll();
+    return tab->frames.size() == 2;
+  }));
+  // The half line from before the unplug did not glue onto the new stream.
+  CHECK(tab->frames[1] == "{\"gesture\":\"mute\",\"value\":10}");
+  CHECK(bridge.stats().bad_lines == 1);
+  CHECK(bridge.stats().ws_clients == 1);
+}
+
+int main() {
+  RUN_TEST(test_one_board_many_listeners);
+  RUN_TEST(test_a_stalled_tab_drops_frames_and_nobody_waits);
+  RUN_TEST(test_ping_close_and_strangers);
+  RUN_TEST(test_half_open_sockets_give_back_their_slots);
+  RUN_TEST(test_board_unplugged_and_back);
+  return checks_done();
+}
@@ -0,0 +1,306 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "capture.h"
+#include "capture_csv.h"
+#include "check.h"
+
+namespace {
+std::string temp_path(const char* suffix) {
+  char dir[] = "/tmp/sfcapture-XXXXXX";
+  if (!mkdtemp(dir)) perror("mkdtemp");
+  return std::string(dir) + "/take" + suffix;
+}
+
+void remove_temp(const std::string& path) {
+  unlink(path.c_str());
+  rmdir(path.substr(0, path.rfind('/')).c_str());
+}
+
+void add(CaptureBuilder& b, int64_t t_us, const std::string& line) { b.add_line(t_us, line.data(), line.size()); }
+
+std::string read_file(const std::string& path) {
+  std::string out;
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return out;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+  fclose(f);
+  return out;
+}
+
+void write_file(const std::string& path, const std::string& bytes) {
+  FILE* f = fopen(path.c_str(), "wb");
+  fwrite(bytes.data(), 1, bytes.size(), f);
+  fclose(f);
+}
+}  // namespace
+
+void test_lines_sort_into_samples_and_events() {
+  std::string path = temp_path(".sfcap");
+  CaptureBuilder b;
+  add(b, 1000, "StringField boot");
+  add(b, 2000, "{\"raw\":[4294967000,0.4200]}");
+  add(b, 3000, "{\"gesture\":\"pluck\",\"value\":90,\"note\":64,\"us\":4294966000}");
+  add(b, 3000, "{\"raw\":[4294966000,-0.0125]}");
+  add(b, 4000, "{\"raw\":[1, 0.5]}");  // not the firmware's spelling: kept verbatim
+  add(b, 5000, "{\"ok\":true}");
+  b.add_note("opt-in: class A");
+  std::string error;
+  CHECK(b.write(path, &error));
+
+  CaptureFile cap;
+  CHECK(cap.open(path, &error));
+  CHECK(cap.sample_count() == 2);
+  CHECK(cap.event_count() == 4);
+  CHECK(cap.samples()[0].device_us == 4294967000u);
+  CHECK(capture_raw_line(cap.samples()[0], cap.header().value_decimals) == "{\"raw\":[4294967000,0.4200]}");
+  CHECK(capture_raw_line(cap.samples()[1], cap.header().value_decimals) == "{\"raw\":[4294966000,-0.0125]}");
+
+  const CaptureEvent& g = cap.events()[1];
+  CHECK(g.kind == CaptureEventKind::Gesture);
+  CHECK(g.gesture == CaptureGesture::Pluck);
+  CHECK(g.value == 90 && g.note == 64);
+  CHECK((g.flags & kCaptureHasDeviceUs) && g.device_us == 4294966000u);
+  CHECK(cap.events()[0].kind == CaptureEventKind::Text);
+  CHECK(cap.text(cap.events()[0]) == "StringField boot");
+  CHECK(cap.events()[2].kind == CaptureEventKind::Telemetry);
+  CHECK(cap.text(cap.events()[2]) == "{\"raw\":[1, 0.5]}");
+  CHECK(cap.notes() == "opt-in: class A\n");
+
+  // Merged back in time order; a sample goes first on a shared microsecond.
+  std::vector<int64_t> order;
+  cap.replay(
+      INT64_MIN, INT64_MAX, [&](const CaptureSample& s) { order.push_back(s.t_us); },
+      [&](const CaptureEvent& e) { order.push_back(-e.t_us); });
+  CHECK((order == std::vector<int64_t>{-1000, 2000, 3000, -3000, -4000, -5000}));
+  cap.close();
+  remove_temp(path);
+}
+
+void test_seeking_matches_a_linear_scan() {
+  // Irregular timing across many buckets, gaps longer than a bucket, and
+  // runs of equal stamps: every seek must agree with brute force.
+  std::string path = temp_path(".sfcap");
+  std::mt19937 rng(7);
+  CaptureBuilder b(1000);
+  std::vector<int64_t> sample_t, event_t;
+  int64_t t = 5000;
+  for (int i = 0; i < 20000; ++i) {
+    int step = rng() % 10;
+    t += step == 0 ? 0 : step < 8 ? static_cast<int64_t>(rng() % 400) : static_cast<int64_t>(rng() % 5000);
+    if (rng() % 16 == 0) {
+      add(b, t, "{\"gesture\":\"bow\",\"value\":40}");
+      event_t.push_back(t);
+    } else {
+      b.add_sample(t, static_cast<uint32_t>(t), 0.5f);
+      sample_t.push_back(t);
+    }
+  }
+  std::string error;
+  CHECK(b.write(path, &error));
+  CaptureFile cap;
+  CHECK(cap.open(path, &error));
+  CHECK(cap.header().index_count > 1000);
+
+  auto first_at = [](const std::vector<int64_t>& v, int64_t q) {
+    size_t i = 0;
+    while (i < v.size() && v[i] < q) ++i;
+    return i;
+  };
+  for (int i = 0; i < 2000; ++i) {
+    int64_t q = static_cast<int64_t>(rng() % static_cast<uint32_t>(t + 20000)) - 10000;
+    CHECK(cap.sample_at(q) == first_at(sample_t, q));
+    CHECK(cap.event_at(q) == first_at(event_t, q));
+  }
+  for (int64_t q : {INT64_MIN, int64_t(0), int64_t(5000), t, t + 1, INT64_MAX}) {
+    CHECK(cap.sample_at(q) == first_at(sample_t, q));
+    CHECK(cap.event_at(q) == first_at(event_t, q));
+  }
+
+  // A slice holds exactly what lies in [from, to).
+  int64_t from = t / 3, to = t / 3 + 250000;
+  size_t samples = 0, events = 0;
+  bool in_range = true;
+  cap.prefetch(from, to);
+  cap.replay(
+      from, to,
+      [&](const CaptureSample& s) {
+        ++samples;
+        in_range = in_range && s.t_us >= from && s.t_us < to;
+      },
+      [&](const CaptureEvent& e) {
+        ++events;
+        in_range = in_range && e.t_us >= from && e.t_us < to;
+      });
+  CHECK(in_range);
+  CHECK(samples == first_at(sample_t, to) - first_at(sample_t, from));
+  CHECK(events == first_at(event_t, to) - first_at(event_t, from));
+  cap.close();
+  remove_temp(path);
+}
+
+void test_an_empty_capture_is_still_a_capture() {
+  std::string path = temp_path(".sfcap");
+  CaptureBuilder b;
+  std::string error;
+  CHECK(b.write(path, &error));
+  CaptureFile cap;
+  CHECK(cap.open(path, &error));
+  CHECK(cap.sample_count() == 0 && cap.event_count() == 0);
+  CHECK(cap.sample_at(123) == 0);
+  size_t n = 0;
+  cap.replay(
+      INT64_MIN, INT64_MAX, [&](const CaptureSample&) { ++n; }, [&](const CaptureEvent&) { ++n; });
+  CHECK(n == 0);
+  cap.close();
+  remove_temp(path);
+}
+
+void test_damaged_files_are_refused() {
+  std::string path = temp_path(".sfcap");
+  CaptureBuilder b;
+  for (int i = 0; i < 100; ++i) add(b, i * 1000, "{\"raw\":[1,0.1000]}");
+  add(b, 200000, "{\"gesture\":\"scrape\",\"value\":12}");
+  std::string error;
+  CHECK(b.write(path, &error));
+  std::string good = read_file(path);
+  CaptureFile cap;
+
+  std::string bad = good;
+  bad[0] = 'X';
+  write_file(path, bad);
+  CHECK(!cap.open(path, &error));
+  CHECK(error.find("not a .sfcap") != std::string::npos);
+
+  write_file(path, good.substr(0, good.size() / 2));
+  CHECK(!cap.open(path, &error));
+  CHECK(error.find("truncated") != std::string::npos);
+
+  // An event whose text runs off the end of its section.
+  bad = good;
+  CaptureHeader h;
+  memcpy(&h, good.data(), sizeof(h));
+  CaptureEvent e;
+  memcpy(&e, good.data() + h.event_offset, sizeof(e));
+  e.text_len = 1u << 30;
+  memcpy(&bad[h.event_offset], &e, sizeof(e));
+  write_file(path, bad);
+  CHECK(!cap.open(path, &error));
+
+  write_file(path, "");
+  CHECK(!cap.open(path, &error));
+  write_file(path, good);
+  CHECK(cap.open(path, &error));
+  cap.close();
+  remove_temp(path);
+}
+
+void test_iso_times_round_trip() {
+  int64_t us = 0;
+  CHECK(capture_parse_iso_time("1970-01-01T00:00:01.5+00:00", &us));
+  CHECK(us == 1500000);
+  CHECK(capture_parse_iso_time("2024-05-01T12:34:56.123456+00:00", &us));
+  CHECK(capture_iso_time(us) == "2024-05-01T12:34:56.123456+00:00");
+  int64_t same = 0;
+  CHECK(capture_parse_iso_time("2024-05-01T14:34:56.123456+02:00", &same));
+  CHECK(same == us);
+  CHECK(capture_iso_time(1714566896000000) == "2024-05-01T12:34:56+00:00");  // no fraction, like Python
+  CHECK(!capture_parse_iso_time("", &us));
+  CHECK(!capture_parse_iso_time("yesterday", &us));
+}
+
+void test_every_firmware_gesture_round_trips() {
+  // Everything gesture_name() in firmware/src/main.cpp can print. A name
+  // missing here is indexed as Other and drops out of gesture seeks.
+  const char* const kFirmwareNames[] = {"pluck", "bow", "scrape", "harmonic", "mute", "tremolo", "vibrato", "idle"};
+  std::string path = temp_path(".sfcap");
+  CaptureBuilder b;
+  int64_t t = 0;
+  for (const char* name : kFirmwareNames) {
+    CHECK(capture_gesture_code(name) != CaptureGesture::Other);
+    CHECK(std::string(capture_gesture_name(capture_gesture_code(name))) == name);
+    add(b, t += 1000, std::string("{\"gesture\":\"") + name + "\",\"value\":64}");
+  }
+  std::string error;
+  CHECK(b.write(path, &error));
+
+  CaptureFile cap;
+  CHECK(cap.open(path, &error));
+  CHECK(cap.event_count() == sizeof(kFirmwareNames) / sizeof(kFirmwareNames[0]));
+  for (size_t i = 0; i < cap.event_count(); ++i) {
+    const CaptureEvent& e = cap.events()[i];
+    CHECK(e.kind == CaptureEventKind::Gesture);
+    CHECK(std::string(capture_gesture_name(e.gesture)) == kFirmwareNames[i]);
+  }
+  CHECK(capture_gesture_code("strum") == CaptureGesture::Other);
+  cap.close();
+  remove_temp(path);
+}
+
+void test_csv_converts_and_replays_row_for_row() {
+  // What serial_logger.py writes: comments, a header, "\r\n" rows, and the
+  // JSON quoted with doubled quotes.
+  const int64_t start = 1714566896000000;
+  std::vector<std::pair<int64_t, std::string>> rows = {
+      {0, "StringField boot"},
+      {1250, "{\"raw\":[100,0.0000]}"},
+      {2250, "{\"raw\":[1100,0.5000]}"},
+      {2251, "{\"gesture\":\"pluck\",\"value\":90,\"note\":64,\"us\":1101}"},
+      {3000, "{\"help\":\"Send {\\\"notes\\\":[60]}, ok\"}"},
+      {1000000, ""},
+  };
+  std::string csv = "# StringField serial_logger\n# Session start (UTC): 2024-05-01T12:34:56+00:00\n";
+  csv += "timestamp_iso,elapsed_seconds,line\r\n";
+  std::string body;
+  for (auto& r : rows) body += capture_csv_row(capture_iso_time(start + r.first), r.first, r.second);
+  csv += body;
+  CHECK(body.find("\"{\"\"raw\"\":[100,0.0000]}\"") != std::string::npos);
+
+  std::string in = temp_path(".csv");
+  std::string out = in.substr(0, in.rfind('/')) + "/take.sfcap";
+  write_file(in, csv);
+  CaptureBuilder b;
+  CsvImportStats stats;
+  std::string error;
+  CHECK(capture_import_csv(in, &b, &stats, &error));
+  CHECK(stats.rows == rows.size());
+  CHECK(stats.comments == 2);
+  CHECK(stats.skipped == 0);
+  CHECK(b.samples() == 2);
+  CHECK(b.write(out, &error));
+
+  CaptureFile cap;
+  CHECK(cap.open(out, &error));
+  CHECK(cap.header().start_unix_us == start);
+  CHECK(cap.notes() == "StringField serial_logger\nSession start (UTC): 2024-05-01T12:34:56+00:00\n");
+  std::string back;
+  auto row = [&](int64_t t, const std::string& line) {
+    back += capture_csv_row(capture_iso_time(cap.header().start_unix_us + t), t, line);
+  };
+  cap.replay(
+      INT64_MIN, INT64_MAX, [&](const CaptureSample& s) { row(s.t_us, capture_raw_line(s, 4)); },
+      [&](const CaptureEvent& e) { row(e.t_us, std::string(cap.text(e))); });
+  CHECK(back == body);
+  cap.close();
+  unlink(out.c_str());
+  remove_temp(in);
+}
+
+int main() {
+  RUN_TEST(test_lines_sort_into_samples_and_events);
+  RUN_TEST(test_seeking_matches_a_linear_scan);
+  RUN_TEST(test_an_empty_capture_is_still_a_capture);
+  RUN_TEST(test_damaged_files_are_refused);
+  RUN_TEST(test_iso_times_round_trip);
+  RUN_TEST(test_every_firmware_gesture_round_trips);
+  RUN_TEST(test_csv_converts_and_replays_row_for_row);
+  return checks_done();
+}
@@ -0,0 +1,81 @@
+#include <string>
+
+#include "check.h"
+#include "client_queue.h"
+
+namespace {
+Payload p(const std::string& s) { return std::make_shared<const std::string>(s); }
+
+std::string drain(ClientQueue& q, size_t max_bytes) {
+  std::string out;
+  while (!q.empty() && out.size() < max_bytes) {
+    iovec iov[8];
+    size_t n = q.gather(iov, 8);
+    size_t take = 0;
+    for (size_t i = 0; i < n && out.size() < max_bytes; ++i) {
+      size_t room = max_bytes - out.size();
+      size_t len = iov[i].iov_len < room ? iov[i].iov_len : room;
+      out.append(static_cast<const char*>(iov[i].iov_base), len);
+      take += len;
+    }
+    q.consume(take);
+  }
+  return out;
+}
+}  // namespace
+
+void test_full_queue_drops_new_frames() {
+  ClientQueue q(3, 1000);
+  CHECK(q.push(p("a")));
+  CHECK(q.push(p("b")));
+  CHECK(q.push(p("c")));
+  CHECK(!q.push(p("d")));
+  CHECK(q.dropped() == 1);
+  CHECK(q.size() == 3 && q.high_water() == 3);
+  CHECK(drain(q, 100) == "abc");
+  CHECK(q.sent() == 3 && q.bytes() == 0);
+}
+
+void test_byte_bound_holds_too() {
+  ClientQueue q(100, 10);
+  CHECK(q.push(p("12345")));
+  CHECK(q.push(p("67890")));
+  CHECK(!q.push(p("x")));
+  CHECK(q.bytes() == 10);
+  // Control replies still get through, or the client would never hear its pong.
+  q.push_control(p("pong"));
+  CHECK(q.size() == 3);
+  CHECK(drain(q, 100) == "1234567890pong");
+}
+
+void test_partial_writes_never_tear_a_frame() {
+  ClientQueue q(8, 1000);
+  q.push(p("first"));
+  q.push(p("second"));
+  // The socket takes 3 bytes, then 6 (the rest of "first" and part of "second").
+  CHECK(drain(q, 3) == "fir");
+  CHECK(q.size() == 2 && q.bytes() == 8);
+  // New frames queue behind the half-sent one; it is still first.
+  CHECK(q.push(p("third")));
+  CHECK(drain(q, 6) == "stseco");
+  CHECK(q.size() == 2 && q.sent() == 1);
+  CHECK(drain(q, 100) == "ndthird");
+}
+
+void test_one_payload_shared_by_many_queues() {
+  Payload shared = p("{\"gesture\":\"pluck\"}");
+  ClientQueue a(4, 100), b(4, 100);
+  a.push(shared);
+  b.push(shared);
+  CHECK(shared.use_count() == 3);
+  drain(a, 100);
+  CHECK(shared.use_count() == 2);
+}
+
+int main() {
+  RUN_TEST(test_full_queue_drops_new_frames);
+  RUN_TEST(test_byte_bound_holds_too);
+  RUN_TEST(test_partial_writes_never_tear_a_frame);
+  RUN_TEST(test_one_payload_shared_by_many_queues);
+  return checks_done();
+}
@@ -0,0 +1,96 @@
+#include <math.h>
+#include <stdint.h>
+
+#include <random>
+
+#include "check.h"
+#include "clock_sync.h"
+
+namespace {
+// A board whose crystal runs `ppm` fast, with its 32-bit micros() reading
+// `start` at host zero.
+struct SimBoard {
+  double ppm;
+  uint32_t start;
+  int64_t device_at(double host_us) const { return static_cast<int64_t>(start + host_us * (1.0 + ppm * 1e-6)); }
+  uint32_t micros_at(double host_us) const { return static_cast<uint32_t>(device_at(host_us)); }
+};
+}  // namespace
+
+void test_unwrap_crosses_the_wrap() {
+  MicrosUnwrapper u;
+  CHECK(!u.started());
+  CHECK(u.unwrap(0xFFFFFF00u) == 0xFFFFFF00ll);
+  CHECK(u.unwrap(0x00000010u) == 0x100000010ll);  // wrapped
+  CHECK(u.latest() == 0x100000010ll);
+  // A slightly older stamp, from before the wrap, stays before it.
+  CHECK(u.unwrap(0xFFFFFFF0u) == 0xFFFFFFF0ll);
+  CHECK(u.latest() == 0x100000010ll);
+  // Several wraps, in steps under half the period.
+  int64_t expect = 0x100000010ll;
+  uint32_t raw = 0x10u;
+  for (int i = 0; i < 10; ++i) {
+    raw += 0x40000000u;
+    expect += 0x40000000ll;
+    CHECK(u.unwrap(raw) == expect);
+  }
+  u.reset();
+  CHECK(!u.started());
+  CHECK(u.unwrap(5) == 5);
+}
+
+void test_one_exchange_gives_an_offset() {
+  ClockModel m;
+  CHECK(!m.synced());
+  // Device read 1000 while the host was between 500 and 700: midpoint 600.
+  m.add(1000, 500, 700);
+  CHECK(m.synced());
+  CHECK(m.to_host(1000) == 600.0);
+  CHECK(m.to_host(2000) == 1600.0);  // no rate yet: 1.0
+  CHECK(m.bound_us() == 100.0);
+  CHECK(m.residual_us() == 0.0);
+}
+
+void test_drift_is_learned_through_wrap_and_outliers() {
+  // +250 ppm, micros() 1.5 s from wrapping, exchanges every 50 ms with
+  // 150..400 µs round trips, and one in five stuck behind telemetry for 5 ms
+  // on the way back.
+  SimBoard board{250.0, 0xFFFFFFFFu - 1500000u};
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> rtt(150.0, 400.0);
+  MicrosUnwrapper u;
+  ClockModel m;
+  double host = 100000.0;
+  for (int i = 0; i < 200; ++i) {
+    double out = rtt(rng) / 2;
+    double back = rtt(rng) / 2 + (i % 5 == 3 ? 5000.0 : 0.0);
+    uint32_t stamp = board.micros_at(host + out);
+    m.add(u.unwrap(stamp), static_cast<int64_t>(host), static_cast<int64_t>(host + out + back));
+    host += 50000.0;
+  }
+  CHECK(u.latest() > 0xFFFFFFFFll);  // really did wrap
+  CHECK(fabs(m.drift_ppm() - 250.0) < 20.0);
+  CHECK(m.bound_us() < 200.0);
+  CHECK(m.samples() == ClockModel::kWindow);
+  // Any recent device stamp maps back to its true host time closely.
+  for (double t = host - 1000000.0; t < host; t += 100000.0) {
+    double err = m.to_host(u.unwrap(board.micros_at(t))) - t;
+    CHECK(fabs(err) < 150.0);
+  }
+}
+
+void test_an_absurd_rate_is_not_believed() {
+  // Exchanges far enough apart for a rate, but 5% off: a reboot or a
+  // wrong pong, never a crystal. The offset still follows; the rate does not.
+  ClockModel m;
+  for (int64_t i = 0; i < 4; ++i) m.add(i * 1000000, i * 1050000, i * 1050000);
+  CHECK(fabs(m.drift_ppm()) < 1e-9);
+}
+
+int main() {
+  RUN_TEST(test_unwrap_crosses_the_wrap);
+  RUN_TEST(test_one_exchange_gives_an_offset);
+  RUN_TEST(test_drift_is_learned_through_wrap_and_outliers);
+  RUN_TEST(test_an_absurd_rate_is_not_believed);
+  return checks_done();
+}
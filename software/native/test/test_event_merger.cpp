@@ -0,0 +1,119 @@
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "event_merger.h"
+
+namespace {
+struct Sink {
+  std::vector<MergedEvent> got;
+  void operator()(MergedEvent e) { got.push_back(std::move(e)); }
+};
+
+std::vector<std::string> lines(const Sink& s) {
+  std::vector<std::string> out;
+  for (const MergedEvent& e : s.got) out.push_back(e.line);
+  return out;
+}
+}  // namespace
+
+void test_interleaves_by_host_time() {
+  EventMerger m(2, 50000, 0, 1000);
+  Sink sink;
+  m.push(0, 100, 100, 0, "a100");
+  m.push(0, 300, 300, 0, "a300");
+  m.release(0, std::ref(sink));
+  CHECK(sink.got.empty());  // board 1 has said nothing yet
+  m.push(1, 200, 9200, 0, "b200");
+  m.release(0, std::ref(sink));
+  // Both boards heard past 200; 300 must wait for board 1 to pass it.
+  CHECK((lines(sink) == std::vector<std::string>{"a100", "b200"}));
+  CHECK(sink.got[1].board == 1 && sink.got[1].device_us == 9200);
+  m.heard(1, 400);
+  m.release(0, std::ref(sink));
+  CHECK(lines(sink).back() == "a300");
+  CHECK(m.stats().late == 0 && m.stats().overdue == 0);
+}
+
+void test_equal_stamps_keep_arrival_order() {
+  EventMerger m(1, 50000, 0, 1000);
+  Sink sink;
+  m.push(0, 10, 10, 0, "first");
+  m.push(0, 10, 10, 0, "second");
+  m.push(0, 10, 10, 0, "third");
+  m.release(0, std::ref(sink));
+  CHECK((lines(sink) == std::vector<std::string>{"first", "second", "third"}));
+}
+
+void test_reorder_slack_holds_back_the_watermark() {
+  EventMerger m(1, 50000, 5000, 1000);
+  Sink sink;
+  m.push(0, 10000, 0, 0, "x");
+  m.release(0, std::ref(sink));
+  CHECK(sink.got.empty());  // could still be overtaken by a line stamped 5000..10000
+  m.push(0, 7000, 0, 0, "earlier");
+  m.push(0, 15000, 0, 0, "y");
+  m.release(0, std::ref(sink));
+  CHECK((lines(sink) == std::vector<std::string>{"earlier", "x"}));
+}
+
+void test_a_quiet_board_costs_at_most_the_latency_bound() {
+  EventMerger m(2, 50000, 0, 1000);
+  Sink sink;
+  m.heard(1, 0);
+  m.push(0, 1000, 0, 1000, "a");
+  m.release(40000, std::ref(sink));
+  CHECK(sink.got.empty());
+  m.release(51000, std::ref(sink));
+  CHECK(sink.got.size() == 1);
+  CHECK(m.stats().overdue == 1);
+  CHECK(m.stats().worst_wait_us == 50000);
+
+  // Board 1 finally speaks, from before what went out: released at once, marked.
+  m.push(1, 500, 0, 52000, "b-late");
+  m.release(52000, std::ref(sink));
+  CHECK(sink.got.size() == 2);
+  CHECK(sink.got[1].late);
+  CHECK(m.stats().late == 1);
+}
+
+void test_an_inactive_board_does_not_hold_anything() {
+  EventMerger m(3, 50000, 0, 1000);
+  Sink sink;
+  m.set_active(2, false);
+  m.push(0, 100, 0, 0, "a");
+  m.push(1, 100, 0, 0, "b");
+  m.release(0, std::ref(sink));
+  CHECK(sink.got.size() == 2);
+  m.set_active(2, true);  // plugged back in: unheard, so it holds things again
+  m.push(0, 200, 0, 0, "c");
+  m.push(1, 200, 0, 0, "d");
+  m.release(0, std::ref(sink));
+  CHECK(sink.got.size() == 2);
+}
+
+void test_max_pending_forces_the_oldest_out() {
+  EventMerger m(2, 50000, 0, 4);
+  Sink sink;
+  for (int i = 0; i < 6; ++i) m.push(0, 100 * i, 0, 0, std::to_string(i));
+  m.release(0, std::ref(sink));
+  CHECK((lines(sink) == std::vector<std::string>{"0", "1"}));
+  CHECK(m.stats().forced == 2);
+  CHECK(m.stats().pending == 4);
+  CHECK(m.stats().high_water == 6);
+  m.drain(0, std::ref(sink));
+  CHECK(sink.got.size() == 6);
+  CHECK(m.stats().pending == 0);
+  CHECK(m.stats().late == 0);
+}
+
+int main() {
+  RUN_TEST(test_interleaves_by_host_time);
+  RUN_TEST(test_equal_stamps_keep_arrival_order);
+  RUN_TEST(test_reorder_slack_holds_back_the_watermark);
+  RUN_TEST(test_a_quiet_board_costs_at_most_the_latency_bound);
+  RUN_TEST(test_an_inactive_board_does_not_hold_anything);
+  RUN_TEST(test_max_pending_forces_the_oldest_out);
+  return checks_done();
+}
@@ -0,0 +1,140 @@
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "frame.h"
+#include "osc.h"
+
+namespace {
+bool parse(const char* line, Frame* f) { return parse_frame(line, strlen(line), f); }
+
+std::vector<std::string> split(LineSplitter& s, const std::string& bytes) {
+  std::vector<std::string> out;
+  s.feed(bytes.data(), bytes.size(), [&](const char* p, size_t n) { out.push_back(std::string(p, n)); });
+  return out;
+}
+}  // namespace
+
+void test_gesture_lines_parse_once() {
+  Frame f;
+  CHECK(parse("{\"gesture\":\"pluck\",\"value\":90,\"note\":64,\"conf\":0.93,\"onset_us\":1200,\"lag_us\":3100}", &f));
+  CHECK(f.kind == FrameKind::Gesture);
+  CHECK(f.gesture == "pluck");
+  CHECK(f.value == 90.0f);
+  CHECK(f.note == 64);
+  CHECK(f.conf > 0.92f && f.conf < 0.94f);
+
+  CHECK(parse(" { \"gesture\" : \"release\" , \"value\" : 0 } ", &f));
+  CHECK(f.kind == FrameKind::Gesture);
+  CHECK(f.gesture == "release");
+  CHECK(f.note == -1);
+  CHECK(f.conf == -1.0f);
+}
+
+void test_everything_else_is_telemetry() {
+  Frame f;
+  CHECK(parse("{\"raw\":[123456,0.42]}", &f));
+  CHECK(f.kind == FrameKind::Telemetry);
+  // A gesture name one level down is a feature dump, not a played gesture.
+  CHECK(parse("{\"features\":{\"gesture\":\"bow\",\"peak\":0.8},\"value\":3}", &f));
+  CHECK(f.kind == FrameKind::Telemetry);
+  // The tree's shadow verdict says what the *other* backend would have done.
+  CHECK(parse("{\"ab\":\"tree\",\"gesture\":\"scrape\",\"conf\":0.61}", &f));
+  CHECK(f.kind == FrameKind::Telemetry);
+  CHECK(parse("{\"help\":\"Send {\\\"notes\\\":[60,62]} \\u2014 ok\",\"ok\":true,\"x\":null}", &f));
+  CHECK(f.kind == FrameKind::Telemetry);
+  CHECK(parse("{}", &f));
+}
+
+void test_board_stamps_are_picked_up() {
+  Frame f;
+  CHECK(parse("{\"gesture\":\"pluck\",\"value\":90,\"note\":64,\"us\":4294967000}", &f));
+  CHECK(f.kind == FrameKind::Gesture);
+  CHECK(f.has_us && f.us == 4294967000u);
+  // Samples carry their stamp first in the array; the rest is ignored.
+  CHECK(parse("{\"raw\":[123456,0.42]}", &f));
+  CHECK(f.kind == FrameKind::Telemetry);
+  CHECK(f.has_us && f.us == 123456u);
+  CHECK(parse("{\"env\":[99,0.1,0.2,0.3]}", &f));
+  CHECK(f.has_us && f.us == 99u);
+  CHECK(parse("{\"pong\":[7,3000000000]}", &f));
+  CHECK(f.kind == FrameKind::Pong);
+  CHECK(f.pong_seq == 7u);
+  CHECK(f.has_us && f.us == 3000000000u);
+  // A pong without its stamp is just telemetry; so is an unstamped line.
+  CHECK(parse("{\"pong\":[7]}", &f));
+  CHECK(f.kind == FrameKind::Telemetry);
+  CHECK(parse("{\"ok\":true}", &f));
+  CHECK(!f.has_us);
+}
+
+void test_junk_is_rejected() {
+  Frame f;
+  CHECK(!parse("", &f));
+  CHECK(!parse("StringField boot", &f));
+  CHECK(!parse("{\"gesture\":\"pluck\"", &f));            // cut short
+  CHECK(!parse("{\"gesture\":\"pluck\"}}", &f));          // trailing junk
+  CHECK(!parse("[1,2,3]", &f));                           // not an object
+  CHECK(!parse("{\"raw\":[1,2}", &f));                    // unbalanced
+  CHECK(!parse("{\"gesture\":pluck}", &f));               // bare word
+}
+
+void test_splitter_reassembles_and_bounds_lines() {
+  LineSplitter s;
+  CHECK(split(s, "{\"a\":").empty());
+  std::vector<std::string> lines = split(s, "1}\r\n\n{\"b\":2}\n{\"c\"");
+  CHECK(lines.size() == 2);
+  CHECK(lines[0] == "{\"a\":1}");
+  CHECK(lines[1] == "{\"b\":2}");
+  lines = split(s, ":3}\n");
+  CHECK(lines.size() == 1 && lines[0] == "{\"c\":3}");
+
+  // An overlong line is dropped whole, and the next one comes through.
+  std::string big(LineSplitter::kMaxLine + 10, 'x');
+  lines = split(s, big + "\n{\"d\":4}\n");
+  CHECK(lines.size() == 1 && lines[0] == "{\"d\":4}");
+  CHECK(s.overlong() == 1);
+
+  // Exactly kMaxLine still fits.
+  lines = split(s, std::string(LineSplitter::kMaxLine, 'y') + "\n");
+  CHECK(lines.size() == 1 && lines[0].size() == LineSplitter::kMaxLine);
+
+  // A reset (port closed mid-line) forgets the fragment.
+  split(s, "{\"half");
+  s.reset();
+  lines = split(s, "{\"e\":5}\n");
+  CHECK(lines.size() == 1 && lines[0] == "{\"e\":5}");
+}
+
+void test_osc_message_layout() {
+  std::string b = OscMessage("/stringfield/gesture").add("bow").add(64.0f).add(0.5f).bytes();
+  // address (20 chars + NULs to 24), ",sff" + NULs to 8, "bow\0", two floats
+  CHECK(b.size() == 24 + 8 + 4 + 4 + 4);
+  CHECK(memcmp(b.data(), "/stringfield/gesture\0\0\0\0", 24) == 0);
+  CHECK(memcmp(b.data() + 24, ",sff\0\0\0\0", 8) == 0);
+  CHECK(memcmp(b.data() + 32, "bow\0", 4) == 0);
+  const uint8_t* f = reinterpret_cast<const uint8_t*>(b.data() + 36);
+  CHECK(f[0] == 0x42 && f[1] == 0x80 && f[2] == 0 && f[3] == 0);  // 64.0f big-endian
+
+  std::string ping = OscMessage("/p").add(int32_t(-2)).bytes();
+  CHECK(ping.size() == 4 + 4 + 4);
+  CHECK(static_cast<uint8_t>(ping[8]) == 0xFF && static_cast<uint8_t>(ping[11]) == 0xFE);
+
+  std::string address;
+  CHECK(osc_address(reinterpret_cast<const uint8_t*>(b.data()), b.size(), &address));
+  CHECK(address == "/stringfield/gesture");
+  CHECK(!osc_address(reinterpret_cast<const uint8_t*>("#bundle\0"), 8, &address));
+  CHECK(!osc_address(reinterpret_cast<const uint8_t*>("/abc"), 4, &address));  // no terminator
+}
+
+int main() {
+  RUN_TEST(test_gesture_lines_parse_once);
+  RUN_TEST(test_everything_else_is_telemetry);
+  RUN_TEST(test_board_stamps_are_picked_up);
+  RUN_TEST(test_junk_is_rejected);
+  RUN_TEST(test_splitter_reassembles_and_bounds_lines);
+  RUN_TEST(test_osc_message_layout);
+  return checks_done();
+}
@@ -0,0 +1,115 @@
+#include <string.h>
+
+#include <string>
+
+#include "check.h"
+#include "websocket.h"
+
+namespace {
+// What a browser sends: a masked frame.
+std::string client_frame(WsOpcode op, const std::string& payload, size_t len_field_size = 0) {
+  std::string out;
+  out.push_back(static_cast<char>(0x80 | static_cast<uint8_t>(op)));
+  size_t n = payload.size();
+  if (n < 126 && len_field_size == 0) {
+    out.push_back(static_cast<char>(0x80 | n));
+  } else {
+    out.push_back(static_cast<char>(0x80 | 126));
+    out.push_back(static_cast<char>(n >> 8));
+    out.push_back(static_cast<char>(n));
+  }
+  const uint8_t mask[4] = {0x37, 0xFA, 0x21, 0x3D};
+  out.append(reinterpret_cast<const char*>(mask), 4);
+  for (size_t i = 0; i < n; ++i) out.push_back(static_cast<char>(payload[i] ^ mask[i % 4]));
+  return out;
+}
+
+WsRead read(const std::string& bytes, WsFrame* f, size_t* used) {
+  return ws_read_frame(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size(), f, used);
+}
+}  // namespace
+
+void test_accept_key_matches_the_rfc_example() {
+  // RFC 6455 §1.3.
+  CHECK(ws_accept_key("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+void test_handshake_parsing() {
+  std::string req =
+      "GET /stringfield HTTP/1.1\r\n"
+      "Host: 10.0.0.2:8765\r\n"
+      "Upgrade: WebSocket\r\n"
+      "Connection: keep-alive, Upgrade\r\n"
+      "sec-websocket-key:   dGhlIHNhbXBsZSBub25jZQ==  \r\n"
+      "Sec-WebSocket-Version: 13\r\n"
+      "\r\n";
+  std::string key;
+  size_t used = 0;
+  CHECK(ws_read_handshake(req.substr(0, 40), &key, &used) == WsHandshake::Incomplete);
+  CHECK(ws_read_handshake(req + "\x81", &key, &used) == WsHandshake::Ok);
+  CHECK(key == "dGhlIHNhbXBsZSBub25jZQ==");
+  CHECK(used == req.size());
+  std::string resp = ws_handshake_response(key);
+  CHECK(resp.find("HTTP/1.1 101") == 0);
+  CHECK(resp.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n") != std::string::npos);
+  CHECK(resp.substr(resp.size() - 4) == "\r\n\r\n");
+
+  // Plain HTTP (someone pointed a browser tab at the port) is refused.
+  CHECK(ws_read_handshake("GET / HTTP/1.1\r\nHost: x\r\n\r\n", &key, &used) == WsHandshake::Bad);
+  CHECK(ws_read_handshake("POST / HTTP/1.1\r\nUpgrade: websocket\r\nConnection: upgrade\r\n"
+                          "Sec-WebSocket-Key: abc\r\n\r\n",
+                          &key, &used) == WsHandshake::Bad);
+  // Headers that never end are refused once they pass the cap.
+  CHECK(ws_read_handshake("GET / HTTP/1.1\r\n" + std::string(kWsMaxHandshake, 'x'), &key, &used) ==
+        WsHandshake::Bad);
+}
+
+void test_server_frames_pick_the_right_length_encoding() {
+  std::string small = ws_frame(WsOpcode::Text, "{\"a\":1}", 7);
+  CHECK(small.size() == 2 + 7);
+  CHECK(static_cast<uint8_t>(small[0]) == 0x81 && small[1] == 7);
+
+  std::string mid(300, 'm');
+  std::string f = ws_frame(WsOpcode::Text, mid.data(), mid.size());
+  CHECK(f.size() == 4 + 300);
+  CHECK(static_cast<uint8_t>(f[1]) == 126 && static_cast<uint8_t>(f[2]) == 1 && static_cast<uint8_t>(f[3]) == 44);
+
+  std::string big(70000, 'b');
+  f = ws_frame(WsOpcode::Binary, big.data(), big.size());
+  CHECK(f.size() == 10 + 70000);
+  CHECK(static_cast<uint8_t>(f[0]) == 0x82 && static_cast<uint8_t>(f[1]) == 127);
+  CHECK(static_cast<uint8_t>(f[7]) == 0x01 && static_cast<uint8_t>(f[8]) == 0x11 &&
+        static_cast<uint8_t>(f[9]) == 0x70);  // 70000 = 0x011170
+}
+
+void test_client_frames_unmask_and_split() {
+  WsFrame f;
+  size_t used = 0;
+  std::string ping = client_frame(WsOpcode::Ping, "hi");
+  std::string text = client_frame(WsOpcode::Text, std::string(200, 'z'), 2);
+  std::string both = ping + text;
+  CHECK(read(both.substr(0, 3), &f, &used) == WsRead::Incomplete);
+  CHECK(read(both, &f, &used) == WsRead::Frame);
+  CHECK(f.opcode == WsOpcode::Ping && f.payload == "hi" && used == ping.size());
+  CHECK(read(both.substr(used, 50), &f, &used) == WsRead::Incomplete);
+  CHECK(read(both.substr(ping.size()), &f, &used) == WsRead::Frame);
+  CHECK(f.opcode == WsOpcode::Text && f.payload == std::string(200, 'z') && used == text.size());
+}
+
+void test_client_frames_that_break_the_rules() {
+  WsFrame f;
+  size_t used = 0;
+  std::string unmasked = ws_frame(WsOpcode::Text, "x", 1);
+  CHECK(read(unmasked, &f, &used) == WsRead::Error);
+  std::string huge = client_frame(WsOpcode::Text, std::string(kWsMaxClientPayload + 1, 'h'), 2);
+  CHECK(read(huge.substr(0, 8), &f, &used) == WsRead::Error);  // refused on the header alone
+}
+
+int main() {
+  RUN_TEST(test_accept_key_matches_the_rfc_example);
+  RUN_TEST(test_handshake_parsing);
+  RUN_TEST(test_server_frames_pick_the_right_length_encoding);
+  RUN_TEST(test_client_frames_unmask_and_split);
+  RUN_TEST(test_client_frames_that_break_the_rules);
+  return checks_done();
+}
@@ -27,6 +27,8 @@ function setup() {
   // you can teach the "click → pick port → data flows" story in real time.
   setupSerialHud();
   setupSerialListeners();
+  // Or, with ?bridge=ws://host:8765 in the URL, listen to the native bridge.
+  setupBridgeSocket();
 }
 
 // draw() fires 60 times per second. Every call repaints the entire scene so the
@@ -282,6 +284,34 @@ async function startSerialReadLoop() {
   }
 }
 
+// ---------------------------------------------------------------------------
+// Bridge mode. WebSerial lets exactly one tab own the board. The native bridge
+// (software/native) owns it instead and hands every line to every tab that
+// asks, so thirty laptops can watch one string. Open the sketch as
+// `.../software/p5js/?bridge=ws://<bridge-host>:8765`; each WebSocket message
+// is one serial line, so it lands in the same handler as WebSerial. Works in
+// Firefox and Safari too, since no WebSerial is involved.
+function setupBridgeSocket() {
+  const url = new URLSearchParams(window.location.search).get('bridge');
+  if (!url) return;
+  serialStatus = `bridge: connecting to ${url}`;
+  updateSerialStatus();
+  const socket = new WebSocket(url);
+  socket.addEventListener('open', () => {
+    serialStatus = `bridge: ${url}`;
+    updateSerialStatus();
+  });
+  socket.addEventListener('message', (event) => {
+    ingestSerialLine(String(event.data).trim());
+  });
+  socket.addEventListener('close', () => {
+    // Bridge restarted or Wi-Fi blinked: keep trying, quietly.
+    serialStatus = 'bridge: lost, retrying...';
+    updateSerialStatus();
+    setTimeout(setupBridgeSocket, 2000);
+  });
+}
+
 // Called whenever WebSerial/WebMIDI hands us a full line of JSON. We parse it,
 // shrug off errors (bad packets shouldn't crash the workshop), and hand the
 // result to the handler below.
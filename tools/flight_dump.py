@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""Decode a flight-recorder dump into a serial_logger-style capture.
+
+INTENT:
+  - The board keeps the last few minutes of samples, gesture lines and MIDI in
+    RAM whether or not anyone was logging (``firmware/include/flight_recorder.h``).
+    When a show misfires, ``{"rec":"dump"}`` streams that ring out as
+    ``{"rec":[seq,"<base64 block>"]}`` lines.
+  - Turn those lines back into the same CSV ``serial_logger.py`` writes, with
+    every sample as ``{"raw":[micros,value]}``, so the capture drops straight
+    into ``train_gesture_tree.py`` or any notebook that already reads captures.
+
+USAGE:
+  # Capture the dump (the logger still asks for consent first).
+  python tools/serial_logger.py /dev/ttyACM0 115200 > dump.csv
+  #   ...then type {"rec":"dump"} into the board and wait for {"rec_done":...}
+  python tools/flight_dump.py dump.csv > replay.csv
+
+  Plain text logs (one JSON line per line, e.g. from a serial monitor) work too.
+  Blocks may arrive in any order or twice; they are sorted and deduplicated.
+"""
+
+from __future__ import annotations
+
+import argparse
+import base64
+import csv
+import json
+import struct
+import sys
+from typing import Dict, Iterable, List, Tuple
+
+# Keep in lockstep with firmware/include/flight_recorder.h.
+HEADER = struct.Struct("<IIhH")  # seq, base_us, base_q, used
+VALUE_SCALE = 16384.0
+TAG_SAMPLE = 0x01
+TAG_GESTURE = 0x10
+TAG_MIDI = 0x20
+TAG_SAME_DT = 0xBF
+GESTURES = ["idle", "pluck", "bow", "scrape", "harmonic", "muted", "tremolo", "vibrato"]
+
+Record = Tuple[int, str]  # (micros, JSON line)
+
+
+def _zigzag(data: bytes, pos: int) -> Tuple[int, int]:
+  z = 0
+  shift = 0
+  while True:
+    if pos >= len(data) or shift > 28:
+      raise ValueError("truncated varint")
+    b = data[pos]
+    pos += 1
+    z |= (b & 0x7F) << shift
+    if not b & 0x80:
+      break
+    shift += 7
+  return (z >> 1) ^ -(z & 1), pos
+
+
+def decode_block(block: bytes) -> List[Record]:
+  """One block → records, the same walk as FlightBlockReader::next()."""
+  seq, last_us, last_q, used = HEADER.unpack_from(block)
+  if used < HEADER.size or used > len(block):
+    raise ValueError(f"block {seq}: bad length {used}")
+  out: List[Record] = []
+  pos = HEADER.size
+  last_dt = None
+  while pos < used:
+    tag = block[pos]
+    pos += 1
+    if 0x80 <= tag < 0xFF:
+      if last_dt is None:
+        break  # same-dt sample before any dt: malformed, stop like the firmware does
+      last_us = (last_us + last_dt) & 0xFFFFFFFF
+      last_q += tag - TAG_SAME_DT
+      out.append((last_us, json.dumps({"raw": [last_us, round(last_q / VALUE_SCALE, 6)]}, separators=(",", ":"))))
+    elif tag == TAG_SAMPLE:
+      dt, pos = _zigzag(block, pos)
+      dq, pos = _zigzag(block, pos)
+      last_dt = dt
+      last_us = (last_us + dt) & 0xFFFFFFFF
+      last_q += dq
+      out.append((last_us, json.dumps({"raw": [last_us, round(last_q / VALUE_SCALE, 6)]}, separators=(",", ":"))))
+    elif tag & 0xF0 == TAG_GESTURE:
+      dt, pos = _zigzag(block, pos)
+      amount, note = block[pos], block[pos + 1]
+      pos += 2
+      event = {"gesture": GESTURES[tag & 0x0F] if tag & 0x0F < len(GESTURES) else "?", "value": amount}
+      if note != 0xFF:
+        event["note"] = note
+      out.append(((last_us + dt) & 0xFFFFFFFF, json.dumps(event, separators=(",", ":"))))
+    elif tag == TAG_MIDI:
+      dt, pos = _zigzag(block, pos)
+      out.append(((last_us + dt) & 0xFFFFFFFF, json.dumps({"midi": list(block[pos:pos + 3])}, separators=(",", ":"))))
+      pos += 3
+    else:
+      break  # unknown tag: stop rather than guess
+  return out
+
+
+def _lines(path: str) -> Iterable[str]:
+  """JSON lines out of a serial_logger CSV or a plain text log."""
+  with open(path, newline="", encoding="utf-8", errors="replace") as fh:
+    for raw in fh:
+      if raw.startswith("#"):
+        continue
+      if raw.lstrip().startswith("{"):
+        yield raw.strip()
+        continue
+      for row in csv.reader([raw]):
+        if len(row) >= 3 and row[2].strip().startswith("{"):
+          yield row[2].strip()
+
+
+def read_dump(path: str) -> Dict[int, bytes]:
+  blocks: Dict[int, bytes] = {}
+  for line in _lines(path):
+    if not line.startswith('{"rec":['):
+      continue
+    try:
+      seq, text = json.loads(line)["rec"]
+      blocks[int(seq)] = base64.b64decode(text)
+    except (ValueError, KeyError, TypeError):
+      continue  # a torn line from a reconnect; that block is just missing
+  return blocks
+
+
+def main() -> None:
+  parser = argparse.ArgumentParser(description="Decode a flight-recorder dump into a capture CSV.")
+  parser.add_argument("log", help="serial_logger CSV (or plain text log) holding the {\"rec\":...} lines")
+  args = parser.parse_args()
+
+  blocks = read_dump(args.log)
+  if not blocks:
+    raise SystemExit(f"{args.log}: no {{\"rec\":[...]}} lines (send {{\"rec\":\"dump\"}} while logging)")
+  seqs = sorted(blocks)
+  missing = seqs[-1] - seqs[0] + 1 - len(seqs)
+
+  writer = csv.writer(sys.stdout)
+  print(f"# StringField flight recorder, blocks {seqs[0]}..{seqs[-1]} ({missing} missing)")
+  writer.writerow(["timestamp_iso", "elapsed_seconds", "line"])
+  start = None
+  prev_us = None
+  t = 0  # 64-bit time: each record steps by its signed distance from the last
+  records = 0
+  for seq in seqs:
+    try:
+      decoded = decode_block(blocks[seq])
+    except (ValueError, IndexError, struct.error) as exc:
+      print(f"warning: block {seq}: {exc}", file=sys.stderr)
+      continue
+    for us, line in decoded:
+      if prev_us is not None:
+        t += ((us - prev_us + 0x80000000) & 0xFFFFFFFF) - 0x80000000  # survives micros() wrap
+      prev_us = us
+      if start is None:
+        start = t
+      writer.writerow(["", f"{(t - start) / 1e6:.6f}", line])
+      records += 1
+  print(f"{records} records from {len(seqs)} blocks ({missing} overwritten or lost)", file=sys.stderr)
+
+
+if __name__ == "__main__":
+  main()
@@ -0,0 +1,366 @@
+#!/usr/bin/env python3
+"""Train the on-device gesture tree and export it as a C++ header.
+
+INTENT:
+  - Let a class retrain the optional classifier backend (``-D GESTURE_TREE``)
+    on its own players instead of living with thresholds tuned for one hand.
+  - Keep the model tiny and legible: an int8 decision tree, exported as a table
+    students can read next to ``firmware/src/gesture_classifier.cpp``.
+  - Mirror the firmware's feature math exactly (integers after quantization),
+    so what trains here is what runs there.
+
+CAPTURE:
+  1. Flash with ``-D GESTURE_TREE`` and send ``{"raw":true}`` so every sample
+     goes out as ``{"raw":[micros,value]}``.
+  2. Record one take per gesture with ``serial_logger.py`` (consent first):
+       python tools/serial_logger.py /dev/ttyACM0 115200 > vibrato_take1.csv
+  3. Train, naming each take's gesture after a colon:
+       python tools/train_gesture_tree.py vibrato_take1.csv:vibrato \\
+           pluck_take1.csv:pluck bow_take1.csv:bow ...
+
+  Samples whose window never rises above ``--contact`` are labelled idle; the
+  rest take the file's label. ``--synthetic`` swaps the captures for generated
+  strokes so the pipeline can be exercised (and a seed model built) without a
+  board attached.
+
+OUTPUT:
+  firmware/include/gesture_tree_model.h (override with ``--out``).
+"""
+
+from __future__ import annotations
+
+import argparse
+import csv
+import json
+import math
+import os
+import random
+import sys
+from collections import Counter
+from typing import Dict, Iterable, List, Optional, Sequence, Tuple
+
+# Keep in lockstep with firmware/include/gesture_classifier.h.
+WINDOW = 32
+MAX_DEPTH = 8
+FLIP_DEADBAND = 4
+FEATURES = ["value", "mean", "min", "max", "range", "slope", "flips", "span_ms"]
+GESTURES = ["idle", "pluck", "bow", "scrape", "harmonic", "muted", "tremolo", "vibrato"]
+
+Sample = Tuple[int, float]  # (micros, value 0..1)
+
+
+def quantize(v: float) -> int:
+  if not v > 0.0:
+    return 0
+  if v >= 1.0:
+    return 127
+  return int(math.floor(v * 127.0 + 0.5))
+
+
+def clamp_i8(x: int) -> int:
+  return max(-128, min(127, x))
+
+
+class FeatureWindow:
+  """Python twin of GestureClassifier::push/extract."""
+
+  def __init__(self) -> None:
+    self.q: List[int] = []
+    self.t: List[int] = []
+
+  def push(self, micros: int, value: float) -> List[int]:
+    self.q.append(quantize(value))
+    self.t.append(micros & 0xFFFFFFFF)
+    if len(self.q) > WINDOW:
+      self.q.pop(0)
+      self.t.pop(0)
+    return self.extract()
+
+  def extract(self) -> List[int]:
+    q, n = self.q, len(self.q)
+    flips, last_sign = 0, 0
+    for i in range(1, n):
+      d = q[i] - q[i - 1]
+      if d >= FLIP_DEADBAND or d <= -FLIP_DEADBAND:
+        sign = 1 if d > 0 else -1
+        if last_sign != 0 and sign != last_sign:
+          flips += 1
+        last_sign = sign
+    back = WINDOW // 4 if n > WINDOW // 4 else n - 1
+    span_ms = ((self.t[-1] - self.t[0]) & 0xFFFFFFFF) // 1000
+    lo, hi = min(q), max(q)
+    return [
+        q[-1],
+        sum(q) // n,
+        lo,
+        hi,
+        hi - lo,
+        clamp_i8(q[-1] - q[-1 - back]),
+        clamp_i8(flips),
+        min(span_ms, 127),
+    ]
+
+
+# ---- Captures -----------------------------------------------------------------
+
+
+def read_capture(path: str) -> List[Sample]:
+  """Pull ``{"raw":[micros,value]}`` rows out of a serial_logger CSV."""
+  samples: List[Sample] = []
+  with open(path, newline="", encoding="utf-8") as fh:
+    rows = csv.reader(line for line in fh if not line.startswith("#"))
+    for row in rows:
+      if len(row) < 3 or row[0] == "timestamp_iso":
+        continue
+      line = row[2].strip()
+      if not line.startswith("{") or '"raw"' not in line:
+        continue
+      try:
+        micros, value = json.loads(line)["raw"]
+      except (ValueError, KeyError, TypeError):
+        continue  # a torn line from a reconnect; skip it
+      samples.append((int(micros), float(value)))
+  return samples
+
+
+def label_stream(samples: Sequence[Sample], label: int, contact_q: int) -> Tuple[List[List[int]], List[int]]:
+  win = FeatureWindow()
+  xs: List[List[int]] = []
+  ys: List[int] = []
+  for micros, value in samples:
+    f = win.push(micros, value)
+    xs.append(f)
+    ys.append(label if f[FEATURES.index("max")] >= contact_q else 0)
+  return xs, ys
+
+
+# ---- Synthetic strokes (no board needed) ----------------------------------------
+
+
+def synth_take(gesture: str, rng: random.Random, rate_hz: int = 1000, strokes: int = 12) -> List[Sample]:
+  """Rough, noisy caricatures of each gesture at `rate_hz`, separated by rests."""
+  out: List[Sample] = []
+  t = 0
+  dt = 1_000_000 // rate_hz
+
+  def emit(v: float) -> None:
+    nonlocal t
+    out.append((t, min(max(v + rng.gauss(0.0, 0.008), 0.0), 1.0)))
+    t += dt
+
+  for _ in range(strokes):
+    for _ in range(rng.randint(150, 300)):  # rest
+      emit(0.03)
+    if gesture == "pluck":
+      peak = rng.uniform(0.7, 0.98)
+      for i in range(rng.randint(80, 160)):
+        emit(peak * math.exp(-i / rng.uniform(25, 45)))
+    elif gesture == "bow":
+      level = rng.uniform(0.55, 0.85)
+      n = rng.randint(400, 800)
+      for i in range(n):
+        ramp = min(1.0, i / 120.0, (n - i) / 120.0)
+        emit(level * ramp + 0.02 * math.sin(i / 90.0))
+    elif gesture == "scrape":
+      for _ in range(rng.randint(6, 10)):
+        for i in range(rng.randint(20, 35)):
+          emit(0.7 * math.exp(-i / 6.0))
+    elif gesture == "harmonic":
+      level = rng.uniform(0.42, 0.58)
+      n = rng.randint(300, 600)
+      for i in range(n):
+        emit(level * min(1.0, i / 30.0, (n - i) / 30.0))
+    elif gesture == "muted":
+      peak = rng.uniform(0.2, 0.3)
+      for i in range(rng.randint(25, 45)):
+        emit(peak * math.sin(math.pi * i / 45.0))
+    elif gesture in ("tremolo", "vibrato"):
+      level = rng.uniform(0.6, 0.75)
+      depth = rng.uniform(0.04, 0.08) if gesture == "tremolo" else rng.uniform(0.16, 0.3)
+      hz = rng.uniform(10, 16) if gesture == "tremolo" else rng.uniform(5, 8)
+      n = rng.randint(500, 900)
+      for i in range(n):
+        ramp = min(1.0, i / 60.0, (n - i) / 60.0)
+        emit(ramp * (level + 0.5 * depth * math.sin(2 * math.pi * hz * i * dt / 1e6)))
+  return out
+
+
+# ---- CART -----------------------------------------------------------------------
+
+
+class Node:
+  def __init__(self) -> None:
+    self.feature = -1
+    self.threshold = 0
+    self.left: Optional["Node"] = None
+    self.right: Optional["Node"] = None
+    self.label = 0
+    self.confidence = 0.0
+
+
+def gini(counts: Counter, n: int) -> float:
+  return 1.0 - sum((c / n) ** 2 for c in counts.values()) if n else 0.0
+
+
+def best_split(xs: List[List[int]], ys: List[int], idx: List[int], min_leaf: int):
+  parent = Counter(ys[i] for i in idx)
+  best = None  # (impurity, feature, threshold)
+  n = len(idx)
+  for f in range(len(FEATURES)):
+    order = sorted(idx, key=lambda i: xs[i][f])
+    left: Counter = Counter()
+    right = parent.copy()
+    for k in range(n - 1):
+      y = ys[order[k]]
+      left[y] += 1
+      right[y] -= 1
+      v, nxt = xs[order[k]][f], xs[order[k + 1]][f]
+      if v == nxt or k + 1 < min_leaf or n - k - 1 < min_leaf:
+        continue
+      imp = ((k + 1) * gini(left, k + 1) + (n - k - 1) * gini(+right, n - k - 1)) / n
+      if best is None or imp < best[0]:
+        best = (imp, f, v)  # go left when x <= v, matching the firmware
+  return best, gini(parent, n)
+
+
+def grow(xs, ys, idx, depth, max_depth, min_leaf) -> Node:
+  node = Node()
+  counts = Counter(ys[i] for i in idx)
+  node.label, top = counts.most_common(1)[0]
+  node.confidence = top / len(idx)
+  if depth >= max_depth or len(counts) == 1 or len(idx) < 2 * min_leaf:
+    return node
+  split, parent_imp = best_split(xs, ys, idx, min_leaf)
+  if split is None or split[0] >= parent_imp - 1e-9:
+    return node
+  _, f, thr = split
+  node.feature, node.threshold = f, thr
+  node.left = grow(xs, ys, [i for i in idx if xs[i][f] <= thr], depth + 1, max_depth, min_leaf)
+  node.right = grow(xs, ys, [i for i in idx if xs[i][f] > thr], depth + 1, max_depth, min_leaf)
+  return node
+
+
+def flatten(root: Node) -> List[Tuple[int, int, int, int]]:
+  """Preorder table; children always land after their parent."""
+  table: List[List[int]] = []
+
+  def visit(n: Node) -> int:
+    i = len(table)
+    table.append([0, 0, 0, 0])
+    if n.feature < 0:
+      table[i] = [-1, 0, n.label, int(round(n.confidence * 255))]
+    else:
+      left = visit(n.left)
+      right = visit(n.right)
+      table[i] = [n.feature, n.threshold, left, right]
+    return i
+
+  visit(root)
+  return [tuple(r) for r in table]
+
+
+def depth_of(n: Node) -> int:
+  return 0 if n.feature < 0 else 1 + max(depth_of(n.left), depth_of(n.right))
+
+
+def predict(table, f: List[int]) -> int:
+  i = 0
+  while table[i][0] >= 0:
+    feat, thr, left, right = table[i]
+    i = left if f[feat] <= thr else right
+  return table[i][2]
+
+
+def write_header(path: str, table, depth: int, sources: Iterable[str], accuracy: float) -> None:
+  lines = [
+      "#pragma once",
+      "",
+      "// Generated by tools/train_gesture_tree.py — do not edit by hand; retrain instead.",
+      "// Sources: " + ", ".join(sources),
+      f"// Training accuracy: {accuracy * 100:.1f}% over per-sample window labels.",
+      "",
+      '#include "gesture_classifier.h"',
+      "",
+      f"static const uint8_t kGestureTreeModelDepth = {depth};",
+      "",
+      "// {feature, threshold, left, right}; leaves: {-1, 0, gesture, confidence*255}",
+      "static const GestureTreeNode kGestureTreeModel[] = {",
+  ]
+  for i, (f, thr, left, right) in enumerate(table):
+    if f < 0:
+      note = f"leaf {GESTURES[left]}"
+    else:
+      note = f"{FEATURES[f]} <= {thr}"
+    lines.append(f"    {{{f}, {thr}, {left}, {right}}},  // {i}: {note}")
+  lines.append("};")
+  with open(path, "w", encoding="utf-8") as fh:
+    fh.write("\n".join(lines) + "\n")
+
+
+def _build_arg_parser() -> argparse.ArgumentParser:
+  here = os.path.dirname(os.path.abspath(__file__))
+  parser = argparse.ArgumentParser(description="Train the int8 gesture tree from serial_logger captures.")
+  parser.add_argument("takes", nargs="*", metavar="CSV:GESTURE", help=f"capture + its gesture ({', '.join(GESTURES[1:])})")
+  parser.add_argument("--synthetic", action="store_true", help="train on generated strokes instead of captures")
+  parser.add_argument("--seed", type=int, default=7, help="RNG seed for --synthetic")
+  parser.add_argument("--max-depth", type=int, default=6, help=f"tree depth (firmware allows up to {MAX_DEPTH})")
+  parser.add_argument("--min-leaf", type=int, default=20, help="smallest sample count a leaf may hold")
+  parser.add_argument("--contact", type=float, default=0.15, help="window max below this is labelled idle")
+  parser.add_argument("--max-samples", type=int, default=20000, help="subsample to keep training quick")
+  parser.add_argument("--out", default=os.path.join(here, "..", "firmware", "include", "gesture_tree_model.h"))
+  return parser
+
+
+def main() -> None:
+  args = _build_arg_parser().parse_args()
+  if args.max_depth > MAX_DEPTH:
+    raise SystemExit(f"--max-depth must be <= {MAX_DEPTH} (kTreeMaxDepth in the firmware)")
+  contact_q = quantize(args.contact)
+
+  xs: List[List[int]] = []
+  ys: List[int] = []
+  sources: List[str] = []
+  if args.synthetic:
+    rng = random.Random(args.seed)
+    for label, name in enumerate(GESTURES):
+      if label == 0:
+        continue
+      fx, fy = label_stream(synth_take(name, rng), label, contact_q)
+      xs += fx
+      ys += fy
+    sources.append(f"synthetic strokes (seed {args.seed})")
+  for take in args.takes:
+    path, _, name = take.rpartition(":")
+    if not path or name not in GESTURES:
+      raise SystemExit(f"{take}: expected CSV:GESTURE with GESTURE in {GESTURES}")
+    samples = read_capture(path)
+    if not samples:
+      print(f"warning: {path} has no raw samples (send {{\"raw\":true}} before logging)", file=sys.stderr)
+      continue
+    fx, fy = label_stream(samples, GESTURES.index(name), contact_q)
+    xs += fx
+    ys += fy
+    sources.append(f"{os.path.basename(path)}:{name}")
+  if not xs:
+    raise SystemExit("no training data: pass CSV:GESTURE takes or --synthetic")
+
+  idx = list(range(len(xs)))
+  if len(idx) > args.max_samples:
+    idx = sorted(random.Random(args.seed).sample(idx, args.max_samples))
+  root = grow(xs, ys, idx, 0, args.max_depth, args.min_leaf)
+  table = flatten(root)
+  if len(table) > 255:
+    raise SystemExit(f"tree has {len(table)} nodes; lower --max-depth or raise --min-leaf")
+  correct = sum(predict(table, xs[i]) == ys[i] for i in range(len(xs)))
+  accuracy = correct / len(xs)
+  write_header(args.out, table, depth_of(root), sources, accuracy)
+  counts = Counter(ys)
+  print(
+      f"{len(table)} nodes, depth {depth_of(root)}, accuracy {accuracy * 100:.1f}% on {len(xs)} samples "
+      f"({', '.join(f'{GESTURES[k]}={v}' for k, v in sorted(counts.items()))}) → {os.path.normpath(args.out)}",
+      file=sys.stderr,
+  )
+
+
+if __name__ == "__main__":
+  main()